@@ -0,0 +1,206 @@
+/**
+ * @file allocator_churn.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the benchmark measuring the throughput and the resident memory
+ * of the linked allocator under a simulated day of session churn.
+ *
+ * Usage: ./AllocatorChurnBench [operations_per_hour] [number_of_threads]
+ *
+ * Each thread keeps a set of simulated sessions. A session owns a JSON tree, a
+ * queue of packages and a receive buffer, like a WebSocketSession in a game.
+ * The number of live sessions follows a daily curve (a trough at 4:00, a peak
+ * at 20:00) and random sessions are replaced all the time. Each hour of the
+ * day the benchmark prints the throughput and the memory of the process. Build
+ * it with different FUSION_ALLOCATOR values to compare the allocators; the
+ * resident memory after the evening peak shows how well the allocator returns
+ * fragmented memory.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fusion_server/allocator.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/system/package.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This constant contains the maximum number of live sessions of a thread.
+ */
+constexpr std::size_t kMaxSessionsPerThread = 20000;
+
+/**
+ * This structure imitates the memory held by a session.
+ */
+struct Session {
+  /**
+   * This is the state of the player.
+   */
+  json::JSON state_;
+
+  /**
+   * These are the packages waiting to be sent.
+   */
+  std::vector<std::shared_ptr<system::Package>> queue_;
+
+  /**
+   * This is the receive buffer.
+   */
+  std::string buffer_;
+};
+
+/**
+ * This function returns the fraction of the peak load at the given hour.
+ *
+ * @param[in] hour
+ *   The hour of the day (0-23).
+ *
+ * @return
+ *   The load between 0.2 and 1.0 is returned.
+ */
+double GetLoad(std::size_t hour) noexcept {
+  constexpr double kPi = 3.14159265358979323846;
+  return 0.6 - 0.4 * std::cos(2.0 * kPi * (static_cast<double>(hour) - 4.0) / 24.0);
+}
+
+/**
+ * This function performs a single operation on a session: a package is
+ * received, parsed, answered and some of the queued packages are sent.
+ *
+ * @param[in,out] session
+ *   The session.
+ *
+ * @param[in,out] random
+ *   The random number generator of the thread.
+ */
+void Process(Session& session, std::mt19937_64& random) {
+  std::uniform_int_distribution<std::size_t> size_distribution{16, 2048};
+  session.buffer_.assign(size_distribution(random), 'x');
+
+  session.state_["position"] = {random() % 1000, random() % 1000};
+  session.state_["angle"] = static_cast<double>(random() % 360);
+  session.state_["nick"] = session.buffer_.substr(0, 16);
+  auto package = std::make_shared<system::Package>(session.state_.dump());
+  auto parsed = json::Parse(package->begin(), package->end());
+  if (parsed) {
+    session.state_["health"] = (*parsed)["angle"];
+  }
+
+  session.queue_.push_back(std::move(package));
+  if (session.queue_.size() > random() % 8) {
+    session.queue_.erase(session.queue_.begin(),
+      session.queue_.begin() + static_cast<std::ptrdiff_t>(session.queue_.size() / 2));
+  }
+}
+
+/**
+ * This function simulates one hour of a single thread.
+ *
+ * @param[in,out] sessions
+ *   The live sessions of the thread.
+ *
+ * @param[in] target
+ *   The number of live sessions at this hour.
+ *
+ * @param[in] operations
+ *   The number of operations performed during the hour.
+ *
+ * @param[in,out] random
+ *   The random number generator of the thread.
+ */
+void SimulateHour(std::vector<std::unique_ptr<Session>>& sessions, std::size_t target,
+    std::size_t operations, std::mt19937_64& random) {
+  for (std::size_t i = 0; i < operations; i++) {
+    // The number of sessions drifts towards the target, while random sessions
+    // leave and join all the time.
+    if (sessions.size() < target || (random() % 64 == 0 && !sessions.empty())) {
+      if (!sessions.empty() && sessions.size() >= target) {
+        sessions[random() % sessions.size()] = std::make_unique<Session>();
+      } else {
+        sessions.push_back(std::make_unique<Session>());
+      }
+    } else if (sessions.size() > target) {
+      std::swap(sessions[random() % sessions.size()], sessions.back());
+      sessions.pop_back();
+      continue;
+    }
+    Process(*sessions[random() % sessions.size()], random);
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief The benchmark's entry point.
+ *
+ * @param[in] argc
+ *   The amount of command-line arguments.
+ *
+ * @param[in] argv
+ *   The array of command-line arguments.
+ *
+ * @return
+ *   EXIT_SUCCESS is returned.
+ */
+int main(int argc, char** argv) {
+  Allocator::Initialize();
+  std::size_t operations_per_hour = argc > 1 ? std::stoul(argv[1]) : 200000;
+  std::size_t number_of_threads = argc > 2 ? std::stoul(argv[2]) : 4;
+
+  std::vector<std::vector<std::unique_ptr<Session>>> sessions(number_of_threads);
+  std::printf("allocator: %s, threads: %zu, operations per hour and thread: %zu\n",
+    Allocator::GetName(), number_of_threads, operations_per_hour);
+  std::printf("%4s %10s %14s %14s %14s\n", "hour", "sessions", "ops/s",
+    "allocated_MiB", "resident_MiB");
+
+  std::size_t peak_resident = 0;
+  auto day_start = std::chrono::steady_clock::now();
+  for (std::size_t hour = 0; hour < 24; hour++) {
+    auto target = static_cast<std::size_t>(GetLoad(hour) * kMaxSessionsPerThread);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < number_of_threads; i++) {
+      threads.emplace_back([&thread_sessions = sessions[i], target, operations_per_hour,
+          seed = hour * number_of_threads + i] {
+        Allocator::BindThreadArena();
+        std::mt19937_64 random{seed};
+        SimulateHour(thread_sessions, target, operations_per_hour, random);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    auto stats = Allocator::GetStats();
+    peak_resident = std::max(peak_resident, stats.resident_bytes_);
+    std::printf("%4zu %10zu %14.0f %14.1f %14.1f\n", hour, target * number_of_threads,
+      static_cast<double>(operations_per_hour * number_of_threads) / elapsed.count(),
+      static_cast<double>(stats.allocated_bytes_) / (1 << 20),
+      static_cast<double>(stats.resident_bytes_) / (1 << 20));
+  }
+  auto day = std::chrono::duration<double>(std::chrono::steady_clock::now() - day_start);
+
+  auto stats = Allocator::GetStats();
+  std::printf("total throughput:      %.0f ops/s\n",
+    static_cast<double>(24 * operations_per_hour * number_of_threads) / day.count());
+  std::printf("peak resident memory:  %.1f MiB\n", static_cast<double>(peak_resident) / (1 << 20));
+  std::printf("final resident memory: %.1f MiB\n",
+    static_cast<double>(stats.resident_bytes_) / (1 << 20));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file idle_connections.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the benchmark measuring the resident memory of idle WebSocket
+ * connections.
+ *
+ * Usage: ./IdleConnectionsBench [number_of_connections] [port]
+ *
+ * The benchmark starts the server on the loopback interface, opens the given
+ * number of WebSocket connections (100000 by default) from the same process
+ * and leaves them idle. It reports the growth of the resident set size per
+ * connection. The figure includes the client sockets of the benchmark, so it's
+ * an upper bound of the server-side cost.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <fusion_server/server.hpp>
+#include <fusion_server/system/buffer_pool.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This constant contains the number of client connections bound to a single
+ * loopback address. It keeps the benchmark below the ephemeral port limit.
+ */
+constexpr std::size_t kConnectionsPerAddress = 25000;
+
+/**
+ * This constant contains the upgrade request sent by each client.
+ */
+constexpr char kUpgradeRequest[] =
+  "GET / HTTP/1.1\r\n"
+  "Host: localhost\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Sec-WebSocket-Version: 13\r\n"
+  "\r\n";
+
+/**
+ * This function returns the resident set size of this process.
+ *
+ * @return
+ *   The resident set size in bytes is returned.
+ */
+std::size_t GetResidentBytes() noexcept {
+  std::ifstream statm{"/proc/self/statm"};
+  std::size_t size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * This function raises the limit of open descriptors to its hard limit.
+ *
+ * @return
+ *   The new limit is returned.
+ */
+std::size_t RaiseDescriptorLimit() noexcept {
+  rlimit limit{};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  return limit.rlim_cur;
+}
+
+}  // namespace
+
+/**
+ * @brief The benchmark's entry point.
+ *
+ * @param[in] argc
+ *   The amount of command-line arguments.
+ *
+ * @param[in] argv
+ *   The array of command-line arguments.
+ *
+ * @return
+ *   EXIT_SUCCESS is returned, if all connections have been opened.
+ */
+int main(int argc, char** argv) {
+  std::size_t number_of_connections = argc > 1 ? std::stoul(argv[1]) : 100000;
+  std::uint16_t port = argc > 2 ? static_cast<std::uint16_t>(std::stoul(argv[2])) : 8090;
+
+  // Each connection needs a descriptor on both sides.
+  auto limit = RaiseDescriptorLimit();
+  if (limit < 2 * number_of_connections + 64) {
+    std::fprintf(stderr, "The limit of open descriptors (%zu) is too low.\n", limit);
+    return EXIT_FAILURE;
+  }
+
+  Server server;
+  auto config = json::JSON({
+    {"listener", {
+      {"interface", "127.0.0.1"},
+      {"port", port},
+      {"max_queued_connections", 4096},
+    }},
+  }, false, json::JSON::value_t::object);
+  if (!server.Configure(std::move(config)) || !server.StartAccepting()) {
+    return EXIT_FAILURE;
+  }
+  std::thread server_thread{[&server] { server.GetIOContext().run(); }};
+
+  auto resident_before = GetResidentBytes();
+  auto borrowed_before = system::BufferPool::Get().GetBorrowedBytes();
+
+  boost::asio::io_context client_ioc;
+  std::vector<boost::asio::ip::tcp::socket> clients;
+  clients.reserve(number_of_connections);
+  boost::asio::ip::tcp::endpoint server_endpoint{
+    boost::asio::ip::make_address("127.0.0.1"), port};
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < number_of_connections; i++) {
+    auto address = boost::asio::ip::address_v4{static_cast<std::uint32_t>(
+      0x7F000001 + i / kConnectionsPerAddress)};
+    boost::system::error_code ec;
+    auto& client = clients.emplace_back(client_ioc);
+    client.open(boost::asio::ip::tcp::v4(), ec);
+    if (!ec) client.bind({address, 0}, ec);
+    if (!ec) client.connect(server_endpoint, ec);
+    if (!ec) boost::asio::write(client, boost::asio::buffer(kUpgradeRequest,
+      sizeof(kUpgradeRequest) - 1), ec);
+    boost::asio::streambuf response;
+    if (!ec) boost::asio::read_until(client, response, "\r\n\r\n", ec);
+    if (ec) {
+      std::fprintf(stderr, "Connection %zu failed: %s\n", i, ec.message().c_str());
+      server.Shutdown();
+      server_thread.join();
+      return EXIT_FAILURE;
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  // Let the server finish handling the last handshakes.
+  std::this_thread::sleep_for(std::chrono::seconds{1});
+
+  auto resident_after = GetResidentBytes();
+  auto& pool = system::BufferPool::Get();
+  std::printf("connections:              %zu\n", number_of_connections);
+  std::printf("handshakes took:          %lld ms\n",
+    static_cast<long long>(elapsed.count()));
+  std::printf("resident memory growth:   %zu bytes\n", resident_after - resident_before);
+  std::printf("per connection:           %zu bytes\n",
+    (resident_after - resident_before) / number_of_connections);
+  std::printf("pool bytes borrowed:      %zu bytes\n",
+    pool.GetBorrowedBytes() - borrowed_before);
+  std::printf("pool bytes retained:      %zu bytes\n", pool.GetRetainedBytes());
+
+  server.Shutdown();
+  server_thread.join();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file memory_pipeline.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the benchmark measuring the throughput of the session pipeline
+ * without the kernel's network stack.
+ *
+ * Usage: ./MemoryPipelineBench [number_of_clients] [packages_per_client]
+ *
+ * Each client is connected to the server by an in-memory stream (see
+ * system::MemoryStream). It upgrades the connection, joins its own game and
+ * sends the given number of UPDATE packages, followed by an invalid package.
+ * The server reads, verifies and dispatches all of them and closes the session
+ * after the invalid one, so the time until the close measures the whole
+ * read -> verify -> dispatch -> write pipeline of a shard.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <fusion_server/http_session.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/system/memory_stream.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This constant contains the UPDATE package sent by the clients.
+ */
+constexpr char kUpdatePackage[] = R"({"type":"update","direction":12,"angle":67.8})";
+
+/**
+ * This function runs a single client.
+ *
+ * @param[in] shard
+ *   The shard running the server's end of the stream.
+ *
+ * @param[in] id
+ *   The identifier of the client. It's used in the name of its game.
+ *
+ * @param[in] number_of_packages
+ *   The number of UPDATE packages sent by the client.
+ *
+ * @param[in,out] failures
+ *   The counter of failed clients.
+ */
+void RunClient(Shard& shard, std::size_t id, std::size_t number_of_packages,
+    std::atomic<std::size_t>& failures) {
+  boost::asio::io_context client_ioc;
+  auto [server_stream, client_stream] = system::MemoryStream::MakePair(
+    shard.GetIOContext(), client_ioc);
+  boost::asio::post(shard.GetIOContext(), [&shard, stream = std::move(server_stream)]() mutable {
+    std::make_shared<BasicHTTPSession<system::MemoryStream>>(std::move(stream), shard)->Run();
+  });
+
+  boost::beast::websocket::stream<system::MemoryStream> websocket{std::move(client_stream)};
+  boost::beast::flat_buffer buffer;
+  boost::system::error_code ec;
+  websocket.handshake("localhost", "/", ec);
+  if (!ec) {
+    websocket.write(boost::asio::buffer("{\"type\":\"join\",\"game\":\"bench-" +
+      std::to_string(id) + "\",\"nick\":\"client\"}"), ec);
+  }
+  if (!ec) {
+    websocket.read(buffer, ec);
+  }
+  if (ec) {
+    failures++;
+    return;
+  }
+
+  for (std::size_t i = 0; i < number_of_packages && !ec; i++) {
+    websocket.write(boost::asio::buffer(kUpdatePackage, sizeof(kUpdatePackage) - 1), ec);
+  }
+  websocket.write(boost::asio::buffer(std::string{"{}"}), ec);
+  // The server closes the session after the invalid package. The states
+  // broadcast by the game in the meantime are skipped.
+  while (!ec) {
+    buffer.consume(buffer.size());
+    websocket.read(buffer, ec);
+  }
+  if (ec != boost::beast::websocket::error::closed) {
+    failures++;
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief The benchmark's entry point.
+ *
+ * @param[in] argc
+ *   The amount of command-line arguments.
+ *
+ * @param[in] argv
+ *   The array of command-line arguments.
+ *
+ * @return
+ *   EXIT_SUCCESS is returned, if all clients have finished successfully.
+ */
+int main(int argc, char** argv) {
+  std::size_t number_of_clients = argc > 1 ? std::stoul(argv[1]) : 8;
+  std::size_t packages_per_client = argc > 2 ? std::stoul(argv[2]) : 100000;
+
+  // The listener is configured, but it doesn't accept any connections.
+  Server server;
+  auto config = json::JSON({
+    {"listener", {
+      {"interface", "127.0.0.1"},
+      {"port", 8090u},
+      {"max_queued_connections", 16},
+    }},
+  }, false, json::JSON::value_t::object);
+  if (!server.Configure(std::move(config))) {
+    return EXIT_FAILURE;
+  }
+  auto& shard = server.GetShard(0);
+  shard.StartTicking();
+  std::thread server_thread{[&shard] { shard.Run(); }};
+
+  std::atomic<std::size_t> failures = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> clients;
+  for (std::size_t i = 0; i < number_of_clients; i++) {
+    clients.emplace_back(RunClient, std::ref(shard), i, packages_per_client,
+      std::ref(failures));
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  std::printf("clients:              %zu\n", number_of_clients);
+  std::printf("packages per client:  %zu\n", packages_per_client);
+  std::printf("failed clients:       %zu\n", failures.load());
+  std::printf("elapsed:              %.3f s\n", elapsed.count());
+  std::printf("throughput:           %.0f packages/s\n",
+    static_cast<double>(number_of_clients * packages_per_client) / elapsed.count());
+
+  server.Shutdown();
+  server_thread.join();
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
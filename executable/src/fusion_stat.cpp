@@ -0,0 +1,96 @@
+/**
+ * @file fusion_stat.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the fusion-stat tool, which prints the
+ * metrics published by a server to its metrics segment.
+ *
+ * Usage: ./fusion-stat /path/to/segment [interval_ms]
+ *
+ * If the interval is given, the metrics are printed repeatedly.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <fusion_server/metrics_segment.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This function prints the given metrics to the standard output.
+ *
+ * @param[in] snapshot
+ *   The printed metrics.
+ */
+void Print(const MetricsSegment::Snapshot& snapshot) noexcept {
+  std::printf("pid %llu  published_at_ms %llu  connections %llu  load_score %llu  ready %s\n",
+    static_cast<unsigned long long>(snapshot.pid_),
+    static_cast<unsigned long long>(snapshot.published_at_ms_),
+    static_cast<unsigned long long>(snapshot.connections_),
+    static_cast<unsigned long long>(snapshot.load_score_),
+    snapshot.ready_ != 0 ? "yes" : "no");
+  std::printf("%5s %8s %6s %12s %12s %12s %8s %8s\n", "shard", "players", "games",
+    "tick_us", "slip_us", "lag_us", "queued", "level");
+  for (std::size_t i = 0; i < snapshot.number_of_shards_ &&
+       i < MetricsSegment::kMaxShards; i++) {
+    const auto& shard = snapshot.shards_[i];
+    std::printf("%5zu %8llu %6llu %12llu %12llu %12llu %8llu %8llu\n", i,
+      static_cast<unsigned long long>(shard.players_),
+      static_cast<unsigned long long>(shard.games_),
+      static_cast<unsigned long long>(shard.tick_time_us_),
+      static_cast<unsigned long long>(shard.tick_slip_us_),
+      static_cast<unsigned long long>(shard.loop_lag_us_),
+      static_cast<unsigned long long>(shard.queued_packages_),
+      static_cast<unsigned long long>(shard.overload_level_));
+  }
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+/**
+ * @brief The tool's entry point.
+ *
+ * @param[in] argc
+ *   The amount of command-line arguments.
+ *
+ * @param[in] argv
+ *   The array of command-line arguments.
+ *
+ * @return
+ *   EXIT_SUCCESS is returned, if the metrics have been read.
+ */
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    std::fprintf(stderr, "Usage: ./fusion-stat /path/to/segment [interval_ms]\n");
+    return EXIT_FAILURE;
+  }
+  auto interval = std::chrono::milliseconds{argc == 3 ? std::stoul(argv[2]) : 0};
+
+  auto segment = MetricsSegment::Open(argv[1]);
+  if (segment == nullptr) {
+    std::fprintf(stderr, "%s is not a metrics segment.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  MetricsSegment::Snapshot snapshot;
+  do {
+    if (!segment->Read(snapshot)) {
+      std::fprintf(stderr, "Cannot read a consistent snapshot.\n");
+      return EXIT_FAILURE;
+    }
+    Print(snapshot);
+    std::this_thread::sleep_for(interval);
+  } while (interval.count() != 0);
+
+  return EXIT_SUCCESS;
+}
@@ -19,6 +19,7 @@
 
 #include <boost/asio.hpp>
 
+#include <fusion_server/allocator.hpp>
 #include <fusion_server/server.hpp>
 #include <fusion_server/json.hpp>
 #include <fusion_server/system/package.hpp>
@@ -30,8 +31,8 @@ using namespace fusion_server;
  * @brief Asynchronous signal handler.
  * This function used as the asynchronous signal handler.
  *
- * @param ioc
- *   The I/O context used in the program.
+ * @param server
+ *   The server run by the program.
  *
  * @param ec
  *   The Boost's error code that indicates whether or not an error occurred.
@@ -39,9 +40,8 @@ using namespace fusion_server;
  * @param signal
  *   The signal code of the received signal.
  */
-void HandleSignal(boost::asio::io_context& ioc,
+void HandleSignal(Server& server,
   const boost::system::error_code& ec, int signal) noexcept {
-  auto& server = Server::GetInstance();
   auto logger = server.GetLogger();
   if (ec) {
     logger->error("An error occurred during signal handling. [Boost: {}]",
@@ -50,7 +50,7 @@ void HandleSignal(boost::asio::io_context& ioc,
   logger->warn("Received a signal ({}). Stopping the I/O context.",
     strsignal(signal));
 
-  ioc.stop();
+  server.GetIOContext().stop();
   server.Shutdown();
 }
 
@@ -98,6 +98,7 @@ std::optional<json::JSON> ReadConfig(const char* file_name) noexcept {
  *   An error number.
  */
 int main(int argc, char** argv) {
+  Allocator::Initialize();
   if (argc != 2) {
     LoggerManager::Get()->error("Usage: ./FusionServer /path/to/config");
     return EXIT_FAILURE;
@@ -110,7 +111,7 @@ int main(int argc, char** argv) {
   }
 
   std::size_t number_of_workers = std::thread::hardware_concurrency() - 1;
-  auto& server = Server::GetInstance();
+  Server server;
 
   if (!config.value().contains("number_of_additional_threads")) {
     server.GetLogger()->critical("[Config] Field \"number_of_additional_threads\" is required.");
@@ -137,18 +138,24 @@ int main(int argc, char** argv) {
   auto& ioc = server.GetIOContext();
   boost::asio::signal_set signals{ioc, SIGINT, SIGTERM};
   signals.async_wait(
-    [&ioc] (const boost::system::error_code& ec, int signal) {
-      HandleSignal(ioc, ec, signal);
+    [&server] (const boost::system::error_code& ec, int signal) {
+      HandleSignal(server, ec, signal);
     }
   );
   server.GetLogger()->info("Registered the signal handler.");
 
   std::vector<std::thread> workers;
-  workers.reserve(number_of_workers);
+  workers.reserve(number_of_workers + server.GetNumberOfShards() - 1);
   for (std::size_t i = 0; i < number_of_workers; i++)
     workers.emplace_back([&ioc]{ ioc.run(); });
   server.GetLogger()->info("Created {} threads.", number_of_workers);
 
+  // Each additional shard is run by its own thread.
+  for (std::size_t i = 1; i < server.GetNumberOfShards(); i++) {
+    workers.emplace_back([&shard = server.GetShard(i)]{ shard.Run(); });
+  }
+  server.GetLogger()->info("Started {} shards.", server.GetNumberOfShards());
+
   ioc.run();
 
   server.GetLogger()->info("No more tasks. Waiting for threads to join.");
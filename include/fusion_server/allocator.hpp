@@ -0,0 +1,78 @@
+/**
+ * @file allocator.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the Allocator class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+namespace fusion_server {
+
+/**
+ * This class gives access to the general-purpose allocator linked to the
+ * server. The allocator is chosen by the FUSION_ALLOCATOR CMake option:
+ * - "system" - the allocator of the C library,
+ * - "jemalloc" - jemalloc with an arena per shard and transparent huge pages,
+ * - "mimalloc" - mimalloc with large OS pages (its heaps are per thread).
+ */
+class Allocator {
+ public:
+  /**
+   * This structure holds the statistics of the allocator. A value, which is
+   * not reported by the allocator, is 0.
+   */
+  struct Stats {
+    /**
+     * This is the number of bytes allocated by the application.
+     */
+    std::size_t allocated_bytes_;
+
+    /**
+     * This is the number of bytes obtained from the system by the allocator.
+     */
+    std::size_t committed_bytes_;
+
+    /**
+     * This is the resident set size of the process.
+     */
+    std::size_t resident_bytes_;
+  };
+
+  /**
+   * @brief Returns the name of the allocator.
+   *
+   * @return
+   *   The name of the linked allocator is returned.
+   */
+  static const char* GetName() noexcept;
+
+  /**
+   * @brief Initializes the allocator.
+   * This function applies the options of the allocator, which cannot be set
+   * at the link time. It should be called once at the program start.
+   */
+  static void Initialize() noexcept;
+
+  /**
+   * @brief Binds the calling thread to its own arena.
+   * Shard threads call this function, so the allocations of different shards
+   * don't contend and don't fragment each other's memory. If the allocator
+   * manages its arenas per thread by itself, the function does nothing.
+   */
+  static void BindThreadArena() noexcept;
+
+  /**
+   * @brief Returns the statistics of the allocator.
+   *
+   * @return
+   *   The current statistics of the allocator are returned.
+   */
+  static Stats GetStats() noexcept;
+};
+
+}  // namespace fusion_server
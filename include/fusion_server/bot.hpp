@@ -0,0 +1,167 @@
+/**
+ * @file bot.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the Bot class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fusion_server/ui/abstract.hpp>
+#include <fusion_server/ui/map.hpp>
+#include <fusion_server/websocket_session.hpp>
+
+namespace fusion_server {
+
+/**
+ * This class represents a bot player. A bot is a session without a stream: it
+ * joins a game through the same path as the clients (a "JOIN" package
+ * dispatched by the server), but it produces its inputs in-process and nothing
+ * is written to it (see WebSocketSession::IsBot()). The bots are driven by
+ * BotPool.
+ */
+class Bot final : public WebSocketSession {
+ public:
+  /**
+   * This constant contains the maximum change of the angle in a single input,
+   * in degrees.
+   */
+  static constexpr double kMaxTurn = 15.0;
+
+  /**
+   * This constant contains the number of random cells drawn, while the bot
+   * looks for a walkable cell.
+   */
+  static constexpr std::size_t kMaxCellDraws = 8;
+
+  /**
+   * This constructor registers the bot on the given shard.
+   *
+   * @param[in] shard
+   *   The shard on which the bot is registered.
+   *
+   * @param[in] seed
+   *   The seed of the bot's random inputs.
+   */
+  Bot(Shard& shard, std::uint64_t seed) noexcept;
+
+  /**
+   * @brief Joins a game.
+   * This method dispatches a "JOIN" package, so the game is created and placed
+   * like for a client.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] nick
+   *   The nick of the bot.
+   *
+   * @return
+   *   An indication whether or not the bot has joined the game is returned.
+   */
+  bool Join(const std::string& game_name, const std::string& nick) noexcept;
+
+  /**
+   * @brief Produces the next input.
+   * If the game has a map, the bot walks along a path to a random destination
+   * found by Game::FindPath(), one cell per input. Otherwise, or if no path
+   * has been found, the bot turns by a random angle. The input is applied to
+   * its game.
+   *
+   * @note
+   *   The calls of this method must be serialized (see BotPool).
+   */
+  void Think() noexcept;
+
+  [[nodiscard]] bool IsBot() const noexcept override;
+
+ private:
+  void StartWait() noexcept override;
+
+  bool CancelWait() noexcept override;
+
+  void DoRead() noexcept override;
+
+  void StartWrite(const system::Package& package) noexcept override;
+
+  void WriteNow(const system::Package& package, boost::system::error_code& ec) noexcept override;
+
+  void StartPing() noexcept override;
+
+  void CloseStream(boost::system::error_code& ec) noexcept override;
+
+  void SetCork(bool enabled) noexcept override;
+
+  bool MoveStream(Shard& target) noexcept override;
+
+  [[nodiscard]] bool IsOpen() const noexcept override;
+
+  /**
+   * This method moves the bot by one cell along its path and turns it towards
+   * the cell. A new path is requested, once the destination has been reached.
+   *
+   * @param[in] game
+   *   The game of the bot.
+   *
+   * @return
+   *   An indication whether or not the bot has moved is returned.
+   */
+  bool FollowPath(Game& game) noexcept;
+
+  /**
+   * This method draws a random walkable cell of the map, which is not the
+   * current cell of the bot.
+   *
+   * @param[in] map
+   *   The map of the game.
+   *
+   * @param[out] cell
+   *   The drawn cell.
+   *
+   * @return
+   *   An indication whether or not a cell has been drawn is returned.
+   */
+  bool DrawCell(const ui::Map& map, ui::Point& cell) noexcept;
+
+  /**
+   * This is the generator of the bot's inputs.
+   */
+  std::minstd_rand engine_;
+
+  /**
+   * This is the cell of the map on which the bot is. It's not walkable until
+   * the bot has been placed on a map.
+   */
+  ui::Point cell_;
+
+  /**
+   * This is the path the bot walks along. The memory is reused by the queries.
+   */
+  std::vector<ui::Point> path_;
+
+  /**
+   * This is the index of the next turning point of the path.
+   */
+  std::size_t waypoint_;
+
+  /**
+   * This is the current angle of the bot's avatar.
+   */
+  double angle_;
+
+  /**
+   * This indicates whether or not the bot has been closed.
+   */
+  std::atomic<bool> closed_;
+};
+
+}  // namespace fusion_server
@@ -0,0 +1,188 @@
+/**
+ * @file bot_pool.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the BotPool class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <fusion_server/bot.hpp>
+#include <fusion_server/game.hpp>
+
+namespace fusion_server {
+
+/**
+ * This is the forward declaration of the Server class.
+ */
+class Server;
+
+/**
+ * This class owns the bots of a server and runs them on a compute pool. The
+ * pool has its own threads, so the bots don't take time from the shards.
+ * Each tick interval the bots are split into one chunk per thread and each
+ * chunk produces the inputs of its bots.
+ */
+class BotPool {
+ public:
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of the thread pool.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  BotPool(const BotPool& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of the thread pool.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  BotPool& operator=(const BotPool& other) = delete;
+
+  /**
+   * This constructor starts the threads of the compute pool.
+   *
+   * @param[in] server
+   *   The server, in which the bots play.
+   *
+   * @param[in] number_of_threads
+   *   The number of threads of the compute pool. It must be positive.
+   */
+  BotPool(Server& server, std::size_t number_of_threads) noexcept;
+
+  /**
+   * This destructor removes all bots and joins the threads.
+   */
+  ~BotPool() noexcept;
+
+  /**
+   * This constant contains the maximum number of bots added by a single call
+   * to Spawn. It's the number of seats of a game.
+   */
+  static constexpr std::size_t kMaxSpawnCount = 2 * Game::kMaxPlayersPerTeam;
+
+  /**
+   * @brief Adds bots to a game.
+   * This method creates the given number of bots and joins them to the game.
+   * The game is created, if it doesn't exist.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] count
+   *   The number of bots to be added.
+   *
+   * @return
+   *   The number of bots, which have joined the game, is returned. It's lower
+   *   than the requested number, if the game has become full.
+   *
+   * @note
+   *   At most kMaxSpawnCount bots are added.
+   */
+  std::size_t Spawn(const std::string& game_name, std::size_t count) noexcept;
+
+  /**
+   * @brief Removes all bots.
+   * The bots leave their games. Empty games are removed.
+   */
+  void Clear() noexcept;
+
+  /**
+   * @brief Stops the bots.
+   * This method removes all bots and joins the threads of the compute pool.
+   */
+  void Stop() noexcept;
+
+  /**
+   * @brief Returns the number of bots.
+   *
+   * @return
+   *   The number of bots playing in the games is returned.
+   */
+  [[nodiscard]] std::size_t GetNumberOfBots() const noexcept;
+
+ private:
+  /**
+   * This is the type of the list of bots shared with the chunks of a tick.
+   */
+  using Bots_t = std::vector<std::shared_ptr<Bot>>;
+
+  /**
+   * This method schedules the next tick.
+   */
+  void ScheduleTick() noexcept;
+
+  /**
+   * This method posts one chunk of bots per thread to the compute pool.
+   */
+  void Tick() noexcept;
+
+  /**
+   * This is the server, in which the bots play.
+   */
+  Server& server_;
+
+  /**
+   * This is the number of threads of the compute pool.
+   */
+  std::size_t number_of_threads_;
+
+  /**
+   * This is the compute pool.
+   */
+  boost::asio::thread_pool pool_;
+
+  /**
+   * This strand serializes the scheduling of the ticks.
+   */
+  boost::asio::strand<boost::asio::thread_pool::executor_type> strand_;
+
+  /**
+   * This timer schedules the ticks. It runs on the strand.
+   */
+  boost::asio::steady_timer timer_;
+
+  /**
+   * This is the current list of bots. It's replaced, not modified, so a tick
+   * takes a reference to it without copying the bots. It's guarded by the
+   * bots' mutex.
+   */
+  std::shared_ptr<const Bots_t> bots_;
+
+  /**
+   * This is the mutex guarding the list of bots.
+   */
+  mutable std::mutex bots_mtx_;
+
+  /**
+   * This is the seed of the next bot.
+   */
+  std::uint64_t next_seed_;
+
+  /**
+   * This indicates whether or not the pool has been stopped.
+   */
+  std::atomic<bool> stopped_;
+};
+
+}  // namespace fusion_server
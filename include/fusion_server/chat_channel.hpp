@@ -0,0 +1,237 @@
+/**
+ * @file chat_channel.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the ChatChannel class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fusion_server/json.hpp>
+#include <fusion_server/system/package.hpp>
+#include <fusion_server/system/rate_limiter.hpp>
+#include <fusion_server/system/ring_buffer.hpp>
+
+namespace fusion_server {
+
+/**
+ * This class represents the chat of a game. It limits the rate of messages of
+ * each sender, collects the messages posted during a tick, so they can be sent
+ * as one frame per recipient, and keeps the recent messages for late joiners.
+ *
+ * @note
+ *   This class is not thread-safe.
+ */
+class ChatChannel {
+ public:
+  /**
+   * This is the clock used to limit the rate of messages.
+   */
+  using Clock = system::RateLimiter::Clock;
+
+  /**
+   * This enum contains the audiences of a chat message.
+   */
+  enum class Scope {
+    /**
+     * This indicates that a message is visible to all players in the game.
+     */
+    kAll,
+
+    /**
+     * This indicates that a message is visible only to the sender's team.
+     */
+    kTeam,
+  };
+
+  /**
+   * This enum contains the results of posting a message.
+   */
+  enum class PostResult {
+    /**
+     * This indicates that the message has been accepted.
+     */
+    kAccepted,
+
+    /**
+     * This indicates that the sender has exceeded its rate limit.
+     */
+    kRateLimited,
+
+    /**
+     * This indicates that the message was either empty or too long.
+     */
+    kNotValid,
+  };
+
+  /**
+   * This structure represents a single chat message.
+   */
+  struct Line {
+    /**
+     * This is the id of the sender.
+     */
+    std::size_t player_id_{};
+
+    /**
+     * This is the id of the sender's team.
+     */
+    std::size_t team_id_{};
+
+    /**
+     * This is the sender's nick.
+     */
+    std::string nick_;
+
+    /**
+     * This is the content of the message.
+     */
+    std::string message_;
+
+    /**
+     * This is the audience of the message.
+     */
+    Scope scope_{Scope::kAll};
+
+    /**
+     * @brief Serializes this object.
+     * This method serializes this object into a JSON object.
+     *
+     * @return
+     *   This object serialized into a JSON object.
+     */
+    [[nodiscard]] json::JSON Serialize() const noexcept;
+
+    /**
+     * @brief Checks if the message is visible to a team.
+     *
+     * @param[in] team_id
+     *   The id of the team.
+     *
+     * @return
+     *   An indication whether or not the message is visible to the given team
+     *   is returned.
+     */
+    [[nodiscard]] bool IsVisibleTo(std::size_t team_id) const noexcept;
+  };
+
+  /**
+   * @brief Posts a message.
+   * This method checks the sender's rate limit and the message itself. If both
+   * are fine, the message is queued until the next flush and saved in the
+   * history.
+   *
+   * @param[in] line
+   *   The message to be posted.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   The result of posting is returned.
+   */
+  PostResult Post(Line line, Clock::time_point now = Clock::now()) noexcept;
+
+  /**
+   * @brief Forgets a sender.
+   * This method removes the rate limit state of the given player. It should be
+   * called when the player leaves the game.
+   *
+   * @param[in] player_id
+   *   The id of the player.
+   */
+  void Forget(std::size_t player_id) noexcept;
+
+  /**
+   * @brief Checks if there are queued messages.
+   *
+   * @return
+   *   An indication whether or not any message has been posted since the last
+   *   flush is returned.
+   */
+  [[nodiscard]] bool HasPending() const noexcept;
+
+  /**
+   * @brief Creates a frame for a team.
+   * This method creates a single package containing all queued messages
+   * visible to the given team.
+   *
+   * @param[in] team_id
+   *   The id of the team.
+   *
+   * @return
+   *   The package is returned. If no queued message is visible to the team,
+   *   nullptr is returned.
+   */
+  [[nodiscard]] std::shared_ptr<system::Package>
+  MakeFrame(std::size_t team_id) const noexcept;
+
+  /**
+   * @brief Drops the queued messages.
+   * This method removes all queued messages. It should be called after the
+   * frames have been created.
+   */
+  void ClearPending() noexcept;
+
+  /**
+   * @brief Returns the history.
+   * This method returns the recent messages visible to the given team, oldest
+   * first.
+   *
+   * @param[in] team_id
+   *   The id of the team.
+   *
+   * @return
+   *   A JSON array of the recent messages is returned.
+   */
+  [[nodiscard]] json::JSON GetHistory(std::size_t team_id) const noexcept;
+
+  /**
+   * This constant contains the number of messages kept for late joiners.
+   */
+  static constexpr std::size_t kHistorySize = 32;
+
+  /**
+   * This constant contains the number of messages a player can post at once.
+   */
+  static constexpr std::size_t kBurst = 5;
+
+  /**
+   * This constant contains the time after which a player can post one more
+   * message.
+   */
+  static constexpr Clock::duration kRefillPeriod = std::chrono::seconds{1};
+
+  /**
+   * This constant contains the maximum length of a message in bytes.
+   */
+  static constexpr std::size_t kMaxMessageLength = 256;
+
+ private:
+  /**
+   * This vector holds the messages posted since the last flush.
+   */
+  std::vector<Line> pending_;
+
+  /**
+   * This buffer holds the recent messages.
+   */
+  system::RingBuffer<Line, kHistorySize> history_;
+
+  /**
+   * This map associates the players' ids with their rate limits.
+   */
+  std::map<std::size_t, system::RateLimiter> limiters_;
+};
+
+}  // namespace fusion_server
@@ -0,0 +1,193 @@
+/**
+ * @file frame_dictionary.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the FrameDictionary class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <fusion_server/system/package.hpp>
+
+/**
+ * This is the forward declaration of zstd's prepared compression dictionary.
+ */
+struct ZSTD_CDict_s;
+
+namespace fusion_server {
+
+/**
+ * This class holds a zstd dictionary trained from recorded game frames. Frames
+ * sent to the game clients are small and alike, so deflate barely shrinks
+ * them, while a dictionary holding their common parts does.
+ *
+ * The dictionary is versioned by its zstd dictionary ID. A client downloads it
+ * from the "/dictionary" endpoint and offers its ID in the kCompressionField
+ * header of the upgrade request. If the ID matches, the server confirms it with
+ * the same header and sends all packages of the connection as binary frames,
+ * each compressed with the dictionary. Otherwise the packages are sent as
+ * plain text frames.
+ *
+ * @note
+ *   The dictionary is available only if the server is built with the
+ *   FUSION_ZSTD option.
+ */
+class FrameDictionary {
+ public:
+  /**
+   * This constant contains the name of the header negotiating the compression.
+   * Its value is "zstd; dict=<ID>".
+   */
+  static constexpr char kCompressionField[] = "X-Fusion-Compression";
+
+  /**
+   * This constant contains the default compression level.
+   */
+  static constexpr int kDefaultLevel = 3;
+
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of the prepared dictionary.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  FrameDictionary(const FrameDictionary& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of the prepared dictionary.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  FrameDictionary& operator=(const FrameDictionary& other) = delete;
+
+  /**
+   * @brief Loads a dictionary.
+   * This function reads the dictionary from the given file (e.g. created by
+   * "zstd --train") and prepares it for the compression.
+   *
+   * @param[in] path
+   *   The path of the dictionary file.
+   *
+   * @param[in] level
+   *   The compression level.
+   *
+   * @return
+   *   The loaded dictionary is returned. If the file cannot be read, it's not
+   *   a zstd dictionary with an ID or the server has been built without zstd,
+   *   nullptr is returned.
+   */
+  static std::shared_ptr<const FrameDictionary>
+  Load(const std::string& path, int level = kDefaultLevel) noexcept;
+
+  /**
+   * @brief Parses a compression offer.
+   *
+   * @param[in] offer
+   *   The value of the kCompressionField header sent by a client.
+   *
+   * @return
+   *   The ID of the offered dictionary is returned. If the value is not
+   *   a valid offer, an empty optional is returned.
+   */
+  static std::optional<std::uint32_t> ParseOffer(std::string_view offer) noexcept;
+
+  /**
+   * This destructor frees the prepared dictionary.
+   */
+  ~FrameDictionary() noexcept;
+
+  /**
+   * @brief Returns the version.
+   *
+   * @return
+   *   The zstd ID of this dictionary is returned.
+   */
+  [[nodiscard]] std::uint32_t GetVersion() const noexcept;
+
+  /**
+   * @brief Returns the value of the kCompressionField header.
+   *
+   * @return
+   *   The value confirming the compression with this dictionary is returned.
+   */
+  [[nodiscard]] std::string GetToken() const noexcept;
+
+  /**
+   * @brief Returns the content.
+   *
+   * @return
+   *   The content of the dictionary file, as served to the clients, is
+   *   returned.
+   */
+  [[nodiscard]] const std::string& GetContent() const noexcept;
+
+  /**
+   * @brief Compresses a package.
+   * Each package is compressed into a separate zstd frame, so a client can
+   * decompress it on its own.
+   *
+   * @param[in] package
+   *   The package to be compressed.
+   *
+   * @param[out] out
+   *   The compressed package. Its allocation is reused.
+   *
+   * @return
+   *   An indication whether or not the package has been compressed is returned.
+   *
+   * @note
+   *   This method is thread-safe. Each thread uses its own compression
+   *   context.
+   */
+  bool Compress(const system::Package& package, std::string& out) const noexcept;
+
+ private:
+  /**
+   * This constructor takes the ownership of the prepared dictionary.
+   *
+   * @param[in] content
+   *   The content of the dictionary file.
+   *
+   * @param[in] version
+   *   The zstd ID of the dictionary.
+   *
+   * @param[in] prepared
+   *   The dictionary prepared for the compression.
+   */
+  FrameDictionary(std::string content, std::uint32_t version,
+    ZSTD_CDict_s* prepared) noexcept;
+
+  /**
+   * This is the content of the dictionary file.
+   */
+  std::string content_;
+
+  /**
+   * This is the zstd ID of the dictionary.
+   */
+  std::uint32_t version_;
+
+  /**
+   * This is the dictionary prepared for the compression. It's read-only, so
+   * it's shared by all threads.
+   */
+  ZSTD_CDict_s* prepared_;
+};
+
+}  // namespace fusion_server
@@ -9,10 +9,13 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <map>
@@ -21,9 +24,12 @@
 #include <tuple>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include <fusion_server/chat_channel.hpp>
 #include <fusion_server/json.hpp>
 #include <fusion_server/logger_manager.hpp>
+#include <fusion_server/ui/map.hpp>
 #include <fusion_server/ui/player.hpp>
 #include <fusion_server/ui/player_factory.hpp>
 #include <fusion_server/system/package.hpp>
@@ -35,6 +41,11 @@ namespace fusion_server {
  */
 class WebSocketSession;
 
+/**
+ * This is the forward declaration of the Shard class.
+ */
+class Shard;
+
 /**
  * This class represents a game. It creates a common context for all joined
  * clients.
@@ -64,8 +75,7 @@ class Game {
   /**
    * This is the return type of the Join method.
    */
-  using join_result_t =
-  std::optional<std::tuple<system::IncomingPackageDelegate&, json::JSON, std::size_t>>;
+  using join_result_t = std::optional<std::tuple<json::JSON, std::size_t>>;
 
   /**
    * @brief Explicitly deleted copy constructor.
@@ -89,9 +99,12 @@ class Game {
   Game& operator=(const Game& other) noexcept = delete;
 
   /**
-   * This constructor creates the asynchronous reading delegate.
+   * This constructor places the game on the given shard.
+   *
+   * @param[in] shard
+   *   The shard on which this game is placed.
    */
-  Game() noexcept;
+  explicit Game(Shard& shard) noexcept;
 
   /**
    * @brief Sets the logger of this instance.
@@ -112,11 +125,111 @@ class Game {
    */
   LoggerManager::Logger GetLogger() const noexcept;
 
+  /**
+   * @brief Returns the owning shard.
+   * This method returns the shard on which this game is placed. All sessions
+   * of this game are moved to this shard.
+   *
+   * @return
+   *   A reference to the shard on which this game is placed is returned.
+   */
+  [[nodiscard]] Shard& GetShard() const noexcept;
+
+  /**
+   * @brief Moves this game to another shard.
+   * This method pauses the game at a tick boundary, places it on the given
+   * shard and requests all sessions of the game to follow it. A session moves
+   * after its current read has completed.
+   *
+   * @param[in] target
+   *   The shard to which the game is moved.
+   *
+   * @note
+   *   The caller is responsible for removing the game from the ticked games of
+   *   the old shard and adding it to the new one.
+   */
+  void MoveTo(Shard& target) noexcept;
+
+  /**
+   * @brief Freezes this game for an export.
+   * This method pauses the game at a tick boundary and returns its snapshot.
+   * Each player gets a random token, which lets the client resume the player
+   * on the node receiving the game. A frozen game doesn't tick and doesn't
+   * accept new players, inputs or chat messages, so nothing changes after the
+   * snapshot has been taken.
+   *
+   * @return
+   *   The snapshot of this game is returned. If the game has already been
+   *   frozen, the returned object is in its invalid state.
+   */
+  [[nodiscard]] std::optional<json::JSON> Freeze() noexcept;
+
+  /**
+   * @brief Unfreezes this game.
+   * This method is called when an export has failed. The game ticks and
+   * accepts new players, inputs and chat messages again. The tokens are
+   * discarded.
+   */
+  void Unfreeze() noexcept;
+
+  /**
+   * @brief Redirects all clients of a frozen game.
+   * This method sends a "REDIRECT" package with the client's token to each
+   * client of this game and closes its session. The game is removed by the
+   * server, when the last session has been unregistered.
+   *
+   * @param[in] address
+   *   The address of the node, which has received this game.
+   */
+  void Redirect(const std::string& address) noexcept;
+
+  /**
+   * @brief Restores the players of an exported game.
+   * This method reserves a seat for each player of the given snapshot. A
+   * reservation can be taken by Resume() until kReservationTimeout passes.
+   *
+   * @param[in] snapshot
+   *   The snapshot created by Freeze().
+   *
+   * @return
+   *   An indication, whether or not the snapshot was valid is returned. If it
+   *   was not, no seats are reserved.
+   */
+  bool Restore(const json::JSON& snapshot) noexcept;
+
+  /**
+   * @brief Resumes a reserved player.
+   * This method joins the client to this game as the player reserved with the
+   * given token. The result has the same meaning as the one of Join().
+   *
+   * @param[in] session
+   *   This is the WebSocket session connected to a client.
+   *
+   * @param[in] token
+   *   The token received in a "REDIRECT" package.
+   *
+   * @return
+   *   If the token was valid and has not expired, the join result is returned,
+   *   otherwise the returned object is in its invalid state.
+   */
+  [[nodiscard]] join_result_t
+  Resume(WebSocketSession* session, const std::string& token) noexcept;
+
+  /**
+   * @brief Returns the number of reserved seats.
+   * This method returns the number of seats reserved for the players of an
+   * imported game, which have not been resumed and have not expired.
+   *
+   * @return
+   *   The number of reserved seats is returned.
+   */
+  std::size_t GetReservationsCount() const noexcept;
+
   /**
    * This method joins the client to this game and adds its session to the
-   * proper team. If the joining was successful it returns a pair of a new
-   * incoming package delegate and a JSON object containing information about
-   * the current state of the game, otherwise the returned object is in its
+   * proper team. If the joining was successful it returns a pair of a JSON
+   * object containing information about the current state of the game and the
+   * identifier of the new player, otherwise the returned object is in its
    * invalid state.
    *
    * @param[in] session
@@ -131,9 +244,10 @@ class Game {
    *   team.
    *
    * @return
-   *   If the joining was successful pair of a new incoming package delegate
-   *   and a JSON object containing information about the current state of the
-   *   game is returned, otherwise the returned object is in its invalid state.
+   *   If the joining was successful pair of a JSON object containing
+   *   information about the current state of the game and the identifier of
+   *   the new player is returned, otherwise the returned object is in its
+   *   invalid state.
    *
    * @note
    *   If a client has already joined to this game, the method does nothing and
@@ -158,6 +272,117 @@ class Game {
    */
   bool Leave(WebSocketSession *session) noexcept;
 
+  /**
+   * This method handles an "UPDATE" package of a player.
+   *
+   * @param[in] session
+   *   The WebSocket session connected to the client.
+   *
+   * @param[in] request
+   *   The verified package.
+   */
+  void HandleUpdate(WebSocketSession* session, const json::JSON& request) noexcept;
+
+  /**
+   * This method applies an input of a player. It's used by the "UPDATE"
+   * packages and by the bots, which produce their inputs in-process. The
+   * inputs of a frozen game are dropped.
+   *
+   * @param[in] session
+   *   The session of the player.
+   *
+   * @param[in] angle
+   *   The new angle of the player's avatar.
+   *
+   * @param[in] seq
+   *   The sequence number of the input, if it has one. An input, which is not
+   *   newer than the last accepted input of the player, is dropped.
+   */
+  void ApplyInput(WebSocketSession* session, double angle,
+    std::optional<std::uint64_t> seq = std::nullopt) noexcept;
+
+  /**
+   * @brief Sets the map of this game.
+   * The map is shared with the other games, so its navigation data is
+   * computed only once.
+   *
+   * @param[in] map
+   *   The map.
+   *
+   * @note
+   *   This method must be called before the game is shared.
+   */
+  void SetMap(std::shared_ptr<const ui::Map> map) noexcept;
+
+  /**
+   * This method returns the map of this game.
+   *
+   * @return
+   *   The map of this game is returned. If no map has been set, nullptr is
+   *   returned.
+   */
+  [[nodiscard]] std::shared_ptr<const ui::Map> GetMap() const noexcept;
+
+  /**
+   * @brief Finds a path on the map of this game.
+   * At most kMaxPathQueriesPerTick queries are answered per tick and each of
+   * them expands at most kMaxPathExpansions cells, so the server-side players
+   * cannot delay the tick. A rejected query is reported as over budget and may
+   * be repeated in the next tick.
+   *
+   * @param[in] from
+   *   The starting cell.
+   *
+   * @param[in] to
+   *   The destination cell.
+   *
+   * @param[out] path
+   *   The found path (see ui::Map::FindPath()).
+   *
+   * @return
+   *   The result of the query is returned. If the game has no map, the
+   *   destination is unreachable.
+   */
+  ui::Map::PathStatus FindPath(ui::Point from, ui::Point to,
+    std::vector<ui::Point>& path) noexcept;
+
+  /**
+   * This method handles a "CHAT" package of a player. If the message is
+   * rejected (also, if the game is frozen), a warning is sent to the client.
+   *
+   * @param[in] session
+   *   The WebSocket session connected to the client.
+   *
+   * @param[in] request
+   *   The verified package.
+   */
+  void HandleChat(WebSocketSession* session, const json::JSON& request) noexcept;
+
+  /**
+   * This method handles a "LEAVE" package of a player. The session leaves
+   * this game and is registered again as a session, which has not joined any
+   * game.
+   *
+   * @param[in] session
+   *   The WebSocket session connected to the client.
+   *
+   * @param[in] request
+   *   The verified package.
+   */
+  void HandleLeave(WebSocketSession* session, const json::JSON& request) noexcept;
+
+  /**
+   * This method handles a package, which is not expected from a player. A
+   * warning is sent to the client.
+   *
+   * @param[in] session
+   *   The WebSocket session connected to the client.
+   *
+   * @param[in] request
+   *   The verified package.
+   */
+  void HandleUnidentified(WebSocketSession* session, const json::JSON& request) noexcept;
+
   /**
    * This method broadcasts the given package to all clients connected to this
    * game.
@@ -167,6 +392,37 @@ class Game {
    */
   void BroadcastPackage(const std::shared_ptr<system::Package>& package) noexcept;
 
+  /**
+   * @brief Checks if a tick should be skipped.
+   * Under overload the shard ticks the games, which have been idle since their
+   * last tick, less often. This method returns whether the current tick of
+   * this game should be skipped.
+   *
+   * @param[in] idle_tick_divisor
+   *   The number of tick intervals between two ticks of an idle game.
+   *
+   * @return
+   *   True is returned if the game has received no package since its last tick
+   *   and fewer than `idle_tick_divisor - 1` of its ticks have been skipped.
+   *
+   * @note
+   *   This method is intended to be called only by the shard's thread.
+   */
+  bool SkipTick(std::size_t idle_tick_divisor) noexcept;
+
+  /**
+   * @brief Advances the game by one tick.
+   * This method performs all the work batched during the last tick. It sends
+   * the current state, if any player has changed since the last tick, and the
+   * chat messages posted since the last tick as one frame per recipient.
+   * Under overload both are sent only every few ticks (see
+   * OverloadController::GetUpdateDivisor()).
+   *
+   * @note
+   *   This method is indented to be called periodically by the server.
+   */
+  void Tick() noexcept;
+
   /**
    * This method returns the amount of players in this game.
    *
@@ -181,6 +437,23 @@ class Game {
    */
   static constexpr size_t kMaxPlayersPerTeam = 5;
 
+  /**
+   * This constant contains the time during which a seat reserved for a player
+   * of an imported game can be resumed.
+   */
+  static constexpr std::chrono::seconds kReservationTimeout{30};
+
+  /**
+   * This constant contains the number of path queries answered per tick.
+   */
+  static constexpr std::size_t kMaxPathQueriesPerTick = 16;
+
+  /**
+   * This constant contains the maximum number of cells expanded by a single
+   * path query.
+   */
+  static constexpr std::size_t kMaxPathExpansions = 2048;
+
  private:
   /**
    * This method returns an indication whether or not the client identified by
@@ -195,6 +468,19 @@ class Game {
    */
   bool IsInGame(WebSocketSession *session) const noexcept;
 
+  /**
+   * This method returns the player controlled by the client identified by the
+   * given session.
+   *
+   * @param[in] session
+   *   The WebSocketSession connected to the client.
+   *
+   * @return
+   *   The player controlled by the client is returned. If the client has not
+   *   joined to this game, nullptr is returned.
+   */
+  std::shared_ptr<ui::Player> GetPlayer(WebSocketSession *session) const noexcept;
+
   /**
    * This method returns a JSON object containing an encoded current state of this
    * game.
@@ -206,17 +492,42 @@ class Game {
   json::JSON GetCurrentState() const noexcept;
 
   /**
-   * This method preparis a response for the given request and either sends it
-   * or broadcasts it.
+   * @brief Sends the current state to all players.
+   * This method writes a STATE package to each session of this game. Each
+   * session decides, based on its link, whether it sends the full or the
+   * reduced form and how often (see WebSocketSession::WriteState()).
+   */
+  void BroadcastState() noexcept;
+
+  /**
+   * This method completes a successful join of a player assigned to the given
+   * team.
    *
    * @param[in] session
-   *   The WebSocket session connected to the client.
+   *   This is the WebSocket session connected to a client.
    *
-   * @param[in] request
-   *   This is a client's request.
+   * @param[in] team
+   *   This is the team to which the player has been assigned.
+   *
+   * @param[in] player_id
+   *   This is the id of the player.
+   *
+   * @return
+   *   The result of the successful join is returned.
    */
-  void
-  DoResponse(WebSocketSession* session, const json::JSON& request) noexcept;
+  join_result_t FinishJoin(WebSocketSession* session, Team team,
+    std::size_t player_id) noexcept;
+
+  /**
+   * This method returns the number of seats reserved in the given team.
+   *
+   * @param[in] team
+   *   The team identifier.
+   *
+   * @return
+   *   The number of seats reserved in the given team is returned.
+   */
+  std::size_t GetReservedSeats(Team team) const noexcept;
 
   /**
    * This set contains the pairs of WebSocket sessions and their roles in the
@@ -256,16 +567,107 @@ class Game {
   mutable std::shared_mutex players_cache_mtx_;
 
   /**
-   * This callable object is used as a callback to the asynchronous reading of
-   * all clients in this game.
+   * This is the chat of this game.
    */
-  system::IncomingPackageDelegate delegate_;
+  ChatChannel chat_;
+
+  /**
+   * This mutex is used to synchronise all operations done on the chat.
+   */
+  mutable std::mutex chat_mtx_;
+
+  /**
+   * This is the shard on which this game is placed.
+   */
+  std::atomic<Shard*> shard_;
+
+  /**
+   * This mutex is held during a tick. Moving and freezing the game take it to
+   * wait for the tick boundary.
+   */
+  std::mutex tick_mtx_;
+
+  /**
+   * This mutex is held shared while an input or a chat message is applied.
+   * Freezing the game takes it exclusively, so no input is applied after the
+   * snapshot has been taken.
+   */
+  std::shared_mutex input_mtx_;
+
+  /**
+   * This is the number of ticks of this game. It's guarded by the tick mutex.
+   */
+  std::size_t ticks_;
+
+  /**
+   * This is the number of packages received since the last tick.
+   */
+  std::atomic<std::size_t> activity_;
+
+  /**
+   * This flag indicates whether or not any player has changed since the last
+   * STATE package.
+   */
+  std::atomic<bool> state_changed_;
+
+  /**
+   * This is the number of consecutive skipped ticks.
+   */
+  std::size_t skipped_ticks_;
+
+  /**
+   * This flag indicates whether or not this game has been frozen for an
+   * export.
+   */
+  std::atomic<bool> frozen_;
+
+  /**
+   * This map associates sessions of a frozen game with their tokens.
+   */
+  std::map<WebSocketSession*, std::string> export_tokens_;
+
+  /**
+   * This structure represents a seat reserved for a player of an imported
+   * game.
+   */
+  struct Reservation {
+    /**
+     * This is the restored player.
+     */
+    std::shared_ptr<ui::Player> player_;
+
+    /**
+     * This is the point in time after which the reservation expires.
+     */
+    std::chrono::steady_clock::time_point deadline_;
+  };
+
+  /**
+   * This map associates tokens with the reserved seats.
+   */
+  std::map<std::string, Reservation> reservations_;
+
+  /**
+   * This mutex is used to synchronise the access to the export tokens and the
+   * reservations.
+   */
+  mutable std::mutex migration_mtx_;
 
   /**
    * This is the factory which is used to create new player in this game.
    */
   ui::PlayerFactory player_factory_;
 
+  /**
+   * This is the map of this game. It's shared with the other games.
+   */
+  std::shared_ptr<const ui::Map> map_;
+
+  /**
+   * This is the number of path queries answered since the last tick.
+   */
+  std::atomic<std::size_t> path_queries_;
+
   /**
    * @brief Game's logger.
    * This is a pointer to the logger used in Game class.
@@ -0,0 +1,302 @@
+/**
+ * @file game_transfer.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the GameExporter and GameImportListener classes.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include <fusion_server/json.hpp>
+#include <fusion_server/logger_manager.hpp>
+
+namespace fusion_server {
+
+/**
+ * This is the forward declaration of the Game class.
+ */
+class Game;
+
+/**
+ * This is the forward declaration of the Shard class.
+ */
+class Shard;
+
+/**
+ * This class transfers a game to another server process on the same node.
+ * The game is frozen, its snapshot is sent as a single line of JSON over a
+ * Unix domain socket and, once the other process has accepted it, all clients
+ * are redirected to the other process. If the transfer fails, the game is
+ * unfrozen and continues on this server.
+ */
+class GameExporter : public std::enable_shared_from_this<GameExporter> {
+ public:
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of boost::asio's socket.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  GameExporter(const GameExporter& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of boost::asio's socket.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  GameExporter& operator=(const GameExporter& other) = delete;
+
+  /**
+   * @brief Constructs an exporter.
+   *
+   * @param[in] ioc
+   *   The I/O context used in all asynchronous operations.
+   *
+   * @param[in] game_name
+   *   The name of the exported game.
+   *
+   * @param[in] game
+   *   The exported game.
+   */
+  GameExporter(boost::asio::io_context& ioc, std::string game_name,
+    std::shared_ptr<Game> game) noexcept;
+
+  /**
+   * @brief Sets the logger of this instance.
+   * This method sets the logger of this instance to the given one.
+   *
+   * @param logger [in]
+   *   The given logger.
+   */
+  void SetLogger(LoggerManager::Logger logger) noexcept;
+
+  /**
+   * @brief Returns this instance's logger.
+   * This method returns the logger of this instance.
+   *
+   * @return
+   *   The logger of this instance is returned. If the logger has not been set
+   *   this method returns std::nullptr.
+   */
+  [[nodiscard]] LoggerManager::Logger GetLogger() const noexcept;
+
+  /**
+   * @brief Starts the transfer.
+   * This method freezes the game and starts connecting to the given socket.
+   *
+   * @param[in] socket_path
+   *   The path of the Unix domain socket of the receiving process.
+   *
+   * @return
+   *   An indication, whether or not the transfer has started is returned. It
+   *   doesn't start if the game is already being exported.
+   */
+  bool Run(const std::string& socket_path) noexcept;
+
+ private:
+  /**
+   * This is the callback to the asynchronous connect.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleConnect(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This is the callback to the asynchronous write of the snapshot.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleWrite(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This is the callback to the asynchronous read of the reply.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleRead(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This method unfreezes the game after a failed transfer.
+   */
+  void Abort() noexcept;
+
+  /**
+   * This is the socket connected to the receiving process.
+   */
+  boost::asio::local::stream_protocol::socket socket_;
+
+  /**
+   * This holds the request sent to the receiving process.
+   */
+  std::string request_;
+
+  /**
+   * This buffer holds the reply of the receiving process.
+   */
+  boost::asio::streambuf buffer_;
+
+  /**
+   * This is the name of the exported game.
+   */
+  std::string game_name_;
+
+  /**
+   * This is the exported game.
+   */
+  std::shared_ptr<Game> game_;
+
+  /**
+   * @brief Exporter's logger.
+   * This is a pointer to the logger used in GameExporter class.
+   */
+  LoggerManager::Logger logger_;
+};
+
+/**
+ * This class accepts games transferred by GameExporter objects of other server
+ * processes. Each accepted game is imported into the server and the exporting
+ * process gets the address to which its clients should be redirected.
+ */
+class GameImportListener
+  : public std::enable_shared_from_this<GameImportListener> {
+ public:
+  /**
+   * This structure holds the configuration of an instance of
+   * GameImportListener class.
+   */
+  struct Configuration {
+    /**
+     * This is the path of the Unix domain socket on which games are accepted.
+     */
+    std::string socket_path_;
+
+    /**
+     * This is the address sent to the redirected clients.
+     */
+    std::string address_;
+  };
+
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of boost::asio's acceptor.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  GameImportListener(const GameImportListener& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of boost::asio's acceptor.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  GameImportListener& operator=(const GameImportListener& other) = delete;
+
+  /**
+   * @brief Sets the shard of the listener.
+   * The I/O context of the shard is used in all asynchronous operations and
+   * the accepted games are imported into the server of the shard.
+   *
+   * @param shard [in]
+   *   Reference to the shard accepting the games.
+   */
+  explicit GameImportListener(Shard& shard) noexcept;
+
+  /**
+   * @brief Configures the listener.
+   * This method configures the listener using the given JSON object.
+   *
+   * @param config
+   *   A JSON object containing the strings "socket" and "address".
+   *
+   * @return
+   *   An indication of whether or not the operation was successful is returned.
+   */
+  bool Configure(const json::JSON& config) noexcept;
+
+  /**
+   * @brief Sets the logger of this instance.
+   * This method sets the logger of this instance to the given one.
+   *
+   * @param logger [in]
+   *   The given logger.
+   */
+  void SetLogger(LoggerManager::Logger logger) noexcept;
+
+  /**
+   * @brief Returns this instance's logger.
+   * This method returns the logger of this instance.
+   *
+   * @return
+   *   The logger of this instance is returned. If the logger has not been set
+   *   this method returns std::nullptr.
+   */
+  [[nodiscard]] LoggerManager::Logger GetLogger() const noexcept;
+
+  /**
+   * This method binds the socket and starts the asynchronous accepting loop.
+   * A stale socket file left by a previous process is removed.
+   *
+   * @return
+   *   An indication whether or not the operation was successful is returned.
+   */
+  bool Run() noexcept;
+
+ private:
+  /**
+   * This is the callback to asynchronous accept of a new connection.
+   *
+   * @param ec [in]
+   *   The Boost error code.
+   */
+  void HandleAccept(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This is the shard accepting the games.
+   */
+  Shard& shard_;
+
+  /**
+   * This acceptor accepts connections of the exporting processes.
+   */
+  boost::asio::local::stream_protocol::acceptor acceptor_;
+
+  /**
+   * This socket holds a newly accepted connection.
+   */
+  boost::asio::local::stream_protocol::socket socket_;
+
+  /**
+   * This holds the configuration of this object.
+   */
+  Configuration configuration_;
+
+  /**
+   * @brief Listener's logger.
+   * This is a pointer to the logger used in GameImportListener class.
+   */
+  LoggerManager::Logger logger_;
+};
+
+}  // namespace fusion_server
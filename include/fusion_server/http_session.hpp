@@ -12,18 +12,33 @@
 #include <cstdlib>
 
 #include <memory>
+#include <optional>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <fusion_server/json.hpp>
 #include <fusion_server/logger_manager.hpp>
+#include <fusion_server/system/buffer_pool.hpp>
+#include <fusion_server/system/memory_stream.hpp>
 
 namespace fusion_server {
 
+/**
+ * This is the forward declaration of the Shard class.
+ */
+class Shard;
+
 /**
  * This class represents the HTTP session between a client and the server.
+ *
+ * @tparam NextLayer
+ *   The type of the stream connected to the client. The server uses
+ *   boost::asio::ip::tcp::socket (see HTTPSession); system::MemoryStream is
+ *   used to run sessions without sockets in the tests and the benchmarks.
  */
-class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
+template <typename NextLayer>
+class BasicHTTPSession : public std::enable_shared_from_this<BasicHTTPSession<NextLayer>> {
  public:
   /**
    * This is the type of a HTTP request used in this class.
@@ -35,6 +50,18 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    */
   using Response_t = boost::beast::http::response<boost::beast::http::string_body>;
 
+  /**
+   * This constant contains the maximum size of a request header. Clients
+   * exceeding it are disconnected.
+   */
+  static constexpr std::size_t kMaxHeaderSize = 8 * 1024;
+
+  /**
+   * This constant contains the name of the header carrying the load score of
+   * the server in responses to the health probes.
+   */
+  static constexpr char kLoadScoreField[] = "X-Load-Score";
+
   /**
    * @brief Explicitly deleted copy constructor.
    * It's deleted due to presence of boost::asio's socket.
@@ -42,7 +69,7 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    * @param[in] other
    *   Copied object.
    */
-  HTTPSession(const HTTPSession& other) = delete;
+  BasicHTTPSession(const BasicHTTPSession& other) = delete;
 
   /**
    * @brief Explicitly deleted move constructor.
@@ -52,7 +79,7 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    * @param[in] other
    *   Moved object.
    */
-  HTTPSession(HTTPSession&& other) = delete;
+  BasicHTTPSession(BasicHTTPSession&& other) = delete;
 
   /**
    * @brief Explicitly deleted copy operator.
@@ -64,7 +91,7 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    * @return
    *   Reference to `this` object.
    */
-  HTTPSession& operator=(const HTTPSession& other) = delete;
+  BasicHTTPSession& operator=(const BasicHTTPSession& other) = delete;
 
   /**
    * @brief Explicitly deleted move operator.
@@ -77,18 +104,21 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    * @return
    *   Reference to `this` object.
    */
-  HTTPSession& operator=(HTTPSession&& other) = delete;
+  BasicHTTPSession& operator=(BasicHTTPSession&& other) = delete;
 
   /**
-   * This constructor takes the ownership of the socket connected to a client.
+   * This constructor takes the ownership of the stream connected to a client.
    *
-   * @param[in] socket
-   *   @brief A socket connected to a client.
-   *   If the socket is not connected or is not in "ready" state, the behaviour
+   * @param[in] stream
+   *   @brief A stream connected to a client.
+   *   If the stream is not connected or is not in "ready" state, the behaviour
    *   is undefined.
    *
+   * @param[in] shard
+   *   The shard running the I/O context of the stream. The requests are
+   *   answered using its server and an upgraded session is registered on it.
    */
-  explicit HTTPSession(boost::asio::ip::tcp::socket socket) noexcept;
+  BasicHTTPSession(NextLayer stream, Shard& shard) noexcept;
 
   /**
    * @brief Sets the logger of this instance.
@@ -136,6 +166,20 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    */
   explicit operator bool() const noexcept;
 
+  /**
+   * @brief The callback to asynchronous reading of a request header.
+   * This method appends the received bytes to the buffer. Once the buffer
+   * holds the whole header, the header is handled. Otherwise the reading
+   * continues.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   *
+   * @param[in] bytes_transmitted
+   *   This is the amount of transmitted bytes.
+   */
+  void HandleReadSome(const boost::system::error_code& ec, std::size_t bytes_transmitted) noexcept;
+
   /**
    * This method is the callback to asynchronous reading from the client.
    * After parsing the request it performs asynchronous responding.
@@ -166,6 +210,23 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
   void HandleWrite(const boost::system::error_code& ec, std::size_t bytes_transmitted, bool close) noexcept;
 
  private:
+  /**
+   * This method starts asynchronous reading of the next request header.
+   */
+  void DoRead() noexcept;
+
+  /**
+   * @brief Handles a request header.
+   * This method parses the header stored at the beginning of the buffer. If
+   * the request is a WebSocket upgrade, both the socket and the buffer
+   * (including any bytes the client has sent after the header) are handed over
+   * to a new WebSocketSession. Otherwise the rest of the request is read.
+   *
+   * @param[in] header_size
+   *   This is the size of the header, including the terminating empty line.
+   */
+  void HandleHeader(std::size_t header_size) noexcept;
+
   /**
    * This method calls asynchronous writing to the client.
    *
@@ -186,6 +247,113 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
    */
   Response_t MakeResponse() const noexcept;
 
+  /**
+   * @brief Constructs a response to an administrative request.
+   * This method handles the requests to the "/admin/" targets. They are
+   * accepted only from the loopback interface.
+   *
+   * Supported requests:
+   * - `POST /admin/migrate` with a JSON body `{"game": name, "shard": id}`
+   *   moves the game to another shard of this server.
+   * - `POST /admin/migrate` with a JSON body `{"game": name, "socket": path}`
+   *   transfers the game to the server process listening on the given Unix
+   *   domain socket.
+   * - `GET /admin/perf` and `POST /admin/perf` (see MakePerfResponse()).
+   * - `GET /admin/allocator` returns the statistics of the allocator (see
+   *   Allocator) and of the buffer pool.
+   * - `GET`, `POST` and `DELETE /admin/bots` (see MakeBotsResponse()).
+   *
+   * `GET /admin/profile` is answered asynchronously (see DoProfile()).
+   *
+   * @return
+   *   A HTTP response to the stored administrative request.
+   */
+  Response_t MakeAdminResponse() const noexcept;
+
+  /**
+   * @brief Constructs a response to a "/admin/perf" request.
+   * `GET` returns the hardware performance counters aggregated per subsystem
+   * (see PerfCounters). `POST` with a JSON body `{"enabled": bool}` enables
+   * or disables the sampling first; enabling fails with 409, if the counters
+   * are not available.
+   *
+   * @return
+   *   A HTTP response to the stored request.
+   */
+  Response_t MakePerfResponse() const noexcept;
+
+  /**
+   * @brief Constructs a response to a "/admin/bots" request.
+   * `GET` returns the number of server-side bots (see BotPool). `POST` with a
+   * JSON body `{"game": name, "count": n}` adds the bots to the game first and
+   * reports how many of them have joined. `DELETE` removes all bots. All
+   * methods fail with 409, if the bots are not configured.
+   *
+   * @return
+   *   A HTTP response to the stored request.
+   */
+  Response_t MakeBotsResponse() const noexcept;
+
+  /**
+   * @brief Handles a "/admin/profile" request.
+   * This method starts the sampling profiler (see Profiler) and responds with
+   * the collected pprof profile after the requested time. The duration is
+   * given in seconds by the "seconds" query parameter (10 by default, at most
+   * Profiler::kMaxDuration). Meanwhile the session reads no other requests.
+   * If another profile is being collected, the response is 409.
+   */
+  void DoProfile() noexcept;
+
+  /**
+   * @brief Checks if the client may use the administrative targets.
+   *
+   * @return
+   *   An indication whether or not the client is connected from the loopback
+   *   interface is returned.
+   */
+  bool IsAdminClient() const noexcept;
+
+  /**
+   * @brief Constructs a response to a health probe.
+   * This method handles the requests to the "/healthz" and "/readyz" targets.
+   * The former succeeds as long as the process is able to respond. The latter
+   * fails with 503, if the server is not ready for new players (see
+   * Server::IsReady()). Both carry the load score of the server in the
+   * kLoadScoreField header.
+   *
+   * @return
+   *   A HTTP response to the stored health probe.
+   */
+  Response_t MakeProbeResponse() const noexcept;
+
+  /**
+   * @brief Constructs a response carrying the frame dictionary.
+   * This method handles the requests to the "/dictionary" target. The
+   * response carries the current dictionary, its version in the ETag header
+   * and the value, which the client offers in its upgrade request, in the
+   * FrameDictionary::kCompressionField header.
+   *
+   * @return
+   *   A HTTP response with the dictionary. If the compression is not
+   *   configured, 404 is returned.
+   */
+  Response_t MakeDictionaryResponse() const noexcept;
+
+  /**
+   * @brief Constructs a response with a JSON body.
+   *
+   * @param[in] status
+   *   The status of the response.
+   *
+   * @param[in] body
+   *   The body of the response.
+   *
+   * @return
+   *   A HTTP response with the given status and body is returned.
+   */
+  Response_t MakeJSONResponse(boost::beast::http::status status,
+    const json::JSON& body) const noexcept;
+
   /**
    * @brief Constructs a "Bad Request" (400) response.
    * This method returns a HTTP response with the status code set to 400.
@@ -232,9 +400,14 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
   inline bool IsTooLargeRequestError(const boost::system::error_code& ec) const noexcept;
 
   /**
-   * This is the socket connected to the client.
+   * This is the stream connected to the client.
    */
-  boost::asio::ip::tcp::socket socket_;
+  NextLayer stream_;
+
+  /**
+   * This is the shard running the I/O context of the stream.
+   */
+  Shard& shard_;
 
   /**
    * This is the strand for this instance of the HTTPSession class.
@@ -242,9 +415,16 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
   boost::asio::strand<boost::asio::io_context::executor_type> strand_;
 
   /**
-   * This is the buffer used to store the client's requests.
+   * This is the buffer used to store the client's requests. Its memory is
+   * borrowed from the buffer pool.
+   */
+  system::PooledFlatBuffer buffer_;
+
+  /**
+   * This is the parser of the request being currently read. It's constructed
+   * anew for each request.
    */
-  boost::beast::flat_buffer buffer_;
+  std::optional<boost::beast::http::request_parser<boost::beast::http::string_body>> parser_;
 
   /**
    * This holds the parsed client's request.
@@ -258,4 +438,12 @@ class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
   LoggerManager::Logger logger_;
 };
 
+/**
+ * This is the HTTP session used by the server.
+ */
+using HTTPSession = BasicHTTPSession<boost::asio::ip::tcp::socket>;
+
+extern template class BasicHTTPSession<boost::asio::ip::tcp::socket>;
+extern template class BasicHTTPSession<system::MemoryStream>;
+
 }  // namespace fusion_server
@@ -9,6 +9,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstdlib>
+
 #include <optional>
 #include <string>
 
@@ -50,6 +53,54 @@ std::optional<JSON> Parse(It1&& it1, It2&& it2) noexcept {
   }
 }
 
+/**
+ * This constant contains the maximum number of inputs in a single "BATCH"
+ * package.
+ */
+constexpr std::size_t kMaxBatchSize = 32;
+
+/**
+ * This enumeration identifies the types of the packages sent by clients.
+ */
+enum class PackageType : std::uint8_t {
+  /**
+   * This identifies a "JOIN" package.
+   */
+  kJoin,
+
+  /**
+   * This identifies an "UPDATE" package.
+   */
+  kUpdate,
+
+  /**
+   * This identifies a "BATCH" package.
+   */
+  kBatch,
+
+  /**
+   * This identifies a "LEAVE" package.
+   */
+  kLeave,
+
+  /**
+   * This identifies a "CHAT" package.
+   */
+  kChat,
+};
+
+/**
+ * This constant contains the number of the package types.
+ */
+constexpr std::size_t kNumberOfPackageTypes = 5;
+
+/**
+ * This constant contains the number of bytes, which should be reserved after
+ * a package passed to Verify(). If the capacity of the string holds the
+ * padding, the package is parsed in place, otherwise it's copied first.
+ */
+constexpr std::size_t kPackagePadding = 64;
+
 /**
  * This function returns a pair of an indication whether or not the verification
  * was successful and a JSON object which is either a parsed package or
@@ -58,6 +109,16 @@ std::optional<JSON> Parse(It1&& it1, It2&& it2) noexcept {
  * @param[in] raw_package
  *   The raw package read from a client.
  *
+ * @note
+ *   A "BATCH" package is verified as a whole. If any of its inputs is not
+ *   valid, the whole package is rejected.
+ *
+ * @note
+ *   If the server is built with the FUSION_SIMDJSON option, a package is first
+ *   read by simdjson's on-demand parser. Only if it cannot be proven valid
+ *   this way, it's parsed again by nlohmann's parser, which produces the error
+ *   message.
+ *
  * @return
  *   A pair of an indication whether or not the verification was successful
  *   and a JSON object which is either a parsed package or an error message is
@@ -66,4 +127,18 @@ std::optional<JSON> Parse(It1&& it1, It2&& it2) noexcept {
 std::pair<bool, JSON>
 Verify(const std::string& raw_package) noexcept;
 
+/**
+ * This function returns the type of the given package. It's meant to be called
+ * once per package, after the verification, so the dispatch doesn't compare
+ * the "type" field again.
+ *
+ * @param[in] package
+ *   The package.
+ *
+ * @return
+ *   The type of the package is returned. If the package has no "type" field
+ *   or its type is unknown, an empty optional is returned.
+ */
+std::optional<PackageType> GetPackageType(const JSON& package) noexcept;
+
 }  // namespace fusion_server::json
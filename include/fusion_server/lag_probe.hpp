@@ -0,0 +1,113 @@
+/**
+ * @file lag_probe.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the LagProbe class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+
+#include <boost/asio.hpp>
+
+namespace fusion_server {
+
+/**
+ * This class measures the lag of an I/O context. It periodically schedules a
+ * timer, which does nothing, and measures how late its handler is dispatched.
+ * A saturated I/O context dispatches the handler late.
+ */
+class LagProbe {
+ public:
+  /**
+   * This constant contains the interval between two probes.
+   */
+  static constexpr std::chrono::milliseconds kProbeInterval{100};
+
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of boost::asio's timer.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  LagProbe(const LagProbe& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of boost::asio's timer.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  LagProbe& operator=(const LagProbe& other) = delete;
+
+  /**
+   * @brief Constructs a probe.
+   *
+   * @param[in] ioc
+   *   The probed I/O context.
+   */
+  explicit LagProbe(boost::asio::io_context& ioc) noexcept;
+
+  /**
+   * @brief Starts probing.
+   *
+   * @note
+   *   This method is indented to be called only once.
+   */
+  void Start() noexcept;
+
+  /**
+   * @brief Stops probing.
+   */
+  void Stop() noexcept;
+
+  /**
+   * @brief Returns the lag.
+   *
+   * @return
+   *   The exponential moving average of the dispatch delay is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::chrono::microseconds GetLag() const noexcept;
+
+ private:
+  /**
+   * This method schedules the next probe.
+   */
+  void Schedule() noexcept;
+
+  /**
+   * This method is the callback to the probe timer. It records the delay of
+   * its own dispatch and schedules the next probe.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleProbe(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This timer is used to probe the I/O context.
+   */
+  boost::asio::steady_timer timer_;
+
+  /**
+   * This is the exponential moving average of the dispatch delay, in
+   * microseconds.
+   */
+  std::atomic<std::int64_t> lag_us_;
+};
+
+}  // namespace fusion_server
@@ -11,6 +11,8 @@
 
 #include <cstdint>
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string_view>
 
@@ -21,12 +23,29 @@
 
 namespace fusion_server {
 
+/**
+ * This is the forward declaration of the Shard class.
+ */
+class Shard;
+
 /**
  * This class represents the local endpoint used to accept new connections
  * from the clients.
  */
 class Listener : public std::enable_shared_from_this<Listener> {
  public:
+  /**
+   * This is the type of the function deciding whether or not new connections
+   * can be accepted.
+   */
+  using AdmissionCheck = std::function<bool()>;
+
+  /**
+   * This constant contains the delay of the next accept, after the admission
+   * check has failed. Meanwhile new connections wait in the kernel's queue.
+   */
+  static constexpr std::chrono::milliseconds kDeferInterval{100};
+
   /**
    * This structure holds the configuration of an instance of Listener class.
    */
@@ -93,13 +112,14 @@ class Listener : public std::enable_shared_from_this<Listener> {
   Listener& operator=(Listener&& other) = delete;
 
   /**
-   * @brief Sets the used I/O context object.
-   * This constructor sets the used I/O context to the given one.
+   * @brief Sets the shard of the listener.
+   * The I/O context of the shard is used in all asynchronous operations and
+   * the accepted sessions start on the shard.
    *
-   * @param ioc [in]
-   *   Reference to the I/O context used in all asynchronous operations.
+   * @param shard [in]
+   *   Reference to the shard accepting the connections.
    */
-  explicit Listener(boost::asio::io_context& ioc) noexcept;
+  explicit Listener(Shard& shard) noexcept;
 
   /**
    * @brief Configures the listener.
@@ -134,6 +154,19 @@ class Listener : public std::enable_shared_from_this<Listener> {
    */
   [[nodiscard]] LoggerManager::Logger GetLogger() const noexcept;
 
+  /**
+   * @brief Sets the admission check.
+   * This method sets the function called before each accept. If it returns
+   * false, the next accept is deferred by kDeferInterval.
+   *
+   * @param[in] admission_check
+   *   The admission check. If it's empty, all connections are accepted.
+   *
+   * @note
+   *   This method is indented to be called before Run().
+   */
+  void SetAdmissionCheck(AdmissionCheck admission_check) noexcept;
+
   /**
    * @brief Binds the listener.
    * This method binds the listener to the endpoint configured by Configure
@@ -246,6 +279,19 @@ class Listener : public std::enable_shared_from_this<Listener> {
   void HandleAccept(const boost::system::error_code& ec) noexcept;
 
  private:
+  /**
+   * This method starts an asynchronous accept of a new connection. If the
+   * admission check fails, the accept is deferred.
+   */
+  void DoAccept() noexcept;
+
+  /**
+   * This is the callback to the defer timer.
+   *
+   * @param[in] ec
+   *   The Boost error code.
+   */
+  void HandleDefer(const boost::system::error_code& ec) noexcept;
 
   /**
    * This method opens the acceptor & binds it to the endpoint.
@@ -256,9 +302,9 @@ class Listener : public std::enable_shared_from_this<Listener> {
   bool InitAcceptor() noexcept;
 
   /**
-   * The context for providing core I/O functionality.
+   * This is the shard accepting the connections.
    */
-  boost::asio::io_context& ioc_;
+  Shard& shard_;
   /**
    * This is the acceptor for accepting new connections.
    */
@@ -269,6 +315,22 @@ class Listener : public std::enable_shared_from_this<Listener> {
    */
   boost::asio::ip::tcp::socket socket_;
 
+  /**
+   * This timer is used to defer accepting, while the admission check fails.
+   */
+  boost::asio::steady_timer defer_timer_;
+
+  /**
+   * This function decides whether or not new connections can be accepted.
+   */
+  AdmissionCheck admission_check_;
+
+  /**
+   * This is an indication whether or not the accepting is being deferred. It's
+   * used to log only the first deferral.
+   */
+  bool is_deferring_;
+
   /**
    * This is an indication whether or not this listener has been properly bind
    * to the endpoint.
@@ -0,0 +1,274 @@
+/**
+ * @file metrics_segment.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the MetricsSegment class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace fusion_server {
+
+/**
+ * This class represents a memory-mapped file, into which the server publishes
+ * its metrics. Local agents map the same file and read the metrics without
+ * any cooperation of the server, so they can poll at a high frequency.
+ *
+ * The layout of the file is fixed. Its content is protected by a sequence lock:
+ * the writer makes the sequence odd, stores the words and makes it even again.
+ * A reader retries, if the sequence was odd or has changed during the read.
+ */
+class MetricsSegment {
+ public:
+  /**
+   * This constant contains the maximum number of shards described by the
+   * segment.
+   */
+  static constexpr std::size_t kMaxShards = 64;
+
+  /**
+   * This constant identifies a metrics segment ("FSMS").
+   */
+  static constexpr std::uint32_t kMagic = 0x534D5346;
+
+  /**
+   * This constant contains the version of the layout. It's changed each time
+   * the Snapshot structure changes.
+   */
+  static constexpr std::uint32_t kVersion = 1;
+
+  /**
+   * This constant contains the maximum number of attempts of a single read.
+   */
+  static constexpr std::size_t kMaxReadAttempts = 64;
+
+  /**
+   * This structure holds the metrics of a single shard.
+   */
+  struct ShardSnapshot {
+    /**
+     * This is the number of players in all games placed on the shard.
+     */
+    std::uint64_t players_;
+
+    /**
+     * This is the number of games placed on the shard.
+     */
+    std::uint64_t games_;
+
+    /**
+     * This is the average time needed to tick all games, in microseconds.
+     */
+    std::uint64_t tick_time_us_;
+
+    /**
+     * This is the average delay of a tick slot, in microseconds.
+     */
+    std::uint64_t tick_slip_us_;
+
+    /**
+     * This is the lag of the shard's I/O context, in microseconds.
+     */
+    std::uint64_t loop_lag_us_;
+
+    /**
+     * This is the number of outgoing packages queued on the shard.
+     */
+    std::uint64_t queued_packages_;
+
+    /**
+     * This is the overload level of the shard.
+     */
+    std::uint64_t overload_level_;
+  };
+
+  /**
+   * This structure holds all published metrics.
+   */
+  struct Snapshot {
+    /**
+     * This is the id of the publishing process.
+     */
+    std::uint64_t pid_;
+
+    /**
+     * This is the time of the publication, in milliseconds since the epoch.
+     */
+    std::uint64_t published_at_ms_;
+
+    /**
+     * This is the number of all connections accepted by the server.
+     */
+    std::uint64_t connections_;
+
+    /**
+     * This is the load score of the server (see Server::GetLoadScore()).
+     */
+    std::uint64_t load_score_;
+
+    /**
+     * This is an indication whether or not the server is ready.
+     */
+    std::uint64_t ready_;
+
+    /**
+     * This is the number of valid entries in the shards_ array.
+     */
+    std::uint64_t number_of_shards_;
+
+    /**
+     * This array holds the metrics of all shards.
+     */
+    std::array<ShardSnapshot, kMaxShards> shards_;
+  };
+
+  static_assert(std::is_trivially_copyable_v<Snapshot>);
+  static_assert(sizeof(Snapshot) % sizeof(std::uint64_t) == 0);
+
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of the mapping.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  MetricsSegment(const MetricsSegment& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of the mapping.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  MetricsSegment& operator=(const MetricsSegment& other) = delete;
+
+  /**
+   * @brief Creates a segment.
+   * This function creates (or truncates) the file at the given path and maps
+   * it for writing. The file is removed when the segment is destructed.
+   *
+   * @param[in] path
+   *   The path of the file, e.g. "/dev/shm/fusion_server".
+   *
+   * @return
+   *   The created segment is returned. If the file cannot be created or
+   *   mapped, nullptr is returned.
+   */
+  static std::unique_ptr<MetricsSegment> Create(const std::string& path) noexcept;
+
+  /**
+   * @brief Opens a segment.
+   * This function maps an existing segment for reading.
+   *
+   * @param[in] path
+   *   The path of the file.
+   *
+   * @return
+   *   The opened segment is returned. If the file doesn't exist, it's too
+   *   small or it's not a metrics segment of this version, nullptr is
+   *   returned.
+   */
+  static std::unique_ptr<MetricsSegment> Open(const std::string& path) noexcept;
+
+  /**
+   * @brief Unmaps the segment.
+   * If the segment has been created by this object, the file is removed.
+   */
+  ~MetricsSegment() noexcept;
+
+  /**
+   * @brief Publishes metrics.
+   *
+   * @param[in] snapshot
+   *   The published metrics.
+   *
+   * @note
+   *   There must be only one writer of a segment.
+   */
+  void Publish(const Snapshot& snapshot) noexcept;
+
+  /**
+   * @brief Reads the metrics.
+   *
+   * @param[out] snapshot
+   *   The read metrics.
+   *
+   * @return
+   *   An indication whether or not a consistent snapshot has been read within
+   *   kMaxReadAttempts attempts is returned.
+   */
+  bool Read(Snapshot& snapshot) const noexcept;
+
+ private:
+  /**
+   * This constant contains the number of words of a snapshot.
+   */
+  static constexpr std::size_t kNumberOfWords = sizeof(Snapshot) / sizeof(std::uint64_t);
+
+  /**
+   * This structure describes the content of the file.
+   */
+  struct Layout {
+    /**
+     * This is the identifier of a metrics segment. It must equal kMagic.
+     */
+    std::uint32_t magic_;
+
+    /**
+     * This is the version of the layout. It must equal kVersion.
+     */
+    std::uint32_t version_;
+
+    /**
+     * This is the sequence of the lock. It's odd while the words are written.
+     */
+    std::atomic<std::uint64_t> sequence_;
+
+    /**
+     * These are the words of the last published snapshot.
+     */
+    std::array<std::atomic<std::uint64_t>, kNumberOfWords> words_;
+  };
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+    "The segment is shared by processes, so its atomics must be lock-free.");
+
+  /**
+   * This constructor is called only by Create() and Open().
+   *
+   * @param[in] layout
+   *   The mapped content of the file.
+   *
+   * @param[in] path
+   *   The path of the file removed by the destructor. If it's empty, the file
+   *   is not removed.
+   */
+  MetricsSegment(Layout* layout, std::string path) noexcept;
+
+  /**
+   * This is the mapped content of the file.
+   */
+  Layout* layout_;
+
+  /**
+   * This is the path of the file removed by the destructor.
+   */
+  std::string path_;
+};
+
+}  // namespace fusion_server
@@ -0,0 +1,150 @@
+/**
+ * @file overload_controller.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the OverloadController class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+
+namespace fusion_server {
+
+/**
+ * This class decides how much a shard degrades its games under overload. Once
+ * per tick interval the shard reports its pressure, i.e. the larger of the
+ * tick slip and the time spent on ticking, as a fraction of the tick interval.
+ * Sustained high pressure raises the degradation level one step at a time and
+ * sustained low pressure lowers it again.
+ */
+class OverloadController {
+ public:
+  /**
+   * This enumeration represents the degradation levels.
+   */
+  enum class Level : std::uint8_t {
+    /**
+     * The games run at the full rate.
+     */
+    kNormal,
+
+    /**
+     * The games send their periodic packages every kReducedUpdateDivisor
+     * ticks.
+     */
+    kReducedUpdates,
+
+    /**
+     * Additionally, games idle since their last tick are ticked every second
+     * tick.
+     */
+    kReducedIdleTicks,
+
+    /**
+     * Additionally, games idle since their last tick are ticked every fourth
+     * tick.
+     */
+    kMinimalIdleTicks,
+  };
+
+  /**
+   * This constant contains the pressure above which the shard is overloaded.
+   */
+  static constexpr double kHighPressure = 0.8;
+
+  /**
+   * This constant contains the pressure below which the shard has recovered.
+   */
+  static constexpr double kLowPressure = 0.5;
+
+  /**
+   * This constant contains the number of consecutive overloaded intervals
+   * needed to raise the level.
+   */
+  static constexpr std::size_t kEscalationIntervals = 10;
+
+  /**
+   * This constant contains the number of consecutive recovered intervals
+   * needed to lower the level.
+   */
+  static constexpr std::size_t kRecoveryIntervals = 40;
+
+  /**
+   * This constant contains the divisor of the update rate on the reduced
+   * levels.
+   */
+  static constexpr std::size_t kReducedUpdateDivisor = 2;
+
+  /**
+   * @brief Reports the pressure of a tick interval.
+   *
+   * @param[in] pressure
+   *   The larger of the tick slip and the tick time, as a fraction of the tick
+   *   interval.
+   *
+   * @return
+   *   True is returned if the level has changed.
+   *
+   * @note
+   *   This method is intended to be called only by the shard's thread.
+   */
+  bool Update(double pressure) noexcept;
+
+  /**
+   * @brief Returns the current level.
+   *
+   * @return
+   *   The current degradation level is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] Level GetLevel() const noexcept;
+
+  /**
+   * @brief Returns the update divisor.
+   *
+   * @return
+   *   The number of ticks between two periodic packages of a game is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetUpdateDivisor() const noexcept;
+
+  /**
+   * @brief Returns the idle tick divisor.
+   *
+   * @return
+   *   The number of tick intervals between two ticks of an idle game is
+   *   returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetIdleTickDivisor() const noexcept;
+
+ private:
+  /**
+   * This is the current degradation level.
+   */
+  std::atomic<Level> level_{Level::kNormal};
+
+  /**
+   * This is the number of consecutive overloaded intervals.
+   */
+  std::size_t overloaded_intervals_ = 0;
+
+  /**
+   * This is the number of consecutive recovered intervals.
+   */
+  std::size_t recovered_intervals_ = 0;
+};
+
+}  // namespace fusion_server
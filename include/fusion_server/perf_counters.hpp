@@ -0,0 +1,269 @@
+/**
+ * @file perf_counters.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the PerfCounters class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <atomic>
+
+namespace fusion_server {
+
+/**
+ * This class aggregates hardware performance counters per subsystem of the
+ * server. Each thread opens its own group of counters (see perf_event_open(2))
+ * the first time it samples. A sample is the difference of the counters read
+ * at the beginning and at the end of a Scope.
+ *
+ * Sampling is disabled by default. If the kernel doesn't provide the counters
+ * (e.g. in a container or a virtual machine), Enable() fails and all scopes
+ * stay no-ops.
+ */
+class PerfCounters {
+ public:
+  /**
+   * This enumeration contains the sampled subsystems.
+   */
+  enum class Subsystem : std::uint8_t {
+    /**
+     * Ticking the games of a slot. It includes the serialization and the
+     * fan-out of the tick.
+     */
+    kTick,
+
+    /**
+     * Building and serializing the packages broadcast to the players.
+     */
+    kSerialization,
+
+    /**
+     * Parsing and verifying a received package (json::Verify).
+     */
+    kVerify,
+
+    /**
+     * Handing a broadcast package over to the sessions of a game.
+     */
+    kFanOut,
+  };
+
+  /**
+   * This constant contains the number of subsystems.
+   */
+  static constexpr std::size_t kNumberOfSubsystems = 4;
+
+  /**
+   * This enumeration contains the counted hardware events.
+   */
+  enum class Event : std::uint8_t {
+    kCycles,
+    kInstructions,
+    kCacheMisses,
+    kBranchMisses,
+  };
+
+  /**
+   * This constant contains the number of counted events.
+   */
+  static constexpr std::size_t kNumberOfEvents = 4;
+
+  /**
+   * This structure holds the aggregated samples of a subsystem.
+   */
+  struct Totals {
+    /**
+     * This is the number of samples.
+     */
+    std::uint64_t samples_;
+
+    /**
+     * This array holds the sums of the counted events, indexed by Event.
+     */
+    std::array<std::uint64_t, kNumberOfEvents> events_;
+  };
+
+  /**
+   * This class samples the counters of the calling thread for its lifetime
+   * and adds the sample to the totals of a subsystem.
+   */
+  class Scope {
+   public:
+    /**
+     * @brief Explicitly deleted copy constructor.
+     *
+     * @param[in] other
+     *   Copied object.
+     */
+    Scope(const Scope& other) = delete;
+
+    /**
+     * @brief Explicitly deleted copy operator.
+     *
+     * @param[in] other
+     *   Copied object.
+     *
+     * @return
+     *   Reference to `this` object.
+     */
+    Scope& operator=(const Scope& other) = delete;
+
+    /**
+     * @brief Starts a sample.
+     * If the sampling is disabled, the scope does nothing.
+     *
+     * @param[in] subsystem
+     *   The sampled subsystem.
+     */
+    explicit Scope(Subsystem subsystem) noexcept;
+
+    /**
+     * @brief Finishes the sample.
+     */
+    ~Scope() noexcept;
+
+   private:
+    /**
+     * This is the sampled subsystem.
+     */
+    Subsystem subsystem_;
+
+    /**
+     * This is an indication whether or not the counters have been read.
+     */
+    bool is_sampling_;
+
+    /**
+     * This array holds the counters read at the beginning of the scope.
+     */
+    std::array<std::uint64_t, kNumberOfEvents> start_;
+  };
+
+  /**
+   * @brief Returns the counters.
+   * This function returns the counters shared by all threads. They are never
+   * destroyed, so scopes closed during the program exit are still valid.
+   *
+   * @return
+   *   A reference to the counters is returned.
+   */
+  static PerfCounters& Get() noexcept;
+
+  /**
+   * @brief Enables sampling.
+   * This method checks whether or not the counters are available by opening
+   * them on the calling thread.
+   *
+   * @return
+   *   An indication whether or not the sampling has been enabled is returned.
+   */
+  bool Enable() noexcept;
+
+  /**
+   * @brief Disables sampling.
+   * The aggregated totals are kept.
+   */
+  void Disable() noexcept;
+
+  /**
+   * @brief Returns whether or not the sampling is enabled.
+   *
+   * @return
+   *   An indication whether or not the sampling is enabled is returned.
+   */
+  [[nodiscard]] bool IsEnabled() const noexcept;
+
+  /**
+   * @brief Returns the totals of a subsystem.
+   *
+   * @param[in] subsystem
+   *   The subsystem.
+   *
+   * @return
+   *   The aggregated samples of the given subsystem are returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] Totals GetTotals(Subsystem subsystem) const noexcept;
+
+  /**
+   * @brief Returns the name of a subsystem.
+   *
+   * @param[in] subsystem
+   *   The subsystem.
+   *
+   * @return
+   *   The name of the given subsystem is returned.
+   */
+  static const char* GetName(Subsystem subsystem) noexcept;
+
+  /**
+   * @brief Returns the name of an event.
+   *
+   * @param[in] event
+   *   The event.
+   *
+   * @return
+   *   The name of the given event is returned.
+   */
+  static const char* GetName(Event event) noexcept;
+
+ private:
+  /**
+   * This constructor is called only once, by the Get() function.
+   */
+  PerfCounters() noexcept = default;
+
+  /**
+   * This method reads the counters of the calling thread. If the thread has
+   * not opened its counters yet, they are opened.
+   *
+   * @param[out] values
+   *   The read counters.
+   *
+   * @return
+   *   An indication whether or not the counters have been read is returned.
+   */
+  static bool Read(std::array<std::uint64_t, kNumberOfEvents>& values) noexcept;
+
+  /**
+   * This method adds a sample to the totals of a subsystem.
+   *
+   * @param[in] subsystem
+   *   The sampled subsystem.
+   *
+   * @param[in] start
+   *   The counters read at the beginning of the sample.
+   *
+   * @param[in] end
+   *   The counters read at the end of the sample.
+   */
+  void Add(Subsystem subsystem, const std::array<std::uint64_t, kNumberOfEvents>& start,
+    const std::array<std::uint64_t, kNumberOfEvents>& end) noexcept;
+
+  /**
+   * This is an indication whether or not the sampling is enabled.
+   */
+  std::atomic<bool> is_enabled_{false};
+
+  /**
+   * This array holds the number of samples of each subsystem.
+   */
+  std::array<std::atomic<std::uint64_t>, kNumberOfSubsystems> samples_{};
+
+  /**
+   * This array holds the sums of the counted events of each subsystem.
+   */
+  std::array<std::array<std::atomic<std::uint64_t>, kNumberOfEvents>,
+    kNumberOfSubsystems> events_{};
+};
+
+}  // namespace fusion_server
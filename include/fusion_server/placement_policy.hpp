@@ -0,0 +1,109 @@
+/**
+ * @file placement_policy.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the PlacementPolicy class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <fusion_server/json.hpp>
+#include <fusion_server/shard.hpp>
+
+namespace fusion_server {
+
+/**
+ * This class decides on which shard a new game is placed. Each shard gets a
+ * load score computed from its live metrics and the game is placed on the shard
+ * with the lowest score.
+ */
+class PlacementPolicy {
+ public:
+  /**
+   * This structure holds the weights of all metrics used in the load score.
+   */
+  struct Weights {
+    /**
+     * This is the weight of a single player.
+     */
+    double players_ = 1.0;
+
+    /**
+     * This is the weight of the tick time, expressed as the used fraction of
+     * the tick interval. By default a shard spending the whole tick interval
+     * on ticking is as loaded as a shard with 100 players.
+     */
+    double tick_time_ = 100.0;
+
+    /**
+     * This is the weight of a single queued outgoing package.
+     */
+    double queued_packages_ = 0.1;
+  };
+
+  /**
+   * @brief Configures the weights.
+   * This method reads the weights from the given configuration. Missing fields
+   * keep their default values.
+   *
+   * @param[in] config
+   *   The configuration object. It may contain the non-negative numbers
+   *   "players", "tick_time" and "queued_packages".
+   *
+   * @return
+   *   An indication, whether or not the configuration was valid is returned. If
+   *   it was not, the weights are not changed.
+   */
+  bool Configure(const json::JSON& config) noexcept;
+
+  /**
+   * @brief Returns the weights.
+   *
+   * @return
+   *   The weights used by this policy are returned.
+   */
+  [[nodiscard]] const Weights& GetWeights() const noexcept;
+
+  /**
+   * @brief Computes the load score of a shard.
+   *
+   * @param[in] shard
+   *   The shard to be scored.
+   *
+   * @return
+   *   The load score of the given shard is returned. The higher the score, the
+   *   more loaded the shard is.
+   */
+  [[nodiscard]] double GetLoadScore(const Shard& shard) const noexcept;
+
+  /**
+   * @brief Selects a shard for a new game.
+   * This method returns the shard with the lowest load score. If the preferred
+   * shard is one of the least loaded ones, it's returned, so the creator of
+   * the game doesn't need to be migrated.
+   *
+   * @param[in] shards
+   *   All shards of the server. It must not be empty.
+   *
+   * @param[in] preferred
+   *   The shard of the session which creates the game.
+   *
+   * @return
+   *   A reference to the selected shard is returned.
+   */
+  Shard& SelectShard(const std::vector<std::unique_ptr<Shard>>& shards,
+    Shard& preferred) const noexcept;
+
+ private:
+  /**
+   * This holds the weights of all metrics.
+   */
+  Weights weights_;
+};
+
+}  // namespace fusion_server
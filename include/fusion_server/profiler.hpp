@@ -0,0 +1,167 @@
+/**
+ * @file profiler.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the Profiler class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace fusion_server {
+
+/**
+ * This class is a sampling CPU profiler running inside the process. While it's
+ * running, the kernel sends SIGPROF every kSamplingPeriod of CPU time consumed
+ * by the process and the signal handler records the stack of the interrupted
+ * thread. The collected samples are exported in the pprof format, so they can
+ * be inspected with `pprof` or `go tool pprof`.
+ *
+ * Only one profile can be collected at a time.
+ */
+class Profiler {
+ public:
+  /**
+   * This constant contains the CPU time between two samples.
+   */
+  static constexpr std::chrono::microseconds kSamplingPeriod{10000};
+
+  /**
+   * This constant contains the maximum number of recorded samples. Samples
+   * above the limit are dropped.
+   */
+  static constexpr std::size_t kMaxSamples = 8192;
+
+  /**
+   * This constant contains the maximum depth of a recorded stack.
+   */
+  static constexpr std::size_t kMaxDepth = 48;
+
+  /**
+   * This constant contains the maximum duration of a profile.
+   */
+  static constexpr std::chrono::seconds kMaxDuration{60};
+
+  /**
+   * @brief Returns the profiler.
+   *
+   * @return
+   *   A reference to the only profiler is returned.
+   */
+  static Profiler& Get() noexcept;
+
+  /**
+   * @brief Starts collecting a profile.
+   * This method installs the SIGPROF handler and starts the profiling timer.
+   *
+   * @return
+   *   An indication whether or not the profiling has been started is
+   *   returned. It's not started if another profile is being collected or the
+   *   timer cannot be set.
+   */
+  bool Start() noexcept;
+
+  /**
+   * @brief Stops collecting the profile.
+   * This method stops the profiling timer, makes the process ignore SIGPROF
+   * signals still pending and returns the collected profile.
+   *
+   * @return
+   *   The profile serialized in the pprof format (an uncompressed
+   *   perftools.profiles.Profile protocol buffer) is returned. If no profile is
+   *   being collected, an empty string is returned.
+   */
+  std::string Stop() noexcept;
+
+  /**
+   * @brief Returns whether or not a profile is being collected.
+   *
+   * @return
+   *   An indication whether or not a profile is being collected is returned.
+   */
+  [[nodiscard]] bool IsRunning() const noexcept;
+
+ private:
+  /**
+   * This structure holds a single recorded stack.
+   */
+  struct Sample {
+    /**
+     * This is the number of valid frames. It's written last, so a sample with
+     * depth 0 has not been completed.
+     */
+    std::atomic<std::size_t> depth_;
+
+    /**
+     * These are the return addresses of the frames, innermost first.
+     */
+    void* frames_[kMaxDepth];
+  };
+
+  /**
+   * This constructor is called only once, by the Get() function.
+   */
+  Profiler() noexcept = default;
+
+  /**
+   * This function is the SIGPROF handler. It records the stack of the
+   * interrupted thread.
+   *
+   * @param[in] signal
+   *   The number of the signal.
+   */
+  static void HandleSignal(int signal) noexcept;
+
+  /**
+   * This method serializes the recorded samples in the pprof format.
+   *
+   * @param[in] duration
+   *   The duration of the profile.
+   *
+   * @return
+   *   The serialized profile is returned.
+   */
+  std::string Serialize(std::chrono::nanoseconds duration) const noexcept;
+
+  /**
+   * This is an indication whether or not a profile is being collected.
+   */
+  std::atomic<bool> is_running_{false};
+
+  /**
+   * This is an indication whether or not the signal handler records samples.
+   */
+  std::atomic<bool> is_recording_{false};
+
+  /**
+   * This is the number of signal handlers being executed.
+   */
+  std::atomic<std::size_t> active_handlers_{0};
+
+  /**
+   * This is the index of the next free sample.
+   */
+  std::atomic<std::size_t> next_sample_{0};
+
+  /**
+   * This array holds kMaxSamples recorded samples. It's allocated by Start()
+   * and released by Stop(), so the signal handler never allocates.
+   */
+  std::unique_ptr<Sample[]> samples_;
+
+  /**
+   * This is the time at which the profile has been started.
+   */
+  std::chrono::system_clock::time_point started_at_;
+};
+
+}  // namespace fusion_server
@@ -9,18 +9,25 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <map>
 #include <memory>
-#include <set>
 #include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include <boost/asio.hpp>
 
+#include <fusion_server/frame_dictionary.hpp>
 #include <fusion_server/game.hpp>
+#include <fusion_server/game_transfer.hpp>
 #include <fusion_server/listener.hpp>
 #include <fusion_server/json.hpp>
+#include <fusion_server/metrics_segment.hpp>
+#include <fusion_server/placement_policy.hpp>
+#include <fusion_server/shard.hpp>
 #include <fusion_server/system/package.hpp>
 
 namespace fusion_server {
@@ -31,19 +38,72 @@ namespace fusion_server {
 class WebSocketSession;
 
 /**
- * This class represents the server itself. It holds all the WebSocket sessions
- * and manages all games.
+ * This is the forward declaration of the BotPool class.
+ */
+class BotPool;
+
+/**
+ * This class represents the server itself. It owns the shards and manages all
+ * games. The sessions are registered on their shards (see Shard), which are
+ * the context passed to the sessions and the games.
  */
 class Server {
  public:
   /**
-   * This function returns the only instance of this class. If the instance has
-   * not yet been created, the function creates it
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of the shards.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  Server(const Server& other) = delete;
+
+  /**
+   * @brief Explicitly deleted move constructor.
+   * It's deleted due to presence of the shards.
+   *
+   * @param[in] other
+   *   Moved object.
+   */
+  Server(Server&& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of the shards.
+   *
+   * @param[in] other
+   *   Copied object.
    *
    * @return
-   *   The only instance of this class is returned.
+   *   Reference to `this` object.
    */
-  static Server& GetInstance() noexcept;
+  Server& operator=(const Server& other) = delete;
+
+  /**
+   * @brief Explicitly deleted move operator.
+   * It's deleted due to presence of the shards.
+   *
+   * @param[in] other
+   *   Moved object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  Server& operator=(Server&& other) = delete;
+
+  /**
+   * @brief Constructs a server with a single shard.
+   * More shards are created by Configure(). Each instance is independent, so a
+   * process (e.g. a test) can run several servers.
+   */
+  Server() noexcept;
+
+  /**
+   * @brief Destructs the server.
+   * The sessions and the games still owned by the handlers of the shards are
+   * destroyed together with the shards.
+   */
+  ~Server() noexcept;
 
   /**
    * @brief Configures the server.
@@ -79,34 +139,77 @@ class Server {
   [[nodiscard]] LoggerManager::Logger GetLogger() const noexcept;
 
   /**
-   * This method returns the reference to the I/O context used in this server.
+   * This method returns the reference to the I/O context of the first shard.
+   * The listener and the signal handling run on this context.
    *
    * @return
-   *   The reference to the I/O context used in this server is returned.
+   *   The reference to the I/O context of the first shard is returned.
    */
   boost::asio::io_context& GetIOContext() noexcept;
 
   /**
-   * This method adds the given session to the set of the unidentified sessions.
-   * It returns the delegate to be called each time when a new package arrives.
+   * @brief Returns the number of shards.
+   *
+   * @return
+   *   The number of shards of this server is returned.
+   */
+  [[nodiscard]] std::size_t GetNumberOfShards() const noexcept;
+
+  /**
+   * @brief Returns a shard.
+   *
+   * @param[in] id
+   *   The id of the shard. If it's not less than GetNumberOfShards(), the
+   *   behaviour is undefined.
+   *
+   * @return
+   *   A reference to the requested shard is returned.
+   */
+  Shard& GetShard(std::size_t id) noexcept;
+
+  /**
+   * This method registers the given session on its shard as a session, which
+   * has not joined any game.
    *
    * @param[in] new_session
    *   A new session to be registered.
    *
    * @note
    *   This method is thread-safe.
+   */
+  void Register(WebSocketSession* new_session) noexcept;
+
+  /**
+   * This method handles a package of a session, which has not joined any
+   * game, and sends the response to the client.
    *
-   * @return
-   *   The delegate to be called each time when a new package arrives is
-   *   returned.
+   * @param[in] src
+   *   The session, which has received the package.
+   *
+   * @param[in] package
+   *   The verified package.
+   */
+  void HandleUnjoined(WebSocketSession* src, const json::JSON& package) noexcept;
+
+  /**
+   * This method registers the given session, which has left its game, as a
+   * session, which has not joined any game. If it was the last player of the
+   * game, the game is removed.
+   *
+   * @param[in] session
+   *   The session, which has left its game.
+   *
+   * @note
+   *   This method is thread-safe.
    */
-  system::IncomingPackageDelegate& Register(WebSocketSession* new_session) noexcept;
+  void Unjoin(WebSocketSession* session) noexcept;
 
   /**
    * This method unregisters the given session. After that method is executed,
    * all shared pointers of that session should go out of scope and the object
-   * itself should be destructed. If the given session is not registered in this
-   * server, the method dose nothing.
+   * itself should be destructed. If the session has joined a game, it leaves
+   * the game. If the given session is not registered on its shard, the method
+   * does nothing.
    *
    * @param[in] session
    *   The session to be unregistered.
@@ -133,9 +236,151 @@ class Server {
    */
   bool StartAccepting() noexcept;
 
+  /**
+   * @brief Checks whether or not a shard is busy.
+   * A shard is busy, if the lag of its I/O context exceeds the configured
+   * limit. New connections are deferred while any shard is busy and new
+   * games are not created on a busy shard.
+   *
+   * @param[in] shard
+   *   The checked shard.
+   *
+   * @return
+   *   An indication whether or not the given shard is busy is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] bool IsBusy(const Shard& shard) const noexcept;
+
+  /**
+   * @brief Checks whether or not the server is ready for new players.
+   * The server is ready, if it's accepting connections, it hasn't been shut
+   * down and none of its shards is busy.
+   *
+   * @return
+   *   An indication whether or not the server is ready is returned.
+   *
+   * @note
+   *   This method is thread-safe. It reads only atomic values and takes no
+   *   locks, so it can be called for each health probe.
+   */
+  [[nodiscard]] bool IsReady() const noexcept;
+
+  /**
+   * @brief Returns the load score.
+   * The load score is the average pressure of all shards in percent. The
+   * pressure of a shard is the larger of its tick time relative to the tick
+   * interval and its lag relative to the configured limit.
+   *
+   * @return
+   *   The load score is returned. It's 0 for an idle server and 100 or more
+   *   for a saturated one.
+   *
+   * @note
+   *   This method is thread-safe. It reads only atomic values and takes no
+   *   locks, so it can be called for each health probe.
+   */
+  [[nodiscard]] std::size_t GetLoadScore() const noexcept;
+
+  /**
+   * @brief Returns the frame dictionary.
+   *
+   * @return
+   *   The dictionary used to compress the packages of the clients, which have
+   *   negotiated it, is returned. If the compression is not configured,
+   *   nullptr is returned.
+   */
+  [[nodiscard]] std::shared_ptr<const FrameDictionary> GetFrameDictionary() const noexcept;
+
+  /**
+   * @brief Returns the bot pool.
+   *
+   * @return
+   *   The pool running the server-side bots is returned. If the bots are not
+   *   configured, nullptr is returned.
+   */
+  [[nodiscard]] BotPool* GetBotPool() noexcept;
+
+  /**
+   * This constant contains the default limit of the lag of a shard's I/O
+   * context.
+   */
+  static constexpr std::chrono::milliseconds kDefaultMaxLoopLag{100};
+
+  /**
+   * This constant contains the default interval between two publications of
+   * the metrics to the metrics segment.
+   */
+  static constexpr std::chrono::milliseconds kDefaultMetricsInterval{100};
+
+  /**
+   * @brief Moves a game to another shard.
+   * This method pauses the game at a tick boundary, places it on the given
+   * shard and moves all its sessions to that shard. The match is not
+   * interrupted.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] shard_id
+   *   The id of the target shard.
+   *
+   * @return
+   *   An indication, whether or not the game has been moved is returned. It's
+   *   not moved if either it doesn't exist, the shard doesn't exist or the game
+   *   is already placed on that shard.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  bool MigrateGame(const std::string& game_name, std::size_t shard_id) noexcept;
+
+  /**
+   * @brief Transfers a game to another server process.
+   * This method starts transferring the game to the process listening on the
+   * given Unix domain socket. After the other process has accepted the game,
+   * all clients are redirected to it.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] socket_path
+   *   The path of the socket of the receiving process.
+   *
+   * @return
+   *   An indication, whether or not the transfer has started is returned.
+   *
+   * @see [class GameExporter](@ref GameExporter)
+   */
+  bool ExportGame(const std::string& game_name, const std::string& socket_path) noexcept;
+
+  /**
+   * @brief Imports a game transferred by another server process.
+   * This method creates the game on the least loaded shard and reserves seats
+   * for all its players. If no player resumes within
+   * Game::kReservationTimeout, the game is removed.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] snapshot
+   *   The snapshot of the game.
+   *
+   * @return
+   *   An indication, whether or not the game has been imported is returned. It's
+   *   not imported if a game with the same name exists or the snapshot is not
+   *   valid.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  bool ImportGame(const std::string& game_name, const json::JSON& snapshot) noexcept;
+
   /**
    * @brief Closes all server's connections.
-   * This method closes all connection stored in this server.
+   * This method closes all connection stored in this server and stops all
+   * shards.
    *
    * @note
    *   It is indented to be called only once. If it's called more than once, the
@@ -144,11 +389,6 @@ class Server {
   void Shutdown() noexcept;
 
  private:
-  /**
-   * This constructor is called only once, by the GetInstance() function.
-   */
-  Server() noexcept;
-
   /**
    * This method returns a response for the given request from a client.
    *
@@ -163,32 +403,133 @@ class Server {
    */
   json::JSON MakeResponse(WebSocketSession* src, const json::JSON& request) noexcept;
 
+  /**
+   * This method completes a successful join of a client and returns the
+   * response for it.
+   *
+   * @param[in] src
+   *   The WebSocket session connected to the client.
+   *
+   * @param[in] game_name
+   *   The name of the joined game.
+   *
+   * @param[in] game
+   *   The joined game.
+   *
+   * @param[in] game_shard
+   *   The shard on which the joined game is placed.
+   *
+   * @param[in] join_result
+   *   The successful result returned by the game.
+   *
+   * @return
+   *   A "JOIN-RESULT" response is returned.
+   */
+  json::JSON FinishJoin(WebSocketSession* src, std::string game_name,
+    std::shared_ptr<Game> game, Shard& game_shard,
+    Game::join_result_t& join_result) noexcept;
+
+  /**
+   * This method removes a game, if it has no players.
+   *
+   * @param[in] game_name
+   *   The name of the game.
+   *
+   * @param[in] game
+   *   The game. If the name refers to another game now, the method does
+   *   nothing.
+   *
+   * @return
+   *   An indication of whether or not the game has been removed is returned.
+   */
+  bool RemoveEmptyGame(const std::string& game_name, const Game* game) noexcept;
+
+  /**
+   * This method checks whether or not any shard is busy, i.e. whether the
+   * largest lag of the shards exceeds the configured limit. A session accepted
+   * by the first shard can be placed on any shard, so all of them are checked.
+   *
+   * @return
+   *   An indication whether or not any shard is busy is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] bool IsAnyShardBusy() const noexcept;
+
+  /**
+   * This method schedules the next publication of the metrics to the metrics
+   * segment.
+   */
+  void SchedulePublishMetrics() noexcept;
+
+  /**
+   * This method publishes the current metrics of the server and its shards to
+   * the metrics segment.
+   */
+  void PublishMetrics() noexcept;
+
   /**
    * This object is used to accept new connections.
    */
   std::shared_ptr<Listener> listener_;
 
   /**
-   * This function object is called by WebSocket sessions from a clients, who
-   * are not yet in any game, each time when a new package arrives.
+   * This object accepts games transferred by other server processes. It's
+   * created only if the migration is configured.
+   */
+  std::shared_ptr<GameImportListener> import_listener_;
+
+  /**
+   * This vector holds all shards of this server. The first shard is created by
+   * the constructor, the others are created during the configuration.
+   */
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  /**
+   * This object selects the shard on which a new game is placed.
+   */
+  PlacementPolicy placement_policy_;
+
+  /**
+   * This is the limit of the lag of a shard's I/O context. Above it the shard
+   * is busy.
+   */
+  std::chrono::microseconds max_loop_lag_;
+
+  /**
+   * This is the segment to which the metrics are published. It's created only
+   * if the metrics segment is configured.
+   */
+  std::unique_ptr<MetricsSegment> metrics_segment_;
+
+  /**
+   * This timer is used to publish the metrics periodically.
+   */
+  std::unique_ptr<boost::asio::steady_timer> metrics_timer_;
+
+  /**
+   * This is the interval between two publications of the metrics.
    */
-  system::IncomingPackageDelegate unjoined_delegate_;
+  std::chrono::milliseconds metrics_interval_;
 
   /**
-   * The context for providing core I/O functionality.
+   * This is the dictionary compressing the packages. It's loaded only if the
+   * compression is configured.
    */
-  boost::asio::io_context ioc_;
+  std::shared_ptr<const FrameDictionary> frame_dictionary_;
 
   /**
-   * This container holds all unidentifies WebSocket sessions.
+   * This is the pool running the server-side bots. It's created only if the
+   * bots are configured.
    */
-  std::set<WebSocketSession*> unidentified_sessions_;
+  std::unique_ptr<BotPool> bot_pool_;
 
   /**
-   * This mutex is used to synchronise the access to the set of the unidentified
-   * sessions.
+   * This is the map of all games. It's loaded only if it's configured, and
+   * its navigation data is shared by the games.
    */
-  std::shared_mutex unidentified_sessions_mtx_;
+  std::shared_ptr<const ui::Map> map_;
 
   /**
    * This map associates all games in the server with their names.
@@ -206,19 +547,6 @@ class Server {
    */
   std::shared_mutex games_mtx_;
 
-  /**
-   * This map associates all sessions in the server and games to which they have
-   * joined. If a sessions has not been joined to any game (it's unidentified)
-   * the value is in its invalid state.
-   */
-  std::map<WebSocketSession*, std::optional<std::string>> sessions_correlation_;
-
-  /**
-   * This mutex is used to synchronise the access to the map of the sessions
-   * and their games.
-   */
-  std::shared_mutex sessions_correlation_mtx_;
-
   /**
    * This object contains configuration for the server.
    */
@@ -242,12 +570,12 @@ class Server {
    *
    * @see fusion_server::Server#Shutdown
    */
-  bool has_stopped_;
+  std::atomic<bool> has_stopped_;
 
   /**
-   * This is the pointer pointing to the only instance of this class.
+   * This flag indicates whether or not this server accepts new connections.
    */
-  static std::unique_ptr<Server> instance_;
+  std::atomic<bool> is_accepting_;
 };
 
 }  // namespace fusion_server
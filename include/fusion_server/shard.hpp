@@ -0,0 +1,529 @@
+/**
+ * @file shard.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the Shard class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <fusion_server/lag_probe.hpp>
+#include <fusion_server/logger_manager.hpp>
+#include <fusion_server/overload_controller.hpp>
+#include <fusion_server/tick_scheduler.hpp>
+
+namespace fusion_server {
+
+/**
+ * This is the forward declaration of the Game class.
+ */
+class Game;
+
+/**
+ * This is the forward declaration of the Server class.
+ */
+class Server;
+
+/**
+ * This is the forward declaration of the WebSocketSession class.
+ */
+class WebSocketSession;
+
+/**
+ * This class represents a shard of the server. Each shard has its own I/O
+ * context and owns the games placed on it. All sessions of a game are moved to
+ * the game's shard, so reads, dispatch and broadcast writes of the game are
+ * all performed by the same thread.
+ * A shard is the context passed to the sessions and the games running on it.
+ * It knows its server and keeps the registry of its own sessions, so opening
+ * and closing a session doesn't touch any state shared by all shards.
+ */
+class Shard {
+ public:
+  /**
+   * This structure holds the live load metrics of a shard. All fields can be
+   * read and updated from any thread.
+   */
+  struct Metrics {
+    /**
+     * This is the number of players in all games placed on the shard.
+     */
+    std::atomic<std::size_t> players_{0};
+
+    /**
+     * This is the exponential moving average of the time needed to tick all
+     * games placed on the shard, in microseconds.
+     */
+    std::atomic<std::uint64_t> tick_time_us_{0};
+
+    /**
+     * This is the exponential moving average of the delay between the planned
+     * and the actual start of a tick slot, in microseconds.
+     */
+    std::atomic<std::uint64_t> tick_slip_us_{0};
+
+    /**
+     * This is the number of outgoing packages queued by all sessions running
+     * on the shard.
+     */
+    std::atomic<std::size_t> queued_packages_{0};
+  };
+
+  /**
+   * This structure describes a session registered on a shard.
+   */
+  struct SessionEntry {
+    /**
+     * This is the name of the game joined by the session. It's empty, if the
+     * session has not joined any game.
+     */
+    std::string game_name_;
+
+    /**
+     * This is the game joined by the session. It's nullptr, if the session has
+     * not joined any game.
+     */
+    std::shared_ptr<Game> game_;
+  };
+
+  /**
+   * @brief Explicitly deleted copy constructor.
+   * It's deleted due to presence of boost::asio's I/O context.
+   *
+   * @param[in] other
+   *   Copied object.
+   */
+  Shard(const Shard& other) = delete;
+
+  /**
+   * @brief Explicitly deleted move constructor.
+   * It's deleted due to presence of boost::asio's I/O context.
+   *
+   * @param[in] other
+   *   Moved object.
+   */
+  Shard(Shard&& other) = delete;
+
+  /**
+   * @brief Explicitly deleted copy operator.
+   * It's deleted due to presence of boost::asio's I/O context.
+   *
+   * @param[in] other
+   *   Copied object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  Shard& operator=(const Shard& other) = delete;
+
+  /**
+   * @brief Explicitly deleted move operator.
+   * It's deleted due to presence of boost::asio's I/O context.
+   *
+   * @param[in] other
+   *   Moved object.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  Shard& operator=(Shard&& other) = delete;
+
+  /**
+   * @brief Constructs a shard.
+   *
+   * @param[in] id
+   *   The id of the new shard.
+   *
+   * @param[in] server
+   *   The server owning the new shard.
+   */
+  Shard(std::size_t id, Server& server) noexcept;
+
+  /**
+   * @brief Sets the logger of this instance.
+   * This method sets the logger of this instance to the given one.
+   *
+   * @param logger [in]
+   *   The given logger.
+   */
+  void SetLogger(LoggerManager::Logger logger) noexcept;
+
+  /**
+   * @brief Returns this instance's logger.
+   * This method returns the logger of this instance.
+   *
+   * @return
+   *   The logger of this instance is returned. If the logger has not been set
+   *   this method returns std::nullptr.
+   */
+  [[nodiscard]] LoggerManager::Logger GetLogger() const noexcept;
+
+  /**
+   * @brief Returns the id of this shard.
+   *
+   * @return
+   *   The id of this shard is returned.
+   */
+  [[nodiscard]] std::size_t GetId() const noexcept;
+
+  /**
+   * @brief Returns the server.
+   *
+   * @return
+   *   The server owning this shard is returned.
+   */
+  [[nodiscard]] Server& GetServer() const noexcept;
+
+  /**
+   * @brief Returns the load metrics.
+   * This method returns the live load metrics of this shard.
+   *
+   * @return
+   *   A reference to the load metrics of this shard is returned.
+   */
+  Metrics& GetMetrics() noexcept;
+
+  /**
+   * @brief Returns the load metrics.
+   * This method returns the live load metrics of this shard.
+   *
+   * @return
+   *   A reference to the load metrics of this shard is returned.
+   */
+  [[nodiscard]] const Metrics& GetMetrics() const noexcept;
+
+  /**
+   * @brief Returns the overload controller.
+   * This method returns the controller deciding how much the games of this
+   * shard are degraded.
+   *
+   * @return
+   *   A reference to the overload controller of this shard is returned.
+   */
+  [[nodiscard]] const OverloadController& GetOverload() const noexcept;
+
+  /**
+   * @brief Returns the lag of the I/O context.
+   * This method returns how late handlers are dispatched by the I/O context of
+   * this shard (see LagProbe).
+   *
+   * @return
+   *   The lag of the I/O context of this shard is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::chrono::microseconds GetLag() const noexcept;
+
+  /**
+   * This method returns the reference to the I/O context of this shard.
+   *
+   * @return
+   *   The reference to the I/O context of this shard is returned.
+   */
+  boost::asio::io_context& GetIOContext() noexcept;
+
+  /**
+   * @brief Places a game on this shard.
+   * This method adds the given game to the games ticked by this shard.
+   *
+   * @param[in] game
+   *   The game to be placed on this shard.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void AddGame(std::shared_ptr<Game> game) noexcept;
+
+  /**
+   * @brief Removes a game from this shard.
+   * If the given game is not placed on this shard, the method does nothing.
+   *
+   * @param[in] game
+   *   The game to be removed.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void RemoveGame(const Game* game) noexcept;
+
+  /**
+   * @brief Returns the number of games.
+   * This method returns the number of games placed on this shard.
+   *
+   * @return
+   *   The number of games placed on this shard is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetNumberOfGames() const noexcept;
+
+  /**
+   * @brief Registers a session on this shard.
+   * If the session is already registered, its entry is replaced.
+   *
+   * @param[in] session
+   *   The registered session.
+   *
+   * @param[in] entry
+   *   The game joined by the session. By default the session has not joined
+   *   any game.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void AddSession(WebSocketSession* session, SessionEntry entry = {}) noexcept;
+
+  /**
+   * @brief Unregisters a session from this shard.
+   *
+   * @param[in] session
+   *   The unregistered session.
+   *
+   * @return
+   *   The entry of the session is returned. If the session is not registered
+   *   on this shard, std::nullopt is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  std::optional<SessionEntry> RemoveSession(WebSocketSession* session) noexcept;
+
+  /**
+   * @brief Returns the number of sessions.
+   * This method returns the number of sessions registered on this shard.
+   *
+   * @return
+   *   The number of sessions registered on this shard is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetNumberOfSessions() const noexcept;
+
+  /**
+   * @brief Schedules a flush of a session.
+   * This method adds the given session to the sessions, whose queued packages
+   * are written at the end of the current tick.
+   *
+   * @param[in] session
+   *   The session to be flushed.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void ScheduleFlush(std::shared_ptr<WebSocketSession> session) noexcept;
+
+  /**
+   * @brief Starts ticking.
+   * This method starts the periodic ticking of all games placed on this shard
+   * and the lag probe of its I/O context.
+   * Games are spread across the phase slots of the tick interval (see
+   * TickScheduler) and each slot is ticked by the same timer.
+   *
+   * @note
+   *   This method is indented to be called only once.
+   */
+  void StartTicking() noexcept;
+
+  /**
+   * @brief Runs the I/O context.
+   * This method runs the I/O context of this shard in the calling thread. It
+   * returns after Stop() has been called. The thread allocates from its own
+   * arena (see Allocator::BindThreadArena()).
+   */
+  void Run() noexcept;
+
+  /**
+   * @brief Stops the I/O context.
+   * This method stops ticking and the I/O context of this shard.
+   */
+  void Stop() noexcept;
+
+  /**
+   * @brief Releases the sessions of the shard.
+   * This method destroys the pending handlers and the scheduled flushes, which
+   * keep the sessions alive. The server calls it for all stopped shards before
+   * any of them is destroyed, since a migrated session is still registered in
+   * the Beast service of the I/O context it has been created on.
+   */
+  void ReleaseSessions() noexcept;
+
+  /**
+   * This constant contains the interval between two consecutive ticks of the
+   * games.
+   */
+  static constexpr std::chrono::milliseconds kTickInterval{50};
+
+  /**
+   * This constant contains the interval between two consecutive phase slots.
+   */
+  static constexpr auto kSlotInterval = kTickInterval / TickScheduler::kNumberOfSlots;
+
+ private:
+  /**
+   * This method schedules the tick of the next phase slot.
+   */
+  void ScheduleTick() noexcept;
+
+  /**
+   * This method is the callback to the tick timer. It ticks the games of the
+   * current phase slot, flushes the sessions and schedules the next slot. If
+   * the shard falls behind by more than a tick interval, the missed deadlines
+   * are dropped and the slip is reported. After the last slot of an interval
+   * the pressure of the interval, including the lag of the I/O context, is
+   * reported to the overload controller.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleTick(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This method writes the packages queued by all sessions scheduled for a
+   * flush. It's called at the end of each tick.
+   */
+  void FlushSessions() noexcept;
+
+  /**
+   * This method adds a sample to an exponential moving average.
+   *
+   * @param[in,out] average
+   *   The moving average.
+   *
+   * @param[in] sample
+   *   The new sample.
+   */
+  static void UpdateAverage(std::atomic<std::uint64_t>& average, std::int64_t sample) noexcept;
+
+  /**
+   * This is the id of this shard.
+   */
+  std::size_t id_;
+
+  /**
+   * This is the server owning this shard.
+   */
+  Server& server_;
+
+  /**
+   * This is the I/O context of a shard. It exposes the shutdown of its
+   * services, so the pending handlers can be destroyed before the context.
+   */
+  class IOContext : public boost::asio::io_context {
+   public:
+    using boost::asio::io_context::shutdown;
+  };
+
+  /**
+   * The context for providing core I/O functionality.
+   */
+  IOContext ioc_;
+
+  /**
+   * This object keeps the I/O context running when it has no work to do.
+   */
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_;
+
+  /**
+   * This timer is used to tick all games periodically.
+   */
+  boost::asio::steady_timer tick_timer_;
+
+  /**
+   * This holds the load metrics of this shard.
+   */
+  Metrics metrics_;
+
+  /**
+   * This holds all games placed on this shard, assigned to phase slots.
+   */
+  TickScheduler scheduler_;
+
+  /**
+   * This is the phase slot to be ticked next.
+   */
+  std::size_t current_slot_;
+
+  /**
+   * This is the planned start of the next phase slot.
+   */
+  std::chrono::steady_clock::time_point slot_deadline_;
+
+  /**
+   * This is the time spent on ticking the slots of the current tick interval.
+   */
+  std::chrono::microseconds interval_tick_time_;
+
+  /**
+   * This is the largest slip of a slot in the current tick interval.
+   */
+  std::chrono::microseconds interval_slip_;
+
+  /**
+   * This decides how much the games of this shard are degraded.
+   */
+  OverloadController overload_;
+
+  /**
+   * This measures the lag of the I/O context of this shard.
+   */
+  LagProbe lag_probe_;
+
+  /**
+   * This vector holds the games of the slot being ticked. It's kept between
+   * ticks, so its memory is reused.
+   */
+  std::vector<std::shared_ptr<Game>> ticked_games_;
+
+  /**
+   * This vector holds the sessions scheduled for a flush.
+   */
+  std::vector<std::shared_ptr<WebSocketSession>> pending_flushes_;
+
+  /**
+   * This vector holds the sessions being flushed. It's kept between ticks, so
+   * its memory is reused.
+   */
+  std::vector<std::shared_ptr<WebSocketSession>> flushed_sessions_;
+
+  /**
+   * This mutex is used to synchronise the access to the pending flushes.
+   */
+  std::mutex flush_mtx_;
+
+  /**
+   * This map holds the sessions registered on this shard.
+   */
+  std::unordered_map<WebSocketSession*, SessionEntry> sessions_;
+
+  /**
+   * This mutex is used to synchronise the access to the sessions.
+   */
+  mutable std::mutex sessions_mtx_;
+
+  /**
+   * @brief Shard's logger.
+   * This is a pointer to the logger used in Shard class.
+   */
+  LoggerManager::Logger logger_;
+};
+
+}  // namespace fusion_server
@@ -0,0 +1,301 @@
+/**
+ * @file buffer_pool.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the BufferPool class and the PoolAllocator class template.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <boost/beast/core/flat_buffer.hpp>
+
+namespace fusion_server::system {
+
+/**
+ * This class is a pool of memory blocks shared by all sessions. Blocks are
+ * grouped into size classes (powers of two). A released block is kept for
+ * reuse by another session instead of being returned to the system.
+ *
+ * Sessions borrow blocks only while a message is being read or written and
+ * release them as soon as the message has been handled, so an idle session
+ * holds no buffer memory at all.
+ */
+class BufferPool {
+ public:
+  /**
+   * This constant contains the size of the smallest block.
+   */
+  static constexpr std::size_t kMinBlockSize = 512;
+
+  /**
+   * This constant contains the size of the largest pooled block. Larger
+   * requests are served directly by the system allocator.
+   */
+  static constexpr std::size_t kMaxBlockSize = 64 * 1024;
+
+  /**
+   * This constant contains the number of size classes.
+   */
+  static constexpr std::size_t kNumberOfClasses = 8;
+
+  /**
+   * This constant contains the maximum number of free blocks kept in a single
+   * size class.
+   */
+  static constexpr std::size_t kMaxRetainedBlocks = 1024;
+
+  static_assert(kMinBlockSize << (kNumberOfClasses - 1) == kMaxBlockSize);
+
+  /**
+   * @brief Returns the pool.
+   * This function returns the pool shared by all sessions. The pool is never
+   * destroyed, so sessions destructed during the program exit can still
+   * release their blocks.
+   *
+   * @return
+   *   A reference to the pool is returned.
+   */
+  static BufferPool& Get() noexcept {
+    static auto* instance = new BufferPool;
+    return *instance;
+  }
+
+  /**
+   * @brief Borrows a block.
+   * This method returns a block of at least the given size.
+   *
+   * @param[in] size
+   *   The requested size.
+   *
+   * @return
+   *   A pointer to the borrowed block is returned.
+   *
+   * @throw std::bad_alloc
+   *   The system allocator has failed.
+   */
+  void* Allocate(std::size_t size) {
+    auto size_class = GetSizeClass(size);
+    if (size_class == kNumberOfClasses) {
+      borrowed_bytes_ += size;
+      return ::operator new(size);
+    }
+
+    auto block_size = kMinBlockSize << size_class;
+    borrowed_bytes_ += block_size;
+
+    auto& free_list = free_lists_[size_class];
+    if (std::unique_lock flm{free_list.mtx_}; !free_list.blocks_.empty()) {
+      auto* block = free_list.blocks_.back();
+      free_list.blocks_.pop_back();
+      retained_bytes_ -= block_size;
+      return block;
+    }
+    return ::operator new(block_size);
+  }
+
+  /**
+   * @brief Releases a block.
+   * This method returns the given block to the pool.
+   *
+   * @param[in] block
+   *   A block returned by Allocate().
+   *
+   * @param[in] size
+   *   The size passed to Allocate().
+   */
+  void Deallocate(void* block, std::size_t size) noexcept {
+    auto size_class = GetSizeClass(size);
+    if (size_class == kNumberOfClasses) {
+      borrowed_bytes_ -= size;
+      ::operator delete(block);
+      return;
+    }
+
+    auto block_size = kMinBlockSize << size_class;
+    borrowed_bytes_ -= block_size;
+
+    auto& free_list = free_lists_[size_class];
+    std::unique_lock flm{free_list.mtx_};
+    if (free_list.blocks_.size() >= kMaxRetainedBlocks) {
+      flm.unlock();
+      ::operator delete(block);
+      return;
+    }
+    free_list.blocks_.push_back(block);
+    retained_bytes_ += block_size;
+  }
+
+  /**
+   * @brief Returns the number of borrowed bytes.
+   *
+   * @return
+   *   The total size of all blocks currently borrowed from this pool is
+   *   returned.
+   */
+  [[nodiscard]] std::size_t GetBorrowedBytes() const noexcept {
+    return borrowed_bytes_;
+  }
+
+  /**
+   * @brief Returns the number of retained bytes.
+   *
+   * @return
+   *   The total size of all free blocks kept by this pool is returned.
+   */
+  [[nodiscard]] std::size_t GetRetainedBytes() const noexcept {
+    return retained_bytes_;
+  }
+
+ private:
+  /**
+   * This constructor is called only once, by the Get() function.
+   */
+  BufferPool() noexcept = default;
+
+  /**
+   * This method returns the size class of the given size.
+   *
+   * @param[in] size
+   *   The requested size.
+   *
+   * @return
+   *   The size class is returned. If the size is larger than kMaxBlockSize,
+   *   kNumberOfClasses is returned.
+   */
+  static std::size_t GetSizeClass(std::size_t size) noexcept {
+    std::size_t size_class = 0;
+    for (auto block_size = kMinBlockSize; block_size < size; block_size <<= 1) {
+      if (++size_class == kNumberOfClasses) {
+        break;
+      }
+    }
+    return size_class;
+  }
+
+  /**
+   * This structure holds the free blocks of a single size class.
+   */
+  struct FreeList {
+    /**
+     * This mutex is used to synchronise the access to the free blocks.
+     */
+    std::mutex mtx_;
+
+    /**
+     * This vector holds the free blocks.
+     */
+    std::vector<void*> blocks_;
+  };
+
+  /**
+   * This array holds the free blocks of all size classes.
+   */
+  std::array<FreeList, kNumberOfClasses> free_lists_;
+
+  /**
+   * This is the total size of all borrowed blocks.
+   */
+  std::atomic<std::size_t> borrowed_bytes_{0};
+
+  /**
+   * This is the total size of all free blocks kept by this pool.
+   */
+  std::atomic<std::size_t> retained_bytes_{0};
+};
+
+/**
+ * This class template is a stateless allocator, which borrows its memory from
+ * the BufferPool.
+ *
+ * @tparam T
+ *   The type of allocated objects.
+ */
+template <typename T>
+class PoolAllocator {
+ public:
+  /**
+   * This is the type of allocated objects.
+   */
+  using value_type = T;
+
+  /**
+   * @brief The default constructor.
+   */
+  PoolAllocator() noexcept = default;
+
+  /**
+   * @brief The converting constructor.
+   *
+   * @param[in] other
+   *   An allocator of another type.
+   */
+  template <typename U>
+  PoolAllocator([[maybe_unused]] const PoolAllocator<U>& other) noexcept {}
+
+  /**
+   * @brief Allocates memory.
+   *
+   * @param[in] n
+   *   The number of objects.
+   *
+   * @return
+   *   A pointer to the allocated memory is returned.
+   */
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(BufferPool::Get().Allocate(n * sizeof(T)));
+  }
+
+  /**
+   * @brief Deallocates memory.
+   *
+   * @param[in] p
+   *   A pointer returned by allocate().
+   *
+   * @param[in] n
+   *   The number of objects passed to allocate().
+   */
+  void deallocate(T* p, std::size_t n) noexcept {
+    BufferPool::Get().Deallocate(p, n * sizeof(T));
+  }
+
+  /**
+   * @brief Compares two allocators.
+   * All allocators are equal, since they share the same pool.
+   *
+   * @return
+   *   True is returned.
+   */
+  template <typename U>
+  bool operator==([[maybe_unused]] const PoolAllocator<U>& other) const noexcept {
+    return true;
+  }
+
+  /**
+   * @brief Compares two allocators.
+   * All allocators are equal, since they share the same pool.
+   *
+   * @return
+   *   False is returned.
+   */
+  template <typename U>
+  bool operator!=([[maybe_unused]] const PoolAllocator<U>& other) const noexcept {
+    return false;
+  }
+};
+
+/**
+ * This is the flat buffer, whose memory is borrowed from the BufferPool.
+ */
+using PooledFlatBuffer = boost::beast::basic_flat_buffer<PoolAllocator<char>>;
+
+}  // namespace fusion_server::system
@@ -0,0 +1,558 @@
+/**
+ * @file framed_stream.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the FramedStream class template.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <fusion_server/system/buffer_pool.hpp>
+#include <fusion_server/system/memory_stream.hpp>
+
+namespace fusion_server::system {
+
+/**
+ * This class template is the next layer of the WebSocket stream of a session.
+ * It reads the frames sent by the client ahead of the WebSocket stream and
+ * hands them over one at a time, so the WebSocket stream never holds bytes of
+ * a frame, which it hasn't been asked to read. Thanks to that a session can
+ * wait for its next frame outside of the WebSocket stream (see
+ * async_wait_frame()) and cancel the wait. A pending WebSocket read cannot be
+ * cancelled without failing the WebSocket stream.
+ *
+ * Pongs are consumed by this stream and reported to the pong handler, so a
+ * pong doesn't keep a WebSocket read pending.
+ *
+ * @tparam NextLayer
+ *   The type of the stream connected to the client.
+ */
+template <typename NextLayer>
+class FramedStream {
+ public:
+  /**
+   * This is the type of the stream connected to the client.
+   */
+  using next_layer_type = NextLayer;
+
+  /**
+   * This is the type of the executor of the stream.
+   */
+  using executor_type = typename NextLayer::executor_type;
+
+  /**
+   * This is the type of the handler called for each received pong.
+   */
+  using PongHandler = std::function<void()>;
+
+  /**
+   * This constructor takes the ownership of the stream connected to the
+   * client.
+   *
+   * @param[in] stream
+   *   The stream connected to the client.
+   */
+  explicit FramedStream(NextLayer stream) noexcept
+      : stream_{std::move(stream)}, frame_remaining_{0}, filling_{false},
+        wait_cancelled_{false} {}
+
+  /**
+   * @brief Returns the stream connected to the client.
+   *
+   * @return
+   *   A reference to the stream connected to the client is returned.
+   */
+  next_layer_type& next_layer() noexcept {
+    return stream_;
+  }
+
+  /**
+   * @brief Returns the stream connected to the client.
+   *
+   * @return
+   *   A reference to the stream connected to the client is returned.
+   */
+  const next_layer_type& next_layer() const noexcept {
+    return stream_;
+  }
+
+  /**
+   * @brief Returns the executor of the stream.
+   *
+   * @return
+   *   The executor of the stream connected to the client is returned.
+   */
+  executor_type get_executor() noexcept {
+    return stream_.get_executor();
+  }
+
+  /**
+   * @brief Sets the handler called for each received pong.
+   * The handler is called by the asynchronous operations of this stream. The
+   * pongs read synchronously (i.e. during the closing handshake) are dropped.
+   *
+   * @param[in] handler
+   *   The pong handler.
+   */
+  void SetPongHandler(PongHandler handler) noexcept {
+    on_pong_ = std::move(handler);
+  }
+
+  /**
+   * @brief Stores the bytes received before this stream has been created.
+   * They are read before the bytes of the next layer, so the frames pipelined
+   * by the client behind its upgrade request aren't lost.
+   *
+   * @param[in] bytes
+   *   The received bytes.
+   */
+  void Preload(boost::asio::const_buffer bytes) {
+    input_.commit(boost::asio::buffer_copy(input_.prepare(bytes.size()), bytes));
+  }
+
+  /**
+   * @brief Waits for the next frame.
+   * The wait completes once the header of a frame other than a pong has been
+   * received. It may be started only while no read is pending. The wait can
+   * be aborted by cancel_wait() without affecting the WebSocket stream; the
+   * bytes received so far are kept.
+   *
+   * @param[in] handler
+   *   The handler called with the error code.
+   */
+  template <typename WaitHandler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(WaitHandler, void(boost::system::error_code))
+  async_wait_frame(WaitHandler&& handler) {
+    boost::asio::async_completion<WaitHandler, void(boost::system::error_code)> init{handler};
+    wait_cancelled_ = false;
+    ContinueWait(std::move(init.completion_handler));
+    return init.result.get();
+  }
+
+  /**
+   * @brief Cancels the wait for the next frame.
+   * The operations of the next layer are cancelled. A read of the wait, which
+   * has already completed, e.g. with a pong, is not repeated; the wait is
+   * aborted instead.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   */
+  void cancel_wait(boost::system::error_code& ec) {
+    wait_cancelled_ = true;
+    stream_.cancel(ec);
+  }
+
+  /**
+   * @brief Reads some bytes of the current frame.
+   * This method blocks until at least one byte can be read.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   *
+   * @return
+   *   The number of bytes read is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec) {
+    ec = {};
+    if (boost::asio::buffer_size(buffers) == 0) {
+      return 0;
+    }
+    if (filling_) {
+      // A wait owns the buffer. The synchronous reads are only used by the
+      // closing handshake, so the frames aren't tracked anymore.
+      return stream_.read_some(buffers, ec);
+    }
+
+    while (!ParseHeader(false)) {
+      auto bytes_transmitted = stream_.read_some(input_.prepare(kFillSize), ec);
+      input_.commit(bytes_transmitted);
+      if (ec) {
+        return 0;
+      }
+    }
+    if (input_.size() != 0) {
+      return Deliver(buffers);
+    }
+    auto bytes_transmitted = stream_.read_some(
+      boost::beast::buffers_prefix(ClampToFrame(buffers), buffers), ec);
+    frame_remaining_ -= bytes_transmitted;
+    return bytes_transmitted;
+  }
+
+  /**
+   * @brief Reads some bytes of the current frame.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @throw boost::system::system_error
+   *   The read has failed.
+   *
+   * @return
+   *   The number of bytes read is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers) {
+    boost::system::error_code ec;
+    auto bytes_transmitted = read_some(buffers, ec);
+    if (ec) {
+      boost::throw_exception(boost::system::system_error{ec});
+    }
+    return bytes_transmitted;
+  }
+
+  /**
+   * @brief Writes some bytes.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   *
+   * @return
+   *   The number of bytes written is returned.
+   */
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec) {
+    return stream_.write_some(buffers, ec);
+  }
+
+  /**
+   * @brief Writes some bytes.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @throw boost::system::system_error
+   *   The write has failed.
+   *
+   * @return
+   *   The number of bytes written is returned.
+   */
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers) {
+    return stream_.write_some(buffers);
+  }
+
+  /**
+   * @brief Starts an asynchronous read of the current frame.
+   * The read never returns bytes following the frame, whose header has been
+   * read last. The rest of a frame is read directly into the given buffers.
+   *
+   * @param[in] buffers
+   *   The buffers to read into. They must stay valid until the handler is
+   *   called.
+   *
+   * @param[in] handler
+   *   The handler called with the error code and the number of bytes read.
+   */
+  template <typename MutableBufferSequence, typename ReadHandler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, std::size_t))
+  async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+    boost::asio::async_completion<ReadHandler,
+      void(boost::system::error_code, std::size_t)> init{handler};
+    ContinueRead(buffers, std::move(init.completion_handler));
+    return init.result.get();
+  }
+
+  /**
+   * @brief Starts an asynchronous write.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @param[in] handler
+   *   The handler called with the error code and the number of bytes written.
+   */
+  template <typename ConstBufferSequence, typename WriteHandler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(WriteHandler, void(boost::system::error_code, std::size_t))
+  async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler) {
+    return stream_.async_write_some(buffers, std::forward<WriteHandler>(handler));
+  }
+
+ private:
+  /**
+   * This constant contains the number of bytes read ahead at once.
+   */
+  static constexpr std::size_t kFillSize = BufferPool::kMinBlockSize;
+
+  /**
+   * This constant contains the opcode of a pong.
+   */
+  static constexpr std::uint8_t kPongOpcode = 0x0A;
+
+  /**
+   * This constant contains the largest payload of a control frame. A larger
+   * "pong" is handed over to the WebSocket stream, which rejects it.
+   */
+  static constexpr std::uint64_t kMaxControlPayload = 125;
+
+  /**
+   * @brief Parses the header of the next frame.
+   * The pongs at the front of the buffer are consumed.
+   *
+   * @param[in] report_pongs
+   *   Indicates whether the consumed pongs are reported to the pong handler.
+   *
+   * @return
+   *   An indication whether or not the bytes of a frame can be handed over is
+   *   returned. If it's false, more bytes have to be read first.
+   */
+  bool ParseHeader(bool report_pongs) {
+    while (frame_remaining_ == 0) {
+      const auto* bytes = static_cast<const std::uint8_t*>(input_.data().data());
+      auto size = input_.size();
+      if (size < 2) {
+        return false;
+      }
+
+      std::uint64_t payload_size = bytes[1] & 0x7Fu;
+      std::size_t length_size = payload_size == 126 ? 2 : payload_size == 127 ? 8 : 0;
+      std::size_t header_size = 2 + length_size + ((bytes[1] & 0x80u) != 0 ? 4 : 0);
+      if (size < header_size) {
+        return false;
+      }
+      if (length_size != 0) {
+        payload_size = 0;
+        for (std::size_t i = 0; i < length_size; i++) {
+          payload_size = payload_size << 8u | bytes[2 + i];
+        }
+      }
+
+      if ((bytes[0] & 0x0Fu) != kPongOpcode || payload_size > kMaxControlPayload) {
+        frame_remaining_ = std::min(payload_size,
+          std::numeric_limits<std::uint64_t>::max() - header_size) + header_size;
+        return true;
+      }
+      if (size < header_size + payload_size) {
+        return false;
+      }
+      input_.consume(header_size + payload_size);
+      if (report_pongs && on_pong_ != nullptr) {
+        on_pong_();
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns the size of the given buffers limited to the current frame.
+   *
+   * @param[in] buffers
+   *   The buffers.
+   *
+   * @return
+   *   The number of bytes, which may be read into the buffers, is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t ClampToFrame(const MutableBufferSequence& buffers) const noexcept {
+    return static_cast<std::size_t>(std::min<std::uint64_t>(
+      frame_remaining_, boost::asio::buffer_size(buffers)));
+  }
+
+  /**
+   * @brief Copies the buffered bytes of the current frame to the given
+   * buffers. The memory of the buffer is returned to the pool once all bytes
+   * have been handed over.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @return
+   *   The number of bytes copied is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t Deliver(const MutableBufferSequence& buffers) {
+    auto bytes_transmitted = boost::asio::buffer_copy(buffers,
+      boost::beast::buffers_prefix(ClampToFrame(buffers), input_.data()));
+    input_.consume(bytes_transmitted);
+    frame_remaining_ -= bytes_transmitted;
+    if (input_.size() == 0) {
+      input_.shrink_to_fit();
+    }
+    return bytes_transmitted;
+  }
+
+  /**
+   * @brief Reads ahead some bytes into the buffer.
+   *
+   * @param[in] executor
+   *   The executor of the operation's handler.
+   *
+   * @param[in] handler
+   *   The handler called with the error code.
+   */
+  template <typename Executor, typename Handler>
+  void Fill(const Executor& executor, Handler handler) {
+    filling_ = true;
+    stream_.async_read_some(input_.prepare(kFillSize), boost::asio::bind_executor(executor,
+      [this, handler = std::move(handler)](const boost::system::error_code& ec,
+          std::size_t bytes_transmitted) mutable {
+        filling_ = false;
+        input_.commit(bytes_transmitted);
+        handler(ec);
+      }));
+  }
+
+  /**
+   * @brief Continues the asynchronous wait for the next frame.
+   *
+   * @param[in] handler
+   *   The completion handler.
+   */
+  template <typename Handler>
+  void ContinueWait(Handler handler) {
+    if (ParseHeader(true)) {
+      boost::asio::post(get_executor(), boost::beast::bind_handler(
+        std::move(handler), boost::system::error_code{}));
+      return;
+    }
+
+    auto executor = boost::asio::get_associated_executor(handler, get_executor());
+    Fill(executor, [this, handler = std::move(handler)](const boost::system::error_code& ec) mutable {
+      if (ec) {
+        handler(ec);
+        return;
+      }
+      if (wait_cancelled_) {
+        // The read completed before it was cancelled.
+        handler(boost::asio::error::operation_aborted);
+        return;
+      }
+      ContinueWait(std::move(handler));
+    });
+  }
+
+  /**
+   * @brief Continues the asynchronous read of the current frame.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @param[in] handler
+   *   The completion handler.
+   */
+  template <typename MutableBufferSequence, typename Handler>
+  void ContinueRead(const MutableBufferSequence& buffers, Handler handler) {
+    if (boost::asio::buffer_size(buffers) == 0 || (ParseHeader(true) && input_.size() != 0)) {
+      auto bytes_transmitted = boost::asio::buffer_size(buffers) == 0 ? 0 : Deliver(buffers);
+      boost::asio::post(get_executor(), boost::beast::bind_handler(
+        std::move(handler), boost::system::error_code{}, bytes_transmitted));
+      return;
+    }
+
+    auto executor = boost::asio::get_associated_executor(handler, get_executor());
+    if (frame_remaining_ != 0) {
+      stream_.async_read_some(boost::beast::buffers_prefix(ClampToFrame(buffers), buffers),
+        boost::asio::bind_executor(executor, [this, handler = std::move(handler)](
+            const boost::system::error_code& ec, std::size_t bytes_transmitted) mutable {
+          frame_remaining_ -= bytes_transmitted;
+          handler(ec, bytes_transmitted);
+        }));
+      return;
+    }
+
+    Fill(executor, [this, buffers, handler = std::move(handler)](
+        const boost::system::error_code& ec) mutable {
+      if (ec) {
+        handler(ec, 0);
+        return;
+      }
+      ContinueRead(buffers, std::move(handler));
+    });
+  }
+
+  /**
+   * This is the stream connected to the client.
+   */
+  NextLayer stream_;
+
+  /**
+   * This buffer holds the bytes read ahead, which haven't been handed over to
+   * the WebSocket stream yet.
+   */
+  PooledFlatBuffer input_;
+
+  /**
+   * This is the number of bytes of the current frame (including its header),
+   * which haven't been handed over yet. It's zero between frames.
+   */
+  std::uint64_t frame_remaining_;
+
+  /**
+   * This indicates whether or not an asynchronous read into the buffer is
+   * pending.
+   */
+  bool filling_;
+
+  /**
+   * This indicates whether or not the current wait has been cancelled.
+   */
+  bool wait_cancelled_;
+
+  /**
+   * This is the handler called for each received pong.
+   */
+  PongHandler on_pong_;
+};
+
+/**
+ * @brief Tears down the stream after a WebSocket closing handshake.
+ * It's found by Boost::Beast through argument-dependent lookup.
+ *
+ * @param[in] role
+ *   The role of the WebSocket stream.
+ *
+ * @param[in] stream
+ *   The stream.
+ *
+ * @param[out] ec
+ *   This is the Boost error code.
+ */
+template <typename NextLayer>
+void teardown(WebSocketRole role, FramedStream<NextLayer>& stream,
+    boost::system::error_code& ec) {
+  using boost::beast::websocket::teardown;
+  teardown(role, stream.next_layer(), ec);
+}
+
+/**
+ * @brief Tears down the stream after a WebSocket closing handshake.
+ * It's found by Boost::Beast through argument-dependent lookup.
+ *
+ * @param[in] role
+ *   The role of the WebSocket stream.
+ *
+ * @param[in] stream
+ *   The stream.
+ *
+ * @param[in] handler
+ *   The handler called with the error code.
+ */
+template <typename NextLayer, typename TeardownHandler>
+void async_teardown(WebSocketRole role, FramedStream<NextLayer>& stream,
+    TeardownHandler&& handler) {
+  using boost::beast::websocket::async_teardown;
+  async_teardown(role, stream.next_layer(), std::forward<TeardownHandler>(handler));
+}
+
+}  // namespace fusion_server::system
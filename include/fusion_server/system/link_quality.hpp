@@ -0,0 +1,231 @@
+/**
+ * @file link_quality.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the LinkQuality class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+
+namespace fusion_server::system {
+
+/**
+ * This class estimates the capacity of a client's link. It measures the round
+ * trip time with WebSocket pings and the drain rate, i.e. how fast the written
+ * bytes leave the socket, and derives from them how often the client should
+ * receive state updates.
+ */
+class LinkQuality {
+ public:
+  /**
+   * This is the clock used to measure the time.
+   */
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * This enumeration represents the detail level of state updates.
+   */
+  enum class Detail {
+    /**
+     * State updates carry all attributes.
+     */
+    kFull,
+
+    /**
+     * State updates carry only the attributes changing during the game.
+     */
+    kReduced,
+  };
+
+  /**
+   * This constant contains the minimal interval between two pings.
+   */
+  static constexpr std::chrono::milliseconds kPingInterval{2000};
+
+  /**
+   * This constant contains the round trip time, above which state updates
+   * are sent at half rate.
+   */
+  static constexpr std::chrono::milliseconds kHighRtt{150};
+
+  /**
+   * This constant contains the round trip time, above which state updates
+   * are sent at a quarter rate.
+   */
+  static constexpr std::chrono::milliseconds kVeryHighRtt{400};
+
+  /**
+   * This constant contains the time, in which the client should be able to
+   * drain all bytes queued for it. If it can't, the update rate is halved.
+   */
+  static constexpr std::chrono::milliseconds kDrainWindow{50};
+
+  /**
+   * This constant contains the largest update divisor.
+   */
+  static constexpr std::size_t kMaxUpdateDivisor = 4;
+
+  /**
+   * @brief Checks if a ping should be sent.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   True is returned if no ping is outstanding and the last ping has been
+   *   sent at least kPingInterval ago.
+   */
+  [[nodiscard]] bool ShouldPing(Clock::time_point now = Clock::now()) const noexcept {
+    return !ping_outstanding_ && now - last_ping_ >= kPingInterval;
+  }
+
+  /**
+   * @brief Records a sent ping.
+   *
+   * @param[in] now
+   *   The current point in time.
+   */
+  void OnPingSent(Clock::time_point now = Clock::now()) noexcept {
+    ping_outstanding_ = true;
+    last_ping_ = now;
+  }
+
+  /**
+   * @brief Records a received pong.
+   * A pong without an outstanding ping is ignored.
+   *
+   * @param[in] now
+   *   The current point in time.
+   */
+  void OnPong(Clock::time_point now = Clock::now()) noexcept {
+    if (!ping_outstanding_) {
+      return;
+    }
+    ping_outstanding_ = false;
+    auto sample = std::chrono::duration_cast<std::chrono::microseconds>(now - last_ping_);
+    // The first sample is taken as is. Then the weight of a sample is 1/4.
+    rtt_ = rtt_.count() == 0 ? sample : rtt_ + (sample - rtt_) / 4;
+  }
+
+  /**
+   * @brief Records a completed write.
+   *
+   * @param[in] bytes
+   *   The number of written bytes.
+   *
+   * @param[in] duration
+   *   The time between the start and the completion of the write.
+   */
+  void OnWriteCompleted(std::size_t bytes, Clock::duration duration) noexcept {
+    auto seconds = std::max(std::chrono::duration<double>(duration).count(), 1e-6);
+    auto sample = static_cast<double>(bytes) / seconds;
+    drain_rate_ = drain_rate_ == 0.0 ? sample : drain_rate_ + (sample - drain_rate_) / 4;
+  }
+
+  /**
+   * @brief Returns the round trip time.
+   * If a ping has been outstanding for longer than the measured round trip
+   * time, the time since the ping is returned instead, so a stalled client is
+   * recognised before its pong arrives.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   The estimated round trip time is returned. If it hasn't been measured
+   *   yet, zero is returned.
+   */
+  [[nodiscard]] std::chrono::microseconds GetRtt(Clock::time_point now = Clock::now()) const noexcept {
+    if (!ping_outstanding_) {
+      return rtt_;
+    }
+    return std::max(rtt_, std::chrono::duration_cast<std::chrono::microseconds>(now - last_ping_));
+  }
+
+  /**
+   * @brief Returns the drain rate.
+   *
+   * @return
+   *   The estimated drain rate in bytes per second is returned. If it hasn't
+   *   been measured yet, zero is returned.
+   */
+  [[nodiscard]] double GetDrainRate() const noexcept {
+    return drain_rate_;
+  }
+
+  /**
+   * @brief Returns the update divisor.
+   * This method returns how many state updates are dropped (replaced by the
+   * newer ones) per each sent state update.
+   *
+   * @param[in] queued_bytes
+   *   The number of bytes queued for the client.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   The number of ticks between two state updates sent to the client is
+   *   returned. It's 1, 2 or kMaxUpdateDivisor.
+   */
+  [[nodiscard]] std::size_t GetUpdateDivisor(std::size_t queued_bytes,
+      Clock::time_point now = Clock::now()) const noexcept {
+    auto rtt = GetRtt(now);
+    std::size_t divisor = rtt >= kVeryHighRtt ? 4 : rtt >= kHighRtt ? 2 : 1;
+
+    auto drain_budget = drain_rate_ * std::chrono::duration<double>(kDrainWindow).count();
+    if (drain_rate_ != 0.0 && static_cast<double>(queued_bytes) > drain_budget) {
+      divisor *= 2;
+    }
+    return std::min(divisor, kMaxUpdateDivisor);
+  }
+
+  /**
+   * @brief Returns the detail level.
+   *
+   * @param[in] queued_bytes
+   *   The number of bytes queued for the client.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   The reduced detail level is returned for clients, whose update rate has
+   *   been lowered to the minimum. Otherwise the full level is returned.
+   */
+  [[nodiscard]] Detail GetDetail(std::size_t queued_bytes,
+      Clock::time_point now = Clock::now()) const noexcept {
+    return GetUpdateDivisor(queued_bytes, now) == kMaxUpdateDivisor ?
+      Detail::kReduced : Detail::kFull;
+  }
+
+ private:
+  /**
+   * This is the estimated round trip time.
+   */
+  std::chrono::microseconds rtt_{0};
+
+  /**
+   * This is the estimated drain rate in bytes per second.
+   */
+  double drain_rate_ = 0.0;
+
+  /**
+   * This is the point in time, when the last ping has been sent.
+   */
+  Clock::time_point last_ping_{};
+
+  /**
+   * This indicates whether or not a ping awaits its pong.
+   */
+  bool ping_outstanding_ = false;
+};
+
+}  // namespace fusion_server::system
@@ -0,0 +1,686 @@
+/**
+ * @file memory_stream.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the MemoryStream class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/version.hpp>
+
+namespace fusion_server::system {
+
+#if BOOST_VERSION >= 107000
+/**
+ * This is the role of a WebSocket stream passed to the teardown functions.
+ */
+using WebSocketRole = boost::beast::role_type;
+#else
+/**
+ * This is the role of a WebSocket stream passed to the teardown functions.
+ */
+using WebSocketRole = boost::beast::websocket::role_type;
+#endif
+
+/**
+ * This class is one end of an in-memory duplex stream. The bytes written to
+ * one end are read from the other one, without any socket or system call
+ * involved. It provides the part of the boost::asio::ip::tcp::socket interface
+ * used by the sessions (the synchronous and asynchronous stream operations,
+ * the endpoints, shutdown() and close()), so a session templated over the
+ * stream type runs on it unchanged. It's used to test and benchmark the
+ * sessions deterministically.
+ *
+ * Written bytes are buffered without limit, so a write never waits for the
+ * reader. Asynchronous reads complete on the executor of the reading end;
+ * synchronous reads block the calling thread until some bytes arrive.
+ *
+ * @note
+ *   The ends of a pair may be used by different threads. A single end
+ *   supports one read and one write at a time, just like a socket.
+ */
+class MemoryStream {
+ public:
+  /**
+   * This is the type of the executor of a stream.
+   */
+  using executor_type = boost::asio::io_context::executor_type;
+
+  /**
+   * This is the type of the endpoints of a stream. The ends of a pair have
+   * unique loopback endpoints, so they can be told apart in logs.
+   */
+  using endpoint_type = boost::asio::ip::tcp::endpoint;
+
+  /**
+   * @brief Creates a connected pair of streams.
+   *
+   * @param[in] first_ioc
+   *   The I/O context of the first stream.
+   *
+   * @param[in] second_ioc
+   *   The I/O context of the second stream.
+   *
+   * @return
+   *   A pair of streams connected to each other is returned.
+   */
+  static std::pair<MemoryStream, MemoryStream>
+  MakePair(boost::asio::io_context& first_ioc, boost::asio::io_context& second_ioc) {
+    auto first_to_second = std::make_shared<Pipe>();
+    auto second_to_first = std::make_shared<Pipe>();
+    auto port = next_port_.fetch_add(2);
+    endpoint_type first_endpoint{boost::asio::ip::address_v4::loopback(), port};
+    endpoint_type second_endpoint{boost::asio::ip::address_v4::loopback(),
+      static_cast<unsigned short>(port + 1)};
+    return {
+      MemoryStream{first_ioc, second_to_first, first_to_second, first_endpoint, second_endpoint},
+      MemoryStream{second_ioc, first_to_second, second_to_first, second_endpoint, first_endpoint},
+    };
+  }
+
+  /**
+   * @brief Move constructor.
+   *
+   * @param[in] other
+   *   Moved stream.
+   */
+  MemoryStream(MemoryStream&& other) noexcept = default;
+
+  /**
+   * @brief Move operator.
+   *
+   * @param[in] other
+   *   Moved stream.
+   *
+   * @return
+   *   Reference to `this` object.
+   */
+  MemoryStream& operator=(MemoryStream&& other) noexcept = default;
+
+  /**
+   * This destructor closes the stream.
+   */
+  ~MemoryStream() noexcept {
+    boost::system::error_code ec;
+    close(ec);
+  }
+
+  /**
+   * @brief Returns the executor of this stream.
+   *
+   * @return
+   *   The executor of the I/O context of this stream is returned.
+   */
+  executor_type get_executor() noexcept {
+    return ioc_->get_executor();
+  }
+
+  /**
+   * @brief Checks if the stream is open.
+   *
+   * @return
+   *   An indication whether or not the stream has not been closed is returned.
+   */
+  [[nodiscard]] bool is_open() const noexcept {
+    if (inbound_ == nullptr) {
+      return false;
+    }
+    std::unique_lock pm{inbound_->mtx_};
+    return inbound_->error_ != boost::asio::error::operation_aborted;
+  }
+
+  /**
+   * @brief Returns the endpoint of this stream.
+   *
+   * @param[out] ec
+   *   This is the Boost error code. It's always cleared.
+   *
+   * @return
+   *   The endpoint of this stream is returned.
+   */
+  endpoint_type local_endpoint(boost::system::error_code& ec) const noexcept {
+    ec = {};
+    return local_endpoint_;
+  }
+
+  /**
+   * @brief Returns the endpoint of the other end.
+   *
+   * @return
+   *   The endpoint of the other end is returned.
+   */
+  [[nodiscard]] endpoint_type remote_endpoint() const noexcept {
+    return remote_endpoint_;
+  }
+
+  /**
+   * @brief Returns the endpoint of the other end.
+   *
+   * @param[out] ec
+   *   This is the Boost error code. It's always cleared.
+   *
+   * @return
+   *   The endpoint of the other end is returned.
+   */
+  endpoint_type remote_endpoint(boost::system::error_code& ec) const noexcept {
+    ec = {};
+    return remote_endpoint_;
+  }
+
+  /**
+   * @brief Disables reads, writes or both.
+   * After the writes are shut down, the other end reads the buffered bytes and
+   * then the end of the stream.
+   *
+   * @param[in] what
+   *   The operations to be shut down.
+   *
+   * @param[out] ec
+   *   This is the Boost error code. It's always cleared.
+   */
+  void shutdown(boost::asio::socket_base::shutdown_type what,
+      boost::system::error_code& ec) noexcept {
+    ec = {};
+    if (inbound_ == nullptr) {
+      return;
+    }
+    if (what != boost::asio::socket_base::shutdown_send) {
+      inbound_->Finish(boost::asio::error::eof);
+    }
+    if (what != boost::asio::socket_base::shutdown_receive) {
+      outbound_->Finish(boost::asio::error::eof);
+    }
+  }
+
+  /**
+   * @brief Disables reads, writes or both.
+   *
+   * @param[in] what
+   *   The operations to be shut down.
+   */
+  void shutdown(boost::asio::socket_base::shutdown_type what) noexcept {
+    boost::system::error_code ec;
+    shutdown(what, ec);
+  }
+
+  /**
+   * @brief Closes the stream.
+   * A pending read of this end completes with operation_aborted. The other end
+   * reads the buffered bytes and then the end of the stream.
+   *
+   * @param[out] ec
+   *   This is the Boost error code. It's always cleared.
+   */
+  void close(boost::system::error_code& ec) noexcept {
+    ec = {};
+    if (inbound_ == nullptr) {
+      return;
+    }
+    inbound_->Finish(boost::asio::error::operation_aborted);
+    outbound_->Finish(boost::asio::error::eof);
+  }
+
+  /**
+   * @brief Closes the stream.
+   */
+  void close() noexcept {
+    boost::system::error_code ec;
+    close(ec);
+  }
+
+  /**
+   * @brief Reads some bytes.
+   * This method blocks until at least one byte can be read or the stream has
+   * ended.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   *
+   * @return
+   *   The number of bytes read is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec) {
+    if (boost::asio::buffer_size(buffers) == 0) {
+      ec = {};
+      return 0;
+    }
+    std::unique_lock pm{inbound_->mtx_};
+    inbound_->cv_.wait(pm, [this] {
+      return inbound_->data_.size() != 0 || inbound_->error_;
+    });
+    return inbound_->Take(buffers, ec);
+  }
+
+  /**
+   * @brief Reads some bytes.
+   *
+   * @param[in] buffers
+   *   The buffers to read into.
+   *
+   * @throw boost::system::system_error
+   *   The read has failed.
+   *
+   * @return
+   *   The number of bytes read is returned.
+   */
+  template <typename MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence& buffers) {
+    boost::system::error_code ec;
+    auto bytes_transmitted = read_some(buffers, ec);
+    if (ec) {
+      boost::throw_exception(boost::system::system_error{ec});
+    }
+    return bytes_transmitted;
+  }
+
+  /**
+   * @brief Writes some bytes.
+   * All bytes are written at once, since the stream buffers them without
+   * limit.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @param[out] ec
+   *   This is the Boost error code. If the other end has been closed or the
+   *   writes have been shut down, it's set to broken_pipe.
+   *
+   * @return
+   *   The number of bytes written is returned.
+   */
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec) {
+    if (outbound_ == nullptr) {
+      ec = boost::asio::error::bad_descriptor;
+      return 0;
+    }
+    return outbound_->Put(buffers, ec);
+  }
+
+  /**
+   * @brief Writes some bytes.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @throw boost::system::system_error
+   *   The write has failed.
+   *
+   * @return
+   *   The number of bytes written is returned.
+   */
+  template <typename ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence& buffers) {
+    boost::system::error_code ec;
+    auto bytes_transmitted = write_some(buffers, ec);
+    if (ec) {
+      boost::throw_exception(boost::system::system_error{ec});
+    }
+    return bytes_transmitted;
+  }
+
+  /**
+   * @brief Starts an asynchronous read.
+   * The read completes as soon as at least one byte is available or the stream
+   * has ended.
+   *
+   * @param[in] buffers
+   *   The buffers to read into. They must stay valid until the handler is
+   *   called.
+   *
+   * @param[in] handler
+   *   The handler called with the error code and the number of bytes read.
+   */
+  template <typename MutableBufferSequence, typename ReadHandler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, std::size_t))
+  async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+    boost::asio::async_completion<ReadHandler,
+      void(boost::system::error_code, std::size_t)> init{handler};
+    using Op = ReadOp<MutableBufferSequence,
+      typename decltype(init)::completion_handler_type>;
+    auto op = std::make_unique<Op>(get_executor(), buffers,
+      std::move(init.completion_handler));
+
+    std::unique_lock pm{inbound_->mtx_};
+    if (boost::asio::buffer_size(buffers) == 0 || inbound_->data_.size() != 0 || inbound_->error_) {
+      op->Complete(*inbound_);
+    } else {
+      inbound_->reader_ = std::move(op);
+    }
+    pm.unlock();
+    return init.result.get();
+  }
+
+  /**
+   * @brief Starts an asynchronous write.
+   * The bytes are written at once; the handler is called through the executor
+   * of this stream.
+   *
+   * @param[in] buffers
+   *   The buffers to be written.
+   *
+   * @param[in] handler
+   *   The handler called with the error code and the number of bytes written.
+   */
+  template <typename ConstBufferSequence, typename WriteHandler>
+  BOOST_ASIO_INITFN_RESULT_TYPE(WriteHandler, void(boost::system::error_code, std::size_t))
+  async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler) {
+    boost::asio::async_completion<WriteHandler,
+      void(boost::system::error_code, std::size_t)> init{handler};
+    boost::system::error_code ec;
+    auto bytes_transmitted = write_some(buffers, ec);
+    boost::asio::post(get_executor(), boost::beast::bind_handler(
+      std::move(init.completion_handler), ec, bytes_transmitted));
+    return init.result.get();
+  }
+
+ private:
+  /**
+   * This is the forward declaration of the Pipe structure.
+   */
+  struct Pipe;
+
+  /**
+   * This is the interface of an asynchronous read waiting for bytes.
+   */
+  class PendingRead {
+   public:
+    virtual ~PendingRead() noexcept = default;
+
+    /**
+     * @brief Completes the read.
+     * This method takes the available bytes (or the error) from the pipe and
+     * posts the handler to its executor. The pipe's mutex must be held.
+     *
+     * @param[in] pipe
+     *   The pipe read from.
+     */
+    virtual void Complete(Pipe& pipe) noexcept = 0;
+  };
+
+  /**
+   * This structure holds the bytes travelling in one direction.
+   */
+  struct Pipe {
+    /**
+     * @brief Copies the buffered bytes to the given buffers.
+     * The mutex must be held.
+     *
+     * @param[in] buffers
+     *   The buffers to read into.
+     *
+     * @param[out] ec
+     *   This is the Boost error code. If no bytes are buffered, it's set to
+     *   the error ending the pipe.
+     *
+     * @return
+     *   The number of bytes read is returned.
+     */
+    template <typename MutableBufferSequence>
+    std::size_t Take(const MutableBufferSequence& buffers, boost::system::error_code& ec) noexcept {
+      if (data_.size() == 0) {
+        ec = error_;
+        return 0;
+      }
+      ec = {};
+      auto bytes_transmitted = boost::asio::buffer_copy(buffers, data_.data());
+      data_.consume(bytes_transmitted);
+      return bytes_transmitted;
+    }
+
+    /**
+     * @brief Appends the given bytes and wakes up the reader.
+     *
+     * @param[in] buffers
+     *   The buffers to be written.
+     *
+     * @param[out] ec
+     *   This is the Boost error code.
+     *
+     * @return
+     *   The number of bytes written is returned.
+     */
+    template <typename ConstBufferSequence>
+    std::size_t Put(const ConstBufferSequence& buffers, boost::system::error_code& ec) noexcept {
+      std::unique_lock pm{mtx_};
+      if (error_) {
+        ec = boost::asio::error::broken_pipe;
+        return 0;
+      }
+      ec = {};
+      auto size = boost::asio::buffer_size(buffers);
+      data_.commit(boost::asio::buffer_copy(data_.prepare(size), buffers));
+      Wake();
+      return size;
+    }
+
+    /**
+     * @brief Ends the pipe.
+     * The reader reads the buffered bytes (unless the pipe is aborted) and
+     * then gets the given error.
+     *
+     * @param[in] error
+     *   The error ending the pipe: eof or operation_aborted.
+     */
+    void Finish(boost::system::error_code error) noexcept {
+      std::unique_lock pm{mtx_};
+      if (error_ == boost::asio::error::operation_aborted) {
+        return;
+      }
+      error_ = error;
+      if (error == boost::asio::error::operation_aborted) {
+        data_.consume(data_.size());
+      }
+      Wake();
+    }
+
+    /**
+     * @brief Wakes up the readers. The mutex must be held.
+     */
+    void Wake() noexcept {
+      if (reader_ != nullptr) {
+        reader_->Complete(*this);
+        reader_.reset();
+      }
+      cv_.notify_all();
+    }
+
+    /**
+     * This is the mutex guarding the pipe.
+     */
+    std::mutex mtx_;
+
+    /**
+     * This condition variable is notified, when bytes arrive or the pipe ends.
+     */
+    std::condition_variable cv_;
+
+    /**
+     * These are the bytes, which haven't been read yet.
+     */
+    boost::beast::flat_buffer data_;
+
+    /**
+     * This is the error ending the pipe. The bytes are read until it's set
+     * and the buffer is empty.
+     */
+    boost::system::error_code error_;
+
+    /**
+     * This is the asynchronous read waiting for bytes, if any.
+     */
+    std::unique_ptr<PendingRead> reader_;
+  };
+
+  /**
+   * This class is an asynchronous read of the given buffers.
+   */
+  template <typename MutableBufferSequence, typename Handler>
+  class ReadOp final : public PendingRead {
+   public:
+    /**
+     * @brief Creates the read.
+     *
+     * @param[in] executor
+     *   The executor of the reading stream.
+     *
+     * @param[in] buffers
+     *   The buffers to read into.
+     *
+     * @param[in] handler
+     *   The completion handler.
+     */
+    ReadOp(executor_type executor, const MutableBufferSequence& buffers, Handler handler)
+        : work_{executor}, buffers_{buffers}, handler_{std::move(handler)} {}
+
+    void Complete(Pipe& pipe) noexcept override {
+      boost::system::error_code ec;
+      auto bytes_transmitted = pipe.Take(buffers_, ec);
+      boost::asio::post(work_.get_executor(), boost::beast::bind_handler(
+        std::move(handler_), ec, bytes_transmitted));
+    }
+
+   private:
+    /**
+     * This keeps the I/O context of the reading stream running, while the read
+     * is pending.
+     */
+    boost::asio::executor_work_guard<executor_type> work_;
+
+    /**
+     * These are the buffers to read into.
+     */
+    MutableBufferSequence buffers_;
+
+    /**
+     * This is the completion handler.
+     */
+    Handler handler_;
+  };
+
+  /**
+   * This constructor is used by MakePair().
+   *
+   * @param[in] ioc
+   *   The I/O context of this stream.
+   *
+   * @param[in] inbound
+   *   The pipe read by this stream.
+   *
+   * @param[in] outbound
+   *   The pipe written by this stream.
+   *
+   * @param[in] local_endpoint
+   *   The endpoint of this stream.
+   *
+   * @param[in] remote_endpoint
+   *   The endpoint of the other end.
+   */
+  MemoryStream(boost::asio::io_context& ioc, std::shared_ptr<Pipe> inbound,
+      std::shared_ptr<Pipe> outbound, endpoint_type local_endpoint,
+      endpoint_type remote_endpoint) noexcept
+      : ioc_{&ioc}, inbound_{std::move(inbound)}, outbound_{std::move(outbound)},
+        local_endpoint_{local_endpoint}, remote_endpoint_{remote_endpoint} {}
+
+  /**
+   * This is the next port used by MakePair().
+   */
+  static inline std::atomic<unsigned short> next_port_{1};
+
+  /**
+   * This is the I/O context of this stream.
+   */
+  boost::asio::io_context* ioc_;
+
+  /**
+   * This is the pipe read by this stream. It's nullptr in a moved-from stream.
+   */
+  std::shared_ptr<Pipe> inbound_;
+
+  /**
+   * This is the pipe written by this stream. It's nullptr in a moved-from
+   * stream.
+   */
+  std::shared_ptr<Pipe> outbound_;
+
+  /**
+   * This is the endpoint of this stream.
+   */
+  endpoint_type local_endpoint_;
+
+  /**
+   * This is the endpoint of the other end.
+   */
+  endpoint_type remote_endpoint_;
+};
+
+/**
+ * @brief Closes the stream, when a Boost::Beast operation times out.
+ * It's found by Boost::Beast through argument-dependent lookup.
+ *
+ * @param[in] stream
+ *   The stream.
+ */
+inline void beast_close_socket(MemoryStream& stream) noexcept {
+  stream.close();
+}
+
+/**
+ * @brief Tears down the stream after a WebSocket closing handshake.
+ * It's found by Boost::Beast through argument-dependent lookup.
+ *
+ * @param[in] role
+ *   The role of the WebSocket stream.
+ *
+ * @param[in] stream
+ *   The stream.
+ *
+ * @param[out] ec
+ *   This is the Boost error code.
+ */
+inline void teardown([[maybe_unused]] WebSocketRole role,
+    MemoryStream& stream, boost::system::error_code& ec) noexcept {
+  stream.close(ec);
+}
+
+/**
+ * @brief Tears down the stream after a WebSocket closing handshake.
+ * It's found by Boost::Beast through argument-dependent lookup.
+ *
+ * @param[in] role
+ *   The role of the WebSocket stream.
+ *
+ * @param[in] stream
+ *   The stream.
+ *
+ * @param[in] handler
+ *   The handler called with the error code.
+ */
+template <typename TeardownHandler>
+void async_teardown([[maybe_unused]] WebSocketRole role,
+    MemoryStream& stream, TeardownHandler&& handler) {
+  boost::system::error_code ec;
+  stream.close(ec);
+  boost::asio::post(stream.get_executor(), boost::beast::bind_handler(
+    std::forward<TeardownHandler>(handler), ec));
+}
+
+}  // namespace fusion_server::system
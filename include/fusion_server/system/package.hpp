@@ -2,7 +2,7 @@
  * @file package.hpp
  *
  * This module is a part of Fusion Server project.
- * It declares the package type and other related types.
+ * It declares the package type.
  *
  * Copyright 2019 Kamil Rusin
  */
@@ -10,19 +10,10 @@
 
 #pragma once
 
-#include <functional>
 #include <string>
 
-#include <fusion_server/json.hpp>
-
-
 namespace fusion_server {
 
-/**
- * This is the forward declaration of the WebSocketSession class.
- */
-class WebSocketSession;
-
 namespace system {
 
 /**
@@ -30,18 +21,6 @@ namespace system {
  */
 using Package = const std::string;
 
-/**
- * This type is used to create delegates that will be called by WebSocket
- * sessions each time, when a new package arrives.
- *
- * @param[in] package
- *   The package received from the client.
- *
- * @param[in] session
- *   The session connected to the client.
- */
-using IncomingPackageDelegate = std::function<void(const json::JSON& package, WebSocketSession* session)>;
-
 }  // namespace system
 
 }  // namespace fusion_server
@@ -0,0 +1,123 @@
+/**
+ * @file rate_limiter.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the RateLimiter class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+
+namespace fusion_server::system {
+
+/**
+ * This class represents a token bucket. The bucket holds at most `burst`
+ * tokens and regains one token each `refill_period`.
+ */
+class RateLimiter {
+ public:
+  /**
+   * This is the clock used to measure the refilling time.
+   */
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Constructs a full bucket.
+   *
+   * @param[in] burst
+   *   The maximum number of tokens in the bucket.
+   *
+   * @param[in] refill_period
+   *   The time after which one token is regained.
+   *
+   * @param[in] now
+   *   The current point in time.
+   */
+  RateLimiter(std::size_t burst, Clock::duration refill_period,
+    Clock::time_point now = Clock::now()) noexcept
+    : burst_{burst}, tokens_{burst}, refill_period_{refill_period},
+    last_refill_{now} {}
+
+  /**
+   * @brief Takes a token from the bucket.
+   * This method refills the bucket and takes one token from it. It returns
+   * false if the bucket was empty.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   An indication whether or not a token has been taken is returned.
+   */
+  bool TryAcquire(Clock::time_point now = Clock::now()) noexcept {
+    Refill(now);
+    if (tokens_ == 0) {
+      return false;
+    }
+    tokens_--;
+    return true;
+  }
+
+  /**
+   * @brief Returns the number of tokens.
+   * This method returns the number of tokens available at the given point in
+   * time.
+   *
+   * @param[in] now
+   *   The current point in time.
+   *
+   * @return
+   *   The number of available tokens is returned.
+   */
+  std::size_t GetTokens(Clock::time_point now = Clock::now()) noexcept {
+    Refill(now);
+    return tokens_;
+  }
+
+ private:
+  /**
+   * This method adds all tokens regained since the last refill.
+   *
+   * @param[in] now
+   *   The current point in time.
+   */
+  void Refill(Clock::time_point now) noexcept {
+    if (now <= last_refill_ || refill_period_.count() <= 0) {
+      return;
+    }
+    auto regained = (now - last_refill_) / refill_period_;
+    if (regained == 0) {
+      return;
+    }
+    tokens_ = std::min(burst_, tokens_ + static_cast<std::size_t>(regained));
+    last_refill_ = tokens_ == burst_ ? now : last_refill_ + regained * refill_period_;
+  }
+
+  /**
+   * This is the maximum number of tokens in the bucket.
+   */
+  std::size_t burst_;
+
+  /**
+   * This is the number of tokens currently in the bucket.
+   */
+  std::size_t tokens_;
+
+  /**
+   * This is the time after which one token is regained.
+   */
+  Clock::duration refill_period_;
+
+  /**
+   * This is the point in time of the last refill.
+   */
+  Clock::time_point last_refill_;
+};
+
+}  // namespace fusion_server::system
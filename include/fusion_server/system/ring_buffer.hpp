@@ -0,0 +1,122 @@
+/**
+ * @file ring_buffer.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the RingBuffer class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <array>
+#include <utility>
+
+namespace fusion_server::system {
+
+/**
+ * This class represents a fixed-size circular buffer. When the buffer is full,
+ * a new element overwrites the oldest one. The storage is allocated inline, so
+ * pushing an element never allocates on its own.
+ *
+ * @tparam T
+ *   The type of the stored elements. It has to be default constructible and
+ *   move assignable.
+ *
+ * @tparam Capacity
+ *   The maximum number of elements stored in the buffer.
+ */
+template <typename T, std::size_t Capacity>
+class RingBuffer {
+  static_assert(Capacity > 0, "The capacity of a RingBuffer must be positive.");
+
+ public:
+  /**
+   * @brief Appends an element.
+   * This method appends the given element at the end of the buffer. If the
+   * buffer is full, the oldest element is overwritten.
+   *
+   * @param[in] value
+   *   The element to be appended.
+   */
+  void Push(T value) noexcept {
+    data_[(head_ + size_) % Capacity] = std::move(value);
+    if (size_ == Capacity) {
+      head_ = (head_ + 1) % Capacity;
+    } else {
+      size_++;
+    }
+  }
+
+  /**
+   * @brief Returns an element.
+   * This method returns the element at the given position. The position `0`
+   * identifies the oldest element.
+   *
+   * @param[in] index
+   *   The position of the element. If it's not less than Size(), the behaviour
+   *   is undefined.
+   *
+   * @return
+   *   A reference to the requested element is returned.
+   */
+  const T& operator[](std::size_t index) const noexcept {
+    return data_[(head_ + index) % Capacity];
+  }
+
+  /**
+   * @brief Returns the number of elements.
+   * This method returns the number of elements stored in the buffer.
+   *
+   * @return
+   *   The number of elements stored in the buffer is returned.
+   */
+  [[nodiscard]] std::size_t Size() const noexcept {
+    return size_;
+  }
+
+  /**
+   * @brief Checks if the buffer is empty.
+   *
+   * @return
+   *   An indication whether or not the buffer is empty is returned.
+   */
+  [[nodiscard]] bool Empty() const noexcept {
+    return size_ == 0;
+  }
+
+  /**
+   * @brief Removes all elements.
+   * This method removes all elements from the buffer.
+   */
+  void Clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * This constant contains the maximum number of elements stored in the
+   * buffer.
+   */
+  static constexpr std::size_t kCapacity = Capacity;
+
+ private:
+  /**
+   * This array holds the stored elements.
+   */
+  std::array<T, Capacity> data_{};
+
+  /**
+   * This is the position of the oldest element in the array.
+   */
+  std::size_t head_{0};
+
+  /**
+   * This is the number of elements stored in the buffer.
+   */
+  std::size_t size_{0};
+};
+
+}  // namespace fusion_server::system
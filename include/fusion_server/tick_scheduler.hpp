@@ -0,0 +1,123 @@
+/**
+ * @file tick_scheduler.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the TickScheduler class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fusion_server {
+
+/**
+ * This is the forward declaration of the Game class.
+ */
+class Game;
+
+/**
+ * This class assigns the games of a shard to phase slots. The tick interval is
+ * divided into kNumberOfSlots slots and in each slot only the games assigned
+ * to it are ticked, so the games of a shard don't tick all at the same instant.
+ * Each game is still ticked once per tick interval.
+ */
+class TickScheduler {
+ public:
+  /**
+   * This constant contains the number of phase slots in a tick interval.
+   */
+  static constexpr std::size_t kNumberOfSlots = 5;
+
+  /**
+   * @brief Adds a game.
+   * This method assigns the given game to the slot with the fewest games.
+   *
+   * @param[in] game
+   *   The game to be added.
+   *
+   * @return
+   *   The slot of the game is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  std::size_t Add(std::shared_ptr<Game> game) noexcept;
+
+  /**
+   * @brief Removes a game.
+   *
+   * @param[in] game
+   *   The game to be removed.
+   *
+   * @return
+   *   True is returned if the game has been removed. If the game has not been
+   *   added, false is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  bool Remove(const Game* game) noexcept;
+
+  /**
+   * @brief Returns the number of games.
+   *
+   * @return
+   *   The number of games in all slots is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetNumberOfGames() const noexcept;
+
+  /**
+   * @brief Returns the number of games in a slot.
+   *
+   * @param[in] slot
+   *   The slot. It must be lower than kNumberOfSlots.
+   *
+   * @return
+   *   The number of games assigned to the given slot is returned.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  [[nodiscard]] std::size_t GetSlotSize(std::size_t slot) const noexcept;
+
+  /**
+   * @brief Returns the games of a slot.
+   * This method appends the games assigned to the given slot to the given
+   * vector. The games are ticked outside of the lock, so a tick can remove its
+   * own game.
+   *
+   * @param[in] slot
+   *   The slot. It must be lower than kNumberOfSlots.
+   *
+   * @param[out] games
+   *   The vector to which the games are appended.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void GetSlot(std::size_t slot, std::vector<std::shared_ptr<Game>>& games) const noexcept;
+
+ private:
+  /**
+   * This array holds the games assigned to each slot.
+   */
+  std::array<std::vector<std::shared_ptr<Game>>, kNumberOfSlots> slots_;
+
+  /**
+   * This mutex is used to synchronise the access to the slots.
+   */
+  mutable std::mutex slots_mtx_;
+};
+
+}  // namespace fusion_server
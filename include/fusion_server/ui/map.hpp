@@ -9,6 +9,15 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstdlib>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fusion_server/ui/abstract.hpp>
+
 namespace fusion_server::ui {
 
 /**
@@ -42,8 +51,208 @@ enum Direction {
 };
 
 /**
- * This class represents the map loaded in a game.
+ * @brief This class represents the map loaded in a game.
+ * The map is a grid of cells, which are either walkable or blocked. The
+ * navigation data is computed once, when the map is loaded, and a map is never
+ * modified afterwards, so a single instance is shared by all games.
+ *
+ * The paths are found with jump point search: the straight and diagonal runs
+ * of free cells are skipped without being queued, so a query expands only the
+ * cells next to the obstacles. A diagonal step is allowed only if both cells
+ * beside it are walkable, so no path cuts a corner.
  */
-class Map {};
+class Map {
+ public:
+  /**
+   * This enum contains the results of a path query.
+   */
+  enum class PathStatus {
+    /**
+     * This indicates that the path has been found.
+     */
+    kFound,
+
+    /**
+     * This indicates that there is no path between the cells.
+     */
+    kUnreachable,
+
+    /**
+     * This indicates that the query has run out of its budget before the
+     * path was found. It may be repeated later.
+     */
+    kOverBudget,
+  };
+
+  /**
+   * This constant contains the character of a blocked cell in a map file.
+   */
+  static constexpr char kBlockedCell = '#';
+
+  /**
+   * @brief Creates a map.
+   * Each row is a line of cells. The cells equal to kBlockedCell are blocked,
+   * all other are walkable.
+   *
+   * @param[in] rows
+   *   The rows of the map, from the top one. All of them must have the same
+   *   length.
+   *
+   * @return
+   *   The map is returned. If the rows are empty or have different lengths,
+   *   nullptr is returned.
+   */
+  static std::shared_ptr<const Map> Parse(const std::vector<std::string>& rows) noexcept;
+
+  /**
+   * @brief Loads a map from a file.
+   * Each line of the file is a row of the map (see Parse()).
+   *
+   * @param[in] path
+   *   The path of the file.
+   *
+   * @return
+   *   The map is returned. If the file cannot be read or is ill-formed,
+   *   nullptr is returned.
+   */
+  static std::shared_ptr<const Map> Load(const std::string& path) noexcept;
+
+  /**
+   * This method returns the number of columns of this map.
+   *
+   * @return
+   *   The number of columns of this map is returned.
+   */
+  [[nodiscard]] std::size_t GetWidth() const noexcept;
+
+  /**
+   * This method returns the number of rows of this map.
+   *
+   * @return
+   *   The number of rows of this map is returned.
+   */
+  [[nodiscard]] std::size_t GetHeight() const noexcept;
+
+  /**
+   * This method returns an indication whether or not the given cell is inside
+   * this map and walkable.
+   *
+   * @param[in] cell
+   *   The cell's coordinates.
+   *
+   * @return
+   *   An indication whether or not the cell is walkable is returned.
+   */
+  [[nodiscard]] bool IsWalkable(Point cell) const noexcept;
+
+  /**
+   * @brief Checks if there is a path between two cells.
+   * The answer is precomputed, so no query is needed.
+   *
+   * @param[in] from
+   *   The first cell.
+   *
+   * @param[in] to
+   *   The second cell.
+   *
+   * @return
+   *   An indication whether or not the cells are walkable and connected is
+   *   returned.
+   */
+  [[nodiscard]] bool IsReachable(Point from, Point to) const noexcept;
+
+  /**
+   * @brief Finds the shortest path between two cells.
+   * The path is the list of its turning points, both ends included. Between
+   * two consecutive points the path is a straight or a diagonal line.
+   *
+   * @param[in] from
+   *   The starting cell.
+   *
+   * @param[in] to
+   *   The destination cell.
+   *
+   * @param[in] max_expansions
+   *   The maximum number of cells expanded by the query.
+   *
+   * @param[out] path
+   *   The found path. It's cleared, if no path has been found.
+   *
+   * @return
+   *   The result of the query is returned.
+   *
+   * @note
+   *   This method is thread-safe. The working memory of the queries is kept
+   *   per thread and reused, so a query doesn't allocate once it has warmed up.
+   */
+  PathStatus FindPath(Point from, Point to, std::size_t max_expansions,
+    std::vector<Point>& path) const noexcept;
+
+ private:
+  /**
+   * This constructor computes the navigation data of the given grid.
+   *
+   * @param[in] width
+   *   The number of columns.
+   *
+   * @param[in] height
+   *   The number of rows.
+   *
+   * @param[in] walkable
+   *   The walkability of the cells, row by row.
+   */
+  Map(std::size_t width, std::size_t height, std::vector<bool> walkable) noexcept;
+
+  /**
+   * This method returns an indication whether or not the given coordinates are
+   * inside this map and the cell is walkable.
+   */
+  [[nodiscard]] bool IsWalkable(std::int64_t x, std::int64_t y) const noexcept;
+
+  /**
+   * This method returns the index of the given cell.
+   */
+  [[nodiscard]] std::size_t GetIndex(std::int64_t x, std::int64_t y) const noexcept;
+
+  /**
+   * @brief Jumps from a cell in the given direction.
+   * This method follows the direction until it finds a jump point: the
+   * destination, or a cell which has a neighbour reachable only through it.
+   *
+   * @return
+   *   An indication whether or not a jump point has been found is returned.
+   *   Its coordinates are stored in `x` and `y`.
+   */
+  bool Jump(std::int64_t& x, std::int64_t& y, std::int64_t dx, std::int64_t dy,
+    Point to) const noexcept;
+
+  /**
+   * This method jumps along a straight line (see Jump()).
+   */
+  bool JumpStraight(std::int64_t& x, std::int64_t& y, std::int64_t dx,
+    std::int64_t dy, Point to) const noexcept;
+
+  /**
+   * This is the number of columns.
+   */
+  std::size_t width_;
+
+  /**
+   * This is the number of rows.
+   */
+  std::size_t height_;
+
+  /**
+   * This is the walkability of the cells, row by row.
+   */
+  std::vector<bool> walkable_;
+
+  /**
+   * This contains the connected area of each cell, row by row. The blocked
+   * cells have the area 0. Two cells are connected iff they have the same
+   * area, so an unreachable destination is rejected without a search.
+   */
+  std::vector<std::uint32_t> areas_;
+};
 
-}  // namespace fusion_server::ui
\ No newline at end of file
+}  // namespace fusion_server::ui
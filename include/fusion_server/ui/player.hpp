@@ -12,6 +12,7 @@
 #include <cstdint>
 #include <cstddef>
 
+#include <optional>
 #include <string>
 
 #include <fusion_server/json.hpp>
@@ -71,15 +72,58 @@ class Player {
    *   This object serialized into a JSON object.
    */
   [[nodiscard]] json::JSON Serialize() const noexcept {
-    return json::JSON({
-                        {"player_id", id_},
-                        {"team_id", team_id_},
-                        {"nick", nick_},
-                        {"color", color_.Serialize()},
-                        {"health", health_},
-                        {"position", position_.Serialize()},
-                        {"angle", angle_},
-      }, false, json::JSON::value_t::object);
+    // The fields are emplaced one by one; an initializer list would create
+    // and copy a temporary array for each of them.
+    json::JSON json(json::JSON::value_t::object);
+    json.emplace("player_id", id_);
+    json.emplace("team_id", team_id_);
+    json.emplace("nick", nick_);
+    json.emplace("color", color_.Serialize());
+    json.emplace("health", health_);
+    json.emplace("position", position_.Serialize());
+    json.emplace("angle", angle_);
+    return json;
+  }
+
+  /**
+   * @brief Deserializes this object from a JSON object.
+   * This method loads the inner state of this object from the given JSON
+   * object. It's used to restore a player of a migrated game.
+   *
+   * @param json
+   *   Object of this class serialised into a JSON object.
+   *
+   * @return
+   *   An indication of whether or not the deserialization went successful. If
+   *   it went unsuccessful, this object is not changed.
+   */
+  bool Deserialize(const json::JSON& json) noexcept {
+    if (!json.is_object() ||
+        !json.contains("player_id") || !json["player_id"].is_number_unsigned() ||
+        !json.contains("team_id") || !json["team_id"].is_number_unsigned() ||
+        !json.contains("nick") || !json["nick"].is_string() ||
+        !json.contains("health") || !json["health"].is_number() ||
+        !json.contains("angle") || !json["angle"].is_number() ||
+        !json.contains("position") || !json.contains("color")) {
+      return false;
+    }
+
+    Point position;
+    Color color;
+    if (!position.Deserialize(json["position"]) ||
+        !color.Deserialize(json["color"])) {
+      return false;
+    }
+
+    id_ = json["player_id"];
+    team_id_ = json["team_id"];
+    nick_ = json["nick"];
+    health_ = json["health"];
+    angle_ = json["angle"];
+    position_ = position;
+    color_ = color;
+
+    return true;
   }
 
   /**
@@ -118,6 +162,25 @@ class Player {
     angle_ = angle;
   }
 
+  /**
+   * @brief Advances the sequence number of the player's inputs.
+   * An input is accepted, if its sequence number is greater than the one of
+   * the last accepted input.
+   *
+   * @param seq
+   *   The sequence number of the input.
+   *
+   * @return
+   *   An indication whether or not the input has been accepted is returned.
+   */
+  [[nodiscard]] bool AdvanceInputSeq(std::uint64_t seq) noexcept {
+    if (last_input_seq_ && seq <= *last_input_seq_) {
+      return false;
+    }
+    last_input_seq_ = seq;
+    return true;
+  }
+
   /**
    * @brief Returns player's id.
    * This method returns the id of this player.
@@ -129,6 +192,28 @@ class Player {
     return id_;
   }
 
+  /**
+   * @brief Returns player's team id.
+   * This method returns the id of this player's team.
+   *
+   * @return
+   *   The id of this player's team is returned.
+   */
+  [[nodiscard]] std::size_t GetTeamId() const noexcept {
+    return team_id_;
+  }
+
+  /**
+   * @brief Returns player's nick.
+   * This method returns the nick of this player.
+   *
+   * @return
+   *   The nick of this player is returned.
+   */
+  [[nodiscard]] const std::string& GetNick() const noexcept {
+    return nick_;
+  }
+
  private:
   /**
    * This is the unique id of this player in its game.
@@ -165,6 +250,11 @@ class Player {
    */
   Color color_;
 
+  /**
+   * This is the sequence number of the last accepted input of this player.
+   */
+  std::optional<std::uint64_t> last_input_seq_;
+
   /**
    * This is the declaration of friendship of this class and PlayerFactory.
    */
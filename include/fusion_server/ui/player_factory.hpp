@@ -109,6 +109,16 @@ class PlayerFactory {
   [[nodiscard]] std::shared_ptr<Player>
   Create(std::string nick, std::size_t team_id) noexcept;
 
+  /**
+   * @brief Skips the ids already in use.
+   * This method ensures that players created afterwards get ids greater than
+   * the given one. It's used after restoring players of a migrated game.
+   *
+   * @param id
+   *   An id of a player, which has not been created by this factory.
+   */
+  void SkipId(std::size_t id) noexcept;
+
  private:
   /**
    * This holds the configuration of this object.
@@ -11,30 +11,83 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <boost/container/deque.hpp>
 
+#include <fusion_server/frame_dictionary.hpp>
+#include <fusion_server/json.hpp>
 #include <fusion_server/logger_manager.hpp>
+#include <fusion_server/system/buffer_pool.hpp>
+#include <fusion_server/system/framed_stream.hpp>
+#include <fusion_server/system/link_quality.hpp>
+#include <fusion_server/system/memory_stream.hpp>
 #include <fusion_server/system/package.hpp>
 
 namespace fusion_server {
 
+/**
+ * This is the forward declaration of the Game class.
+ */
+class Game;
+
+/**
+ * This is the forward declaration of the Shard class.
+ */
+class Shard;
+
 /**
  * This class represents the WebSocket session between a client and the server.
- * Boost::Beast library is used to perform communication.
+ * It holds the part of the session, which doesn't depend on the underlying
+ * stream: the queue of outgoing packages, the flushes, the closing procedure
+ * and the migration between shards. The games and the server use sessions
+ * through this class only. The I/O is performed by BasicWebSocketSession,
+ * which is templated over the stream type.
  *
  * @see [Boost::Beast](https://www.boost.org/doc/libs/1_67_0/libs/beast/doc/html/index.html)
  */
 class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
  public:
+  /**
+   * This is the type of the strand serializing the operations of a session.
+   */
+  using Strand_t = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+  /**
+   * This enumeration identifies the states of a session. The state decides
+   * which handler is called for an incoming package (see Dispatch()).
+   */
+  enum class State : std::uint8_t {
+    /**
+     * The session has not joined any game.
+     */
+    kUnjoined,
+
+    /**
+     * The session plays in a game.
+     */
+    kInGame,
+
+    /**
+     * The closing procedure has started. Incoming packages are dropped.
+     */
+    kClosing,
+  };
+
+  /**
+   * This constant contains the number of the session's states.
+   */
+  static constexpr std::size_t kNumberOfStates = 3;
+
   /**
    * @brief Explicitly deleted copy constructor.
    * It's deleted due to presence of boost::asio's socket.
@@ -79,21 +132,10 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
    */
   WebSocketSession& operator=(WebSocketSession&& other) = delete;
 
-  /**
-   * This constructor takes the ownership of the socket connected to a client
-   * and registers this session to the server.
-   *
-   * @param[in] socket
-   *   The socket connected to a client.
-   *
-   * @see [boost::asio::ip::tcp::socket](https://www.boost.org/doc/libs/1_67_0/doc/html/boost_asio/reference/ip__tcp/socket.html)
-   */
-  explicit WebSocketSession(boost::asio::ip::tcp::socket socket) noexcept;
-
   /**
    * This destructor unregisters this session from the server.
    */
-  ~WebSocketSession() noexcept;
+  virtual ~WebSocketSession() noexcept;
 
   /**
    * @brief Sets the logger of this instance.
@@ -116,9 +158,9 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
 
   /**
    * This method delegates the write operation to the client.
-   * Since Boost::Beast allows only one writing at a time, the packages is
-   * always queued and if no writing is taking place the asynchronous write
-   * operation is called.
+   * The package is always queued. Queued packages are written at the end of
+   * the current tick of the session's shard (see Flush()), so all packages
+   * produced by a tick leave together.
    *
    * @param[in] package
    *   The package to be send to the client. The shared_ptr is used to ensure
@@ -131,14 +173,42 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
   void Write(const std::shared_ptr<system::Package>& package) noexcept;
 
   /**
-   * This method upgrades the connection to the WebSocket Protocol and performs
-   * the asynchronous handshake.
+   * @brief Writes a state update.
+   * Unlike packages written with Write(), state updates aren't queued. A state
+   * update, which hasn't been sent yet, is replaced by the newer one, so the
+   * client always receives the latest state. The rate of state updates and
+   * their detail level are chosen to match the client's link (see
+   * system::LinkQuality).
    *
-   * @param[in] request
-   *   A HTTP Upgrade request.
+   * @param[in] full
+   *   The state update carrying all attributes.
+   *
+   * @param[in] reduced
+   *   The state update carrying only the attributes changing during the game.
+   *
+   * @note
+   *   This method is thread-safe.
    */
-  template <typename Body, typename Allocator>
-  void Run(boost::beast::http::request<Body, boost::beast::http::basic_fields<Allocator>> request) noexcept;
+  void WriteState(const std::shared_ptr<system::Package>& full,
+    const std::shared_ptr<system::Package>& reduced) noexcept;
+
+  /**
+   * @brief Writes the queued packages.
+   * This method starts writing all packages queued since the last flush. The
+   * socket is corked until the last of them has been written, so they are
+   * sent in full-sized segments. The pending state update is queued as well,
+   * if the client is due for one. From time to time a ping is sent to measure
+   * the round trip time. It's called by the shard at the end of a tick.
+   *
+   * @param[in] shard
+   *   The shard performing the flush. A flush scheduled by a shard, which the
+   *   session has left since, is ignored; the migration schedules it on the
+   *   new shard.
+   *
+   * @note
+   *   This method is thread-safe.
+   */
+  void Flush(const Shard& shard) noexcept;
 
   /**
    * This method allows the current writing to complete (if any) and then closes
@@ -171,7 +241,9 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
    *   A value that indicates whether or not the socket is connected to a client
    *   is returned.
    */
-  explicit operator bool() const noexcept;
+  explicit operator bool() const noexcept {
+    return IsOpen();
+  }
 
   /**
    * @brief Returns the remote endpoint.
@@ -188,6 +260,104 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
   const boost::asio::ip::tcp::socket::endpoint_type&
   GetRemoteEndpoint() const noexcept;
 
+  /**
+   * @brief Returns the current shard.
+   * This method returns the shard, whose I/O context performs all asynchronous
+   * operations of this session.
+   *
+   * @return
+   *   A reference to the current shard of this session is returned.
+   */
+  [[nodiscard]] Shard& GetShard() const noexcept;
+
+  /**
+   * @brief Moves this session to another shard.
+   * This method requests moving the underlying socket and all further
+   * asynchronous operations of this session to the I/O context of the given
+   * shard. The migration is performed once no operation is pending on the
+   * socket, i.e. after the currently handled package has been dispatched and
+   * the current write or ping (if any) has been completed.
+   *
+   * @param[in] shard
+   *   The target shard. The registry entry of the session is moved to it too.
+   *
+   * @note
+   *   An idle session waits for its next frame outside of the WebSocket
+   *   stream. The wait is cancelled on the session's strand, so the session
+   *   follows its game without receiving a package. A session in the middle
+   *   of a WebSocket read (e.g. of a fragmented message) is moved after the
+   *   read completes.
+   */
+  void MigrateTo(Shard& shard) noexcept;
+
+  /**
+   * @brief Returns the current state.
+   *
+   * @return
+   *   The current state of this session is returned.
+   */
+  [[nodiscard]] State GetState() const noexcept;
+
+  /**
+   * @brief Returns the joined game.
+   *
+   * @return
+   *   A pointer to the game, in which this session plays, is returned. If the
+   *   session has not joined any game, nullptr is returned.
+   */
+  [[nodiscard]] Game* GetGame() const noexcept;
+
+  /**
+   * @brief Sets the joined game.
+   * This method moves the session into the kInGame state or, if nullptr is
+   * given, back into the kUnjoined state. The transition is a single atomic
+   * store, so a concurrently dispatched package sees either the old or the new
+   * state.
+   *
+   * @param[in] game
+   *   The joined game or nullptr, if the session has left its game. The
+   *   caller keeps the game alive while the session plays in it (see
+   *   Shard::SessionEntry).
+   */
+  void SetGame(Game* game) noexcept;
+
+  /**
+   * @brief Checks if this session is a bot.
+   * A bot plays in-process (see Bot). Nothing is written to it, so the
+   * packages of its game are neither queued nor compressed for it.
+   *
+   * @return
+   *   An indication whether or not this session is a bot is returned.
+   */
+  [[nodiscard]] virtual bool IsBot() const noexcept;
+
+  /**
+   * @brief Sets the frame dictionary.
+   * This method enables the compression of all packages sent to the client.
+   * The client must have offered the dictionary in its upgrade request. It
+   * must be called before the session is run, so the handshake confirms the
+   * compression (see FrameDictionary).
+   *
+   * @param[in] dictionary
+   *   The dictionary negotiated with the client.
+   */
+  void SetFrameDictionary(std::shared_ptr<const FrameDictionary> dictionary) noexcept;
+
+  /**
+   * @brief Dispatches a verified package.
+   * This method calls the handler of the given package type in the current
+   * state of this session. The handlers are plain functions looked up in
+   * a table built at the compile time, so no delegate is copied or called
+   * through a type-erased wrapper on the per-package path.
+   *
+   * @param[in] type
+   *   The type of the package.
+   *
+   * @param[in] package
+   *   The package verified by json::Verify().
+   */
+  void Dispatch(json::PackageType type, const json::JSON& package) noexcept;
+
   /**
    * This method is the callback to asynchronous handshake with the client.
    *
@@ -207,6 +377,16 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
    */
   void HandleRead(const boost::system::error_code& ec, std::size_t bytes_transmitted) noexcept;
 
+  /**
+   * This method is the callback to the asynchronous wait for the next frame
+   * from the client. It performs a pending migration or starts reading the
+   * frame.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleWait(const boost::system::error_code& ec) noexcept;
+
   /**
    * This method is the callback to asynchronous write to the client.
    *
@@ -218,49 +398,309 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
    */
   void HandleWrite(const boost::system::error_code& ec, std::size_t bytes_transmitted) noexcept;
 
+ protected:
+  /**
+   * This constructor registers this session on the given shard.
+   *
+   * @param[in] strand
+   *   The strand of the session. It uses the executor of the stream.
+   *
+   * @param[in] shard
+   *   The shard, whose I/O context runs the stream.
+   *
+   * @param[in] remote_endpoint
+   *   The endpoint of the client.
+   *
+   * @param[in] buffer
+   *   The buffer for the incoming packages (see BasicWebSocketSession).
+   */
+  WebSocketSession(Strand_t strand, Shard& shard,
+    boost::asio::ip::tcp::endpoint remote_endpoint,
+    system::PooledFlatBuffer buffer) noexcept;
+
   /**
-   * This delegate is called each time when a new package arrives.
+   * This method waits for the next frame from the client without reading it.
+   * HandleWait() is called on the strand, when it completes.
    */
-  system::IncomingPackageDelegate delegate_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+  virtual void StartWait() noexcept = 0;
 
- private:
+  /**
+   * This method cancels the wait for the next frame. No other operation is
+   * pending on the stream, when it's called. Streams, which cannot be moved,
+   * ignore it.
+   *
+   * @return
+   *   An indication whether or not the wait has been cancelled is returned.
+   */
+  virtual bool CancelWait() noexcept = 0;
 
   /**
-   * This is the WebSocket wrapper around the socket connected to a client.
+   * This method performs an asynchronous read from the client into the
+   * buffer. HandleRead() is called on the strand, when it completes.
    */
-  boost::beast::websocket::stream<boost::asio::ip::tcp::socket> websocket_;
+  virtual void DoRead() noexcept = 0;
 
   /**
-   * @brief The remote endpoint.
-   * This is the remote endpoint of the websocket_'s underlying socket.
+   * This method performs an asynchronous write of the given package.
+   * HandleWrite() is called on the strand, when it completes.
+   *
+   * @param[in] package
+   *   The package to be written. It's the first queued package, so it stays
+   *   valid until the write completes.
+   */
+  virtual void StartWrite(const system::Package& package) noexcept = 0;
+
+  /**
+   * This method writes the given package synchronously. It's used to send the
+   * last package of the closing procedure.
+   *
+   * @param[in] package
+   *   The package to be written.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   */
+  virtual void WriteNow(const system::Package& package, boost::system::error_code& ec) noexcept = 0;
+
+  /**
+   * This method sends a ping to the client. The completion of the ping must be
+   * reported with HandlePing() and a received pong with HandlePong().
+   */
+  virtual void StartPing() noexcept = 0;
+
+  /**
+   * This method performs the WebSocket closing handshake and closes the
+   * stream.
+   *
+   * @param[out] ec
+   *   This is the Boost error code.
+   */
+  virtual void CloseStream(boost::system::error_code& ec) noexcept = 0;
+
+  /**
+   * @brief Corks or uncorks the stream.
+   * While a socket is corked, the kernel sends only full-sized segments.
+   * Streams, which cannot be corked, ignore it.
+   *
+   * @param[in] enabled
+   *   Indicates whether the stream should be corked.
+   */
+  virtual void SetCork(bool enabled) noexcept = 0;
+
+  /**
+   * This method moves the stream to the I/O context of the given shard. No
+   * operation is pending on the stream when it's called.
+   *
+   * @note
+   *   Only the next layer of the WebSocket stream is moved. The stream keeps
+   *   its timer and its registration in the Beast service of the I/O context
+   *   it has been created on. The timer is armed only for timeouts, which the
+   *   sessions don't set, and the server releases the sessions of all shards
+   *   before any I/O context is destroyed.
+   *
+   * @param[in] target
+   *   The target shard.
+   *
+   * @return
+   *   An indication whether or not the stream has been moved is returned.
+   */
+  virtual bool MoveStream(Shard& target) noexcept = 0;
+
+  /**
+   * This method returns a value that indicates whether or not the stream is
+   * open.
+   *
+   * @return
+   *   A value that indicates whether or not the stream is open is returned.
+   */
+  [[nodiscard]] virtual bool IsOpen() const noexcept = 0;
+
+  /**
+   * This method is the callback to the asynchronous ping. A migration waiting
+   * for the ping is performed.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandlePing(const boost::system::error_code& ec) noexcept;
+
+  /**
+   * This method updates the link quality after a pong has been received.
    */
-  decltype(websocket_)::next_layer_type::endpoint_type remote_endpoint_;
+  void HandlePong() noexcept;
 
   /**
-   * This is the buffer for the incoming packages.
+   * This is the buffer for the incoming packages. Its memory is borrowed from
+   * the buffer pool when a message starts arriving and it's returned after the
+   * message has been read.
    */
-  boost::beast::multi_buffer buffer_;
+  system::PooledFlatBuffer buffer_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
 
   /**
    * This is the strand for this instance of WebSocketSession class.
    */
-  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+  Strand_t strand_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+
+  /**
+   * @brief WebSocketSession's logger.
+   * This is a pointer to the logger used in WebSocketSession class.
+   */
+  LoggerManager::Logger logger_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+
+  /**
+   * This is the dictionary compressing the packages sent to the client. If the
+   * compression has not been negotiated, it's nullptr.
+   */
+  std::shared_ptr<const FrameDictionary> frame_dictionary_;  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+
+ private:
+  /**
+   * This method performs an asynchronous write of the first queued package.
+   *
+   * @note
+   *   The outgoing queue's mutex must be held by the caller.
+   */
+  void DoWrite() noexcept;
+
+  /**
+   * This method starts waiting for the next frame from the client.
+   */
+  void WaitForFrame() noexcept;
+
+  /**
+   * This method continues the read loop after a package has been read. If a
+   * migration is pending and no write or ping is in progress, the session is
+   * moved first.
+   */
+  void ContinueReading() noexcept;
+
+  /**
+   * This method returns a value that indicates whether or not a migration is
+   * pending and no write or ping is in progress.
+   *
+   * @note
+   *   The outgoing queue's mutex must be held by the caller.
+   */
+  [[nodiscard]] bool CanMigrate() const noexcept;
+
+  /**
+   * This method cancels the wait for the next frame, if the session can be
+   * moved. HandleWait() performs the migration then.
+   *
+   * @return
+   *   An indication whether or not the wait has been cancelled is returned.
+   *
+   * @note
+   *   The outgoing queue's mutex must be held by the caller.
+   */
+  bool StartMigration() noexcept;
+
+  /**
+   * This method moves the stream and the strand to the I/O context of the
+   * migration target.
+   *
+   * @note
+   *   The outgoing queue's mutex must be held by the caller and no operation
+   *   may be pending on the stream.
+   */
+  void PerformMigration() noexcept;
+
+  /**
+   * @brief The remote endpoint.
+   * This is the endpoint of the client.
+   */
+  boost::asio::ip::tcp::endpoint remote_endpoint_;
 
   /**
    * This queue holds all outgoing packages, which have not yet been sent.
+   * Unlike std::deque, an empty boost::container::deque doesn't allocate, so
+   * an idle session doesn't hold any memory for its queue.
    */
-  std::deque<std::shared_ptr<system::Package>> outgoing_queue_;
+  boost::container::deque<std::shared_ptr<system::Package>> outgoing_queue_;
 
   /**
    * This is the mutex for outgoing queue.
    */
   std::mutex outgoing_queue_mtx_;
 
+  /**
+   * This indicates whether or not the session has been scheduled for a flush
+   * by its shard. It's guarded by the outgoing queue's mutex.
+   */
+  bool flush_scheduled_;
+
+  /**
+   * This is the number of packages of the current flush, which have not been
+   * written yet. The socket is corked while it's not zero. It's guarded by the
+   * outgoing queue's mutex.
+   */
+  std::size_t corked_writes_;
+
+  /**
+   * This indicates whether or not a write is in progress. It's guarded by the
+   * outgoing queue's mutex.
+   */
+  bool writing_;
+
+  /**
+   * This indicates whether or not a ping is in progress. It's guarded by the
+   * outgoing queue's mutex.
+   */
+  bool pinging_;
+
+  /**
+   * This is the total size of all queued packages. It's guarded by the
+   * outgoing queue's mutex.
+   */
+  std::size_t queued_bytes_;
+
+  /**
+   * This is the start of the write in progress.
+   */
+  std::chrono::steady_clock::time_point write_started_;
+
+  /**
+   * This is the latest state update, which hasn't been queued yet. It's
+   * guarded by the outgoing queue's mutex.
+   */
+  std::shared_ptr<system::Package> pending_state_;
+
+  /**
+   * This is the point in time, when the last state update has been queued.
+   */
+  std::chrono::steady_clock::time_point last_state_;
+
+  /**
+   * This holds the estimated capacity of the client's link. It's guarded by
+   * the outgoing queue's mutex.
+   */
+  system::LinkQuality link_quality_;
+
   /**
    * This indicates whether or not the handshake has been completed.
    */
   std::atomic<bool> handshake_complete_;
 
+  /**
+   * This is the shard on which this session currently runs. It's replaced on
+   * the session's strand during a migration, while the game and the server
+   * read it from other threads.
+   */
+  std::atomic<Shard*> shard_;
+
+  /**
+   * This is the shard to which this session will be moved. If no migration
+   * is pending, it's nullptr. It's guarded by the outgoing queue's mutex.
+   */
+  Shard* migration_target_;
+
+  /**
+   * This indicates whether or not the session waits for the next frame
+   * outside of the WebSocket stream. It's guarded by the outgoing queue's
+   * mutex.
+   */
+  bool waiting_;
+
   /**
    * This indicates wheter or not the closing procedure has started.
    * If it's true, no writing to the
@@ -268,22 +708,135 @@ class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
   std::atomic<bool> in_closing_procedure_;
 
   /**
-   * @brief WebSocketSession's logger.
-   * This is a pointer to the logger used in WebSocketSession class.
+   * This is the game, in which this session plays. If the session has not
+   * joined any game, it's nullptr.
+   */
+  std::atomic<Game*> game_;
+
+};
+
+/**
+ * This class performs the I/O of a WebSocket session over the given stream.
+ * The server uses boost::asio::ip::tcp::socket; system::MemoryStream is used
+ * to run sessions without sockets in the tests and the benchmarks.
+ *
+ * @tparam NextLayer
+ *   The type of the stream. It has to satisfy the requirements of the
+ *   Boost::Beast WebSocket stream's next layer and provide remote_endpoint(),
+ *   local_endpoint() and is_open() like a socket. It's wrapped in
+ *   system::FramedStream, so the session can wait for frames outside of the
+ *   WebSocket stream.
+ */
+template <typename NextLayer>
+class BasicWebSocketSession final : public WebSocketSession {
+ public:
+  /**
+   * This constructor takes the ownership of the stream connected to a client
+   * and registers this session on the given shard.
+   *
+   * @param[in] stream
+   *   The stream connected to a client.
+   *
+   * @param[in] shard
+   *   The shard running the I/O context of the stream.
+   *
+   * @param[in] buffer
+   *   The buffer of the HTTP session, which has received the upgrade request.
+   *   Its allocation is reused for reading the incoming packages. The bytes it
+   *   holds follow the request and they are read before the bytes of the
+   *   stream, so a frame pipelined by the client isn't lost.
+   */
+  BasicWebSocketSession(NextLayer stream, Shard& shard,
+    system::PooledFlatBuffer buffer = {}) noexcept;
+
+  /**
+   * This method upgrades the connection to the WebSocket Protocol and performs
+   * the asynchronous handshake.
+   *
+   * @param[in] request
+   *   A HTTP Upgrade request.
+   */
+  template <typename Body, typename Allocator>
+  void Run(boost::beast::http::request<Body, boost::beast::http::basic_fields<Allocator>> request) noexcept;
+
+ private:
+  /**
+   * This method is the callback to the asynchronous WebSocket handshake. It
+   * starts watching for pongs and calls HandleHandshake().
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleAccept(const boost::system::error_code& ec) noexcept;
+
+  void StartWait() noexcept override;
+
+  bool CancelWait() noexcept override;
+
+  void DoRead() noexcept override;
+
+  void StartWrite(const system::Package& package) noexcept override;
+
+  void WriteNow(const system::Package& package, boost::system::error_code& ec) noexcept override;
+
+  void StartPing() noexcept override;
+
+  void CloseStream(boost::system::error_code& ec) noexcept override;
+
+  void SetCork(bool enabled) noexcept override;
+
+  bool MoveStream(Shard& target) noexcept override;
+
+  [[nodiscard]] bool IsOpen() const noexcept override;
+
+  /**
+   * This method confirms the compression in the response to the upgrade
+   * request, if it has been negotiated.
    */
-  LoggerManager::Logger logger_;
+  void ConfirmCompression() noexcept;
+
+  /**
+   * This method prepares the frame carrying the given package. If the
+   * compression has been negotiated, the package is compressed into a binary
+   * frame, otherwise it's sent as a text frame.
+   *
+   * @param[in] package
+   *   The package to be written.
+   *
+   * @return
+   *   The buffer holding the payload of the frame is returned. It stays valid
+   *   until the next package is prepared.
+   */
+  boost::asio::const_buffer PrepareFrame(const system::Package& package) noexcept;
+
+  /**
+   * This is the WebSocket wrapper around the stream connected to a client.
+   */
+  boost::beast::websocket::stream<system::FramedStream<NextLayer>> websocket_;
+
+  /**
+   * This is the compressed package being written. Its allocation is reused by
+   * the next packages.
+   */
+  std::string compressed_;
 };
 
+extern template class BasicWebSocketSession<boost::asio::ip::tcp::socket>;
+extern template class BasicWebSocketSession<system::MemoryStream>;
+
+template <typename NextLayer>
 template <typename Body, typename Allocator>
-void WebSocketSession::Run(boost::beast::http::request<Body, boost::beast::http::basic_fields<Allocator>> request) noexcept {
+void BasicWebSocketSession<NextLayer>::Run(
+    boost::beast::http::request<Body, boost::beast::http::basic_fields<Allocator>> request) noexcept {
+  ConfirmCompression();
   websocket_.async_accept(
     std::move(request),
     boost::asio::bind_executor(
       strand_,
-      [self = shared_from_this()](
+      [self = std::static_pointer_cast<BasicWebSocketSession>(shared_from_this())](
         const boost::system::error_code& ec
       ) {
-        self->HandleHandshake(ec);
+        self->HandleAccept(ec);
       }
     )
   );
@@ -0,0 +1,128 @@
+/**
+ * @file allocator.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the Allocator class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <unistd.h>
+
+#include <cstdint>
+
+#include <fstream>
+
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(FUSION_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <fusion_server/allocator.hpp>
+
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+/**
+ * These are the options read by jemalloc at its initialization. Huge pages are
+ * used for all mappings and the purging of unused pages is done by background
+ * threads instead of the shard threads.
+ */
+extern "C" {
+const char* malloc_conf = "thp:always,metadata_thp:auto,background_thread:true";
+}
+#endif
+
+namespace fusion_server {
+
+namespace {
+
+/**
+ * This function returns the resident set size of the process.
+ *
+ * @return
+ *   The resident set size in bytes is returned.
+ */
+std::size_t GetResidentBytes() noexcept {
+  std::ifstream statm{"/proc/self/statm"};
+  std::size_t size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+/**
+ * This function reads a size statistic of jemalloc.
+ *
+ * @param[in] name
+ *   The name of the statistic.
+ *
+ * @return
+ *   The value of the statistic is returned. If it cannot be read, 0 is
+ *   returned.
+ */
+std::size_t ReadJemallocStat(const char* name) noexcept {
+  std::size_t value = 0;
+  std::size_t size = sizeof(value);
+  return mallctl(name, &value, &size, nullptr, 0) == 0 ? value : 0;
+}
+#endif
+
+}  // namespace
+
+const char* Allocator::GetName() noexcept {
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+  return "jemalloc";
+#elif defined(FUSION_ALLOCATOR_MIMALLOC)
+  return "mimalloc";
+#else
+  return "system";
+#endif
+}
+
+void Allocator::Initialize() noexcept {
+#if defined(FUSION_ALLOCATOR_MIMALLOC)
+  mi_option_enable(mi_option_large_os_pages);
+#endif
+}
+
+void Allocator::BindThreadArena() noexcept {
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+  unsigned arena = 0;
+  std::size_t size = sizeof(arena);
+  if (mallctl("arenas.create", &arena, &size, nullptr, 0) == 0) {
+    mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+  }
+#endif
+}
+
+auto Allocator::GetStats() noexcept -> Stats {
+  Stats stats{};
+#if defined(FUSION_ALLOCATOR_JEMALLOC)
+  // The statistics are cached by jemalloc until the epoch is advanced.
+  std::uint64_t epoch = 1;
+  std::size_t size = sizeof(epoch);
+  mallctl("epoch", &epoch, &size, &epoch, size);
+  stats.allocated_bytes_ = ReadJemallocStat("stats.allocated");
+  stats.committed_bytes_ = ReadJemallocStat("stats.mapped");
+  stats.resident_bytes_ = ReadJemallocStat("stats.resident");
+#elif defined(FUSION_ALLOCATOR_MIMALLOC)
+  std::size_t elapsed = 0, user = 0, system = 0, rss = 0, peak_rss = 0;
+  std::size_t commit = 0, peak_commit = 0, page_faults = 0;
+  mi_process_info(&elapsed, &user, &system, &rss, &peak_rss, &commit,
+    &peak_commit, &page_faults);
+  stats.committed_bytes_ = commit;
+  stats.resident_bytes_ = rss;
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  auto info = ::mallinfo2();
+  stats.allocated_bytes_ = info.uordblks + info.hblkhd;
+  stats.committed_bytes_ = info.arena + info.hblkhd;
+#endif
+  if (stats.resident_bytes_ == 0) {
+    stats.resident_bytes_ = GetResidentBytes();
+  }
+  return stats;
+}
+
+}  // namespace fusion_server
@@ -0,0 +1,148 @@
+/**
+ * @file bot.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the Bot class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cmath>
+
+#include <fusion_server/bot.hpp>
+#include <fusion_server/game.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/shard.hpp>
+
+namespace fusion_server {
+
+namespace {
+
+/**
+ * This constant contains the number of degrees in a radian.
+ */
+constexpr double kDegreesPerRadian = 180.0 / 3.14159265358979323846;
+
+/**
+ * This function returns the sign of the given value.
+ */
+std::int64_t Sign(std::int64_t value) noexcept {
+  return (value > 0) - (value < 0);
+}
+
+}  // namespace
+
+Bot::Bot(Shard& shard, std::uint64_t seed) noexcept
+    : WebSocketSession{Strand_t{shard.GetIOContext().get_executor()}, shard, {}, {}},
+      engine_{static_cast<std::minstd_rand::result_type>(seed)}, cell_{-1, -1},
+      waypoint_{0}, angle_{0.0}, closed_{false} {
+  angle_ = std::uniform_real_distribution<double>{0.0, 360.0}(engine_);
+}
+
+bool Bot::Join(const std::string& game_name, const std::string& nick) noexcept {
+  Dispatch(json::PackageType::kJoin, json::JSON({
+    {"type", "join"},
+    {"game", game_name},
+    {"nick", nick},
+  }, false, json::JSON::value_t::object));
+  return GetState() == State::kInGame;
+}
+
+void Bot::Think() noexcept {
+  auto* game = GetGame();
+  if (game == nullptr || GetState() != State::kInGame) {
+    return;
+  }
+
+  if (!FollowPath(*game)) {
+    std::uniform_real_distribution<double> turn{-kMaxTurn, kMaxTurn};
+    angle_ = std::fmod(angle_ + turn(engine_) + 360.0, 360.0);
+  }
+  game->ApplyInput(this, angle_);
+}
+
+bool Bot::FollowPath(Game& game) noexcept {
+  auto map = game.GetMap();
+  if (map == nullptr) {
+    return false;
+  }
+  if (!map->IsWalkable(cell_) && !DrawCell(*map, cell_)) {
+    return false;
+  }
+
+  if (waypoint_ >= path_.size()) {
+    ui::Point destination;
+    if (!DrawCell(*map, destination) ||
+        game.FindPath(cell_, destination, path_) != ui::Map::PathStatus::kFound) {
+      // The query is repeated in the next tick, if it was over budget.
+      path_.clear();
+      waypoint_ = 0;
+      return false;
+    }
+    waypoint_ = 1;  // The first point is the current cell.
+  }
+
+  const auto& next = path_[waypoint_];
+  auto dx = Sign(next.x_ - cell_.x_);
+  auto dy = Sign(next.y_ - cell_.y_);
+  angle_ = std::fmod(std::atan2(static_cast<double>(dy), static_cast<double>(dx)) *
+    kDegreesPerRadian + 360.0, 360.0);
+  cell_.x_ += dx;
+  cell_.y_ += dy;
+  if (cell_.x_ == next.x_ && cell_.y_ == next.y_) {
+    waypoint_++;
+  }
+  return true;
+}
+
+bool Bot::DrawCell(const ui::Map& map, ui::Point& cell) noexcept {
+  if (map.GetWidth() == 0 || map.GetHeight() == 0) {
+    return false;
+  }
+  std::uniform_int_distribution<std::int64_t> x{0, static_cast<std::int64_t>(map.GetWidth()) - 1};
+  std::uniform_int_distribution<std::int64_t> y{0, static_cast<std::int64_t>(map.GetHeight()) - 1};
+  for (std::size_t i = 0; i < kMaxCellDraws; i++) {
+    ui::Point drawn{x(engine_), y(engine_)};
+    if (map.IsWalkable(drawn) && (drawn.x_ != cell_.x_ || drawn.y_ != cell_.y_)) {
+      cell = drawn;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Bot::IsBot() const noexcept {
+  return true;
+}
+
+void Bot::StartWait() noexcept {}
+
+bool Bot::CancelWait() noexcept {
+  return false;
+}
+
+void Bot::DoRead() noexcept {}
+
+void Bot::StartWrite([[maybe_unused]] const system::Package& package) noexcept {}
+
+void Bot::WriteNow([[maybe_unused]] const system::Package& package,
+    [[maybe_unused]] boost::system::error_code& ec) noexcept {}
+
+void Bot::StartPing() noexcept {}
+
+void Bot::CloseStream([[maybe_unused]] boost::system::error_code& ec) noexcept {
+  closed_ = true;
+}
+
+void Bot::SetCork([[maybe_unused]] bool enabled) noexcept {}
+
+bool Bot::MoveStream([[maybe_unused]] Shard& target) noexcept {
+  // A bot has no stream. It stays registered on its shard.
+  return false;
+}
+
+bool Bot::IsOpen() const noexcept {
+  return !closed_;
+}
+
+}  // namespace fusion_server
@@ -0,0 +1,136 @@
+/**
+ * @file bot_pool.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the BotPool class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <fusion_server/bot_pool.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/shard.hpp>
+
+namespace fusion_server {
+
+BotPool::BotPool(Server& server, std::size_t number_of_threads) noexcept
+    : server_{server}, number_of_threads_{std::max<std::size_t>(number_of_threads, 1)},
+      pool_{number_of_threads_}, strand_{pool_.get_executor()}, timer_{strand_},
+      bots_{std::make_shared<const Bots_t>()}, next_seed_{1}, stopped_{false} {
+  boost::asio::dispatch(strand_, [this] { ScheduleTick(); });
+}
+
+BotPool::~BotPool() noexcept {
+  Stop();
+}
+
+std::size_t BotPool::Spawn(const std::string& game_name, std::size_t count) noexcept {
+  if (stopped_) {
+    return 0;
+  }
+
+  count = std::min(count, kMaxSpawnCount);
+  Bots_t spawned;
+  spawned.reserve(count);
+  std::unique_lock bm{bots_mtx_};
+  auto first_seed = next_seed_;
+  next_seed_ += count;
+  bm.unlock();
+
+  // The bots join outside of the lock, so a tick is not blocked by the joins.
+  for (std::size_t i = 0; i < count; i++) {
+    auto seed = first_seed + i;
+    auto bot = std::make_shared<Bot>(server_.GetShard(0), seed);
+    if (!bot->Join(game_name, "bot-" + std::to_string(seed))) {
+      break;  // The game is full or the shard is busy.
+    }
+    spawned.push_back(std::move(bot));
+  }
+
+  bm.lock();
+  auto bots = std::make_shared<Bots_t>(*bots_);
+  bots->insert(bots->end(), spawned.begin(), spawned.end());
+  bots_ = std::move(bots);
+  return spawned.size();
+}
+
+void BotPool::Clear() noexcept {
+  std::unique_lock bm{bots_mtx_};
+  auto bots = std::exchange(bots_, std::make_shared<const Bots_t>());
+  bm.unlock();
+  // The bots in a running tick are removed, when the tick has finished.
+}
+
+void BotPool::Stop() noexcept {
+  if (stopped_.exchange(true)) {
+    return;
+  }
+  boost::asio::dispatch(strand_, [this] {
+    boost::system::error_code ec;
+    timer_.cancel(ec);
+  });
+  pool_.join();
+  Clear();
+}
+
+std::size_t BotPool::GetNumberOfBots() const noexcept {
+  std::unique_lock bm{bots_mtx_};
+  return bots_->size();
+}
+
+void BotPool::ScheduleTick() noexcept {
+  // It runs on the strand, so it's serialized with the cancellation in Stop().
+  if (stopped_) {
+    return;
+  }
+  timer_.expires_after(Shard::kTickInterval);
+  timer_.async_wait([this](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted || stopped_) {
+      return;
+    }
+    Tick();
+  });
+}
+
+void BotPool::Tick() noexcept {
+  std::unique_lock bm{bots_mtx_};
+  // The bots which have left their games are dropped.
+  if (std::any_of(bots_->begin(), bots_->end(), [](const auto& bot) {
+        return bot->GetState() != WebSocketSession::State::kInGame; })) {
+    auto bots = std::make_shared<Bots_t>();
+    bots->reserve(bots_->size());
+    std::copy_if(bots_->begin(), bots_->end(), std::back_inserter(*bots),
+      [](const auto& bot) { return bot->GetState() == WebSocketSession::State::kInGame; });
+    bots_ = std::move(bots);
+  }
+  auto bots = bots_;
+  bm.unlock();
+
+  if (bots->empty()) {
+    ScheduleTick();
+    return;
+  }
+
+  // The next tick is scheduled by the last finished chunk, so a bot never
+  // thinks in two ticks at once.
+  auto chunk_size = (bots->size() + number_of_threads_ - 1) / number_of_threads_;
+  auto number_of_chunks = (bots->size() + chunk_size - 1) / chunk_size;
+  auto pending = std::make_shared<std::atomic<std::size_t>>(number_of_chunks);
+  for (std::size_t first = 0; first < bots->size(); first += chunk_size) {
+    auto last = std::min(first + chunk_size, bots->size());
+    boost::asio::post(pool_, [this, bots, first, last, pending] {
+      for (auto i = first; i < last; i++) {
+        (*bots)[i]->Think();
+      }
+      if (pending->fetch_sub(1) == 1) {
+        boost::asio::dispatch(strand_, [this] { ScheduleTick(); });
+      }
+    });
+  }
+}
+
+}  // namespace fusion_server
@@ -0,0 +1,89 @@
+/**
+ * @file chat_channel.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the ChatChannel class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <utility>
+
+#include <fusion_server/chat_channel.hpp>
+
+namespace fusion_server {
+
+json::JSON ChatChannel::Line::Serialize() const noexcept {
+  return json::JSON({
+    {"player_id", player_id_},
+    {"nick", nick_},
+    {"channel", scope_ == Scope::kTeam ? "team" : "all"},
+    {"message", message_},
+  }, false, json::JSON::value_t::object);
+}
+
+bool ChatChannel::Line::IsVisibleTo(std::size_t team_id) const noexcept {
+  return scope_ == Scope::kAll || team_id_ == team_id;
+}
+
+auto ChatChannel::Post(Line line, Clock::time_point now) noexcept -> PostResult {
+  if (line.message_.empty() || line.message_.size() > kMaxMessageLength) {
+    return PostResult::kNotValid;
+  }
+
+  auto it = limiters_.find(line.player_id_);
+  if (it == limiters_.end()) {
+    it = limiters_.emplace(line.player_id_,
+      system::RateLimiter{kBurst, kRefillPeriod, now}).first;
+  }
+  if (!it->second.TryAcquire(now)) {
+    return PostResult::kRateLimited;
+  }
+
+  history_.Push(line);
+  pending_.push_back(std::move(line));
+  return PostResult::kAccepted;
+}
+
+void ChatChannel::Forget(std::size_t player_id) noexcept {
+  limiters_.erase(player_id);
+}
+
+bool ChatChannel::HasPending() const noexcept {
+  return !pending_.empty();
+}
+
+std::shared_ptr<system::Package>
+ChatChannel::MakeFrame(std::size_t team_id) const noexcept {
+  auto messages = json::JSON::array();
+  for (const auto& line : pending_) {
+    if (line.IsVisibleTo(team_id)) {
+      messages.push_back(line.Serialize());
+    }
+  }
+  if (messages.empty()) {
+    return nullptr;
+  }
+
+  auto frame = json::JSON({
+    {"type", "chat"},
+    {"messages", std::move(messages)},
+  }, false, json::JSON::value_t::object);
+  return std::make_shared<system::Package>(frame.dump());
+}
+
+void ChatChannel::ClearPending() noexcept {
+  pending_.clear();
+}
+
+json::JSON ChatChannel::GetHistory(std::size_t team_id) const noexcept {
+  auto history = json::JSON::array();
+  for (std::size_t i = 0; i < history_.Size(); i++) {
+    if (history_[i].IsVisibleTo(team_id)) {
+      history.push_back(history_[i].Serialize());
+    }
+  }
+  return history;
+}
+
+}  // namespace fusion_server
@@ -0,0 +1,153 @@
+/**
+ * @file frame_dictionary.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the FrameDictionary class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <utility>
+
+#if defined(FUSION_ZSTD)
+#include <zstd.h>
+#endif
+
+#include <fusion_server/frame_dictionary.hpp>
+
+namespace fusion_server {
+
+namespace {
+
+/**
+ * This function removes the leading and trailing spaces.
+ *
+ * @param[in] value
+ *   The trimmed value.
+ *
+ * @return
+ *   The value without the leading and trailing spaces is returned.
+ */
+std::string_view Trim(std::string_view value) noexcept {
+  auto first = value.find_first_not_of(" \t");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  auto last = value.find_last_not_of(" \t");
+  return value.substr(first, last - first + 1);
+}
+
+}  // namespace
+
+std::shared_ptr<const FrameDictionary>
+FrameDictionary::Load([[maybe_unused]] const std::string& path,
+    [[maybe_unused]] int level) noexcept {
+#if defined(FUSION_ZSTD)
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    return nullptr;
+  }
+  std::string content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  if (file.bad() || content.empty()) {
+    return nullptr;
+  }
+
+  // The ID versions the dictionary, so raw content dictionaries (without an
+  // ID) are not accepted.
+  auto version = ZSTD_getDictID_fromDict(content.data(), content.size());
+  if (version == 0) {
+    return nullptr;
+  }
+
+  auto* prepared = ZSTD_createCDict(content.data(), content.size(), level);
+  if (prepared == nullptr) {
+    return nullptr;
+  }
+  auto* dictionary = new (std::nothrow) FrameDictionary{std::move(content), version, prepared};
+  if (dictionary == nullptr) {
+    ZSTD_freeCDict(prepared);
+    return nullptr;
+  }
+  return std::shared_ptr<const FrameDictionary>{dictionary};
+#else
+  return nullptr;
+#endif
+}
+
+std::optional<std::uint32_t> FrameDictionary::ParseOffer(std::string_view offer) noexcept {
+  auto separator = offer.find(';');
+  if (separator == std::string_view::npos ||
+      Trim(offer.substr(0, separator)) != "zstd") {
+    return {};
+  }
+
+  constexpr std::string_view kDictParameter = "dict=";
+  auto parameter = Trim(offer.substr(separator + 1));
+  if (parameter.substr(0, kDictParameter.size()) != kDictParameter) {
+    return {};
+  }
+
+  auto id = parameter.substr(kDictParameter.size());
+  if (id.empty() || id.size() > 10 || id.find_first_not_of("0123456789") != id.npos) {
+    return {};
+  }
+  std::uint64_t version = 0;
+  for (auto digit : id) {
+    version = version * 10 + static_cast<std::uint64_t>(digit - '0');
+  }
+  if (version == 0 || version > std::numeric_limits<std::uint32_t>::max()) {
+    return {};
+  }
+  return static_cast<std::uint32_t>(version);
+}
+
+FrameDictionary::FrameDictionary(std::string content, std::uint32_t version,
+    ZSTD_CDict_s* prepared) noexcept
+    : content_{std::move(content)}, version_{version}, prepared_{prepared} {}
+
+FrameDictionary::~FrameDictionary() noexcept {
+#if defined(FUSION_ZSTD)
+  ZSTD_freeCDict(prepared_);
+#endif
+}
+
+std::uint32_t FrameDictionary::GetVersion() const noexcept {
+  return version_;
+}
+
+std::string FrameDictionary::GetToken() const noexcept {
+  return "zstd; dict=" + std::to_string(version_);
+}
+
+const std::string& FrameDictionary::GetContent() const noexcept {
+  return content_;
+}
+
+bool FrameDictionary::Compress([[maybe_unused]] const system::Package& package,
+    [[maybe_unused]] std::string& out) const noexcept {
+#if defined(FUSION_ZSTD)
+  // A context is reused by all packages compressed by its thread.
+  thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context{
+    ZSTD_createCCtx(), &ZSTD_freeCCtx};
+  if (context == nullptr) {
+    return false;
+  }
+
+  out.resize(ZSTD_compressBound(package.size()));
+  auto size = ZSTD_compress_usingCDict(context.get(), out.data(), out.size(),
+    package.data(), package.size(), prepared_);
+  if (ZSTD_isError(size) != 0) {
+    return false;
+  }
+  out.resize(size);
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace fusion_server
@@ -7,22 +7,49 @@
  * Copyright 2019 Kamil Rusin
  */
 
+#include <algorithm>
 #include <mutex>
+#include <random>
 
 #include <fusion_server/game.hpp>
 #include <fusion_server/json.hpp>
+#include <fusion_server/perf_counters.hpp>
 #include <fusion_server/server.hpp>
 #include <fusion_server/system/package.hpp>
 #include <fusion_server/websocket_session.hpp>
 
 namespace fusion_server {
 
-Game::Game() noexcept : logger_{LoggerManager::Get()} {
-  delegate_ = [this](const json::JSON& package, WebSocketSession* src) {
-    DoResponse(src, package);
-  };
+namespace {
+
+/**
+ * This function returns a random token identifying a player of an exported
+ * game.
+ *
+ * @return
+ *   A random token of 32 hexadecimal digits is returned.
+ */
+std::string MakeToken() noexcept {
+  thread_local std::mt19937_64 engine{std::random_device{}()};
+  constexpr char kDigits[] = "0123456789abcdef";
+
+  std::string token(32, '0');
+  for (std::size_t i = 0; i < token.size(); i += 16) {
+    auto bits = engine();
+    for (std::size_t j = 0; j < 16; j++, bits >>= 4) {
+      token[i + j] = kDigits[bits & 0xF];
+    }
+  }
+  return token;
 }
 
+}  // namespace
+
+Game::Game(Shard& shard) noexcept
+  : shard_{&shard}, ticks_{0}, activity_{0}, state_changed_{false},
+  skipped_ticks_{0}, frozen_{false}, path_queries_{0},
+  logger_{LoggerManager::Get()} {}
+
 void Game::SetLogger(LoggerManager::Logger logger) noexcept {
   logger_ = std::move(logger);
 }
@@ -31,6 +58,183 @@ LoggerManager::Logger Game::GetLogger() const noexcept {
   return logger_;
 }
 
+Shard& Game::GetShard() const noexcept {
+  return *shard_;
+}
+
+void Game::MoveTo(Shard& target) noexcept {
+  std::unique_lock tm{tick_mtx_};
+  auto* source = shard_.exchange(&target);
+  if (source == &target) {
+    return;
+  }
+
+  auto players = GetPlayersCount();
+  source->GetMetrics().players_ -= players;
+  target.GetMetrics().players_ += players;
+  tm.unlock();
+
+  logger_->debug("Moving the game from shard {} to shard {}.", source->GetId(),
+    target.GetId());
+
+  std::shared_lock ftm{first_team_mtx_};
+  for (auto& pair : first_team_) {
+    pair.first->MigrateTo(target);
+  }
+  ftm.unlock();
+
+  std::shared_lock stm{second_team_mtx_};
+  for (auto& pair : second_team_) {
+    pair.first->MigrateTo(target);
+  }
+}
+
+std::optional<json::JSON> Game::Freeze() noexcept {
+  std::unique_lock tm{tick_mtx_};
+  // No input is applied after the snapshot has been taken, so nothing is lost
+  // on the node receiving the game.
+  std::unique_lock im{input_mtx_};
+  if (frozen_.exchange(true)) {
+    return {};
+  }
+
+  auto snapshot = json::JSON({
+    {"players", json::JSON::array()},
+  }, false, json::JSON::value_t::object);
+
+  std::unique_lock mm{migration_mtx_};
+  const auto add_player = [this, &snapshot](WebSocketSession* session,
+      const std::shared_ptr<ui::Player>& player) {
+    auto token = MakeToken();
+    snapshot["players"].push_back(json::JSON({
+      {"token", token},
+      {"player", player->Serialize()},
+    }, false, json::JSON::value_t::object));
+    export_tokens_[session] = std::move(token);
+  };
+
+  std::shared_lock ftm{first_team_mtx_};
+  for (auto& [session, player] : first_team_) {
+    add_player(session, player);
+  }
+  ftm.unlock();
+
+  std::shared_lock stm{second_team_mtx_};
+  for (auto& [session, player] : second_team_) {
+    add_player(session, player);
+  }
+  stm.unlock();
+
+  return snapshot;
+}
+
+void Game::Unfreeze() noexcept {
+  std::unique_lock im{input_mtx_};
+  std::unique_lock mm{migration_mtx_};
+  export_tokens_.clear();
+  frozen_ = false;
+}
+
+void Game::Redirect(const std::string& address) noexcept {
+  std::unique_lock mm{migration_mtx_};
+  auto tokens = std::move(export_tokens_);
+  export_tokens_.clear();
+  mm.unlock();
+
+  const auto make_redirect = [&address](const std::string& token) {
+    return json::JSON({
+      {"type", "redirect"},
+      {"address", address},
+      {"token", token},
+    }, false, json::JSON::value_t::object);
+  };
+
+  // The teams are locked, so no session can leave while it's being closed.
+  // The sessions unregister themselves after being closed and the game is
+  // removed from the server, when the last session has been destroyed.
+  std::shared_lock ftm{first_team_mtx_};
+  std::shared_lock stm{second_team_mtx_};
+  for (auto* team : {&first_team_, &second_team_}) {
+    for (auto& pair : *team) {
+      if (auto it = tokens.find(pair.first); it != tokens.end()) {
+        pair.first->Close(std::make_shared<system::Package>(
+          make_redirect(it->second).dump()));
+      }
+    }
+  }
+}
+
+bool Game::Restore(const json::JSON& snapshot) noexcept {
+  if (!snapshot.is_object() || !snapshot.contains("players") ||
+      !snapshot["players"].is_array()) {
+    return false;
+  }
+
+  std::map<std::string, Reservation> reservations;
+  auto deadline = std::chrono::steady_clock::now() + kReservationTimeout;
+  for (const auto& entry : snapshot["players"]) {
+    if (!entry.is_object() || !entry.contains("token") ||
+        !entry["token"].is_string() || !entry.contains("player")) {
+      return false;
+    }
+    auto player = std::make_shared<ui::Player>();
+    if (!player->Deserialize(entry["player"])) {
+      return false;
+    }
+    if (player->GetTeamId() != Team::kFirst &&
+        player->GetTeamId() != Team::kSecond) {
+      return false;
+    }
+    reservations[entry["token"]] = {std::move(player), deadline};
+  }
+
+  std::unique_lock mm{migration_mtx_};
+  for (auto& [token, reservation] : reservations) {
+    player_factory_.SkipId(reservation.player_->GetId());
+    reservations_.insert_or_assign(token, std::move(reservation));
+  }
+  return true;
+}
+
+Game::join_result_t
+Game::Resume(WebSocketSession* session, const std::string& token) noexcept {
+  if (IsInGame(session)) {
+    logger_->warn("Trying to resume an already joined session. ({})",
+      session->GetRemoteEndpoint());
+    return {};
+  }
+
+  std::unique_lock mm{migration_mtx_};
+  auto it = reservations_.find(token);
+  if (it == reservations_.end()) {
+    return {};
+  }
+  auto reservation = std::move(it->second);
+  reservations_.erase(it);
+  mm.unlock();
+
+  if (reservation.deadline_ < std::chrono::steady_clock::now()) {
+    return {};
+  }
+
+  auto player = std::move(reservation.player_);
+  auto team = static_cast<Team>(player->GetTeamId());
+  auto player_id = player->GetId();
+  if (team == Team::kFirst) {
+    std::unique_lock ftm{first_team_mtx_};
+    first_team_.insert({session, std::move(player)});
+  } else {
+    std::unique_lock stm{second_team_mtx_};
+    second_team_.insert({session, std::move(player)});
+  }
+
+  return FinishJoin(session, team, player_id);
+}
+
+std::size_t Game::GetReservationsCount() const noexcept {
+  return GetReservedSeats(Team::kFirst) + GetReservedSeats(Team::kSecond);
+}
+
 Game::join_result_t
 Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcept {
   if (IsInGame(session)) {
@@ -38,12 +242,22 @@ Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcep
       session->GetRemoteEndpoint());
     return {};
   }
+  if (frozen_) {
+    // The game is being exported.
+    return {};
+  }
+
+  // Seats reserved for the players of an imported game are not given away.
+  auto first_team_capacity = kMaxPlayersPerTeam - std::min(kMaxPlayersPerTeam,
+    GetReservedSeats(Team::kFirst));
+  auto second_team_capacity = kMaxPlayersPerTeam - std::min(kMaxPlayersPerTeam,
+    GetReservedSeats(Team::kSecond));
 
   std::size_t player_id;
   switch (team) {
     case Team::kFirst: {
         std::unique_lock ftm{first_team_mtx_};
-        if (first_team_.size() >= kMaxPlayersPerTeam) {
+        if (first_team_.size() >= first_team_capacity) {
           return {};
         }
         auto [it, _] = first_team_.insert({session, player_factory_.Create(nick, team)});
@@ -54,7 +268,7 @@ Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcep
 
     case Team::kSecond: {
         std::unique_lock stm{second_team_mtx_};
-        if (second_team_.size() >= kMaxPlayersPerTeam) {
+        if (second_team_.size() >= second_team_capacity) {
           return {};
         }
         auto [it, _] = second_team_.insert({session, player_factory_.Create(nick, team)});
@@ -68,7 +282,7 @@ Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcep
       std::unique_lock ftm{first_team_mtx_};
       std::unique_lock stm{second_team_mtx_};
       if (first_team_.size() >= second_team_.size()) {
-        if (second_team_.size() >= kMaxPlayersPerTeam) {
+        if (second_team_.size() >= second_team_capacity) {
           return {};
         }
         ftm.unlock();
@@ -79,7 +293,7 @@ Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcep
       }
       stm.unlock();
       // The second team is bigger than the first.
-      if (first_team_.size() >= kMaxPlayersPerTeam) {
+      if (first_team_.size() >= first_team_capacity) {
         return {};
       }
       team = Team::kFirst;
@@ -88,14 +302,25 @@ Game::Join(WebSocketSession* session,const std::string& nick, Team team) noexcep
     }
   }  // switch
 
+  return FinishJoin(session, team, player_id);
+}
+
+Game::join_result_t Game::FinishJoin(WebSocketSession* session, Team team,
+    std::size_t player_id) noexcept {
   logger_->debug("{} joined the game.", session->GetRemoteEndpoint());
 
   std::unique_lock pcm{players_cache_mtx_};
   players_cache_[session] = team;
   pcm.unlock();
+  shard_.load()->GetMetrics().players_++;
+  state_changed_ = true;
+
+  auto state = GetCurrentState();
+  std::unique_lock cm{chat_mtx_};
+  state["chat"] = chat_.GetHistory(team);
+  cm.unlock();
 
-  return std::make_optional<join_result_t::value_type>(
-    delegate_, GetCurrentState(), player_id);
+  return std::make_optional<join_result_t::value_type>(std::move(state), player_id);
 }
 
 bool Game::Leave(WebSocketSession* session) noexcept {
@@ -112,7 +337,13 @@ bool Game::Leave(WebSocketSession* session) noexcept {
     std::unique_lock ftm{first_team_mtx_};
     for (const auto& pair : first_team_) {
       if (session == pair.first) {
+        auto player_id = pair.second->GetId();
         first_team_.erase(pair);
+        ftm.unlock();
+        shard_.load()->GetMetrics().players_--;
+        state_changed_ = true;
+        std::unique_lock cm{chat_mtx_};
+        chat_.Forget(player_id);
         return true;
       }
     }
@@ -122,7 +353,13 @@ bool Game::Leave(WebSocketSession* session) noexcept {
     std::unique_lock stm{second_team_mtx_};
     for (const auto& pair : second_team_) {
       if (session == pair.first) {
+        auto player_id = pair.second->GetId();
         second_team_.erase(pair);
+        stm.unlock();
+        shard_.load()->GetMetrics().players_--;
+        state_changed_ = true;
+        std::unique_lock cm{chat_mtx_};
+        chat_.Forget(player_id);
         return true;
       }
     }
@@ -132,6 +369,7 @@ bool Game::Leave(WebSocketSession* session) noexcept {
 }
 
 void Game::BroadcastPackage(const std::shared_ptr<system::Package>& package) noexcept {
+  PerfCounters::Scope perf{PerfCounters::Subsystem::kFanOut};
   std::shared_lock ftm{first_team_mtx_};
   for (auto& pair : first_team_) {
     pair.first->Write(package);
@@ -145,6 +383,92 @@ void Game::BroadcastPackage(const std::shared_ptr<system::Package>& package) noe
   stm.unlock();
 }
 
+bool Game::SkipTick(std::size_t idle_tick_divisor) noexcept {
+  if (activity_.exchange(0) != 0 || ++skipped_ticks_ >= idle_tick_divisor) {
+    skipped_ticks_ = 0;
+    return false;
+  }
+  return true;
+}
+
+void Game::Tick() noexcept {
+  std::unique_lock tm{tick_mtx_};
+  if (frozen_) {
+    // The game is paused, until it's either unfrozen or its clients are
+    // redirected.
+    return;
+  }
+  path_queries_ = 0;
+  // Changes and chat lines stay pending, so a skipped tick is merged into the
+  // next one.
+  if (++ticks_ % shard_.load()->GetOverload().GetUpdateDivisor() != 0) {
+    return;
+  }
+
+  if (state_changed_.exchange(false)) {
+    BroadcastState();
+  }
+
+  std::unique_lock cm{chat_mtx_};
+  if (!chat_.HasPending()) {
+    return;
+  }
+  std::shared_ptr<system::Package> first_frame, second_frame;
+  {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kSerialization};
+    first_frame = chat_.MakeFrame(Team::kFirst);
+    second_frame = chat_.MakeFrame(Team::kSecond);
+  }
+  chat_.ClearPending();
+  cm.unlock();
+
+  PerfCounters::Scope perf{PerfCounters::Subsystem::kFanOut};
+  if (first_frame != nullptr) {
+    std::shared_lock ftm{first_team_mtx_};
+    for (auto& pair : first_team_) {
+      pair.first->Write(first_frame);
+    }
+    ftm.unlock();
+  }
+
+  if (second_frame != nullptr) {
+    std::shared_lock stm{second_team_mtx_};
+    for (auto& pair : second_team_) {
+      pair.first->Write(second_frame);
+    }
+    stm.unlock();
+  }
+}
+
+void Game::BroadcastState() noexcept {
+  std::shared_ptr<system::Package> full, reduced;
+  {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kSerialization};
+    auto state = GetCurrentState();
+    state["type"] = "state";
+    full = std::make_shared<system::Package>(state.dump());
+    for (auto& player : state["players"]) {
+      player.erase("team_id");
+      player.erase("nick");
+      player.erase("color");
+    }
+    reduced = std::make_shared<system::Package>(state.dump());
+  }
+
+  PerfCounters::Scope perf{PerfCounters::Subsystem::kFanOut};
+  std::shared_lock ftm{first_team_mtx_};
+  for (auto& pair : first_team_) {
+    pair.first->WriteState(full, reduced);
+  }
+  ftm.unlock();
+
+  std::shared_lock stm{second_team_mtx_};
+  for (auto& pair : second_team_) {
+    pair.first->WriteState(full, reduced);
+  }
+  stm.unlock();
+}
+
 std::size_t Game::GetPlayersCount() const noexcept {
   std::size_t ret{0};
 
@@ -164,6 +488,39 @@ bool Game::IsInGame(WebSocketSession *session) const noexcept {
   return players_cache_.count(session) != 0;
 }
 
+std::shared_ptr<ui::Player> Game::GetPlayer(WebSocketSession *session) const noexcept {
+  std::shared_lock pcm{players_cache_mtx_};
+  auto it = players_cache_.find(session);
+  if (it == players_cache_.end()) {
+    return nullptr;
+  }
+  auto team = it->second;
+  pcm.unlock();
+
+  if (team == Team::kFirst) {
+    std::shared_lock ftm{first_team_mtx_};
+    for (auto& [player_session, player_ptr] : first_team_) {
+      if (player_session == session) return player_ptr;
+    }
+  } else {
+    std::shared_lock stm{second_team_mtx_};
+    for (auto& [player_session, player_ptr] : second_team_) {
+      if (player_session == session) return player_ptr;
+    }
+  }
+  return nullptr;
+}
+
+std::size_t Game::GetReservedSeats(Team team) const noexcept {
+  auto now = std::chrono::steady_clock::now();
+  std::unique_lock mm{migration_mtx_};
+  return static_cast<std::size_t>(std::count_if(reservations_.begin(),
+    reservations_.end(), [team, now](const auto& pair) {
+      return pair.second.deadline_ >= now &&
+        pair.second.player_->GetTeamId() == static_cast<std::size_t>(team);
+    }));
+}
+
 json::JSON Game::GetCurrentState() const noexcept {
   auto state = [] {
     return json::JSON({
@@ -186,39 +543,135 @@ json::JSON Game::GetCurrentState() const noexcept {
   return state;
 }
 
-void
-Game::DoResponse(WebSocketSession* session, const json::JSON& request) noexcept {
-  const auto make_unidentified = [] {
+void Game::HandleUpdate(WebSocketSession* session, const json::JSON& request) noexcept {
+  // Only the inputs of a "BATCH" package have a sequence number.
+  std::optional<std::uint64_t> seq;
+  if (auto it = request.find("seq"); it != request.end()) {
+    seq = it->get<std::uint64_t>();
+  }
+  ApplyInput(session, request["angle"], seq);
+}
+
+void Game::ApplyInput(WebSocketSession* session, double angle,
+    std::optional<std::uint64_t> seq) noexcept {
+  activity_++;
+  std::shared_lock im{input_mtx_};
+  if (frozen_) {
+    // The game is being exported. The input would be lost on the other node.
+    return;
+  }
+  if (auto player = GetPlayer(session); player != nullptr) {
+    if (seq && !player->AdvanceInputSeq(*seq)) {
+      return;  // A replayed or reordered input.
+    }
+    player->SetAngle(angle);
+    state_changed_ = true;
+  }
+}
+
+void Game::SetMap(std::shared_ptr<const ui::Map> map) noexcept {
+  map_ = std::move(map);
+}
+
+std::shared_ptr<const ui::Map> Game::GetMap() const noexcept {
+  return map_;
+}
+
+ui::Map::PathStatus Game::FindPath(ui::Point from, ui::Point to,
+    std::vector<ui::Point>& path) noexcept {
+  if (map_ == nullptr) {
+    path.clear();
+    return ui::Map::PathStatus::kUnreachable;
+  }
+  // An unreachable destination is rejected without spending the budget.
+  if (!map_->IsReachable(from, to)) {
+    path.clear();
+    return ui::Map::PathStatus::kUnreachable;
+  }
+  if (path_queries_.fetch_add(1) >= kMaxPathQueriesPerTick) {
+    path.clear();
+    return ui::Map::PathStatus::kOverBudget;
+  }
+  return map_->FindPath(from, to, kMaxPathExpansions, path);
+}
+
+void Game::HandleChat(WebSocketSession* session, const json::JSON& request) noexcept {
+  const auto make_chat_rejected = [](const char* message) {
     return json::JSON({
       {"type", "warning"},
-      {"message", "Received an unidentified package."},
+      {"message", message},
       {"closed", false},
     }, false, json::JSON::value_t::object);
   };
 
-  // analysing
-  if (request["type"] == "update") {
-    // TODO(nathiss): respond to this package
-
-  }  // "update"
+  activity_++;
+  auto player = GetPlayer(session);
+  if (player == nullptr) {
+    logger_->warn("Received a chat message from an unjoined session ({}).",
+      session->GetRemoteEndpoint());
+    return;
+  }
 
-  if (request["type"] == "leave") {
-    if (!Leave(session)) {
-      logger_->warn("Trying to remove an unjoined session ({}).",
-        session->GetRemoteEndpoint());
-      session->Close();
-      return;
-    }
+  std::shared_lock im{input_mtx_};
+  if (frozen_) {
+    im.unlock();
+    session->Write(std::make_shared<system::Package>(make_chat_rejected(
+      "The game is being moved. The message was not sent.").dump()));
+    return;
+  }
 
-    logger_->debug("Session {} left the game.", session->GetRemoteEndpoint());
+  ChatChannel::Line line;
+  line.player_id_ = player->GetId();
+  line.team_id_ = player->GetTeamId();
+  line.nick_ = player->GetNick();
+  line.message_ = request["message"];
+  line.scope_ = request["channel"] == "team" ? ChatChannel::Scope::kTeam :
+    ChatChannel::Scope::kAll;
+
+  std::unique_lock cm{chat_mtx_};
+  auto result = chat_.Post(std::move(line));
+  cm.unlock();
+  im.unlock();
+
+  if (result == ChatChannel::PostResult::kRateLimited) {
+    logger_->debug("Session {} exceeded the chat rate limit.",
+      session->GetRemoteEndpoint());
+    session->Write(std::make_shared<system::Package>(make_chat_rejected(
+      "Chat rate limit exceeded.").dump()));
+  } else if (result == ChatChannel::PostResult::kNotValid) {
+    session->Write(std::make_shared<system::Package>(make_chat_rejected(
+      "A chat message was either empty or too long.").dump()));
+  }
+}
 
-    // TODO(nathiss): broadcast the leaving
-    session->delegate_ = Server::GetInstance().Register(session);
+void Game::HandleLeave(WebSocketSession* session,
+    [[maybe_unused]] const json::JSON& request) noexcept {
+  activity_++;
+  if (!Leave(session)) {
+    logger_->warn("Trying to remove an unjoined session ({}).",
+      session->GetRemoteEndpoint());
+    session->Close();
+    return;
   }
 
+  logger_->debug("Session {} left the game.", session->GetRemoteEndpoint());
+
+  // TODO(nathiss): broadcast the leaving
+  session->SetGame(nullptr);
+  // The game is destroyed here, if the session was its last player.
+  GetShard().GetServer().Unjoin(session);
+}
+
+void Game::HandleUnidentified(WebSocketSession* session,
+    const json::JSON& request) noexcept {
+  activity_++;
   logger_->warn("Received an unidentified package from {}. [type={}]",
     session->GetRemoteEndpoint(), request["type"].dump());
-  session->Write(std::make_shared<system::Package>(make_unidentified().dump()));
+  session->Write(std::make_shared<system::Package>(json::JSON({
+    {"type", "warning"},
+    {"message", "Received an unidentified package."},
+    {"closed", false},
+  }, false, json::JSON::value_t::object).dump()));
 }
 
 }  // namespace fusion_server
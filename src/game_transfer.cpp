@@ -0,0 +1,328 @@
+/**
+ * @file game_transfer.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the GameExporter and GameImportListener
+ * classes.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include <fusion_server/game.hpp>
+#include <fusion_server/game_transfer.hpp>
+#include <fusion_server/server.hpp>
+
+namespace fusion_server {
+
+namespace {
+
+/**
+ * This constant contains the maximum size of a single message exchanged
+ * between two processes.
+ */
+constexpr std::size_t kMaxMessageSize = 1024 * 1024;
+
+/**
+ * This function extracts a single line from the given buffer.
+ *
+ * @param[in] buffer
+ *   The buffer containing at least one line.
+ *
+ * @return
+ *   The first line without the line feed is returned.
+ */
+std::string ReadLine(boost::asio::streambuf& buffer) noexcept {
+  std::istream stream{&buffer};
+  std::string line;
+  std::getline(stream, line);
+  return line;
+}
+
+/**
+ * This class handles a single connection of an exporting process. It reads the
+ * snapshot, imports the game and writes the reply.
+ */
+class ImportConnection : public std::enable_shared_from_this<ImportConnection> {
+ public:
+  /**
+   * @brief Constructs a connection.
+   *
+   * @param[in] socket
+   *   The socket connected to the exporting process.
+   *
+   * @param[in] server
+   *   The server importing the game.
+   *
+   * @param[in] address
+   *   The address sent to the redirected clients.
+   *
+   * @param[in] logger
+   *   The logger of the import listener.
+   */
+  ImportConnection(boost::asio::local::stream_protocol::socket socket,
+    Server& server, std::string address, LoggerManager::Logger logger) noexcept
+    : socket_{std::move(socket)}, server_{server}, buffer_{kMaxMessageSize},
+    address_{std::move(address)}, logger_{std::move(logger)} {}
+
+  /**
+   * This method starts reading the snapshot.
+   */
+  void Run() noexcept {
+    boost::asio::async_read_until(socket_, buffer_, '\n',
+      [self = shared_from_this()](const boost::system::error_code& ec,
+          std::size_t) {
+        self->HandleRead(ec);
+      });
+  }
+
+ private:
+  /**
+   * This is the callback to the asynchronous read of the snapshot.
+   *
+   * @param[in] ec
+   *   This is the Boost error code.
+   */
+  void HandleRead(const boost::system::error_code& ec) noexcept {
+    if (ec) {
+      logger_->error("An error occurred during reading a game. [Boost: {}]",
+        ec.message());
+      return;
+    }
+
+    auto line = ReadLine(buffer_);
+    auto request = json::Parse(line.begin(), line.end());
+    auto accepted = request && request->is_object() &&
+      request->contains("game") && (*request)["game"].is_string() &&
+      request->contains("snapshot") &&
+      server_.ImportGame((*request)["game"], (*request)["snapshot"]);
+
+    auto reply = accepted ?
+      json::JSON({
+        {"result", "accepted"},
+        {"address", address_},
+      }, false, json::JSON::value_t::object) :
+      json::JSON({
+        {"result", "rejected"},
+      }, false, json::JSON::value_t::object);
+    reply_ = reply.dump() + '\n';
+
+    boost::asio::async_write(socket_, boost::asio::buffer(reply_),
+      [self = shared_from_this()](const boost::system::error_code& ec,
+          std::size_t) {
+        if (ec) {
+          self->logger_->error("An error occurred during replying to an exporting process. [Boost: {}]",
+            ec.message());
+        }
+      });
+  }
+
+  /**
+   * This is the socket connected to the exporting process.
+   */
+  boost::asio::local::stream_protocol::socket socket_;
+
+  /**
+   * This is the server importing the game.
+   */
+  Server& server_;
+
+  /**
+   * This buffer holds the snapshot.
+   */
+  boost::asio::streambuf buffer_;
+
+  /**
+   * This holds the reply sent to the exporting process.
+   */
+  std::string reply_;
+
+  /**
+   * This is the address sent to the redirected clients.
+   */
+  std::string address_;
+
+  /**
+   * This is the logger of the import listener.
+   */
+  LoggerManager::Logger logger_;
+};
+
+}  // namespace
+
+GameExporter::GameExporter(boost::asio::io_context& ioc, std::string game_name,
+    std::shared_ptr<Game> game) noexcept
+  : socket_{ioc}, buffer_{kMaxMessageSize}, game_name_{std::move(game_name)},
+  game_{std::move(game)}, logger_{LoggerManager::Get()} {}
+
+void GameExporter::SetLogger(LoggerManager::Logger logger) noexcept {
+  logger_ = std::move(logger);
+}
+
+LoggerManager::Logger GameExporter::GetLogger() const noexcept {
+  return logger_;
+}
+
+bool GameExporter::Run(const std::string& socket_path) noexcept {
+  auto snapshot = game_->Freeze();
+  if (!snapshot) {
+    logger_->warn("Game {} is already being exported.", game_name_);
+    return false;
+  }
+
+  request_ = json::JSON({
+    {"game", game_name_},
+    {"snapshot", std::move(snapshot.value())},
+  }, false, json::JSON::value_t::object).dump() + '\n';
+
+  logger_->info("Exporting game {} to {}.", game_name_, socket_path);
+  socket_.async_connect(
+    boost::asio::local::stream_protocol::endpoint{socket_path},
+    [self = shared_from_this()](const boost::system::error_code& ec) {
+      self->HandleConnect(ec);
+    });
+  return true;
+}
+
+void GameExporter::HandleConnect(const boost::system::error_code& ec) noexcept {
+  if (ec) {
+    logger_->error("Cannot connect to the receiving process. [Boost: {}]",
+      ec.message());
+    Abort();
+    return;
+  }
+
+  boost::asio::async_write(socket_, boost::asio::buffer(request_),
+    [self = shared_from_this()](const boost::system::error_code& ec,
+        std::size_t) {
+      self->HandleWrite(ec);
+    });
+}
+
+void GameExporter::HandleWrite(const boost::system::error_code& ec) noexcept {
+  if (ec) {
+    logger_->error("An error occurred during sending game {}. [Boost: {}]",
+      game_name_, ec.message());
+    Abort();
+    return;
+  }
+
+  boost::asio::async_read_until(socket_, buffer_, '\n',
+    [self = shared_from_this()](const boost::system::error_code& ec,
+        std::size_t) {
+      self->HandleRead(ec);
+    });
+}
+
+void GameExporter::HandleRead(const boost::system::error_code& ec) noexcept {
+  if (ec) {
+    logger_->error("An error occurred during reading the reply. [Boost: {}]",
+      ec.message());
+    Abort();
+    return;
+  }
+
+  auto line = ReadLine(buffer_);
+  auto reply = json::Parse(line.begin(), line.end());
+  if (!reply || !reply->is_object() || !reply->contains("result") ||
+      (*reply)["result"] != "accepted" || !reply->contains("address") ||
+      !(*reply)["address"].is_string()) {
+    logger_->error("The receiving process rejected game {}.", game_name_);
+    Abort();
+    return;
+  }
+
+  logger_->info("Game {} exported. Redirecting clients to {}.", game_name_,
+    (*reply)["address"].get<std::string>());
+  game_->Redirect((*reply)["address"]);
+}
+
+void GameExporter::Abort() noexcept {
+  logger_->warn("Game {} continues on this server.", game_name_);
+  game_->Unfreeze();
+}
+
+GameImportListener::GameImportListener(Shard& shard) noexcept
+  : shard_{shard}, acceptor_{shard.GetIOContext()}, socket_{shard.GetIOContext()}, logger_{LoggerManager::Get()} {}
+
+bool GameImportListener::Configure(const json::JSON& config) noexcept {
+  if (!config.is_object()) {
+    logger_->critical("[Config::Migration] A config must be an object.");
+    return false;
+  }
+
+  if (!config.contains("socket") || !config["socket"].is_string()) {
+    logger_->critical("[Config::Migration] A config object must have \"socket\" string.");
+    return false;
+  }
+  configuration_.socket_path_ = config["socket"];
+
+  if (!config.contains("address") || !config["address"].is_string()) {
+    logger_->critical("[Config::Migration] A config object must have \"address\" string.");
+    return false;
+  }
+  configuration_.address_ = config["address"];
+
+  return true;
+}
+
+void GameImportListener::SetLogger(LoggerManager::Logger logger) noexcept {
+  logger_ = std::move(logger);
+}
+
+LoggerManager::Logger GameImportListener::GetLogger() const noexcept {
+  return logger_;
+}
+
+bool GameImportListener::Run() noexcept {
+  std::remove(configuration_.socket_path_.c_str());
+
+  boost::asio::local::stream_protocol::endpoint endpoint{
+    configuration_.socket_path_};
+  boost::system::error_code ec;
+  acceptor_.open(endpoint.protocol(), ec);
+  if (!ec) acceptor_.bind(endpoint, ec);
+  if (!ec) acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
+  if (ec) {
+    logger_->error("Cannot listen on {}. [Boost: {}]",
+      configuration_.socket_path_, ec.message());
+    return false;
+  }
+
+  logger_->info("Accepting games on {}.", configuration_.socket_path_);
+  acceptor_.async_accept(socket_,
+    [self = shared_from_this()](const boost::system::error_code& ec) {
+      self->HandleAccept(ec);
+    });
+  return true;
+}
+
+void GameImportListener::HandleAccept(const boost::system::error_code& ec) noexcept {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  if (ec) {
+    logger_->error("An error occurred during accepting a game. [Boost: {}]",
+      ec.message());
+  } else {
+    std::make_shared<ImportConnection>(std::move(socket_), shard_.GetServer(),
+      configuration_.address_, logger_)->Run();
+    socket_ = boost::asio::local::stream_protocol::socket{shard_.GetIOContext()};
+  }
+
+  acceptor_.async_accept(socket_,
+    [self = shared_from_this()](const boost::system::error_code& ec) {
+      self->HandleAccept(ec);
+    });
+}
+
+}  // namespace fusion_server
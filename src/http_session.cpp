@@ -9,52 +9,82 @@
 
 #include <cstdlib>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <fusion_server/allocator.hpp>
+#include <fusion_server/bot_pool.hpp>
+#include <fusion_server/frame_dictionary.hpp>
 #include <fusion_server/http_session.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/perf_counters.hpp>
+#include <fusion_server/profiler.hpp>
+#include <fusion_server/server.hpp>
 #include <fusion_server/websocket_session.hpp>
 
 namespace fusion_server {
 
-HTTPSession::HTTPSession(boost::asio::ip::tcp::socket socket) noexcept
-    : socket_{std::move(socket)}, strand_{socket_.get_executor()},
+namespace {
+
+/**
+ * This function returns the size of the request header stored at the
+ * beginning of the given buffer.
+ *
+ * @param[in] buffer
+ *   The buffer with received bytes.
+ *
+ * @return
+ *   The size of the header, including the terminating empty line, is returned.
+ *   If the buffer doesn't hold the whole header, 0 is returned.
+ */
+std::size_t GetHeaderSize(const system::PooledFlatBuffer& buffer) noexcept {
+  auto data = buffer.data();
+  std::string_view received{static_cast<const char*>(data.data()), data.size()};
+  auto position = received.find("\r\n\r\n");
+  return position == std::string_view::npos ? 0 : position + 4;
+}
+
+}  // namespace
+
+template <typename NextLayer>
+BasicHTTPSession<NextLayer>::BasicHTTPSession(NextLayer stream, Shard& shard) noexcept
+    : stream_{std::move(stream)}, shard_{shard}, strand_{stream_.get_executor()},
     logger_{LoggerManager::Get()} {}
 
 
-void HTTPSession::SetLogger(LoggerManager::Logger logger) noexcept {
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::SetLogger(LoggerManager::Logger logger) noexcept {
   logger_ = std::move(logger);
 }
 
-LoggerManager::Logger HTTPSession::GetLogger() const noexcept {
+template <typename NextLayer>
+LoggerManager::Logger BasicHTTPSession<NextLayer>::GetLogger() const noexcept {
   return logger_;
 }
 
-void HTTPSession::Run() noexcept {
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::Run() noexcept {
   if (!(*this)) {
     return;
   }
-  boost::beast::http::async_read(
-    socket_,
-    buffer_,
-    request_,
-    [self = shared_from_this()](
-      const boost::system::error_code& ec,
-      std::size_t bytes_transmitted
-    ) {
-      self->HandleRead(ec, bytes_transmitted);
-  });
+  parser_.emplace();
+  DoRead();
 }
 
-void HTTPSession::Close() noexcept {
-  auto endpoint = socket_.remote_endpoint();
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::Close() noexcept {
+  auto endpoint = stream_.remote_endpoint();
   logger_->debug("Closing connection to {}.", endpoint);
 
   boost::system::error_code ec;
-  socket_.close(ec);
+  stream_.close(ec);
 
   if (ec) {
     logger_->warn("An error occurred during closing the connection to {}", endpoint);
@@ -64,83 +94,193 @@ void HTTPSession::Close() noexcept {
   }
 }
 
-HTTPSession::operator bool() const noexcept {
-  return socket_.is_open();
+template <typename NextLayer>
+BasicHTTPSession<NextLayer>::operator bool() const noexcept {
+  return stream_.is_open();
+}
+
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::HandleReadSome(const boost::system::error_code& ec,
+  std::size_t bytes_transmitted) noexcept {
+  if (ec == boost::asio::error::eof) {
+    logger_->debug("Connection from {} has been closed.", stream_.remote_endpoint());
+    stream_.shutdown(boost::asio::socket_base::shutdown_send);
+    return;
+  }
+  if (ec) {
+    logger_->error("An error occurred during reading. [Boost:{}]", ec.message());
+    return;
+  }
+
+  buffer_.commit(bytes_transmitted);
+  DoRead();
 }
 
-void HTTPSession::HandleRead(const boost::system::error_code& ec, std::size_t bytes_transmitted) noexcept {
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::HandleRead(const boost::system::error_code& ec, std::size_t bytes_transmitted) noexcept {
   logger_->debug("Read {} bytes from {}.", bytes_transmitted,
-    socket_.remote_endpoint());
+    stream_.remote_endpoint());
 
   if (ec == boost::beast::http::error::end_of_stream ||
     ec == boost::beast::http::error::partial_message) {
     // Either client closed the connection or the connection timed out.
-    logger_->debug("Connection from {} has been closed.", socket_.remote_endpoint());
-    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+    logger_->debug("Connection from {} has been closed.", stream_.remote_endpoint());
+    stream_.shutdown(boost::asio::socket_base::shutdown_send);
     return;
   }
   if (IsTooLargeRequestError(ec)) {
     logger_->warn("A request from {} is too large. Closing the connection. [Size: {}]",
-      socket_.remote_endpoint(), bytes_transmitted);
-    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both);
+      stream_.remote_endpoint(), bytes_transmitted);
+    stream_.shutdown(boost::asio::socket_base::shutdown_both);
     return;
   }
 
   if (IsBadRequestError(ec)) {
+    buffer_.consume(buffer_.size());
     PerformAsyncWrite(MakeBadRequest());
     return;
   }
 
-  if (request_.version() == 11 &&
-    request_.find(boost::beast::http::field::host) == request_.end()) {
-    PerformAsyncWrite(MakeBadRequest());
+  if (ec) {
+    logger_->error("An error occurred during reading. [Boost:{}]", ec.message());
     return;
   }
 
-  if (ec) {
-    logger_->error("An error occurred during reading. [Boost:{}]", ec.message());
+  request_ = parser_->release();
+
+  if (request_.target() == "/healthz" || request_.target() == "/readyz") {
+    PerformAsyncWrite(MakeProbeResponse());
     return;
   }
 
-  if (boost::beast::websocket::is_upgrade(request_)) {
-    logger_->debug("Received an upgrade request from {}.", socket_.remote_endpoint());
-    auto ws = std::make_shared<WebSocketSession>(std::move(socket_));
-    ws->SetLogger(LoggerManager::Get("websocket"));
-    ws->Run(std::move(request_));
+  if (request_.target() == "/dictionary") {
+    PerformAsyncWrite(MakeDictionaryResponse());
+    return;
+  }
+
+  if (request_.target().substr(0, 14) == "/admin/profile") {
+    DoProfile();
+    return;
+  }
+
+  if (request_.target().substr(0, 7) == "/admin/") {
+    PerformAsyncWrite(MakeAdminResponse());
     return;
   }
 
   PerformAsyncWrite(MakeResponse());
 }
 
-void HTTPSession::HandleWrite(const boost::system::error_code& ec,
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::HandleWrite(const boost::system::error_code& ec,
   std::size_t bytes_transmitted, bool close) noexcept {
   logger_->debug("Written {} bytes to {}.", bytes_transmitted,
-    socket_.remote_endpoint());
+    stream_.remote_endpoint());
 
   if (ec) {
     logger_->error("An error occurred during writing to {}. [Boost:{}]",
-      socket_.remote_endpoint(), ec.message());
+      stream_.remote_endpoint(), ec.message());
     return;
   }
 
   if (close) {
     // The client closed its connection. We do the same.
     logger_->debug("Client {} closed the connection. [KeepAlive: false]",
-      socket_.remote_endpoint());
-    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+      stream_.remote_endpoint());
+    stream_.shutdown(boost::asio::socket_base::shutdown_send);
     return;
   }
 
   // Clear contents of the request message, otherwise the read behavior is undefined.
-  buffer_.consume(buffer_.size());
+  // The memory of both is released while the connection is idle. Bytes of a
+  // pipelined request are kept in the buffer.
+  if (buffer_.size() == 0) {
+    buffer_.shrink_to_fit();
+  }
   request_ = {};
+  parser_.emplace();
+
+  DoRead();
+}
+
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::DoRead() noexcept {
+  if (auto header_size = GetHeaderSize(buffer_); header_size != 0) {
+    HandleHeader(header_size);
+    return;
+  }
+
+  if (buffer_.size() >= kMaxHeaderSize) {
+    logger_->warn("A request header from {} is too large. Closing the connection. [Size: {}]",
+      stream_.remote_endpoint(), buffer_.size());
+    stream_.shutdown(boost::asio::socket_base::shutdown_both);
+    return;
+  }
+
+  // The header never needs more than a single allocation of the buffer.
+  stream_.async_read_some(
+    buffer_.prepare(kMaxHeaderSize - buffer_.size()),
+    [self = this->shared_from_this()](
+      const boost::system::error_code& ec,
+      std::size_t bytes_transmitted
+    ) {
+      self->HandleReadSome(ec, bytes_transmitted);
+  });
+}
+
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::HandleHeader(std::size_t header_size) noexcept {
+  boost::system::error_code ec;
+  parser_->header_limit(kMaxHeaderSize);
+  parser_->put(boost::asio::buffer(buffer_.data().data(), header_size), ec);
+
+  if (IsTooLargeRequestError(ec)) {
+    logger_->warn("A request header from {} is too large. Closing the connection. [Size: {}]",
+      stream_.remote_endpoint(), header_size);
+    stream_.shutdown(boost::asio::socket_base::shutdown_both);
+    return;
+  }
+
+  const auto& header = parser_->get();
+  if (ec || !parser_->is_header_done() || (header.version() == 11 &&
+      header.find(boost::beast::http::field::host) == header.end())) {
+    buffer_.consume(buffer_.size());
+    PerformAsyncWrite(MakeBadRequest());
+    return;
+  }
+
+  if (boost::beast::websocket::is_upgrade(header)) {
+    logger_->debug("Received an upgrade request from {}.", stream_.remote_endpoint());
+    // The WebSocket session takes over the buffer, so its allocation is reused
+    // for the first message. The bytes the client has already sent after the
+    // header are read before the ones of the socket.
+    buffer_.consume(header_size);
+    auto ws = std::make_shared<BasicWebSocketSession<NextLayer>>(
+      std::move(stream_), shard_, std::move(buffer_));
+    ws->SetLogger(LoggerManager::Get("websocket"));
+    // The packages are compressed only if the client has the current version
+    // of the dictionary.
+    auto dictionary = shard_.GetServer().GetFrameDictionary();
+    auto offer = header[FrameDictionary::kCompressionField];
+    if (dictionary != nullptr && !offer.empty() &&
+        FrameDictionary::ParseOffer({offer.data(), offer.size()}) == dictionary->GetVersion()) {
+      ws->SetFrameDictionary(std::move(dictionary));
+    }
+    ws->Run(parser_->release());
+    return;
+  }
+
+  buffer_.consume(header_size);
+  if (parser_->is_done()) {
+    HandleRead({}, header_size);
+    return;
+  }
 
   boost::beast::http::async_read(
-    socket_,
+    stream_,
     buffer_,
-    request_,
-    [self = shared_from_this()](
+    *parser_,
+    [self = this->shared_from_this()](
       const boost::system::error_code& ec,
       std::size_t bytes_transmitted
     ) {
@@ -148,13 +288,14 @@ void HTTPSession::HandleWrite(const boost::system::error_code& ec,
   });
 }
 
-void HTTPSession::PerformAsyncWrite(Response_t response) noexcept {
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::PerformAsyncWrite(Response_t response) noexcept {
   auto response_ptr = std::make_shared<decltype(response)>(std::move(response));
 
   boost::beast::http::async_write(
-    socket_,
+    stream_,
     *response_ptr,
-    [self = shared_from_this(), response_ptr](
+    [self = this->shared_from_this(), response_ptr](
       const boost::system::error_code& ec,
       std::size_t bytes_transmitted
     ) {
@@ -162,7 +303,8 @@ void HTTPSession::PerformAsyncWrite(Response_t response) noexcept {
   });
 }
 
-HTTPSession::Response_t HTTPSession::MakeResponse() const noexcept {
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeResponse() const noexcept -> Response_t {
   Response_t res{
     request_.target() == "/" ? boost::beast::http::status::ok :
     boost::beast::http::status::not_found, request_.version()
@@ -175,7 +317,282 @@ HTTPSession::Response_t HTTPSession::MakeResponse() const noexcept {
   return res;
 }
 
-HTTPSession::Response_t  HTTPSession::MakeBadRequest() const noexcept {
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeAdminResponse() const noexcept -> Response_t {
+  using boost::beast::http::status;
+  const auto make_result = [](const char* result) {
+    return json::JSON({
+      {"result", result},
+    }, false, json::JSON::value_t::object);
+  };
+
+  if (!IsAdminClient()) {
+    return MakeJSONResponse(status::forbidden, make_result("forbidden"));
+  }
+
+  if (request_.target() == "/admin/perf") {
+    return MakePerfResponse();
+  }
+
+  if (request_.target() == "/admin/bots") {
+    return MakeBotsResponse();
+  }
+
+  if (request_.target() == "/admin/allocator") {
+    auto stats = Allocator::GetStats();
+    const auto& pool = system::BufferPool::Get();
+    return MakeJSONResponse(status::ok, json::JSON({
+      {"allocator", Allocator::GetName()},
+      {"allocated_bytes", stats.allocated_bytes_},
+      {"committed_bytes", stats.committed_bytes_},
+      {"resident_bytes", stats.resident_bytes_},
+      {"pool_borrowed_bytes", pool.GetBorrowedBytes()},
+      {"pool_retained_bytes", pool.GetRetainedBytes()},
+    }, false, json::JSON::value_t::object));
+  }
+
+  if (request_.target() != "/admin/migrate") {
+    return MakeJSONResponse(status::not_found, make_result("not-found"));
+  }
+  if (request_.method() != boost::beast::http::verb::post) {
+    return MakeJSONResponse(status::method_not_allowed,
+      make_result("method-not-allowed"));
+  }
+
+  const auto& body = request_.body();
+  auto request = json::Parse(body.begin(), body.end());
+  if (!request || !request->is_object() || !request->contains("game") ||
+      !(*request)["game"].is_string()) {
+    return MakeJSONResponse(status::bad_request, make_result("bad-request"));
+  }
+  std::string game_name = (*request)["game"];
+
+  if (request->contains("shard") && (*request)["shard"].is_number_unsigned()) {
+    auto moved = shard_.GetServer().MigrateGame(game_name, (*request)["shard"]);
+    return moved ? MakeJSONResponse(status::ok, make_result("moved")) :
+      MakeJSONResponse(status::conflict, make_result("not-moved"));
+  }
+
+  if (request->contains("socket") && (*request)["socket"].is_string()) {
+    auto started = shard_.GetServer().ExportGame(game_name, (*request)["socket"]);
+    return started ? MakeJSONResponse(status::accepted, make_result("exporting")) :
+      MakeJSONResponse(status::conflict, make_result("not-exported"));
+  }
+
+  return MakeJSONResponse(status::bad_request, make_result("bad-request"));
+}
+
+template <typename NextLayer>
+void BasicHTTPSession<NextLayer>::DoProfile() noexcept {
+  using boost::beast::http::status;
+  const auto make_result = [](const char* result) {
+    return json::JSON({
+      {"result", result},
+    }, false, json::JSON::value_t::object);
+  };
+
+  if (!IsAdminClient()) {
+    PerformAsyncWrite(MakeJSONResponse(status::forbidden, make_result("forbidden")));
+    return;
+  }
+  if (request_.method() != boost::beast::http::verb::get) {
+    PerformAsyncWrite(MakeJSONResponse(status::method_not_allowed,
+      make_result("method-not-allowed")));
+    return;
+  }
+
+  auto target = request_.target();
+  std::chrono::seconds duration{10};
+  if (target != "/admin/profile") {
+    const boost::beast::string_view kSecondsQuery = "/admin/profile?seconds=";
+    auto value = target.substr(std::min(target.size(), kSecondsQuery.size()));
+    if (target.substr(0, kSecondsQuery.size()) != kSecondsQuery || value.empty() ||
+        value.size() > 3 || value.find_first_not_of("0123456789") != value.npos) {
+      PerformAsyncWrite(MakeJSONResponse(status::bad_request, make_result("bad-request")));
+      return;
+    }
+    duration = std::chrono::seconds{std::stoi(std::string{value})};
+    if (duration.count() < 1 || duration > Profiler::kMaxDuration) {
+      PerformAsyncWrite(MakeJSONResponse(status::bad_request, make_result("bad-request")));
+      return;
+    }
+  }
+
+  if (!Profiler::Get().Start()) {
+    PerformAsyncWrite(MakeJSONResponse(status::conflict, make_result("already-profiling")));
+    return;
+  }
+  logger_->info("Profiling for {} s on request of {}.", duration.count(),
+    stream_.remote_endpoint());
+
+  auto timer = std::make_shared<boost::asio::steady_timer>(stream_.get_executor(), duration);
+  timer->async_wait([self = this->shared_from_this(), timer](const boost::system::error_code&) {
+    Response_t res{status::ok, self->request_.version()};
+    res.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+    res.set(boost::beast::http::field::content_type, "application/octet-stream");
+    res.set(boost::beast::http::field::content_disposition,
+      "attachment; filename=\"profile.pb\"");
+    res.keep_alive(self->request_.keep_alive());
+    res.body() = Profiler::Get().Stop();
+    res.prepare_payload();
+    self->PerformAsyncWrite(std::move(res));
+  });
+}
+
+template <typename NextLayer>
+bool BasicHTTPSession<NextLayer>::IsAdminClient() const noexcept {
+  boost::system::error_code ec;
+  auto endpoint = stream_.remote_endpoint(ec);
+  return !ec && endpoint.address().is_loopback();
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakePerfResponse() const noexcept -> Response_t {
+  using boost::beast::http::status;
+  auto& counters = PerfCounters::Get();
+
+  if (request_.method() == boost::beast::http::verb::post) {
+    const auto& body = request_.body();
+    auto request = json::Parse(body.begin(), body.end());
+    if (!request || !request->is_object() || !request->contains("enabled") ||
+        !(*request)["enabled"].is_boolean()) {
+      return MakeJSONResponse(status::bad_request, json::JSON({
+        {"result", "bad-request"},
+      }, false, json::JSON::value_t::object));
+    }
+    if (!(*request)["enabled"]) {
+      counters.Disable();
+    } else if (!counters.Enable()) {
+      return MakeJSONResponse(status::conflict, json::JSON({
+        {"result", "not-available"},
+      }, false, json::JSON::value_t::object));
+    }
+  } else if (request_.method() != boost::beast::http::verb::get) {
+    return MakeJSONResponse(status::method_not_allowed, json::JSON({
+      {"result", "method-not-allowed"},
+    }, false, json::JSON::value_t::object));
+  }
+
+  auto subsystems = json::JSON::object();
+  for (std::size_t i = 0; i < PerfCounters::kNumberOfSubsystems; i++) {
+    auto subsystem = static_cast<PerfCounters::Subsystem>(i);
+    auto totals = counters.GetTotals(subsystem);
+    auto entry = json::JSON::object();
+    entry["samples"] = totals.samples_;
+    for (std::size_t j = 0; j < PerfCounters::kNumberOfEvents; j++) {
+      entry[PerfCounters::GetName(static_cast<PerfCounters::Event>(j))] = totals.events_[j];
+    }
+    subsystems[PerfCounters::GetName(subsystem)] = std::move(entry);
+  }
+  return MakeJSONResponse(status::ok, json::JSON({
+    {"enabled", counters.IsEnabled()},
+    {"subsystems", std::move(subsystems)},
+  }, false, json::JSON::value_t::object));
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeBotsResponse() const noexcept -> Response_t {
+  using boost::beast::http::status;
+  auto* bot_pool = shard_.GetServer().GetBotPool();
+  if (bot_pool == nullptr) {
+    return MakeJSONResponse(status::conflict, json::JSON({
+      {"result", "not-available"},
+    }, false, json::JSON::value_t::object));
+  }
+
+  if (request_.method() == boost::beast::http::verb::post) {
+    const auto& body = request_.body();
+    auto request = json::Parse(body.begin(), body.end());
+    if (!request || !request->is_object() || !request->contains("game") ||
+        !(*request)["game"].is_string() || !request->contains("count") ||
+        !(*request)["count"].is_number_unsigned()) {
+      return MakeJSONResponse(status::bad_request, json::JSON({
+        {"result", "bad-request"},
+      }, false, json::JSON::value_t::object));
+    }
+    std::string game_name = (*request)["game"];
+    std::size_t count = (*request)["count"];
+    if (count > BotPool::kMaxSpawnCount) {
+      return MakeJSONResponse(status::bad_request, json::JSON({
+        {"result", "too-many-bots"},
+        {"max_count", BotPool::kMaxSpawnCount},
+      }, false, json::JSON::value_t::object));
+    }
+    auto joined = bot_pool->Spawn(game_name, count);
+    return MakeJSONResponse(status::ok, json::JSON({
+      {"result", joined == count ? "joined" : "partially-joined"},
+      {"joined", joined},
+      {"bots", bot_pool->GetNumberOfBots()},
+    }, false, json::JSON::value_t::object));
+  }
+
+  if (request_.method() == boost::beast::http::verb::delete_) {
+    bot_pool->Clear();
+  } else if (request_.method() != boost::beast::http::verb::get) {
+    return MakeJSONResponse(status::method_not_allowed, json::JSON({
+      {"result", "method-not-allowed"},
+    }, false, json::JSON::value_t::object));
+  }
+
+  return MakeJSONResponse(status::ok, json::JSON({
+    {"bots", bot_pool->GetNumberOfBots()},
+  }, false, json::JSON::value_t::object));
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeProbeResponse() const noexcept -> Response_t {
+  using boost::beast::http::status;
+  // Probes are frequent, so the answer is built from atomic values only.
+  auto& server = shard_.GetServer();
+  auto is_ok = request_.target() == "/healthz" || server.IsReady();
+
+  Response_t res{is_ok ? status::ok : status::service_unavailable,
+    request_.version()};
+  res.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(boost::beast::http::field::content_type, "text/plain; charset=utf-8");
+  res.set(kLoadScoreField, std::to_string(server.GetLoadScore()));
+  res.keep_alive(request_.keep_alive());
+  res.body() = is_ok ? "ok\r\n" : "not-ready\r\n";
+  res.prepare_payload();
+  return res;
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeDictionaryResponse() const noexcept -> Response_t {
+  using boost::beast::http::status;
+  auto dictionary = shard_.GetServer().GetFrameDictionary();
+  if (dictionary == nullptr) {
+    return MakeJSONResponse(status::not_found, json::JSON({
+      {"result", "not-available"},
+    }, false, json::JSON::value_t::object));
+  }
+
+  Response_t res{status::ok, request_.version()};
+  res.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(boost::beast::http::field::content_type, "application/octet-stream");
+  res.set(boost::beast::http::field::etag,
+    "\"" + std::to_string(dictionary->GetVersion()) + "\"");
+  res.set(FrameDictionary::kCompressionField, dictionary->GetToken());
+  res.keep_alive(request_.keep_alive());
+  res.body() = dictionary->GetContent();
+  res.prepare_payload();
+  return res;
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeJSONResponse(
+    boost::beast::http::status status, const json::JSON& body) const noexcept -> Response_t {
+  Response_t res{status, request_.version()};
+  res.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(boost::beast::http::field::content_type, "application/json");
+  res.keep_alive(request_.keep_alive());
+  res.body() = body.dump();
+  res.prepare_payload();
+  return res;
+}
+
+template <typename NextLayer>
+auto BasicHTTPSession<NextLayer>::MakeBadRequest() const noexcept -> Response_t {
   Response_t res{
     boost::beast::http::status::bad_request,
     request_.version()
@@ -188,7 +605,8 @@ HTTPSession::Response_t  HTTPSession::MakeBadRequest() const noexcept {
   return res;
 }
 
-bool HTTPSession::IsBadRequestError(const boost::system::error_code& ec) const noexcept {
+template <typename NextLayer>
+bool BasicHTTPSession<NextLayer>::IsBadRequestError(const boost::system::error_code& ec) const noexcept {
   return ec == boost::beast::http::error::bad_line_ending ||
          ec == boost::beast::http::error::bad_method ||
          ec == boost::beast::http::error::bad_target ||
@@ -204,10 +622,14 @@ bool HTTPSession::IsBadRequestError(const boost::system::error_code& ec) const n
          ec == boost::beast::http::error::bad_obs_fold;
 }
 
-bool HTTPSession::IsTooLargeRequestError(const boost::system::error_code& ec) const noexcept {
+template <typename NextLayer>
+bool BasicHTTPSession<NextLayer>::IsTooLargeRequestError(const boost::system::error_code& ec) const noexcept {
   return ec == boost::beast::http::error::buffer_overflow ||
          ec == boost::beast::http::error::header_limit ||
          ec == boost::beast::http::error::body_limit;
 }
 
+template class BasicHTTPSession<boost::asio::ip::tcp::socket>;
+template class BasicHTTPSession<system::MemoryStream>;
+
 }  // namespace fusion_server
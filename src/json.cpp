@@ -1,3 +1,14 @@
+#include <cstdint>
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#if defined(FUSION_SIMDJSON)
+#include <simdjson.h>
+#endif
+
 #include <fusion_server/json.hpp>
 
 namespace fusion_server::json {
@@ -84,6 +95,38 @@ JSON MakeNotValidLeave() noexcept {
     }, false, JSON::value_t::object);
 }
 
+/**
+ * This method returns a JSON object contains an error message for the client
+ * informing that a "CHAT" package was ill-formed.
+ *
+ * @return
+ *   A JSON object contains an error message for the client informing that
+ *   a "CHAT" package was ill-formed is returned.
+ */
+JSON MakeNotValidChat() noexcept {
+  return JSON({
+    {"closed", true},
+    {"type", "error"},
+    {"message", "A \"CHAT\" was ill-formed."}
+    }, false, JSON::value_t::object);
+}
+
+/**
+ * This method returns a JSON object contains an error message for the client
+ * informing that a "BATCH" package was ill-formed.
+ *
+ * @return
+ *   A JSON object contains an error message for the client informing that
+ *   a "BATCH" package was ill-formed is returned.
+ */
+JSON MakeNotValidBatch() noexcept {
+  return JSON({
+    {"closed", true},
+    {"type", "error"},
+    {"message", "A \"BATCH\" was ill-formed."}
+    }, false, JSON::value_t::object);
+}
+
 /**
  * This method returns a JSON object contains an error message for the client
  * informing that a package was unidentified.
@@ -100,9 +143,91 @@ JSON MakeUnidentified() noexcept {
     }, false, JSON::value_t::object);
 }
 
-}  // namespace
+/**
+ * This function returns an indication whether or not the given object has all
+ * fields of an "UPDATE" package and exactly the given number of other fields.
+ *
+ * @param[in] json
+ *   The verified object.
+ *
+ * @param[in] other_fields
+ *   The number of fields other than "direction" and "angle" (including
+ *   "type").
+ *
+ * @return
+ *   An indication whether or not the given object is a valid "UPDATE" package
+ *   is returned.
+ */
+bool IsValidUpdate(const JSON& json, std::size_t other_fields) noexcept {
+  auto direction = json.find("direction");
+  auto angle = json.find("angle");
+  return direction != json.end() &&
+         angle != json.end() &&
+         json.size() == 2 + other_fields &&
+         direction->type() == JSON::value_t::number_unsigned &&
+         angle->type() == JSON::value_t::number_float;
+}
 
-std::pair<bool, JSON>  Verify(const std::string& raw_package) noexcept {
+/**
+ * This function returns an indication whether or not the given object is
+ * a valid "BATCH" package. All inputs and their sequence numbers are verified
+ * in a single pass.
+ *
+ * @param[in] json
+ *   The verified object.
+ *
+ * @return
+ *   An indication whether or not the given object is a valid "BATCH" package
+ *   is returned.
+ */
+bool IsValidBatch(const JSON& json) noexcept {
+  auto inputs = json.find("inputs");
+  if (!(inputs != json.end() &&
+        json.size() == 1 + 1 &&
+        inputs->is_array() &&
+        !inputs->empty() &&
+        inputs->size() <= kMaxBatchSize)) {
+    return false;
+  }
+
+  std::optional<std::uint64_t> last_seq;
+  for (const auto& input : *inputs) {
+    if (!input.is_object()) {
+      return false;
+    }
+    auto type = input.find("type");
+    auto seq = input.find("seq");
+    if (!(type != input.end() &&
+          seq != input.end() &&
+          *type == "update" &&
+          seq->type() == JSON::value_t::number_unsigned &&
+          IsValidUpdate(input, 2))) {
+      return false;
+    }
+
+    auto current_seq = seq->get<std::uint64_t>();
+    if (last_seq && current_seq <= last_seq.value()) {
+      // Sequence numbers must be strictly increasing.
+      return false;
+    }
+    last_seq = current_seq;
+  }
+  return true;
+}
+
+/**
+ * This table maps the names of the package types to their identifiers. The
+ * names are ordered like the enumerators of PackageType.
+ */
+constexpr std::array<std::string_view, kNumberOfPackageTypes> kPackageTypeNames{{
+  "join", "update", "batch", "leave", "chat",
+}};
+
+/**
+ * This function verifies the given package with nlohmann's DOM parser. See
+ * Verify() for the description.
+ */
+std::pair<bool, JSON> VerifyDOM(const std::string& raw_package) noexcept {
   auto parsed = Parse(raw_package.begin(), raw_package.end());
   if (!parsed) {
     return std::make_pair(false, MakeNotValidJSON());
@@ -116,27 +241,33 @@ std::pair<bool, JSON>  Verify(const std::string& raw_package) noexcept {
   }
 
   if (json["type"] == "join") {
+    // A client redirected from another node sends also its "token".
+    auto has_token = json.contains("token");
     if (!(json.contains("nick") &&
           json.contains("game") &&
-          json.size() ==  2 + 1 &&
+          json.size() == 2 + 1 + (has_token ? 1 : 0) &&
           json["nick"].type() == decltype(json)::value_t::string &&
-          json["game"].type() == decltype(json)::value_t::string)) {
+          json["game"].type() == decltype(json)::value_t::string &&
+          (!has_token || json["token"].is_string()))) {
       return std::make_pair(false, MakeNotValidJoin());
     }
     return std::make_pair(true, std::move(json));
   }
 
   if (json["type"] == "update") {
-    if (!(json.contains("direction") &&
-          json.contains("angle") &&
-          json.size() ==  2 + 1 &&
-          json["direction"].type() == decltype(json)::value_t::number_unsigned &&
-          json["angle"].type() == decltype(json)::value_t::number_float)) {
+    if (!IsValidUpdate(json, 1)) {
       return std::make_pair(false, MakeNotValidUpdate());
     }
     return std::make_pair(true, std::move(json));
   }
 
+  if (json["type"] == "batch") {
+    if (!IsValidBatch(json)) {
+      return std::make_pair(false, MakeNotValidBatch());
+    }
+    return std::make_pair(true, std::move(json));
+  }
+
   if (json["type"] == "leave") {
     if (json.size() != 1) {
       return std::make_pair(false, MakeNotValidLeave());
@@ -144,9 +275,384 @@ std::pair<bool, JSON>  Verify(const std::string& raw_package) noexcept {
     return std::make_pair(true, std::move(json));
   }
 
+  if (json["type"] == "chat") {
+    if (!(json.contains("channel") &&
+          json.contains("message") &&
+          json.size() == 2 + 1 &&
+          json["message"].type() == decltype(json)::value_t::string &&
+          (json["channel"] == "all" || json["channel"] == "team"))) {
+      return std::make_pair(false, MakeNotValidChat());
+    }
+    return std::make_pair(true, std::move(json));
+  }
 
   // Received an undefined package.
   return std::make_pair(false, MakeUnidentified());
 }
 
+#if defined(FUSION_SIMDJSON)
+
+static_assert(kPackagePadding >= simdjson::SIMDJSON_PADDING,
+  "The packages must be padded as required by simdjson.");
+
+/**
+ * This enumeration identifies the fields read by the on-demand parser. Each
+ * enumerator is a bit of the mask of the fields present in an object.
+ */
+enum Field : std::uint16_t {
+  kNoField = 0,
+  kTypeField = 1U << 0U,
+  kNickField = 1U << 1U,
+  kGameField = 1U << 2U,
+  kTokenField = 1U << 3U,
+  kDirectionField = 1U << 4U,
+  kAngleField = 1U << 5U,
+  kInputsField = 1U << 6U,
+  kSeqField = 1U << 7U,
+  kChannelField = 1U << 8U,
+  kMessageField = 1U << 9U,
+};
+
+/**
+ * This function returns the field of the given name.
+ *
+ * @param[in] key
+ *   The unescaped name of the field.
+ *
+ * @return
+ *   The field of the given name is returned. If the name is unknown, kNoField
+ *   is returned.
+ */
+Field GetField(std::string_view key) noexcept {
+  constexpr std::array<std::pair<std::string_view, Field>, 10> kFields{{
+    {"type", kTypeField}, {"nick", kNickField}, {"game", kGameField},
+    {"token", kTokenField}, {"direction", kDirectionField},
+    {"angle", kAngleField}, {"inputs", kInputsField}, {"seq", kSeqField},
+    {"channel", kChannelField}, {"message", kMessageField},
+  }};
+  for (const auto& [name, field] : kFields) {
+    if (key == name) {
+      return field;
+    }
+  }
+  return kNoField;
+}
+
+/**
+ * This function reads a number, which nlohmann's parser would store as
+ * number_unsigned.
+ *
+ * @param[in] value
+ *   The value to be read.
+ *
+ * @param[out] out
+ *   The read number.
+ *
+ * @return
+ *   An indication whether or not the value is an unsigned number is returned.
+ */
+bool ReadUnsigned(simdjson::ondemand::value& value, std::uint64_t& out) noexcept {
+  // nlohmann's parser stores every number with a minus sign (also -0) as
+  // number_integer.
+  std::string_view raw = value.raw_json_token();
+  simdjson::ondemand::number number;
+  if (raw.empty() || raw.front() == '-' ||
+      value.get_number().get(number) != simdjson::SUCCESS) {
+    return false;
+  }
+
+  switch (number.get_number_type()) {
+    case simdjson::ondemand::number_type::signed_integer:
+      out = static_cast<std::uint64_t>(number.get_int64());
+      return true;
+    case simdjson::ondemand::number_type::unsigned_integer:
+      out = number.get_uint64();
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * This function reads a number, which nlohmann's parser would store as
+ * number_float.
+ *
+ * @param[in] value
+ *   The value to be read.
+ *
+ * @param[out] out
+ *   The read number.
+ *
+ * @return
+ *   An indication whether or not the value is a floating-point number is
+ *   returned.
+ */
+bool ReadFloat(simdjson::ondemand::value& value, double& out) noexcept {
+  simdjson::ondemand::number number;
+  if (value.get_number().get(number) != simdjson::SUCCESS ||
+      number.get_number_type() != simdjson::ondemand::number_type::floating_point_number) {
+    return false;
+  }
+  out = number.get_double();
+  return true;
+}
+
+/**
+ * This function reads the inputs of a "BATCH" package.
+ *
+ * @param[in] value
+ *   The value of the "inputs" field.
+ *
+ * @return
+ *   If all inputs are valid, an array of them is returned, otherwise the
+ *   returned object is in its invalid state.
+ */
+std::optional<JSON> ReadInputs(simdjson::ondemand::value& value) noexcept {
+  simdjson::ondemand::array array;
+  if (value.get_array().get(array) != simdjson::SUCCESS) {
+    return {};
+  }
+
+  auto inputs = JSON::array();
+  std::optional<std::uint64_t> last_seq;
+  for (auto element : array) {
+    simdjson::ondemand::object object;
+    if (element.get_object().get(object) != simdjson::SUCCESS ||
+        inputs.size() == kMaxBatchSize) {
+      return {};
+    }
+
+    std::uint16_t fields = kNoField;
+    std::string_view type;
+    std::uint64_t seq = 0;
+    std::uint64_t direction = 0;
+    double angle = 0.0;
+    for (auto result : object) {
+      simdjson::ondemand::field field;
+      std::string_view key;
+      if (std::move(result).get(field) != simdjson::SUCCESS ||
+          field.unescaped_key().get(key) != simdjson::SUCCESS) {
+        return {};
+      }
+
+      auto current = GetField(key);
+      if ((fields & current) != 0) {
+        // nlohmann's parser keeps the last of the duplicated fields.
+        return {};
+      }
+      fields |= current;
+
+      bool is_read = false;
+      switch (current) {
+        case kTypeField:
+          is_read = field.value().get_string().get(type) == simdjson::SUCCESS;
+          break;
+        case kSeqField:
+          is_read = ReadUnsigned(field.value(), seq);
+          break;
+        case kDirectionField:
+          is_read = ReadUnsigned(field.value(), direction);
+          break;
+        case kAngleField:
+          is_read = ReadFloat(field.value(), angle);
+          break;
+        default:
+          break;
+      }
+      if (!is_read) {
+        return {};
+      }
+    }
+
+    if (fields != (kTypeField | kSeqField | kDirectionField | kAngleField) ||
+        type != "update" || (last_seq && seq <= last_seq.value())) {
+      return {};
+    }
+    last_seq = seq;
+
+    inputs.push_back(JSON({
+      {"type", "update"},
+      {"seq", seq},
+      {"direction", direction},
+      {"angle", angle},
+    }, false, JSON::value_t::object));
+  }
+
+  if (inputs.empty()) {
+    return {};
+  }
+  return inputs;
+}
+
+/**
+ * This function verifies the given package with simdjson's on-demand parser.
+ * The fields are read straight from the raw package, without building its DOM
+ * first. Only the valid packages are accepted; for everything else (including
+ * the packages, which nlohmann's parser would read differently, e.g. with
+ * duplicated fields) the returned object is in its invalid state and the
+ * package has to be verified by VerifyDOM(), which produces the error message.
+ *
+ * @param[in] raw_package
+ *   The raw package followed by simdjson's padding.
+ *
+ * @return
+ *   If the package is valid, the parsed package is returned, otherwise the
+ *   returned object is in its invalid state.
+ */
+std::optional<JSON>
+VerifyOnDemand(simdjson::padded_string_view raw_package) noexcept {
+  // The parser reuses its buffers, so only the first package read by a thread
+  // allocates them.
+  thread_local simdjson::ondemand::parser parser;
+
+  simdjson::ondemand::document document;
+  simdjson::ondemand::object object;
+  if (parser.iterate(raw_package).get(document) != simdjson::SUCCESS ||
+      document.get_object().get(object) != simdjson::SUCCESS) {
+    return {};
+  }
+
+  std::uint16_t fields = kNoField;
+  std::string_view type;
+  std::string_view nick;
+  std::string_view game;
+  std::string_view token;
+  std::string_view channel;
+  std::string_view message;
+  std::uint64_t direction = 0;
+  double angle = 0.0;
+  std::optional<JSON> inputs;
+  for (auto result : object) {
+    simdjson::ondemand::field field;
+    std::string_view key;
+    if (std::move(result).get(field) != simdjson::SUCCESS ||
+        field.unescaped_key().get(key) != simdjson::SUCCESS) {
+      return {};
+    }
+
+    auto current = GetField(key);
+    if (current == kNoField || (fields & current) != 0) {
+      // An unknown field makes every package not valid.
+      return {};
+    }
+    fields |= current;
+
+    bool is_read = false;
+    switch (current) {
+      case kTypeField:
+        is_read = field.value().get_string().get(type) == simdjson::SUCCESS;
+        break;
+      case kNickField:
+        is_read = field.value().get_string().get(nick) == simdjson::SUCCESS;
+        break;
+      case kGameField:
+        is_read = field.value().get_string().get(game) == simdjson::SUCCESS;
+        break;
+      case kTokenField:
+        is_read = field.value().get_string().get(token) == simdjson::SUCCESS;
+        break;
+      case kChannelField:
+        is_read = field.value().get_string().get(channel) == simdjson::SUCCESS;
+        break;
+      case kMessageField:
+        is_read = field.value().get_string().get(message) == simdjson::SUCCESS;
+        break;
+      case kDirectionField:
+        is_read = ReadUnsigned(field.value(), direction);
+        break;
+      case kAngleField:
+        is_read = ReadFloat(field.value(), angle);
+        break;
+      case kInputsField:
+        inputs = ReadInputs(field.value());
+        is_read = inputs.has_value();
+        break;
+      default:
+        break;
+    }
+    if (!is_read) {
+      return {};
+    }
+  }
+
+  if (!document.at_end()) {
+    return {};
+  }
+
+  if (type == "join" && (fields & ~kTokenField) == (kTypeField | kNickField | kGameField)) {
+    auto package = JSON({
+      {"type", "join"},
+      {"nick", std::string{nick}},
+      {"game", std::string{game}},
+    }, false, JSON::value_t::object);
+    if ((fields & kTokenField) != 0) {
+      package["token"] = std::string{token};
+    }
+    return package;
+  }
+
+  if (type == "update" && fields == (kTypeField | kDirectionField | kAngleField)) {
+    return JSON({
+      {"type", "update"},
+      {"direction", direction},
+      {"angle", angle},
+    }, false, JSON::value_t::object);
+  }
+
+  if (type == "batch" && fields == (kTypeField | kInputsField)) {
+    return JSON({
+      {"type", "batch"},
+      {"inputs", std::move(inputs.value())},
+    }, false, JSON::value_t::object);
+  }
+
+  if (type == "leave" && fields == kTypeField) {
+    return JSON({{"type", "leave"}}, false, JSON::value_t::object);
+  }
+
+  if (type == "chat" && fields == (kTypeField | kChannelField | kMessageField) &&
+      (channel == "all" || channel == "team")) {
+    return JSON({
+      {"type", "chat"},
+      {"channel", std::string{channel}},
+      {"message", std::string{message}},
+    }, false, JSON::value_t::object);
+  }
+
+  return {};
+}
+
+#endif
+
+}  // namespace
+
+std::pair<bool, JSON> Verify(const std::string& raw_package) noexcept {
+#if defined(FUSION_SIMDJSON)
+  // The read buffers of the sessions reserve the padding, so usually the
+  // package is parsed in place.
+  auto package = raw_package.capacity() >= raw_package.size() + simdjson::SIMDJSON_PADDING ?
+    VerifyOnDemand(simdjson::padded_string_view{raw_package}) :
+    VerifyOnDemand(simdjson::padded_string{raw_package});
+  if (package) {
+    return std::make_pair(true, std::move(package.value()));
+  }
+#endif
+  return VerifyDOM(raw_package);
+}
+
+std::optional<PackageType> GetPackageType(const JSON& package) noexcept {
+  auto type = package.find("type");
+  if (type == package.end() || !type->is_string()) {
+    return {};
+  }
+
+  const auto& name = type->get_ref<const JSON::string_t&>();
+  for (std::size_t i = 0; i < kPackageTypeNames.size(); i++) {
+    if (name == kPackageTypeNames[i]) {
+      return static_cast<PackageType>(i);
+    }
+  }
+  return {};
+}
+
 }  // namespace fusion_server::json
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file lag_probe.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the LagProbe class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <fusion_server/lag_probe.hpp>
+
+namespace fusion_server {
+
+LagProbe::LagProbe(boost::asio::io_context& ioc) noexcept
+  : timer_{ioc}, lag_us_{0} {}
+
+void LagProbe::Start() noexcept {
+  Schedule();
+}
+
+void LagProbe::Stop() noexcept {
+  boost::system::error_code ec;
+  timer_.cancel(ec);
+}
+
+std::chrono::microseconds LagProbe::GetLag() const noexcept {
+  return std::chrono::microseconds{lag_us_.load()};
+}
+
+void LagProbe::Schedule() noexcept {
+  timer_.expires_after(kProbeInterval);
+  timer_.async_wait([this](const boost::system::error_code& ec) {
+    HandleProbe(ec);
+  });
+}
+
+void LagProbe::HandleProbe(const boost::system::error_code& ec) noexcept {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  auto sample = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - timer_.expiry()).count();
+  // The weight of a sample is 1/4, so a saturation is noticed within a few
+  // probes.
+  auto lag = lag_us_.load();
+  lag_us_ = lag + (sample - lag) / 4;
+
+  Schedule();
+}
+
+}  // namespace fusion_server
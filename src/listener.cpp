@@ -17,11 +17,14 @@
 
 #include <fusion_server/http_session.hpp>
 #include <fusion_server/listener.hpp>
+#include <fusion_server/shard.hpp>
 
 namespace fusion_server {
 
-Listener::Listener(boost::asio::io_context &ioc) noexcept
-  : ioc_{ioc}, acceptor_{ioc}, socket_{ioc_}, is_open_{false}, logger_{LoggerManager::Get()} {
+Listener::Listener(Shard& shard) noexcept
+  : shard_{shard}, acceptor_{shard.GetIOContext()}, socket_{shard.GetIOContext()},
+    defer_timer_{shard.GetIOContext()},
+    is_deferring_{false}, is_open_{false}, logger_{LoggerManager::Get()} {
   configuration_.number_of_connections_ = 0;
   configuration_.max_queued_connections_ = boost::asio::socket_base::max_listen_connections;
 }
@@ -79,6 +82,10 @@ LoggerManager::Logger Listener::GetLogger() const noexcept {
   return logger_;
 }
 
+void Listener::SetAdmissionCheck(AdmissionCheck admission_check) noexcept {
+  admission_check_ = std::move(admission_check);
+}
+
 bool Listener::Bind() noexcept {
   return InitAcceptor();
 }
@@ -117,11 +124,7 @@ bool Listener::Run() noexcept {
   }
 
   logger_->info("Starting asynchronous accepting on {}.", configuration_.endpoint_);
-  acceptor_.async_accept(
-    socket_,
-    [self = shared_from_this()](const boost::system::error_code &ec) {
-      self->HandleAccept(ec);
-    });
+  DoAccept();
   return true;
 }
 
@@ -153,9 +156,32 @@ void Listener::HandleAccept(const boost::system::error_code& ec) noexcept {
   } else {
     logger_->debug("Accepted a new connection from {}.", socket_.remote_endpoint());
     configuration_.number_of_connections_++;
-    std::make_shared<HTTPSession>(std::move(socket_))->Run();
+    std::make_shared<HTTPSession>(std::move(socket_), shard_)->Run();
   }
 
+  DoAccept();
+}
+
+void Listener::DoAccept() noexcept {
+  if (admission_check_ && !admission_check_()) {
+    // The server is too busy. Connections wait in the kernel's queue until the
+    // load drops, so the clients see a slower handshake instead of an error.
+    if (!is_deferring_) {
+      logger_->warn("The server is busy. Deferring new connections.");
+      is_deferring_ = true;
+    }
+    defer_timer_.expires_after(kDeferInterval);
+    defer_timer_.async_wait(
+      [self = shared_from_this()](const boost::system::error_code& ec) {
+        self->HandleDefer(ec);
+    });
+    return;
+  }
+
+  if (is_deferring_) {
+    logger_->info("Accepting new connections again.");
+    is_deferring_ = false;
+  }
   acceptor_.async_accept(
     socket_,
     [self = shared_from_this()](const boost::system::error_code& ec) {
@@ -163,6 +189,13 @@ void Listener::HandleAccept(const boost::system::error_code& ec) noexcept {
   });
 }
 
+void Listener::HandleDefer(const boost::system::error_code& ec) noexcept {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  DoAccept();
+}
+
 bool Listener::InitAcceptor() noexcept {
   boost::system::error_code ec;
 
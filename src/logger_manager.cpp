@@ -107,6 +107,10 @@ auto LoggerManager::Register(Logger logger) noexcept -> std::pair<bool, Logger>
     registered_names_ = std::make_unique<std::set<std::string>>();
   }
   auto [it, took_place] = registered_names_->insert(logger->name());
+  // Get() looks the loggers up in spdlog's registry, so they're added there.
+  if (took_place && spdlog::get(logger->name()) == nullptr) {
+    spdlog::register_logger(logger);
+  }
   return std::make_pair(took_place, spdlog::get(*it));
 }
 
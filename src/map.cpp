@@ -0,0 +1,366 @@
+/**
+ * @file map.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It defines the Map class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include <fusion_server/ui/map.hpp>
+
+namespace fusion_server::ui {
+
+namespace {
+
+/**
+ * This structure contains the working memory of the path queries of a thread.
+ * The entries are valid only if their stamp is equal to the stamp of the
+ * current query, so nothing is cleared between the queries.
+ */
+struct Scratch {
+  /**
+   * This method prepares the memory for a query on a map of the given size.
+   *
+   * @param[in] size
+   *   The number of cells of the map.
+   */
+  void Prepare(std::size_t size) {
+    if (stamps_.size() < size) {
+      stamps_.resize(size, 0);
+      closed_.resize(size, 0);
+      costs_.resize(size);
+      parents_.resize(size);
+    }
+    open_.clear();
+    if (++stamp_ == 0) {
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      std::fill(closed_.begin(), closed_.end(), 0);
+      stamp_ = 1;
+    }
+  }
+
+  /**
+   * This is the stamp of the current query.
+   */
+  std::uint32_t stamp_ = 0;
+
+  /**
+   * This contains the stamp of the query, which has reached each cell.
+   */
+  std::vector<std::uint32_t> stamps_;
+
+  /**
+   * This contains the stamp of the query, which has expanded each cell.
+   */
+  std::vector<std::uint32_t> closed_;
+
+  /**
+   * This contains the cost of the best known path to each cell.
+   */
+  std::vector<double> costs_;
+
+  /**
+   * This contains the previous jump point on the best known path to each cell.
+   */
+  std::vector<std::uint32_t> parents_;
+
+  /**
+   * This is the heap of the cells to be expanded, ordered by their estimated
+   * cost. A cell may be queued more than once; the stale entries are skipped.
+   */
+  std::vector<std::pair<double, std::uint32_t>> open_;
+};
+
+/**
+ * This function returns the length of the shortest path between two cells on
+ * an empty grid, where a diagonal step costs sqrt(2).
+ */
+double Octile(std::int64_t x1, std::int64_t y1, std::int64_t x2, std::int64_t y2) noexcept {
+  auto dx = static_cast<double>(std::abs(x1 - x2));
+  auto dy = static_cast<double>(std::abs(y1 - y2));
+  return dx + dy + (std::sqrt(2.0) - 2.0) * std::min(dx, dy);
+}
+
+/**
+ * This function returns the sign of the given value.
+ */
+std::int64_t Sign(std::int64_t value) noexcept {
+  return (value > 0) - (value < 0);
+}
+
+}  // namespace
+
+std::shared_ptr<const Map> Map::Parse(const std::vector<std::string>& rows) noexcept {
+  if (rows.empty() || rows.front().empty()) {
+    return nullptr;
+  }
+  auto width = rows.front().size();
+  auto height = rows.size();
+  // The cells are indexed with 32-bit integers.
+  if (width > std::numeric_limits<std::uint32_t>::max() / height) {
+    return nullptr;
+  }
+
+  std::vector<bool> walkable;
+  walkable.reserve(width * height);
+  for (const auto& row : rows) {
+    if (row.size() != width) {
+      return nullptr;
+    }
+    for (auto cell : row) {
+      walkable.push_back(cell != kBlockedCell);
+    }
+  }
+
+  auto* map = new (std::nothrow) Map{width, height, std::move(walkable)};
+  return std::shared_ptr<const Map>{map};
+}
+
+std::shared_ptr<const Map> Map::Load(const std::string& path) noexcept {
+  std::ifstream file{path};
+  if (!file) {
+    return nullptr;
+  }
+
+  std::vector<std::string> rows;
+  for (std::string row; std::getline(file, row);) {
+    if (!row.empty() && row.back() == '\r') {
+      row.pop_back();
+    }
+    rows.push_back(std::move(row));
+  }
+  if (file.bad()) {
+    return nullptr;
+  }
+  while (!rows.empty() && rows.back().empty()) {
+    rows.pop_back();
+  }
+  return Parse(rows);
+}
+
+Map::Map(std::size_t width, std::size_t height, std::vector<bool> walkable) noexcept
+    : width_{width}, height_{height}, walkable_{std::move(walkable)},
+      areas_(width * height, 0) {
+  // A diagonal step needs both cells beside it, so the cells connected by the
+  // paths are exactly the cells connected by the straight steps.
+  std::vector<std::uint32_t> pending;
+  std::uint32_t area = 0;
+  for (std::size_t first = 0; first < areas_.size(); first++) {
+    if (!walkable_[first] || areas_[first] != 0) {
+      continue;
+    }
+    areas_[first] = ++area;
+    pending.push_back(static_cast<std::uint32_t>(first));
+    while (!pending.empty()) {
+      auto cell = pending.back();
+      pending.pop_back();
+      auto x = static_cast<std::int64_t>(cell % width_);
+      auto y = static_cast<std::int64_t>(cell / width_);
+      for (auto [nx, ny] : {std::pair{x + 1, y}, std::pair{x - 1, y},
+          std::pair{x, y + 1}, std::pair{x, y - 1}}) {
+        if (IsWalkable(nx, ny) && areas_[GetIndex(nx, ny)] == 0) {
+          areas_[GetIndex(nx, ny)] = area;
+          pending.push_back(static_cast<std::uint32_t>(GetIndex(nx, ny)));
+        }
+      }
+    }
+  }
+}
+
+std::size_t Map::GetWidth() const noexcept {
+  return width_;
+}
+
+std::size_t Map::GetHeight() const noexcept {
+  return height_;
+}
+
+bool Map::IsWalkable(Point cell) const noexcept {
+  return IsWalkable(cell.x_, cell.y_);
+}
+
+bool Map::IsReachable(Point from, Point to) const noexcept {
+  return IsWalkable(from) && IsWalkable(to) &&
+    areas_[GetIndex(from.x_, from.y_)] == areas_[GetIndex(to.x_, to.y_)];
+}
+
+auto Map::FindPath(Point from, Point to, std::size_t max_expansions,
+    std::vector<Point>& path) const noexcept -> PathStatus {
+  path.clear();
+  if (!IsReachable(from, to)) {
+    return PathStatus::kUnreachable;
+  }
+  if (from == to) {
+    path.push_back(from);
+    return PathStatus::kFound;
+  }
+
+  thread_local Scratch scratch;
+  scratch.Prepare(areas_.size());
+  auto& open = scratch.open_;
+  const auto compare = std::greater<std::pair<double, std::uint32_t>>{};
+  const auto reach = [&](std::uint32_t cell, std::uint32_t parent, double cost) {
+    scratch.stamps_[cell] = scratch.stamp_;
+    scratch.costs_[cell] = cost;
+    scratch.parents_[cell] = parent;
+    auto x = static_cast<std::int64_t>(cell % width_);
+    auto y = static_cast<std::int64_t>(cell / width_);
+    open.emplace_back(cost + Octile(x, y, to.x_, to.y_), cell);
+    std::push_heap(open.begin(), open.end(), compare);
+  };
+
+  auto start = static_cast<std::uint32_t>(GetIndex(from.x_, from.y_));
+  auto goal = static_cast<std::uint32_t>(GetIndex(to.x_, to.y_));
+  reach(start, start, 0.0);
+
+  std::size_t expansions = 0;
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), compare);
+    auto cell = open.back().second;
+    open.pop_back();
+    if (scratch.closed_[cell] == scratch.stamp_) {
+      continue;
+    }
+    scratch.closed_[cell] = scratch.stamp_;
+
+    if (cell == goal) {
+      for (auto i = goal; i != start; i = scratch.parents_[i]) {
+        path.push_back({static_cast<std::int64_t>(i % width_),
+          static_cast<std::int64_t>(i / width_)});
+      }
+      path.push_back(from);
+      std::reverse(path.begin(), path.end());
+      return PathStatus::kFound;
+    }
+    if (expansions++ == max_expansions) {
+      return PathStatus::kOverBudget;
+    }
+
+    auto x = static_cast<std::int64_t>(cell % width_);
+    auto y = static_cast<std::int64_t>(cell / width_);
+    auto parent = scratch.parents_[cell];
+    auto dx = Sign(x - static_cast<std::int64_t>(parent % width_));
+    auto dy = Sign(y - static_cast<std::int64_t>(parent / width_));
+
+    // Only the directions, in which a path through this cell may be shorter
+    // than a path avoiding it, are followed.
+    std::pair<std::int64_t, std::int64_t> directions[8];
+    std::size_t count = 0;
+    if (cell == start) {
+      for (std::int64_t ddx = -1; ddx <= 1; ddx++) {
+        for (std::int64_t ddy = -1; ddy <= 1; ddy++) {
+          if (ddx != 0 || ddy != 0) {
+            directions[count++] = {ddx, ddy};
+          }
+        }
+      }
+    } else if (dx != 0 && dy != 0) {
+      directions[count++] = {dx, dy};
+      directions[count++] = {dx, 0};
+      directions[count++] = {0, dy};
+    } else if (dx != 0) {
+      directions[count++] = {dx, 0};
+      directions[count++] = {dx, 1};
+      directions[count++] = {dx, -1};
+      directions[count++] = {0, 1};
+      directions[count++] = {0, -1};
+    } else {
+      directions[count++] = {0, dy};
+      directions[count++] = {1, dy};
+      directions[count++] = {-1, dy};
+      directions[count++] = {1, 0};
+      directions[count++] = {-1, 0};
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+      auto jx = x, jy = y;
+      if (!Jump(jx, jy, directions[i].first, directions[i].second, to)) {
+        continue;
+      }
+      auto next = static_cast<std::uint32_t>(GetIndex(jx, jy));
+      if (scratch.closed_[next] == scratch.stamp_) {
+        continue;
+      }
+      auto cost = scratch.costs_[cell] + Octile(x, y, jx, jy);
+      if (scratch.stamps_[next] != scratch.stamp_ || cost < scratch.costs_[next]) {
+        reach(next, cell, cost);
+      }
+    }
+  }
+  return PathStatus::kUnreachable;
+}
+
+bool Map::IsWalkable(std::int64_t x, std::int64_t y) const noexcept {
+  return x >= 0 && y >= 0 && static_cast<std::size_t>(x) < width_ &&
+    static_cast<std::size_t>(y) < height_ && walkable_[GetIndex(x, y)];
+}
+
+std::size_t Map::GetIndex(std::int64_t x, std::int64_t y) const noexcept {
+  return static_cast<std::size_t>(y) * width_ + static_cast<std::size_t>(x);
+}
+
+bool Map::Jump(std::int64_t& x, std::int64_t& y, std::int64_t dx, std::int64_t dy,
+    Point to) const noexcept {
+  if (dx == 0 || dy == 0) {
+    return JumpStraight(x, y, dx, dy, to);
+  }
+
+  while (true) {
+    if (!IsWalkable(x + dx, y) || !IsWalkable(x, y + dy)) {
+      return false;  // A diagonal step cannot cut a corner.
+    }
+    x += dx;
+    y += dy;
+    if (!IsWalkable(x, y)) {
+      return false;
+    }
+    if (x == to.x_ && y == to.y_) {
+      return true;
+    }
+    // A cell is a jump point, if any straight run leaving it has one.
+    auto sx = x, sy = y;
+    if (JumpStraight(sx, sy, dx, 0, to)) {
+      return true;
+    }
+    sx = x;
+    sy = y;
+    if (JumpStraight(sx, sy, 0, dy, to)) {
+      return true;
+    }
+  }
+}
+
+bool Map::JumpStraight(std::int64_t& x, std::int64_t& y, std::int64_t dx,
+    std::int64_t dy, Point to) const noexcept {
+  while (true) {
+    x += dx;
+    y += dy;
+    if (!IsWalkable(x, y)) {
+      return false;
+    }
+    if (x == to.x_ && y == to.y_) {
+      return true;
+    }
+    // A cell is a jump point, if a cell beside it has just become reachable.
+    if (dx != 0) {
+      if ((IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) ||
+          (IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1))) {
+        return true;
+      }
+    } else if ((IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) ||
+        (IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy))) {
+      return true;
+    }
+  }
+}
+
+}  // namespace fusion_server::ui
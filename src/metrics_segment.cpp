@@ -0,0 +1,115 @@
+/**
+ * @file metrics_segment.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the MetricsSegment class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <new>
+#include <utility>
+
+#include <fusion_server/metrics_segment.hpp>
+
+namespace fusion_server {
+
+std::unique_ptr<MetricsSegment> MetricsSegment::Create(const std::string& path) noexcept {
+  auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return nullptr;
+  }
+  if (::ftruncate(fd, sizeof(Layout)) == -1) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto* memory = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  // The file is filled with zeros, so all words are already valid.
+  auto* layout = static_cast<Layout*>(memory);
+  layout->version_ = kVersion;
+  layout->sequence_.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  layout->magic_ = kMagic;
+  return std::unique_ptr<MetricsSegment>{new (std::nothrow) MetricsSegment{layout, path}};
+}
+
+std::unique_ptr<MetricsSegment> MetricsSegment::Open(const std::string& path) noexcept {
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return nullptr;
+  }
+  struct stat file_stat{};
+  if (::fstat(fd, &file_stat) == -1 ||
+      static_cast<std::size_t>(file_stat.st_size) < sizeof(Layout)) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto* memory = ::mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  auto* layout = static_cast<Layout*>(memory);
+  if (layout->magic_ != kMagic || layout->version_ != kVersion) {
+    ::munmap(memory, sizeof(Layout));
+    return nullptr;
+  }
+  return std::unique_ptr<MetricsSegment>{new (std::nothrow) MetricsSegment{layout, {}}};
+}
+
+MetricsSegment::~MetricsSegment() noexcept {
+  ::munmap(layout_, sizeof(Layout));
+  if (!path_.empty()) {
+    ::unlink(path_.c_str());
+  }
+}
+
+void MetricsSegment::Publish(const Snapshot& snapshot) noexcept {
+  std::array<std::uint64_t, kNumberOfWords> words;
+  std::memcpy(words.data(), &snapshot, sizeof(snapshot));
+
+  auto sequence = layout_->sequence_.load(std::memory_order_relaxed);
+  layout_->sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i = 0; i < kNumberOfWords; i++) {
+    layout_->words_[i].store(words[i], std::memory_order_relaxed);
+  }
+  layout_->sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+bool MetricsSegment::Read(Snapshot& snapshot) const noexcept {
+  std::array<std::uint64_t, kNumberOfWords> words;
+  for (std::size_t attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+    auto before = layout_->sequence_.load(std::memory_order_acquire);
+    if (before % 2 != 0) {
+      continue;
+    }
+    for (std::size_t i = 0; i < kNumberOfWords; i++) {
+      words[i] = layout_->words_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (layout_->sequence_.load(std::memory_order_relaxed) == before) {
+      std::memcpy(&snapshot, words.data(), sizeof(snapshot));
+      return true;
+    }
+  }
+  return false;
+}
+
+MetricsSegment::MetricsSegment(Layout* layout, std::string path) noexcept
+  : layout_{layout}, path_{std::move(path)} {}
+
+}  // namespace fusion_server
@@ -0,0 +1,62 @@
+/**
+ * @file overload_controller.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the OverloadController class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <fusion_server/overload_controller.hpp>
+
+namespace fusion_server {
+
+bool OverloadController::Update(double pressure) noexcept {
+  auto level = level_.load();
+
+  if (pressure > kHighPressure) {
+    recovered_intervals_ = 0;
+    if (++overloaded_intervals_ < kEscalationIntervals ||
+        level == Level::kMinimalIdleTicks) {
+      return false;
+    }
+    overloaded_intervals_ = 0;
+    level_ = static_cast<Level>(static_cast<std::uint8_t>(level) + 1);
+    return true;
+  }
+
+  overloaded_intervals_ = 0;
+  if (pressure >= kLowPressure) {
+    // Between both thresholds the level is kept, so it doesn't flap.
+    recovered_intervals_ = 0;
+    return false;
+  }
+
+  if (++recovered_intervals_ < kRecoveryIntervals || level == Level::kNormal) {
+    return false;
+  }
+  recovered_intervals_ = 0;
+  level_ = static_cast<Level>(static_cast<std::uint8_t>(level) - 1);
+  return true;
+}
+
+auto OverloadController::GetLevel() const noexcept -> Level {
+  return level_;
+}
+
+std::size_t OverloadController::GetUpdateDivisor() const noexcept {
+  return level_ == Level::kNormal ? 1 : kReducedUpdateDivisor;
+}
+
+std::size_t OverloadController::GetIdleTickDivisor() const noexcept {
+  switch (level_.load()) {
+    case Level::kReducedIdleTicks:
+      return 2;
+    case Level::kMinimalIdleTicks:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+}  // namespace fusion_server
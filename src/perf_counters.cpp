@@ -0,0 +1,200 @@
+/**
+ * @file perf_counters.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the PerfCounters class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <fusion_server/perf_counters.hpp>
+
+namespace fusion_server {
+
+namespace {
+
+#if defined(__linux__)
+
+/**
+ * This class holds the group of counters opened by a thread. The counters
+ * count the events of the owning thread only, in the user space.
+ */
+class CounterGroup {
+ public:
+  /**
+   * @brief Opens the counters.
+   * If any of the counters cannot be opened, the group is not valid.
+   */
+  CounterGroup() noexcept {
+    static constexpr std::array<std::uint64_t, PerfCounters::kNumberOfEvents> kConfigs{
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (std::size_t i = 0; i < kConfigs.size(); i++) {
+      perf_event_attr attr{};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = kConfigs[i];
+      attr.disabled = i == 0 ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      auto fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1,
+        i == 0 ? -1 : fds_[0], 0));
+      if (fd == -1) {
+        return;
+      }
+      fds_[i] = fd;
+    }
+    ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    is_valid_ = true;
+  }
+
+  /**
+   * @brief Closes the counters.
+   */
+  ~CounterGroup() noexcept {
+    for (auto fd : fds_) {
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+  }
+
+  /**
+   * @brief Reads all counters of the group at once.
+   *
+   * @param[out] values
+   *   The read counters.
+   *
+   * @return
+   *   An indication whether or not the counters have been read is returned.
+   */
+  bool Read(std::array<std::uint64_t, PerfCounters::kNumberOfEvents>& values) const noexcept {
+    if (!is_valid_) {
+      return false;
+    }
+    // The group is read as {nr, values[nr]}.
+    std::array<std::uint64_t, PerfCounters::kNumberOfEvents + 1> buffer;
+    if (::read(fds_[0], buffer.data(), sizeof(buffer)) != sizeof(buffer)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < values.size(); i++) {
+      values[i] = buffer[i + 1];
+    }
+    return true;
+  }
+
+ private:
+  /**
+   * These are the descriptors of the counters. The first one is the leader.
+   */
+  std::array<int, PerfCounters::kNumberOfEvents> fds_{-1, -1, -1, -1};
+
+  /**
+   * This is an indication whether or not all counters have been opened.
+   */
+  bool is_valid_ = false;
+};
+
+#endif  // __linux__
+
+}  // namespace
+
+PerfCounters::Scope::Scope(Subsystem subsystem) noexcept
+  : subsystem_{subsystem}, is_sampling_{false} {
+  if (PerfCounters::Get().IsEnabled()) {
+    is_sampling_ = PerfCounters::Read(start_);
+  }
+}
+
+PerfCounters::Scope::~Scope() noexcept {
+  std::array<std::uint64_t, kNumberOfEvents> end;
+  if (is_sampling_ && PerfCounters::Read(end)) {
+    PerfCounters::Get().Add(subsystem_, start_, end);
+  }
+}
+
+PerfCounters& PerfCounters::Get() noexcept {
+  static auto* instance = new PerfCounters;
+  return *instance;
+}
+
+bool PerfCounters::Enable() noexcept {
+  std::array<std::uint64_t, kNumberOfEvents> values;
+  if (!Read(values)) {
+    return false;
+  }
+  is_enabled_ = true;
+  return true;
+}
+
+void PerfCounters::Disable() noexcept {
+  is_enabled_ = false;
+}
+
+bool PerfCounters::IsEnabled() const noexcept {
+  return is_enabled_.load(std::memory_order_relaxed);
+}
+
+auto PerfCounters::GetTotals(Subsystem subsystem) const noexcept -> Totals {
+  auto index = static_cast<std::size_t>(subsystem);
+  Totals totals{};
+  totals.samples_ = samples_[index];
+  for (std::size_t i = 0; i < kNumberOfEvents; i++) {
+    totals.events_[i] = events_[index][i];
+  }
+  return totals;
+}
+
+const char* PerfCounters::GetName(Subsystem subsystem) noexcept {
+  switch (subsystem) {
+    case Subsystem::kTick: return "tick";
+    case Subsystem::kSerialization: return "serialization";
+    case Subsystem::kVerify: return "verify";
+    case Subsystem::kFanOut: return "fan_out";
+  }
+  return "unknown";
+}
+
+const char* PerfCounters::GetName(Event event) noexcept {
+  switch (event) {
+    case Event::kCycles: return "cycles";
+    case Event::kInstructions: return "instructions";
+    case Event::kCacheMisses: return "cache_misses";
+    case Event::kBranchMisses: return "branch_misses";
+  }
+  return "unknown";
+}
+
+bool PerfCounters::Read(std::array<std::uint64_t, kNumberOfEvents>& values) noexcept {
+#if defined(__linux__)
+  thread_local CounterGroup group;
+  return group.Read(values);
+#else
+  static_cast<void>(values);
+  return false;
+#endif
+}
+
+void PerfCounters::Add(Subsystem subsystem,
+    const std::array<std::uint64_t, kNumberOfEvents>& start,
+    const std::array<std::uint64_t, kNumberOfEvents>& end) noexcept {
+  auto index = static_cast<std::size_t>(subsystem);
+  samples_[index].fetch_add(1, std::memory_order_relaxed);
+  for (std::size_t i = 0; i < kNumberOfEvents; i++) {
+    events_[index][i].fetch_add(end[i] - start[i], std::memory_order_relaxed);
+  }
+}
+
+}  // namespace fusion_server
@@ -0,0 +1,76 @@
+/**
+ * @file placement_policy.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the PlacementPolicy class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+
+#include <fusion_server/placement_policy.hpp>
+
+namespace fusion_server {
+
+bool PlacementPolicy::Configure(const json::JSON& config) noexcept {
+  if (!config.is_object()) {
+    return false;
+  }
+
+  auto weights = weights_;
+  const auto read = [&config](const char* key, double& weight) {
+    if (!config.contains(key)) {
+      return true;
+    }
+    if (!config[key].is_number() || config[key] < 0) {
+      return false;
+    }
+    weight = config[key];
+    return true;
+  };
+
+  if (!read("players", weights.players_) ||
+      !read("tick_time", weights.tick_time_) ||
+      !read("queued_packages", weights.queued_packages_)) {
+    return false;
+  }
+
+  weights_ = weights;
+  return true;
+}
+
+auto PlacementPolicy::GetWeights() const noexcept -> const Weights& {
+  return weights_;
+}
+
+double PlacementPolicy::GetLoadScore(const Shard& shard) const noexcept {
+  const auto& metrics = shard.GetMetrics();
+  constexpr auto tick_interval_us = static_cast<double>(
+    std::chrono::microseconds{Shard::kTickInterval}.count());
+
+  return weights_.players_ * static_cast<double>(metrics.players_.load()) +
+    weights_.tick_time_ * static_cast<double>(metrics.tick_time_us_.load()) /
+      tick_interval_us +
+    weights_.queued_packages_ *
+      static_cast<double>(metrics.queued_packages_.load());
+}
+
+Shard& PlacementPolicy::SelectShard(
+    const std::vector<std::unique_ptr<Shard>>& shards,
+    Shard& preferred) const noexcept {
+  Shard* selected = &preferred;
+  double lowest_score = GetLoadScore(preferred);
+
+  for (const auto& shard : shards) {
+    auto score = GetLoadScore(*shard);
+    if (score < lowest_score) {
+      selected = shard.get();
+      lowest_score = score;
+    }
+  }
+
+  return *selected;
+}
+
+}  // namespace fusion_server
@@ -7,6 +7,8 @@
  * Copyright 2019 Kamil Rusin
  */
 
+#include <algorithm>
+
 #include <fusion_server/ui/player_factory.hpp>
 #include <fusion_server/ui/player.hpp>
 
@@ -67,4 +69,8 @@ PlayerFactory::Create(std::string nick, std::size_t team_id) noexcept {
   return p;
 }
 
+void PlayerFactory::SkipId(std::size_t id) noexcept {
+  configuration_.next_id_ = std::max(configuration_.next_id_, id + 1);
+}
+
 }  // namespace fusion_server::ui
\ No newline at end of file
@@ -0,0 +1,410 @@
+/**
+ * @file profiler.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the Profiler class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <cerrno>
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fusion_server/profiler.hpp>
+
+namespace fusion_server {
+
+namespace {
+
+/**
+ * This class encodes a protocol buffer message. Only the wire types used by
+ * the pprof format are supported.
+ */
+class ProtoWriter {
+ public:
+  /**
+   * @brief Appends a varint field.
+   *
+   * @param[in] field
+   *   The number of the field.
+   *
+   * @param[in] value
+   *   The value of the field.
+   */
+  void AddVarint(std::uint32_t field, std::uint64_t value) {
+    AddRawVarint(static_cast<std::uint64_t>(field) << 3);
+    AddRawVarint(value);
+  }
+
+  /**
+   * @brief Appends a length-delimited field.
+   *
+   * @param[in] field
+   *   The number of the field.
+   *
+   * @param[in] bytes
+   *   The content of the field, e.g. an encoded message or a string.
+   */
+  void AddBytes(std::uint32_t field, const std::string& bytes) {
+    AddRawVarint(static_cast<std::uint64_t>(field) << 3 | 2);
+    AddRawVarint(bytes.size());
+    buffer_ += bytes;
+  }
+
+  /**
+   * @brief Appends a packed repeated varint field.
+   *
+   * @param[in] field
+   *   The number of the field.
+   *
+   * @param[in] values
+   *   The values of the field.
+   */
+  void AddPacked(std::uint32_t field, const std::vector<std::uint64_t>& values) {
+    ProtoWriter packed;
+    for (auto value : values) {
+      packed.AddRawVarint(value);
+    }
+    AddBytes(field, packed.buffer_);
+  }
+
+  /**
+   * @brief Returns the encoded message.
+   *
+   * @return
+   *   The encoded message is returned.
+   */
+  const std::string& Get() const noexcept {
+    return buffer_;
+  }
+
+ private:
+  /**
+   * This method appends a varint without a key.
+   *
+   * @param[in] value
+   *   The appended value.
+   */
+  void AddRawVarint(std::uint64_t value) {
+    while (value >= 0x80) {
+      buffer_.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    buffer_.push_back(static_cast<char>(value));
+  }
+
+  /**
+   * This is the encoded message.
+   */
+  std::string buffer_;
+};
+
+/**
+ * This class holds the string table of a profile.
+ */
+class StringTable {
+ public:
+  /**
+   * @brief Creates the table. The first string of a pprof table is empty.
+   */
+  StringTable() {
+    Index("");
+  }
+
+  /**
+   * @brief Returns the index of a string. The string is added if needed.
+   *
+   * @param[in] value
+   *   The string.
+   *
+   * @return
+   *   The index of the string is returned.
+   */
+  std::uint64_t Index(const std::string& value) {
+    auto [it, is_new] = indices_.emplace(value, strings_.size());
+    if (is_new) {
+      strings_.push_back(value);
+    }
+    return it->second;
+  }
+
+  /**
+   * @brief Returns all strings.
+   *
+   * @return
+   *   All strings in the order of their indices are returned.
+   */
+  const std::vector<std::string>& Get() const noexcept {
+    return strings_;
+  }
+
+ private:
+  /**
+   * This map associates the strings with their indices.
+   */
+  std::unordered_map<std::string, std::uint64_t> indices_;
+
+  /**
+   * This vector holds the strings in the order of their indices.
+   */
+  std::vector<std::string> strings_;
+};
+
+/**
+ * This structure describes an executable mapping of the process.
+ */
+struct Mapping {
+  std::uint64_t start_;
+  std::uint64_t limit_;
+  std::uint64_t offset_;
+  std::string path_;
+};
+
+/**
+ * This function reads the executable mappings of the process.
+ *
+ * @return
+ *   The executable mappings are returned.
+ */
+std::vector<Mapping> ReadMappings() {
+  std::vector<Mapping> mappings;
+  std::ifstream maps{"/proc/self/maps"};
+  std::string line;
+  while (std::getline(maps, line)) {
+    // Format: start-limit perms offset dev inode path
+    char permissions[5] = {};
+    unsigned long long start = 0, limit = 0, offset = 0;
+    int path_position = 0;
+    if (std::sscanf(line.c_str(), "%llx-%llx %4s %llx %*s %*s %n", &start, &limit,
+        permissions, &offset, &path_position) < 4 || permissions[2] != 'x') {
+      continue;
+    }
+    mappings.push_back({start, limit, offset,
+      path_position > 0 ? line.substr(static_cast<std::size_t>(path_position)) : ""});
+  }
+  return mappings;
+}
+
+/**
+ * This function returns the name of the function containing an address.
+ *
+ * @param[in] address
+ *   The address.
+ *
+ * @return
+ *   The demangled name of the function is returned. If the address cannot be
+ *   symbolized, an empty string is returned.
+ */
+std::string GetFunctionName(std::uint64_t address) {
+  Dl_info info{};
+  if (::dladdr(reinterpret_cast<void*>(address), &info) == 0 || info.dli_sname == nullptr) {
+    return {};
+  }
+  int status = 0;
+  auto* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+  std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+  std::free(demangled);
+  return name;
+}
+
+}  // namespace
+
+Profiler& Profiler::Get() noexcept {
+  static auto* instance = new Profiler;
+  return *instance;
+}
+
+bool Profiler::Start() noexcept {
+  if (is_running_.exchange(true)) {
+    return false;
+  }
+
+  // backtrace() loads its unwinder on the first call, which allocates. It's
+  // done here, so the signal handler doesn't.
+  void* frames[1];
+  ::backtrace(frames, 1);
+
+  samples_ = std::make_unique<Sample[]>(kMaxSamples);
+  next_sample_ = 0;
+  started_at_ = std::chrono::system_clock::now();
+  is_recording_ = true;
+
+  struct sigaction action{};
+  action.sa_handler = &Profiler::HandleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  ::sigaction(SIGPROF, &action, nullptr);
+
+  itimerval timer{};
+  timer.it_interval.tv_usec = static_cast<decltype(timer.it_interval.tv_usec)>(
+    kSamplingPeriod.count());
+  timer.it_value = timer.it_interval;
+  if (::setitimer(ITIMER_PROF, &timer, nullptr) == -1) {
+    Stop();
+    return false;
+  }
+  return true;
+}
+
+std::string Profiler::Stop() noexcept {
+  if (!is_running_) {
+    return {};
+  }
+
+  itimerval timer{};
+  ::setitimer(ITIMER_PROF, &timer, nullptr);
+  is_recording_ = false;
+  // A signal may still be handled by another thread.
+  while (active_handlers_ != 0) {
+    std::this_thread::yield();
+  }
+  // Pending signals are ignored from now on.
+  struct sigaction action{};
+  action.sa_handler = SIG_IGN;
+  sigemptyset(&action.sa_mask);
+  ::sigaction(SIGPROF, &action, nullptr);
+
+  auto profile = Serialize(std::chrono::system_clock::now() - started_at_);
+  samples_.reset();
+  is_running_ = false;
+  return profile;
+}
+
+bool Profiler::IsRunning() const noexcept {
+  return is_running_;
+}
+
+void Profiler::HandleSignal([[maybe_unused]] int signal) noexcept {
+  auto& profiler = Get();
+  auto saved_errno = errno;
+  profiler.active_handlers_.fetch_add(1, std::memory_order_acquire);
+  if (profiler.is_recording_.load(std::memory_order_acquire)) {
+    auto index = profiler.next_sample_.fetch_add(1, std::memory_order_relaxed);
+    if (index < kMaxSamples) {
+      auto& sample = profiler.samples_[index];
+      auto depth = ::backtrace(sample.frames_, static_cast<int>(kMaxDepth));
+      sample.depth_.store(depth > 0 ? static_cast<std::size_t>(depth) : 0,
+        std::memory_order_release);
+    }
+  }
+  profiler.active_handlers_.fetch_sub(1, std::memory_order_release);
+  errno = saved_errno;
+}
+
+std::string Profiler::Serialize(std::chrono::nanoseconds duration) const noexcept {
+  try {
+    StringTable strings;
+    ProtoWriter profile;
+
+    // sample_type: [samples/count, cpu/nanoseconds]
+    const auto make_value_type = [&strings](const char* type, const char* unit) {
+      ProtoWriter value_type;
+      value_type.AddVarint(1, strings.Index(type));
+      value_type.AddVarint(2, strings.Index(unit));
+      return value_type.Get();
+    };
+    profile.AddBytes(1, make_value_type("samples", "count"));
+    profile.AddBytes(1, make_value_type("cpu", "nanoseconds"));
+
+    // Identical stacks are merged into a single sample. The first frame is the
+    // signal handler itself and the second one is the signal trampoline.
+    std::map<std::vector<std::uint64_t>, std::uint64_t> stacks;
+    std::unordered_map<std::uint64_t, std::uint64_t> location_ids;
+    auto number_of_samples = std::min(next_sample_.load(), kMaxSamples);
+    for (std::size_t i = 0; i < number_of_samples; i++) {
+      auto depth = samples_[i].depth_.load(std::memory_order_acquire);
+      if (depth <= 2) {
+        continue;
+      }
+      std::vector<std::uint64_t> stack;
+      for (std::size_t j = 2; j < depth; j++) {
+        auto address = reinterpret_cast<std::uint64_t>(samples_[i].frames_[j]);
+        // Return addresses point past the call instruction.
+        auto location = location_ids.emplace(j == 2 ? address : address - 1,
+          location_ids.size() + 1).first;
+        stack.push_back(location->second);
+      }
+      stacks[std::move(stack)]++;
+    }
+
+    auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(kSamplingPeriod).count();
+    for (const auto& [stack, count] : stacks) {
+      ProtoWriter sample;
+      sample.AddPacked(1, stack);
+      sample.AddPacked(2, {count, count * static_cast<std::uint64_t>(period)});
+      profile.AddBytes(2, sample.Get());
+    }
+
+    auto mappings = ReadMappings();
+    for (std::size_t i = 0; i < mappings.size(); i++) {
+      ProtoWriter mapping;
+      mapping.AddVarint(1, i + 1);
+      mapping.AddVarint(2, mappings[i].start_);
+      mapping.AddVarint(3, mappings[i].limit_);
+      mapping.AddVarint(4, mappings[i].offset_);
+      mapping.AddVarint(5, strings.Index(mappings[i].path_));
+      profile.AddBytes(3, mapping.Get());
+    }
+
+    std::unordered_map<std::string, std::uint64_t> function_ids;
+    std::vector<std::string> functions;
+    for (const auto& [address, id] : location_ids) {
+      ProtoWriter location;
+      location.AddVarint(1, id);
+      for (std::size_t i = 0; i < mappings.size(); i++) {
+        if (mappings[i].start_ <= address && address < mappings[i].limit_) {
+          location.AddVarint(2, i + 1);
+          break;
+        }
+      }
+      location.AddVarint(3, address);
+      if (auto name = GetFunctionName(address); !name.empty()) {
+        auto [it, is_new] = function_ids.emplace(name, function_ids.size() + 1);
+        if (is_new) {
+          ProtoWriter function;
+          function.AddVarint(1, it->second);
+          function.AddVarint(2, strings.Index(name));
+          function.AddVarint(3, strings.Index(name));
+          functions.push_back(function.Get());
+        }
+        ProtoWriter line;
+        line.AddVarint(1, it->second);
+        location.AddBytes(4, line.Get());
+      }
+      profile.AddBytes(4, location.Get());
+    }
+    for (const auto& function : functions) {
+      profile.AddBytes(5, function);
+    }
+
+    // The string table is complete only after all other messages.
+    for (const auto& value : strings.Get()) {
+      profile.AddBytes(6, value);
+    }
+    profile.AddVarint(9, static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        started_at_.time_since_epoch()).count()));
+    profile.AddVarint(10, static_cast<std::uint64_t>(duration.count()));
+    profile.AddBytes(11, make_value_type("cpu", "nanoseconds"));
+    profile.AddVarint(12, static_cast<std::uint64_t>(period));
+    return profile.Get();
+  } catch (const std::exception&) {
+    return {};
+  }
+}
+
+}  // namespace fusion_server
@@ -7,27 +7,39 @@
  * Copyright 2019 Kamil Rusin
  */
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <mutex>
 #include <string_view>
 #include <tuple>
 #include <utility>
 
+#include <fusion_server/bot_pool.hpp>
 #include <fusion_server/json.hpp>
+#include <fusion_server/perf_counters.hpp>
 #include <fusion_server/server.hpp>
 #include <fusion_server/websocket_session.hpp>
 
 namespace fusion_server {
 
-std::unique_ptr<Server> Server::instance_ = nullptr;  // NOLINT(fuchsia-statically-constructed-objects)
+namespace {
 
-Server& Server::GetInstance() noexcept {
-  if (instance_ == nullptr) {
-    instance_ = std::unique_ptr<Server>{new Server};
-    instance_->GetLogger()->info("Creating a new server instance.");
-  }
-  return *instance_;
+/**
+ * This function returns the logger of the games. The "game" logger is created
+ * by Server::Configure(), so the games of a server, which has not been
+ * configured, use the default logger.
+ *
+ * @return
+ *   The logger of the games is returned.
+ */
+LoggerManager::Logger GetGameLogger() noexcept {
+  auto logger = LoggerManager::Get("game");
+  return logger != nullptr ? logger : LoggerManager::Get();
 }
 
+}  // namespace
+
 bool Server::Configure(json::JSON config) noexcept {
   config_ = std::move(config);
 
@@ -51,17 +63,149 @@ bool Server::Configure(json::JSON config) noexcept {
       logger_->critical("[Config] Field \"listener\" is not an object.");
       return false;
     }
-    listener_ = std::make_shared<Listener>(ioc_);
+    listener_ = std::make_shared<Listener>(*shards_.front());
     listener_->SetLogger(logger_manager_.CreateLogger<false>("listener"));
     if (!listener_->Configure(config_["listener"])) return false;
   }
 
+  if (config_.contains("number_of_shards")) {
+    if (!config_["number_of_shards"].is_number_unsigned() ||
+        config_["number_of_shards"] < 1) {
+      logger_->critical("[Config] A value of \"number_of_shards\" must be a positive integer.");
+      return false;
+    }
+    std::size_t number_of_shards = config_["number_of_shards"];
+    while (shards_.size() < number_of_shards) {
+      shards_.push_back(std::make_unique<Shard>(shards_.size(), *this));
+    }
+  }
+
+  if (config_.contains("migration")) {
+    import_listener_ = std::make_shared<GameImportListener>(*shards_.front());
+    import_listener_->SetLogger(logger_manager_.CreateLogger<false>("migration"));
+    if (!import_listener_->Configure(config_["migration"])) return false;
+  }
+
+  if (config_.contains("placement")) {
+    if (!placement_policy_.Configure(config_["placement"])) {
+      logger_->critical("[Config] Field \"placement\" must be an object of non-negative weights.");
+      return false;
+    }
+  }
+
+  if (config_.contains("load_shedding")) {
+    const auto& load_shedding = config_["load_shedding"];
+    if (!load_shedding.is_object()) {
+      logger_->critical("[Config] Field \"load_shedding\" is not an object.");
+      return false;
+    }
+    if (load_shedding.contains("max_loop_lag_ms")) {
+      if (!load_shedding["max_loop_lag_ms"].is_number_unsigned() ||
+          load_shedding["max_loop_lag_ms"] < 1) {
+        logger_->critical("[Config::LoadShedding] A value of \"max_loop_lag_ms\" must be a positive integer.");
+        return false;
+      }
+      max_loop_lag_ = std::chrono::milliseconds{
+        load_shedding["max_loop_lag_ms"].get<std::int64_t>()};
+    }
+  }
+
+  if (config_.contains("metrics_segment")) {
+    const auto& metrics = config_["metrics_segment"];
+    if (!metrics.is_object() || !metrics.contains("path") || !metrics["path"].is_string()) {
+      logger_->critical("[Config::MetricsSegment] A config object must have \"path\" string field.");
+      return false;
+    }
+    if (metrics.contains("interval_ms")) {
+      if (!metrics["interval_ms"].is_number_unsigned() || metrics["interval_ms"] < 1) {
+        logger_->critical("[Config::MetricsSegment] A value of \"interval_ms\" must be a positive integer.");
+        return false;
+      }
+      metrics_interval_ = std::chrono::milliseconds{metrics["interval_ms"].get<std::int64_t>()};
+    }
+    std::string path = metrics["path"];
+    metrics_segment_ = MetricsSegment::Create(path);
+    if (metrics_segment_ == nullptr) {
+      logger_->critical("[Config::MetricsSegment] Cannot create the metrics segment {}.", path);
+      return false;
+    }
+    metrics_timer_ = std::make_unique<boost::asio::steady_timer>(GetIOContext());
+  }
+
+  if (config_.contains("perf_counters")) {
+    if (!config_["perf_counters"].is_boolean()) {
+      logger_->critical("[Config] A value of \"perf_counters\" must be a boolean.");
+      return false;
+    }
+    if (config_["perf_counters"] && !PerfCounters::Get().Enable()) {
+      logger_->warn("[Config] Hardware performance counters are not available. Sampling is disabled.");
+    }
+  }
+
+  if (config_.contains("compression")) {
+    const auto& compression = config_["compression"];
+    if (!compression.is_object() || !compression.contains("dictionary") ||
+        !compression["dictionary"].is_string()) {
+      logger_->critical("[Config::Compression] A config object must have \"dictionary\" string field.");
+      return false;
+    }
+    auto level = FrameDictionary::kDefaultLevel;
+    if (compression.contains("level")) {
+      if (!compression["level"].is_number_integer()) {
+        logger_->critical("[Config::Compression] A value of \"level\" must be an integer.");
+        return false;
+      }
+      level = compression["level"];
+    }
+    std::string path = compression["dictionary"];
+    frame_dictionary_ = FrameDictionary::Load(path, level);
+    if (frame_dictionary_ == nullptr) {
+      // The clients fall back to the uncompressed packages.
+      logger_->warn("[Config::Compression] Cannot load the dictionary {}. The compression is disabled.", path);
+    } else {
+      logger_->info("[Config::Compression] Loaded the dictionary {}. [Version: {}]",
+        path, frame_dictionary_->GetVersion());
+    }
+  }
+
+  if (config_.contains("map")) {
+    if (!config_["map"].is_string()) {
+      logger_->critical("[Config::Map] A value of \"map\" must be a string.");
+      return false;
+    }
+    std::string path = config_["map"];
+    map_ = ui::Map::Load(path);
+    if (map_ == nullptr) {
+      logger_->critical("[Config::Map] Cannot load the map {}.", path);
+      return false;
+    }
+    logger_->info("[Config::Map] Loaded the map {}. [Size: {}x{}]", path,
+      map_->GetWidth(), map_->GetHeight());
+  }
+
+  if (config_.contains("bots")) {
+    const auto& bots = config_["bots"];
+    if (!bots.is_object() || !bots.contains("threads") ||
+        !bots["threads"].is_number_unsigned() || bots["threads"] == 0) {
+      logger_->critical("[Config::Bots] A config object must have positive \"threads\" integer field.");
+      return false;
+    }
+    std::size_t threads = bots["threads"];
+    bot_pool_ = std::make_unique<BotPool>(*this, threads);
+    logger_->info("[Config::Bots] Started the bot pool. [Threads: {}]", threads);
+  }
+
   // TODO(nathiss): complete configuration.
 
   logger_manager_.CreateLogger<true>("websocket", LoggerManager::Level::none,
     true);
   logger_manager_.CreateLogger<true>("game", LoggerManager::Level::none,
     true);
+  auto shard_logger = logger_manager_.CreateLogger<true>("shard",
+    LoggerManager::Level::none, true);
+  for (auto& shard : shards_) {
+    shard->SetLogger(shard_logger);
+  }
 
   return true;
 }
@@ -75,27 +219,41 @@ LoggerManager::Logger Server::GetLogger() const noexcept {
 }
 
 boost::asio::io_context& Server::GetIOContext() noexcept {
-  return ioc_;
+  return shards_.front()->GetIOContext();
 }
 
-system::IncomingPackageDelegate&
-Server::Register(WebSocketSession* session) noexcept {
-  std::unique_lock scm{sessions_correlation_mtx_};
-  if (sessions_correlation_.count(session) != 0) {
-    logger_->warn("Second registration of a session {}.", session->GetRemoteEndpoint());
-    return unjoined_delegate_;
-  }
-
-  sessions_correlation_[session] = {};
-  scm.unlock();
+std::size_t Server::GetNumberOfShards() const noexcept {
+  return shards_.size();
+}
 
-  std::unique_lock usm{unidentified_sessions_mtx_};
-  unidentified_sessions_.insert(session);
-  usm.unlock();
+Shard& Server::GetShard(std::size_t id) noexcept {
+  return *shards_[id];
+}
 
+void Server::Register(WebSocketSession* session) noexcept {
+  session->GetShard().AddSession(session);
   logger_->debug("New WebSocket session registered {}.", session->GetRemoteEndpoint());
+}
 
-  return unjoined_delegate_;
+void Server::HandleUnjoined(WebSocketSession* src, const json::JSON& package) noexcept {
+  logger_->debug("Received a new package from {}.", src->GetRemoteEndpoint());
+  auto response = MakeResponse(src, package);
+  src->Write(std::make_shared<system::Package>(response.dump()));
+}
+
+void Server::Unjoin(WebSocketSession* session) noexcept {
+  // The entry keeps the game alive, until its removal has been checked.
+  auto entry = session->GetShard().RemoveSession(session);
+  session->GetShard().AddSession(session);
+  if (!entry || entry->game_ == nullptr) {
+    return;
+  }
+
+  logger_->debug("Session {} left game {}.", session->GetRemoteEndpoint(), entry->game_name_);
+  if (entry->game_->GetPlayersCount() == 0 &&
+      RemoveEmptyGame(entry->game_name_, entry->game_.get())) {
+    logger_->debug("Game {} has no players. Removed.", entry->game_name_);
+  }
 }
 
 void Server::Unregister(WebSocketSession* session) noexcept {
@@ -105,51 +263,192 @@ void Server::Unregister(WebSocketSession* session) noexcept {
     return;
   }
 
-  std::unique_lock scm{sessions_correlation_mtx_};
-  if (auto it = sessions_correlation_.find(session); it != sessions_correlation_.end()) {
-    auto game_name = it->second;
-    sessions_correlation_.erase(it);
-    scm.unlock();
-
-    // TODO(nathiss): refactor this.
-    if (!game_name) {
-      logger_->debug("Unregistering session {}.", session->GetRemoteEndpoint());
-      std::unique_lock usm{unidentified_sessions_mtx_};
-      unidentified_sessions_.erase(session);
-    } else {
-      logger_->debug("Removing session {} from game {}.", session->GetRemoteEndpoint(), game_name.value());
-      std::unique_lock gm{games_mtx_};
-      auto& game = games_[game_name.value()];
-      game->Leave(session);
-      if (game->GetPlayersCount() == 0) {
-        logger_->debug("Game {} has no players. Removing.", game_name.value());
-          games_.erase(game_name.value());
-      }
-    }
-  } else {
+  auto entry = session->GetShard().RemoveSession(session);
+  if (!entry) {
     logger_->warn("Trying to unregister session which is not registered. [{}]",
       session->GetRemoteEndpoint());
+    return;
+  }
+
+  if (entry->game_ == nullptr) {
+    logger_->debug("Unregistering session {}.", session->GetRemoteEndpoint());
+    return;
+  }
+
+  logger_->debug("Removing session {} from game {}.", session->GetRemoteEndpoint(),
+    entry->game_name_);
+  entry->game_->Leave(session);
+  if (entry->game_->GetPlayersCount() == 0 &&
+      RemoveEmptyGame(entry->game_name_, entry->game_.get())) {
+    logger_->debug("Game {} has no players. Removed.", entry->game_name_);
   }
 }
 
 bool Server::StartAccepting() noexcept {
   logger_->info("Creating a Listener object.");
   listener_->Bind();
-  return listener_->Run();
+  listener_->SetAdmissionCheck([this] { return !IsAnyShardBusy(); });
+  if (!listener_->Run()) {
+    return false;
+  }
+  for (auto& shard : shards_) {
+    shard->StartTicking();
+  }
+  if (import_listener_ != nullptr && !import_listener_->Run()) {
+    return false;
+  }
+  is_accepting_ = true;
+  if (metrics_segment_ != nullptr) {
+    SchedulePublishMetrics();
+  }
+  return true;
+}
+
+bool Server::IsBusy(const Shard& shard) const noexcept {
+  return shard.GetLag() > max_loop_lag_;
+}
+
+bool Server::IsAnyShardBusy() const noexcept {
+  // The shards are created during the configuration only, so they can be read
+  // without a lock.
+  return std::any_of(shards_.begin(), shards_.end(),
+    [this](const auto& shard) { return IsBusy(*shard); });
+}
+
+bool Server::IsReady() const noexcept {
+  return is_accepting_ && !has_stopped_ && !IsAnyShardBusy();
+}
+
+std::size_t Server::GetLoadScore() const noexcept {
+  // The shards are created during the configuration only, so they can be read
+  // without a lock.
+  double pressure = 0.0;
+  for (auto& shard : shards_) {
+    auto tick_time = static_cast<double>(shard->GetMetrics().tick_time_us_) /
+      static_cast<double>(std::chrono::microseconds{Shard::kTickInterval}.count());
+    auto lag = static_cast<double>(shard->GetLag().count()) /
+      static_cast<double>(max_loop_lag_.count());
+    pressure += std::max(tick_time, lag);
+  }
+  return static_cast<std::size_t>(100.0 * pressure / static_cast<double>(shards_.size()));
+}
+
+std::shared_ptr<const FrameDictionary> Server::GetFrameDictionary() const noexcept {
+  return frame_dictionary_;
+}
+
+BotPool* Server::GetBotPool() noexcept {
+  return bot_pool_.get();
+}
+
+bool Server::MigrateGame(const std::string& game_name, std::size_t shard_id) noexcept {
+  if (shard_id >= shards_.size()) {
+    return false;
+  }
+
+  std::unique_lock gm{games_mtx_};
+  auto it = games_.find(game_name);
+  if (it == games_.end()) {
+    return false;
+  }
+  auto& game = it->second;
+  auto& source = game->GetShard();
+  auto& target = *shards_[shard_id];
+  if (&source == &target) {
+    return false;
+  }
+
+  logger_->info("Moving game {} from shard {} to shard {}.", game_name,
+    source.GetId(), target.GetId());
+  source.RemoveGame(game.get());
+  game->MoveTo(target);
+  target.AddGame(game);
+  return true;
+}
+
+bool Server::ExportGame(const std::string& game_name,
+    const std::string& socket_path) noexcept {
+  std::shared_lock gm{games_mtx_};
+  auto it = games_.find(game_name);
+  if (it == games_.end()) {
+    return false;
+  }
+  auto game = it->second;
+  gm.unlock();
+
+  auto exporter = std::make_shared<GameExporter>(
+    game->GetShard().GetIOContext(), game_name, game);
+  exporter->SetLogger(LoggerManager::Get("migration"));
+  return exporter->Run(socket_path);
+}
+
+bool Server::ImportGame(const std::string& game_name,
+    const json::JSON& snapshot) noexcept {
+  std::unique_lock gm{games_mtx_};
+  if (games_.count(game_name) != 0) {
+    logger_->warn("Cannot import game {}. The game already exists.", game_name);
+    return false;
+  }
+
+  auto& shard = placement_policy_.SelectShard(shards_, *shards_.front());
+  auto game = std::make_shared<Game>(shard);
+  game->SetLogger(GetGameLogger());
+  game->SetMap(map_);
+  if (!game->Restore(snapshot)) {
+    logger_->warn("Cannot import game {}. The snapshot is not valid.", game_name);
+    return false;
+  }
+  games_.emplace(game_name, game);
+  shard.AddGame(game);
+  gm.unlock();
+
+  logger_->info("Imported game {} on shard {}.", game_name, shard.GetId());
+
+  auto timer = std::make_shared<boost::asio::steady_timer>(shard.GetIOContext(),
+    Game::kReservationTimeout);
+  timer->async_wait([this, timer, game_name, game = game.get()](
+      const boost::system::error_code& ec) {
+    if (!ec && RemoveEmptyGame(game_name, game)) {
+      logger_->info("No player of imported game {} has resumed. Removed.", game_name);
+    }
+  });
+  return true;
 }
 
 void Server::Shutdown() noexcept {
+  // The bots leave their games, before the sessions stop unregistering.
+  if (bot_pool_ != nullptr) {
+    bot_pool_->Stop();
+  }
   has_stopped_ = true;
+  is_accepting_ = false;
+  if (metrics_timer_ != nullptr) {
+    boost::system::error_code ec;
+    metrics_timer_->cancel(ec);
+  }
+  for (auto& shard : shards_) {
+    shard->Stop();
+  }
+}
+
+Server::~Server() noexcept {
+  // The bots are registered on the shards, so they're destroyed first.
+  bot_pool_.reset();
+  // The sessions destroyed together with the shards must not unregister.
+  has_stopped_ = true;
+  for (auto& shard : shards_) {
+    shard->ReleaseSessions();
+  }
+  shards_.clear();
 }
 
 Server::Server() noexcept {
+  shards_.push_back(std::make_unique<Shard>(0, *this));
+  max_loop_lag_ = kDefaultMaxLoopLag;
+  metrics_interval_ = kDefaultMetricsInterval;
   logger_ = LoggerManager::Get();
   has_stopped_ = false;
-  unjoined_delegate_ = [this](const json::JSON& package, WebSocketSession* src) {
-    logger_->debug("Received a new package from {}.", src->GetRemoteEndpoint());
-    auto response = MakeResponse(src, package);
-    src->Write(std::make_shared<system::Package>(response.dump()));
-  };
+  is_accepting_ = false;
 }
 
 json::JSON Server::MakeResponse(WebSocketSession* src, const json::JSON& request) noexcept {
@@ -168,39 +467,65 @@ json::JSON Server::MakeResponse(WebSocketSession* src, const json::JSON& request
     }, false, json::JSON::value_t::object);
   };
 
+  const auto make_busy = [] {
+    return json::JSON({
+      {"type", "join-result"},
+      {"result", "busy"},
+    }, false, json::JSON::value_t::object);
+  };
+
+  const auto make_expired = [] {
+    return json::JSON({
+      {"type", "join-result"},
+      {"result", "expired"},
+    }, false, json::JSON::value_t::object);
+  };
+
+  if (request["type"] == "join" && request.contains("token")) {
+    // The client has been redirected from another node.
+    std::string game_name = request["game"];
+    std::unique_lock gm{games_mtx_};
+    auto it = games_.find(game_name);
+    if (it == games_.end()) {
+      return make_expired();
+    }
+    auto join_result = it->second->Resume(src, request["token"]);
+    auto game = it->second;
+    auto& game_shard = game->GetShard();
+    gm.unlock();
+    if (!join_result) {
+      return make_expired();
+    }
+    return FinishJoin(src, std::move(game_name), std::move(game), game_shard, join_result);
+  }  // "join" with a token
+
   if (request["type"] == "join") {
     std::string game_name = request["game"];
     std::unique_lock gm{games_mtx_};
     auto it = games_.find(game_name);
     if (it == games_.end()) {
-      it = games_.emplace(game_name, std::make_shared<Game>()).first;
-      it->second->SetLogger(LoggerManager::Get("game"));
+      // A new game is placed on the least loaded shard. The games_mtx_ is held
+      // until the creator joins, so the next placement sees its player.
+      auto& shard = placement_policy_.SelectShard(shards_, src->GetShard());
+      if (IsBusy(shard)) {
+        gm.unlock();
+        logger_->warn("Rejected creating game {}. Shard {} is busy.", game_name,
+          shard.GetId());
+        return make_busy();
+      }
+      it = games_.emplace(game_name, std::make_shared<Game>(shard)).first;
+      it->second->SetLogger(GetGameLogger());
+      it->second->SetMap(map_);
+      shard.AddGame(it->second);
     }
     auto join_result = it->second->Join(src, request["nick"]);
+    auto game = it->second;
+    auto& game_shard = game->GetShard();
     gm.unlock();
     if (!join_result) {  // The game is full.
       return make_game_full();
     }
-    // If we're here it means the join was successful.
-    src->delegate_ = std::get<0>(join_result.value());
-
-      std::unique_lock usm{unidentified_sessions_mtx_};
-      unidentified_sessions_.erase(src);
-      usm.unlock();
-
-      std::unique_lock scm{sessions_correlation_mtx_};
-      sessions_correlation_[src] = std::make_optional<std::string>(std::move(game_name));
-      scm.unlock();
-
-    auto response = [&join_result] {
-      return json::JSON({
-        {"type", "join-result"},
-        {"result", "joined"},
-        {"my_id", std::get<2>(join_result.value())},
-        {"players", std::get<1>(join_result.value())["players"]},
-      }, false, json::JSON::value_t::object);
-    }();
-    return response;
+    return FinishJoin(src, std::move(game_name), std::move(game), game_shard, join_result);
   }  // "join"
 
   // If we're here it means we've received an unidentified package.
@@ -209,4 +534,77 @@ json::JSON Server::MakeResponse(WebSocketSession* src, const json::JSON& request
   return make_unidentified();
 }
 
+bool Server::RemoveEmptyGame(const std::string& game_name, const Game* game) noexcept {
+  // A player may have joined since the game was found empty. Joins are done
+  // under the games mutex, so the count is checked again.
+  std::unique_lock gm{games_mtx_};
+  auto it = games_.find(game_name);
+  if (it == games_.end() || it->second.get() != game ||
+      it->second->GetPlayersCount() != 0) {
+    return false;
+  }
+  game->GetShard().RemoveGame(game);
+  games_.erase(it);
+  return true;
+}
+
+json::JSON Server::FinishJoin(WebSocketSession* src, std::string game_name,
+    std::shared_ptr<Game> game, Shard& game_shard,
+    Game::join_result_t& join_result) noexcept {
+  // The entry keeps the game alive while the session plays in it. It's moved
+  // along with the session, if it migrates (see WebSocketSession::MigrateTo()).
+  auto* joined = game.get();
+  src->GetShard().AddSession(src, {std::move(game_name), std::move(game)});
+  src->SetGame(joined);
+  if (&game_shard != &src->GetShard()) {
+    logger_->debug("Migrating session {} to shard {}.",
+      src->GetRemoteEndpoint(), game_shard.GetId());
+    src->MigrateTo(game_shard);
+  }
+
+  return json::JSON({
+    {"type", "join-result"},
+    {"result", "joined"},
+    {"my_id", std::get<1>(join_result.value())},
+    {"players", std::get<0>(join_result.value())["players"]},
+    {"chat", std::get<0>(join_result.value())["chat"]},
+  }, false, json::JSON::value_t::object);
+}
+
+void Server::SchedulePublishMetrics() noexcept {
+  metrics_timer_->expires_after(metrics_interval_);
+  metrics_timer_->async_wait([this](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted || has_stopped_) {
+      return;
+    }
+    PublishMetrics();
+    SchedulePublishMetrics();
+  });
+}
+
+void Server::PublishMetrics() noexcept {
+  MetricsSegment::Snapshot snapshot{};
+  snapshot.pid_ = static_cast<std::uint64_t>(::getpid());
+  snapshot.published_at_ms_ = static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  snapshot.connections_ = listener_->GetNumberOfConnections();
+  snapshot.load_score_ = GetLoadScore();
+  snapshot.ready_ = IsReady();
+  snapshot.number_of_shards_ = std::min(shards_.size(), MetricsSegment::kMaxShards);
+  for (std::size_t i = 0; i < snapshot.number_of_shards_; i++) {
+    const auto& shard = *shards_[i];
+    const auto& metrics = shard.GetMetrics();
+    auto& shard_snapshot = snapshot.shards_[i];
+    shard_snapshot.players_ = metrics.players_;
+    shard_snapshot.games_ = shard.GetNumberOfGames();
+    shard_snapshot.tick_time_us_ = metrics.tick_time_us_;
+    shard_snapshot.tick_slip_us_ = metrics.tick_slip_us_;
+    shard_snapshot.loop_lag_us_ = static_cast<std::uint64_t>(shard.GetLag().count());
+    shard_snapshot.queued_packages_ = metrics.queued_packages_;
+    shard_snapshot.overload_level_ = static_cast<std::uint64_t>(shard.GetOverload().GetLevel());
+  }
+  metrics_segment_->Publish(snapshot);
+}
+
 }  // namespace fusion_server
@@ -0,0 +1,210 @@
+/**
+ * @file shard.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the Shard class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include <fusion_server/allocator.hpp>
+#include <fusion_server/game.hpp>
+#include <fusion_server/perf_counters.hpp>
+#include <fusion_server/shard.hpp>
+#include <fusion_server/websocket_session.hpp>
+
+namespace fusion_server {
+
+Shard::Shard(std::size_t id, Server& server) noexcept
+  : id_{id}, server_{server}, work_{ioc_.get_executor()}, tick_timer_{ioc_}, current_slot_{0},
+  interval_tick_time_{0}, interval_slip_{0}, lag_probe_{ioc_}, logger_{LoggerManager::Get()} {}
+
+void Shard::SetLogger(LoggerManager::Logger logger) noexcept {
+  logger_ = std::move(logger);
+}
+
+LoggerManager::Logger Shard::GetLogger() const noexcept {
+  return logger_;
+}
+
+std::size_t Shard::GetId() const noexcept {
+  return id_;
+}
+
+Server& Shard::GetServer() const noexcept {
+  return server_;
+}
+
+auto Shard::GetMetrics() noexcept -> Metrics& {
+  return metrics_;
+}
+
+auto Shard::GetMetrics() const noexcept -> const Metrics& {
+  return metrics_;
+}
+
+const OverloadController& Shard::GetOverload() const noexcept {
+  return overload_;
+}
+
+std::chrono::microseconds Shard::GetLag() const noexcept {
+  return lag_probe_.GetLag();
+}
+
+boost::asio::io_context& Shard::GetIOContext() noexcept {
+  return ioc_;
+}
+
+void Shard::AddGame(std::shared_ptr<Game> game) noexcept {
+  scheduler_.Add(std::move(game));
+}
+
+void Shard::RemoveGame(const Game* game) noexcept {
+  scheduler_.Remove(game);
+}
+
+std::size_t Shard::GetNumberOfGames() const noexcept {
+  return scheduler_.GetNumberOfGames();
+}
+
+void Shard::AddSession(WebSocketSession* session, SessionEntry entry) noexcept {
+  std::unique_lock sm{sessions_mtx_};
+  sessions_.insert_or_assign(session, std::move(entry));
+}
+
+auto Shard::RemoveSession(WebSocketSession* session) noexcept -> std::optional<SessionEntry> {
+  std::unique_lock sm{sessions_mtx_};
+  auto it = sessions_.find(session);
+  if (it == sessions_.end()) {
+    return std::nullopt;
+  }
+  auto entry = std::move(it->second);
+  sessions_.erase(it);
+  return entry;
+}
+
+std::size_t Shard::GetNumberOfSessions() const noexcept {
+  std::unique_lock sm{sessions_mtx_};
+  return sessions_.size();
+}
+
+void Shard::ScheduleFlush(std::shared_ptr<WebSocketSession> session) noexcept {
+  std::unique_lock fm{flush_mtx_};
+  pending_flushes_.push_back(std::move(session));
+}
+
+void Shard::StartTicking() noexcept {
+  logger_->debug("Shard {} starts ticking.", id_);
+  slot_deadline_ = std::chrono::steady_clock::now();
+  ScheduleTick();
+  lag_probe_.Start();
+}
+
+void Shard::Run() noexcept {
+  Allocator::BindThreadArena();
+  ioc_.run();
+}
+
+void Shard::Stop() noexcept {
+  boost::system::error_code ec;
+  tick_timer_.cancel(ec);
+  lag_probe_.Stop();
+  work_.reset();
+  ioc_.stop();
+}
+
+void Shard::ReleaseSessions() noexcept {
+  {
+    std::unique_lock fm{flush_mtx_};
+    pending_flushes_.clear();
+  }
+  ioc_.shutdown();
+}
+
+void Shard::ScheduleTick() noexcept {
+  // Deadlines are absolute, so the time spent on ticking doesn't delay the
+  // following slots.
+  slot_deadline_ += kSlotInterval;
+  tick_timer_.expires_at(slot_deadline_);
+  tick_timer_.async_wait([this](const boost::system::error_code& ec) {
+    HandleTick(ec);
+  });
+}
+
+void Shard::HandleTick(const boost::system::error_code& ec) noexcept {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  if (ec) {
+    logger_->error("An error occurred during waiting for a tick. [Boost: {}]",
+      ec.message());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto slip = std::chrono::duration_cast<std::chrono::microseconds>(
+    start - slot_deadline_);
+  UpdateAverage(metrics_.tick_slip_us_, slip.count());
+  interval_slip_ = std::max(interval_slip_, slip);
+  if (slip > kTickInterval) {
+    // Catching up would tick the same games several times in a row.
+    logger_->warn("Shard {} is {} ms behind its tick schedule.", id_,
+      std::chrono::duration_cast<std::chrono::milliseconds>(slip).count());
+    slot_deadline_ = start;
+  }
+
+  ticked_games_.clear();
+  scheduler_.GetSlot(current_slot_, ticked_games_);
+  auto idle_tick_divisor = overload_.GetIdleTickDivisor();
+  {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kTick};
+    for (auto& game : ticked_games_) {
+      if (!game->SkipTick(idle_tick_divisor)) {
+        game->Tick();
+      }
+    }
+  }
+  ticked_games_.clear();
+  interval_tick_time_ += std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  if (++current_slot_ == TickScheduler::kNumberOfSlots) {
+    current_slot_ = 0;
+    UpdateAverage(metrics_.tick_time_us_, interval_tick_time_.count());
+    auto pressure = static_cast<double>(std::max({interval_tick_time_, interval_slip_,
+      lag_probe_.GetLag()}).count()) /
+      static_cast<double>(std::chrono::microseconds{kTickInterval}.count());
+    if (overload_.Update(pressure)) {
+      logger_->warn("Shard {} changed its overload level to {}. [Pressure: {:.2f}]",
+        id_, static_cast<int>(overload_.GetLevel()), pressure);
+    }
+    interval_tick_time_ = std::chrono::microseconds{0};
+    interval_slip_ = std::chrono::microseconds{0};
+  }
+
+  FlushSessions();
+  ScheduleTick();
+}
+
+void Shard::UpdateAverage(std::atomic<std::uint64_t>& average,
+    std::int64_t sample) noexcept {
+  // The moving average smooths out single slow ticks (weight of a sample: 1/8).
+  auto value = static_cast<std::int64_t>(average.load());
+  value += (sample - value) / 8;
+  average = static_cast<std::uint64_t>(value);
+}
+
+void Shard::FlushSessions() noexcept {
+  std::unique_lock fm{flush_mtx_};
+  flushed_sessions_.swap(pending_flushes_);
+  fm.unlock();
+
+  for (auto& session : flushed_sessions_) {
+    session->Flush(*this);
+  }
+  flushed_sessions_.clear();
+}
+
+}  // namespace fusion_server
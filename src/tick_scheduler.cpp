@@ -0,0 +1,58 @@
+/**
+ * @file tick_scheduler.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the TickScheduler class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include <fusion_server/tick_scheduler.hpp>
+
+namespace fusion_server {
+
+std::size_t TickScheduler::Add(std::shared_ptr<Game> game) noexcept {
+  std::unique_lock sm{slots_mtx_};
+  auto slot = std::min_element(slots_.begin(), slots_.end(),
+    [](const auto& lhs, const auto& rhs) { return lhs.size() < rhs.size(); });
+  slot->push_back(std::move(game));
+  return static_cast<std::size_t>(slot - slots_.begin());
+}
+
+bool TickScheduler::Remove(const Game* game) noexcept {
+  std::unique_lock sm{slots_mtx_};
+  for (auto& slot : slots_) {
+    auto it = std::find_if(slot.begin(), slot.end(),
+      [game](const auto& ptr) { return ptr.get() == game; });
+    if (it != slot.end()) {
+      slot.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t TickScheduler::GetNumberOfGames() const noexcept {
+  std::unique_lock sm{slots_mtx_};
+  std::size_t number_of_games = 0;
+  for (const auto& slot : slots_) {
+    number_of_games += slot.size();
+  }
+  return number_of_games;
+}
+
+std::size_t TickScheduler::GetSlotSize(std::size_t slot) const noexcept {
+  std::unique_lock sm{slots_mtx_};
+  return slots_[slot].size();
+}
+
+void TickScheduler::GetSlot(std::size_t slot,
+    std::vector<std::shared_ptr<Game>>& games) const noexcept {
+  std::unique_lock sm{slots_mtx_};
+  games.insert(games.end(), slots_[slot].begin(), slots_[slot].end());
+}
+
+}  // namespace fusion_server
@@ -7,34 +7,155 @@
  * Copyright 2019 Kamil Rusin
  */
 
+#if defined(__linux__)
+#include <netinet/tcp.h>
+#endif
+
 #include <cstdlib>
 
+#include <array>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
+#include <fusion_server/game.hpp>
 #include <fusion_server/json.hpp>
+#include <fusion_server/perf_counters.hpp>
 #include <fusion_server/server.hpp>
+#include <fusion_server/shard.hpp>
 #include <fusion_server/websocket_session.hpp>
 
 namespace fusion_server {
 
-WebSocketSession::WebSocketSession(boost::asio::ip::tcp::socket socket) noexcept
-    : websocket_{std::move(socket)},
-      remote_endpoint_{websocket_.next_layer().remote_endpoint()},
-      strand_{websocket_.get_executor()},
+namespace {
+
+#if defined(TCP_CORK)
+/**
+ * This is the socket option corking a TCP socket.
+ */
+using TCPCork = boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK>;
+#endif
+
+/**
+ * This is the type of the handlers called for the incoming packages.
+ *
+ * @param[in] session
+ *   The session, which has received the package.
+ *
+ * @param[in] game
+ *   The game of the session, if it's in the kInGame state.
+ *
+ * @param[in] package
+ *   The verified package.
+ */
+using PackageHandler = void (*)(WebSocketSession& session, Game* game,
+  const json::JSON& package) noexcept;
+
+/**
+ * This function passes a package of a session, which has not joined any game,
+ * to the server.
+ */
+void HandleUnjoined(WebSocketSession& session, [[maybe_unused]] Game* game,
+    const json::JSON& package) noexcept {
+  session.GetShard().GetServer().HandleUnjoined(&session, package);
+}
+
+/**
+ * This function passes an "UPDATE" package to the game.
+ */
+void HandleUpdate(WebSocketSession& session, Game* game,
+    const json::JSON& package) noexcept {
+  game->HandleUpdate(&session, package);
+}
+
+/**
+ * This function passes all inputs of a "BATCH" package to the game. They are
+ * verified to be "UPDATE" packages.
+ */
+void HandleBatch(WebSocketSession& session, Game* game,
+    const json::JSON& package) noexcept {
+  for (const auto& input : package["inputs"]) {
+    game->HandleUpdate(&session, input);
+  }
+}
+
+/**
+ * This function passes a "LEAVE" package to the game.
+ */
+void HandleLeave(WebSocketSession& session, Game* game,
+    const json::JSON& package) noexcept {
+  game->HandleLeave(&session, package);
+}
+
+/**
+ * This function passes a "CHAT" package to the game.
+ */
+void HandleChat(WebSocketSession& session, Game* game,
+    const json::JSON& package) noexcept {
+  game->HandleChat(&session, package);
+}
+
+/**
+ * This function passes a package, which is not expected in a game, to the
+ * game.
+ */
+void HandleUnidentified(WebSocketSession& session, Game* game,
+    const json::JSON& package) noexcept {
+  game->HandleUnidentified(&session, package);
+}
+
+/**
+ * This function drops a package of a closing session.
+ */
+void DropPackage([[maybe_unused]] WebSocketSession& session,
+    [[maybe_unused]] Game* game, [[maybe_unused]] const json::JSON& package) noexcept {}
+
+/**
+ * This table holds the handlers of the packages. It's indexed by the state of
+ * the session and the type of the package (in the order of the enumerators of
+ * json::PackageType).
+ */
+constexpr std::array<std::array<PackageHandler, json::kNumberOfPackageTypes>,
+    WebSocketSession::kNumberOfStates> kDispatchTable{{
+  // kUnjoined
+  {{&HandleUnjoined, &HandleUnjoined, &HandleUnjoined, &HandleUnjoined, &HandleUnjoined}},
+  // kInGame
+  {{&HandleUnidentified, &HandleUpdate, &HandleBatch, &HandleLeave, &HandleChat}},
+  // kClosing
+  {{&DropPackage, &DropPackage, &DropPackage, &DropPackage, &DropPackage}},
+}};
+
+}  // namespace
+
+WebSocketSession::WebSocketSession(Strand_t strand, Shard& shard,
+    boost::asio::ip::tcp::endpoint remote_endpoint,
+    system::PooledFlatBuffer buffer) noexcept
+    : buffer_{std::move(buffer)},
+      strand_{std::move(strand)},
+      logger_{LoggerManager::Get()},
+      remote_endpoint_{std::move(remote_endpoint)},
+      flush_scheduled_{false},
+      corked_writes_{0},
+      writing_{false},
+      pinging_{false},
+      queued_bytes_{0},
       handshake_complete_{false},
+      shard_{&shard},
+      migration_target_{nullptr},
+      waiting_{false},
       in_closing_procedure_{false},
-      logger_{LoggerManager::Get()} {
-  delegate_ = Server::GetInstance().Register(this);
+      game_{nullptr} {
+  shard_.load()->GetServer().Register(this);
 }
 
 WebSocketSession::~WebSocketSession() noexcept {
-  Server::GetInstance().Unregister(this);
+  shard_.load()->GetMetrics().queued_packages_ -= outgoing_queue_.size();
+  shard_.load()->GetServer().Unregister(this);
 }
 
 void WebSocketSession::SetLogger(LoggerManager::Logger logger) noexcept {
@@ -46,6 +167,9 @@ LoggerManager::Logger WebSocketSession::GetLogger() const noexcept {
 }
 
 void WebSocketSession::Write(const std::shared_ptr<system::Package>& package) noexcept {
+  if (IsBot()) {
+    return;
+  }
   std::unique_lock uqm{outgoing_queue_mtx_};
 
   if (in_closing_procedure_) {
@@ -56,9 +180,11 @@ void WebSocketSession::Write(const std::shared_ptr<system::Package>& package) no
   }
 
   outgoing_queue_.push_back(package);
+  queued_bytes_ += package->size();
+  shard_.load()->GetMetrics().queued_packages_++;
 
-  if (outgoing_queue_.size() > 1) {
-    // Means we're already writing.
+  if (writing_ || flush_scheduled_ || outgoing_queue_.size() > 1) {
+    // Means we're already writing, waiting for a flush or for the handshake.
     return;
   }
 
@@ -68,16 +194,74 @@ void WebSocketSession::Write(const std::shared_ptr<system::Package>& package) no
     return;
   }
 
-  websocket_.async_write(
-      boost::asio::buffer(*outgoing_queue_.front()),
-      boost::asio::bind_executor(
-        strand_,
-        [self = shared_from_this()](
-          const boost::system::error_code& ec,
-          std::size_t bytes_transmitted
-        ) {
-          self->HandleWrite(ec, bytes_transmitted);
-        }));
+  flush_scheduled_ = true;
+  shard_.load()->ScheduleFlush(shared_from_this());
+}
+
+void WebSocketSession::WriteState(const std::shared_ptr<system::Package>& full,
+    const std::shared_ptr<system::Package>& reduced) noexcept {
+  if (IsBot()) {
+    return;
+  }
+  std::unique_lock uqm{outgoing_queue_mtx_};
+  if (in_closing_procedure_ || !handshake_complete_) {
+    return;
+  }
+
+  // A newer state replaces the one, which hasn't been sent yet.
+  auto detail = link_quality_.GetDetail(queued_bytes_);
+  pending_state_ = detail == system::LinkQuality::Detail::kFull ? full : reduced;
+
+  if (writing_ || flush_scheduled_) {
+    // The state is queued by the next flush.
+    return;
+  }
+  flush_scheduled_ = true;
+  shard_.load()->ScheduleFlush(shared_from_this());
+}
+
+void WebSocketSession::Flush(const Shard& shard) noexcept {
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  if (!flush_scheduled_ || &shard != shard_.load()) {
+    return;
+  }
+  flush_scheduled_ = false;
+
+  auto now = std::chrono::steady_clock::now();
+  if (in_closing_procedure_) {
+    pending_state_.reset();
+  } else if (pending_state_ != nullptr) {
+    auto interval = Shard::kTickInterval * link_quality_.GetUpdateDivisor(queued_bytes_, now);
+    // Flushes are aligned to the tick slots, so a slot of tolerance is allowed.
+    if (now - last_state_ + Shard::kSlotInterval >= interval) {
+      queued_bytes_ += pending_state_->size();
+      shard_.load()->GetMetrics().queued_packages_++;
+      outgoing_queue_.push_back(std::move(pending_state_));
+      pending_state_.reset();
+      last_state_ = now;
+    } else {
+      flush_scheduled_ = true;
+      shard_.load()->ScheduleFlush(shared_from_this());
+    }
+  }
+
+  if (!in_closing_procedure_ && !pinging_ && link_quality_.ShouldPing(now)) {
+    link_quality_.OnPingSent(now);
+    pinging_ = true;
+    StartPing();
+  }
+
+  if (writing_ || outgoing_queue_.empty()) {
+    return;
+  }
+
+  if (outgoing_queue_.size() > 1) {
+    // All packages of the tick leave in full-sized segments. The socket is
+    // uncorked after the last of them has been written.
+    corked_writes_ = outgoing_queue_.size();
+    SetCork(true);
+  }
+  DoWrite();
 }
 
 void WebSocketSession::Close() noexcept {
@@ -87,6 +271,10 @@ void WebSocketSession::Close() noexcept {
     if (outgoing_queue_.size() > 1) {
       // This means there are queued additional packages. We return and allow
       // HandleWrite to call this method after the writing has been completed.
+      shard_.load()->GetMetrics().queued_packages_ -= outgoing_queue_.size() - 1;
+      for (auto it = outgoing_queue_.begin() + 1; it != outgoing_queue_.end(); ++it) {
+        queued_bytes_ -= (*it)->size();
+      }
       outgoing_queue_.erase(outgoing_queue_.begin() + 1, outgoing_queue_.end());
       return;
     }
@@ -101,7 +289,7 @@ void WebSocketSession::Close() noexcept {
   // already in closing procedure.
 
   boost::system::error_code ec;
-  websocket_.close(boost::beast::websocket::close_code::none, ec);
+  CloseStream(ec);
     // Now callers should not performs writing to the WebSocket and should
     // perform reading as long as a read returns boost::beast::websocket::closed
     // error.
@@ -125,8 +313,13 @@ void WebSocketSession::Close(const std::shared_ptr<system::Package>& package) no
   if (outgoing_queue_.size() > 1) {
     // This means we're already writing and other packages are waiting.
     // We remove all additional packages and queue the closing package.
+    shard_.load()->GetMetrics().queued_packages_ -= outgoing_queue_.size() - 2;
+    for (auto it = outgoing_queue_.begin() + 1; it != outgoing_queue_.end(); ++it) {
+      queued_bytes_ -= (*it)->size();
+    }
     outgoing_queue_.erase(outgoing_queue_.begin() + 1, outgoing_queue_.end());
     outgoing_queue_.push_back(package);
+    queued_bytes_ += package->size();
     return;
   }
   if (outgoing_queue_.size() == 1) {
@@ -134,12 +327,14 @@ void WebSocketSession::Close(const std::shared_ptr<system::Package>& package) no
     // We queue the closing package and return. HandleWrite method will perform
     // sending and closing.
     outgoing_queue_.push_back(package);
+    queued_bytes_ += package->size();
+    shard_.load()->GetMetrics().queued_packages_++;
     return;
   }
 
   // If we're here it means no writing is performed right now.
   boost::system::error_code ec;
-  websocket_.write(boost::asio::buffer(*package), ec);
+  WriteNow(*package, ec);
   if (ec) {
     logger_->error("An error occurred during sync writing the closing message. [Boost:{}]",
       ec.message());
@@ -147,15 +342,65 @@ void WebSocketSession::Close(const std::shared_ptr<system::Package>& package) no
   Close();
 }
 
-WebSocketSession::operator bool() const noexcept {
-  return websocket_.is_open();
-}
-
 const boost::asio::ip::tcp::socket::endpoint_type&
 WebSocketSession::GetRemoteEndpoint() const noexcept {
   return remote_endpoint_;
 }
 
+Shard& WebSocketSession::GetShard() const noexcept {
+  return *shard_;
+}
+
+void WebSocketSession::MigrateTo(Shard& shard) noexcept {
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  migration_target_ = &shard == shard_.load() ? nullptr : &shard;
+  auto self = weak_from_this().lock();
+  if (migration_target_ == nullptr || self == nullptr) {
+    return;
+  }
+
+  // An idle session is moved without waiting for its next package.
+  boost::asio::post(strand_, [self = std::move(self)] {
+    std::unique_lock oqm{self->outgoing_queue_mtx_};
+    self->StartMigration();
+  });
+}
+
+auto WebSocketSession::GetState() const noexcept -> State {
+  if (in_closing_procedure_) {
+    return State::kClosing;
+  }
+  return game_ == nullptr ? State::kUnjoined : State::kInGame;
+}
+
+Game* WebSocketSession::GetGame() const noexcept {
+  return game_;
+}
+
+void WebSocketSession::SetGame(Game* game) noexcept {
+  game_ = game;
+}
+
+bool WebSocketSession::IsBot() const noexcept {
+  return false;
+}
+
+void WebSocketSession::SetFrameDictionary(
+    std::shared_ptr<const FrameDictionary> dictionary) noexcept {
+  frame_dictionary_ = std::move(dictionary);
+}
+
+void WebSocketSession::Dispatch(json::PackageType type,
+    const json::JSON& package) noexcept {
+  // The game is loaded once, so the handler gets the game of the state, in
+  // which it has been selected.
+  auto* game = game_.load();
+  auto state = in_closing_procedure_ ? State::kClosing :
+    game == nullptr ? State::kUnjoined : State::kInGame;
+  kDispatchTable[static_cast<std::size_t>(state)][static_cast<std::size_t>(type)](
+    *this, game, package);
+}
+
 void WebSocketSession::HandleHandshake(const boost::system::error_code& ec) noexcept {
   if (ec) {
     logger_->error("An error occurred during handshake. Closing the session to {}. [Boost: {}]",
@@ -168,28 +413,10 @@ void WebSocketSession::HandleHandshake(const boost::system::error_code& ec) noex
 
   if (std::unique_lock oqm{outgoing_queue_mtx_}; !outgoing_queue_.empty()) {
     logger_->debug("Sending a message queued before handshake completion.");
-    websocket_.async_write(
-      boost::asio::buffer(*outgoing_queue_.front()),
-      boost::asio::bind_executor(
-        strand_,
-        [self = shared_from_this()](
-          const boost::system::error_code& ec,
-          std::size_t bytes_transmitted
-        ) {
-          self->HandleWrite(ec, bytes_transmitted);
-        }));
+    DoWrite();
   }
 
-  websocket_.async_read(
-    buffer_,
-    boost::asio::bind_executor(
-      strand_,
-      [self = shared_from_this()](
-        const boost::system::error_code& ec,
-        std::size_t bytes_transmitted
-      ) {
-        self->HandleRead(ec, bytes_transmitted);
-      }));
+  WaitForFrame();
 }
 
 void WebSocketSession::HandleRead(const boost::system::error_code& ec,
@@ -215,10 +442,18 @@ void WebSocketSession::HandleRead(const boost::system::error_code& ec,
     return;
   }
 
-  auto package = boost::beast::buffers_to_string(buffer_.data());
+  // The padding lets json::Verify() parse the package in place.
+  std::string package;
+  package.reserve(buffer_.size() + json::kPackagePadding);
+  package.append(static_cast<const char*>(buffer_.data().data()), buffer_.size());
   buffer_.consume(buffer_.size());
+  // The session may stay idle now, so its memory is returned to the pool.
+  buffer_.shrink_to_fit();
 
-  auto[is_valid, msg] = json::Verify(package);
+  auto[is_valid, msg] = [&package] {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kVerify};
+    return json::Verify(package);
+  }();
 
   if (!is_valid) {
     logger_->warn("A package from {} was not valid. Closing the connection.",
@@ -227,20 +462,25 @@ void WebSocketSession::HandleRead(const boost::system::error_code& ec,
     return;
   }
 
-  boost::asio::post(websocket_.get_executor(), [this, msg = std::move(msg)] {
-    delegate_(msg, this);
+  // The package has been verified, so its type is known.
+  auto type = *json::GetPackageType(msg);
+  if (type == json::PackageType::kJoin) {
+    // A "JOIN" may move this session to another shard. The next wait is
+    // started after the package has been dispatched, so the session is moved
+    // right away.
+    boost::asio::post(strand_, [self = shared_from_this(), type, msg = std::move(msg)] {
+      self->Dispatch(type, msg);
+      self->ContinueReading();
+    });
+    return;
+  }
+
+  boost::asio::post(strand_.get_inner_executor(), [this, type, msg = std::move(msg)] {
+    Dispatch(type, msg);
   });
 
-  websocket_.async_read(
-    buffer_,
-    boost::asio::bind_executor(
-      strand_,
-      [self = shared_from_this()](
-        const boost::system::error_code& ec,
-        std::size_t bytes_transmitted
-      ) {
-        self->HandleRead(ec, bytes_transmitted);
-      }));
+  // The game of this session may have been moved to another shard.
+  ContinueReading();
 }
 
 void WebSocketSession::HandleWrite(const boost::system::error_code& ec,
@@ -260,7 +500,17 @@ void WebSocketSession::HandleWrite(const boost::system::error_code& ec,
   }
 
   std::unique_lock oqm{outgoing_queue_mtx_};
+  writing_ = false;
+  link_quality_.OnWriteCompleted(bytes_transmitted,
+    std::chrono::steady_clock::now() - write_started_);
+  queued_bytes_ -= outgoing_queue_.front()->size();
   outgoing_queue_.pop_front();
+  shard_.load()->GetMetrics().queued_packages_--;
+
+  if (corked_writes_ != 0 && (--corked_writes_ == 0 || in_closing_procedure_)) {
+    corked_writes_ = 0;
+    SetCork(false);
+  }
 
   if (in_closing_procedure_) {
     // We're in closing procedure. The next package is the last one to be sent.
@@ -270,7 +520,7 @@ void WebSocketSession::HandleWrite(const boost::system::error_code& ec,
 
     if (!outgoing_queue_.empty()) {
       boost::system::error_code ec;
-      websocket_.write(boost::asio::buffer(*outgoing_queue_.front()), ec);
+      WriteNow(*outgoing_queue_.front(), ec);
 
       if (ec) {
         logger_->error("An error occurred during writing closing package to {}. [Boost: {}]",
@@ -281,18 +531,318 @@ void WebSocketSession::HandleWrite(const boost::system::error_code& ec,
     return;
   }  // in_closing_procedure_
 
+  if (StartMigration()) {
+    // The next write is started on the new shard.
+    return;
+  }
+
+  if (!outgoing_queue_.empty()) {
+    DoWrite();
+  } else if (pending_state_ != nullptr && !flush_scheduled_) {
+    flush_scheduled_ = true;
+    shard_.load()->ScheduleFlush(shared_from_this());
+  }
+}
+
+void WebSocketSession::HandlePing(const boost::system::error_code& ec) noexcept {
+  if (ec && ec != boost::asio::error::operation_aborted) {
+    logger_->debug("Cannot ping {}. [Boost: {}]", GetRemoteEndpoint(), ec.message());
+  }
+
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  pinging_ = false;
+  StartMigration();
+}
+
+void WebSocketSession::HandlePong() noexcept {
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  link_quality_.OnPong();
+}
+
+void WebSocketSession::DoWrite() noexcept {
+  writing_ = true;
+  write_started_ = std::chrono::steady_clock::now();
+  StartWrite(*outgoing_queue_.front());
+}
+
+void WebSocketSession::HandleWait(const boost::system::error_code& ec) noexcept {
+  if (ec == boost::asio::error::eof) {
+    logger_->debug("The session to {} was closed.", GetRemoteEndpoint());
+    return;
+  }
+  if (ec && ec != boost::asio::error::operation_aborted) {
+    logger_->error("An error occurred during waiting for a frame from {}. [Boost: {}]",
+      GetRemoteEndpoint(), ec.message());
+    return;
+  }
+
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  waiting_ = false;
+  if (CanMigrate()) {
+    // No operation is pending now. We move the session and resume both loops
+    // on the new shard. The bytes received so far stay in the stream.
+    PerformMigration();
+    if (!outgoing_queue_.empty()) {
+      DoWrite();
+    }
+    oqm.unlock();
+    boost::asio::post(strand_, [self = shared_from_this()] {
+      self->WaitForFrame();
+    });
+    return;
+  }
+  oqm.unlock();
+
+  if (ec == boost::asio::error::operation_aborted) {
+    if (in_closing_procedure_) {
+      logger_->debug("The wait for a frame from {} was aborted.", GetRemoteEndpoint());
+      return;
+    }
+    // A write has started after the wait was cancelled. The migration is
+    // retried, when the write completes.
+    WaitForFrame();
+    return;
+  }
+  DoRead();
+}
+
+void WebSocketSession::WaitForFrame() noexcept {
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  waiting_ = true;
+  oqm.unlock();
+  // A pong received during the wait is reported with the mutex released.
+  StartWait();
+}
+
+void WebSocketSession::ContinueReading() noexcept {
+  std::unique_lock oqm{outgoing_queue_mtx_};
+  if (!CanMigrate()) {
+    // A write or a ping in progress cancels the wait, when it completes.
+    oqm.unlock();
+    WaitForFrame();
+    return;
+  }
+
+  PerformMigration();
   if (!outgoing_queue_.empty()) {
-    websocket_.async_write(
-      boost::asio::buffer(*outgoing_queue_.front()),
-      boost::asio::bind_executor(
-        strand_,
-        [self = shared_from_this()](
-          const boost::system::error_code& ec,
-          std::size_t bytes_transmitted
-        ) {
-          self->HandleWrite(ec, bytes_transmitted);
-        }));
+    DoWrite();
+  }
+  oqm.unlock();
+  boost::asio::post(strand_, [self = shared_from_this()] {
+    self->WaitForFrame();
+  });
+}
+
+bool WebSocketSession::CanMigrate() const noexcept {
+  return migration_target_ != nullptr && !in_closing_procedure_ && !writing_ && !pinging_;
+}
+
+bool WebSocketSession::StartMigration() noexcept {
+  return waiting_ && CanMigrate() && CancelWait();
+}
+
+void WebSocketSession::PerformMigration() noexcept {
+  auto& target = *migration_target_;
+  migration_target_ = nullptr;
+  if (!MoveStream(target)) {
+    return;
+  }
+
+  strand_ = Strand_t{target.GetIOContext().get_executor()};
+  auto* source = shard_.exchange(&target);
+  if (flush_scheduled_) {
+    // The flush scheduled by the source shard is ignored.
+    target.ScheduleFlush(shared_from_this());
+  }
+  if (auto entry = source->RemoveSession(this)) {
+    target.AddSession(this, std::move(*entry));
+  }
+  source->GetMetrics().queued_packages_ -= outgoing_queue_.size();
+  target.GetMetrics().queued_packages_ += outgoing_queue_.size();
+  logger_->debug("Session {} moved from shard {} to shard {}.",
+    GetRemoteEndpoint(), source->GetId(), target.GetId());
+}
+
+template <typename NextLayer>
+BasicWebSocketSession<NextLayer>::BasicWebSocketSession(NextLayer stream,
+    Shard& shard, system::PooledFlatBuffer buffer) noexcept
+    : WebSocketSession{Strand_t{stream.get_executor()}, shard,
+        stream.remote_endpoint(), std::move(buffer)},
+      websocket_{std::move(stream)} {
+  websocket_.next_layer().Preload(buffer_.data());
+  buffer_.consume(buffer_.size());
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::HandleAccept(const boost::system::error_code& ec) noexcept {
+  if (!ec) {
+    // The pongs are consumed by the framed stream, so they never reach the
+    // WebSocket stream.
+    websocket_.next_layer().SetPongHandler([this] {
+      HandlePong();
+    });
+  }
+  HandleHandshake(ec);
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::StartWait() noexcept {
+  websocket_.next_layer().async_wait_frame(
+    boost::asio::bind_executor(
+      strand_,
+      [self = shared_from_this()](const boost::system::error_code& ec) {
+        self->HandleWait(ec);
+      }));
+}
+
+template <typename NextLayer>
+bool BasicWebSocketSession<NextLayer>::CancelWait() noexcept {
+  if constexpr (std::is_same_v<NextLayer, boost::asio::ip::tcp::socket>) {
+    // Only the wait is pending on the socket, so no other operation is
+    // aborted.
+    boost::system::error_code ec;
+    websocket_.next_layer().cancel_wait(ec);
+    if (ec) {
+      logger_->warn("Cannot cancel the wait of the session to {}. [Boost: {}]",
+        GetRemoteEndpoint(), ec.message());
+      return false;
+    }
+    return true;
+  } else {
+    // An in-memory stream cannot be moved (see MoveStream()).
+    return false;
+  }
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::DoRead() noexcept {
+  websocket_.async_read(
+    buffer_,
+    boost::asio::bind_executor(
+      strand_,
+      [self = shared_from_this()](
+        const boost::system::error_code& ec,
+        std::size_t bytes_transmitted
+      ) {
+        self->HandleRead(ec, bytes_transmitted);
+      }));
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::StartWrite(const system::Package& package) noexcept {
+  websocket_.async_write(
+    PrepareFrame(package),
+    boost::asio::bind_executor(
+      strand_,
+      [self = shared_from_this()](
+        const boost::system::error_code& ec,
+        std::size_t bytes_transmitted
+      ) {
+        self->HandleWrite(ec, bytes_transmitted);
+      }));
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::WriteNow(const system::Package& package,
+    boost::system::error_code& ec) noexcept {
+  websocket_.write(PrepareFrame(package), ec);
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::StartPing() noexcept {
+  websocket_.async_ping({}, boost::asio::bind_executor(
+    strand_,
+    [self = std::static_pointer_cast<BasicWebSocketSession>(shared_from_this())](
+        const boost::system::error_code& ec) {
+      self->HandlePing(ec);
+    }));
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::CloseStream(boost::system::error_code& ec) noexcept {
+  websocket_.close(boost::beast::websocket::close_code::none, ec);
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::SetCork([[maybe_unused]] bool enabled) noexcept {
+#if defined(TCP_CORK)
+  if constexpr (std::is_same_v<NextLayer, boost::asio::ip::tcp::socket>) {
+    boost::system::error_code ec;
+    websocket_.next_layer().next_layer().set_option(TCPCork{enabled}, ec);
+    if (ec) {
+      logger_->warn("Cannot {} the socket connected to {}. [Boost: {}]",
+        enabled ? "cork" : "uncork", GetRemoteEndpoint(), ec.message());
+    }
   }
+#endif
 }
 
+template <typename NextLayer>
+bool BasicWebSocketSession<NextLayer>::MoveStream(Shard& target) noexcept {
+  if constexpr (std::is_same_v<NextLayer, boost::asio::ip::tcp::socket>) {
+    auto& socket = websocket_.next_layer().next_layer();
+    boost::system::error_code ec;
+    auto protocol = socket.local_endpoint(ec).protocol();
+    if (ec) {
+      logger_->error("Cannot migrate the session to {}. [Boost: {}]",
+        GetRemoteEndpoint(), ec.message());
+      return false;
+    }
+
+    // The socket is re-created on the target I/O context from the released
+    // descriptor. The WebSocket stream and the framed stream keep their state,
+    // since only the socket is replaced.
+    auto handle = socket.release(ec);
+    if (ec) {
+      logger_->error("Cannot release the socket connected to {}. [Boost: {}]",
+        GetRemoteEndpoint(), ec.message());
+      return false;
+    }
+    socket = boost::asio::ip::tcp::socket{target.GetIOContext()};
+    socket.assign(protocol, handle, ec);
+    if (ec) {
+      logger_->error("Cannot assign the socket connected to {} to shard {}. [Boost: {}]",
+        GetRemoteEndpoint(), target.GetId(), ec.message());
+      return false;
+    }
+    return true;
+  } else {
+    // An in-memory stream completes its operations on the executor it has
+    // been created with, so the session stays on its shard.
+    logger_->debug("The stream of the session {} cannot be moved to shard {}.",
+      GetRemoteEndpoint(), target.GetId());
+    return false;
+  }
+}
+
+template <typename NextLayer>
+bool BasicWebSocketSession<NextLayer>::IsOpen() const noexcept {
+  return websocket_.is_open();
+}
+
+template <typename NextLayer>
+void BasicWebSocketSession<NextLayer>::ConfirmCompression() noexcept {
+  if (frame_dictionary_ == nullptr) {
+    return;
+  }
+  websocket_.set_option(boost::beast::websocket::stream_base::decorator(
+    [token = frame_dictionary_->GetToken()](boost::beast::websocket::response_type& res) {
+      res.set(FrameDictionary::kCompressionField, token);
+    }));
+}
+
+template <typename NextLayer>
+boost::asio::const_buffer
+BasicWebSocketSession<NextLayer>::PrepareFrame(const system::Package& package) noexcept {
+  if (frame_dictionary_ != nullptr && frame_dictionary_->Compress(package, compressed_)) {
+    websocket_.binary(true);
+    return boost::asio::buffer(compressed_);
+  }
+  websocket_.binary(false);
+  return boost::asio::buffer(package);
+}
+
+template class BasicWebSocketSession<boost::asio::ip::tcp::socket>;
+template class BasicWebSocketSession<system::MemoryStream>;
+
 }  // namespace fusion_server
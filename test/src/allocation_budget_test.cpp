@@ -0,0 +1,143 @@
+/**
+ * @file allocation_budget_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the tests asserting the allocation budgets of the hot paths.
+ * A budget is the number of allocations a path is allowed to make, so a change
+ * adding an allocation to a hot path fails these tests. When a path gets
+ * cheaper, its budget should be lowered.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <gtest/gtest.h>
+
+#include <fusion_server/game.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/ui/player.hpp>
+#include <fusion_server/websocket_session.hpp>
+
+#include "allocation_counter.hpp"
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This constant contains the budget of verifying an update package.
+ */
+constexpr std::size_t kVerifyUpdateBudget = 14;
+
+/**
+ * This constant contains the budget of serializing a player.
+ */
+constexpr std::size_t kPlayerSerializeBudget = 13;
+
+/**
+ * This fixture creates WebSocket sessions on the first shard of its server. The
+ * sessions don't perform the handshake, so the written packages stay queued.
+ */
+struct SessionAllocationBudgetTest : public ::testing::Test {
+  void SetUp() override {
+    acceptor_ = std::make_unique<boost::asio::ip::tcp::acceptor>(ioc_,
+      boost::asio::ip::tcp::endpoint{boost::asio::ip::make_address_v4("127.0.0.1"), 0});
+  }
+
+  std::shared_ptr<WebSocketSession> MakeSession() {
+    auto& client = clients_.emplace_back(ioc_);
+    client.connect(acceptor_->local_endpoint());
+    return std::make_shared<BasicWebSocketSession<boost::asio::ip::tcp::socket>>(
+      acceptor_->accept(server_.GetIOContext()), server_.GetShard(0));
+  }
+
+  Server server_;  // NOLINT
+  boost::asio::io_context ioc_;  // NOLINT
+  std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;  // NOLINT
+  std::vector<boost::asio::ip::tcp::socket> clients_;  // NOLINT
+};
+
+}  // namespace
+
+TEST(AllocationCounterTest, CountsAllocationsOfThisThread) {
+  // Arrange
+  test::AllocationCounter counter;
+
+  // Act
+  auto value = std::make_unique<int>(0);
+  std::thread{[] { auto other = std::make_unique<int>(0); }}.join();
+
+  // Assert
+  // The std::thread's state is allocated by this thread as well.
+  EXPECT_EQ(2, counter.GetCount());
+}
+
+TEST(AllocationBudgetTest, JsonVerifyUpdate) {
+  // Arrange
+  std::string package = R"({"type": "update", "direction": 4, "angle": 1.5})";
+  // The first package read by a thread may allocate the parser's buffers.
+  json::Verify(package);
+  test::AllocationCounter counter;
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  ASSERT_TRUE(is_valid);
+  EXPECT_LE(counter.GetCount(), kVerifyUpdateBudget);
+}
+
+TEST(AllocationBudgetTest, PlayerSerialize) {
+  // Arrange
+  ui::Player player{0, 0, "nick", 100.0, {}, 0.0, {}};
+  test::AllocationCounter counter;
+
+  // Act
+  auto json = player.Serialize();
+
+  // Assert
+  EXPECT_LE(counter.GetCount(), kPlayerSerializeBudget);
+}
+
+TEST_F(SessionAllocationBudgetTest, WebSocketSessionWriteDoesNotAllocate) {  // NOLINT
+  // Arrange
+  auto session = MakeSession();
+  auto package = std::make_shared<system::Package>("{}");
+  // The first write allocates the first block of the queue.
+  session->Write(package);
+  session->Write(package);
+  test::AllocationCounter counter;
+
+  // Act
+  for (int i = 0; i < 8; i++) {
+    session->Write(package);
+  }
+
+  // Assert
+  EXPECT_EQ(0, counter.GetCount());
+}
+
+TEST_F(SessionAllocationBudgetTest, GameBroadcastPackageDoesNotAllocate) {  // NOLINT
+  // Arrange
+  auto first = MakeSession();
+  auto second = MakeSession();
+  Game game{server_.GetShard(0)};
+  ASSERT_TRUE(game.Join(first.get(), "first"));
+  ASSERT_TRUE(game.Join(second.get(), "second"));
+  auto package = std::make_shared<system::Package>("{}");
+  game.BroadcastPackage(package);
+  game.BroadcastPackage(package);
+  test::AllocationCounter counter;
+
+  // Act
+  game.BroadcastPackage(package);
+
+  // Assert
+  EXPECT_EQ(0, counter.GetCount());
+}
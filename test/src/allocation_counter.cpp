@@ -0,0 +1,134 @@
+/**
+ * @file allocation_counter.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the AllocationCounter class and the
+ * replacement of the global allocation functions of the test binary.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cstdlib>
+
+#include <new>
+
+#include "allocation_counter.hpp"
+
+namespace {
+
+/**
+ * This is the number of allocations made by the thread. It's a plain integer,
+ * so reading it doesn't allocate.
+ */
+thread_local std::size_t allocations = 0;
+
+/**
+ * This function allocates memory and counts the allocation.
+ *
+ * @param[in] size
+ *   The size of the allocation.
+ *
+ * @return
+ *   A pointer to the allocated memory is returned. If it cannot be allocated,
+ *   nullptr is returned.
+ */
+void* Allocate(std::size_t size) noexcept {
+  allocations++;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+/**
+ * This function allocates aligned memory and counts the allocation.
+ *
+ * @param[in] size
+ *   The size of the allocation.
+ *
+ * @param[in] alignment
+ *   The alignment of the allocation.
+ *
+ * @return
+ *   A pointer to the allocated memory is returned. If it cannot be allocated,
+ *   nullptr is returned.
+ */
+void* Allocate(std::size_t size, std::align_val_t alignment) noexcept {
+  allocations++;
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+}  // namespace
+
+namespace fusion_server::test {
+
+AllocationCounter::AllocationCounter() noexcept : start_{allocations} {}
+
+AllocationCounter::~AllocationCounter() noexcept = default;
+
+std::size_t AllocationCounter::GetCount() const noexcept {
+  return allocations - start_;
+}
+
+}  // namespace fusion_server::test
+
+void* operator new(std::size_t size) {
+  if (auto* pointer = Allocate(size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  if (auto* pointer = Allocate(size, alignment)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+  std::free(pointer);
+}
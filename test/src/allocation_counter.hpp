@@ -0,0 +1,56 @@
+/**
+ * @file allocation_counter.hpp
+ *
+ * This module is a part of Fusion Server project.
+ * It declares the AllocationCounter class used by the allocation budget tests.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#pragma once
+
+#include <cstdlib>
+
+namespace fusion_server::test {
+
+/**
+ * This class counts the allocations made by the calling thread during its
+ * lifetime. The test binary replaces the global operator new, so every
+ * allocation made with it (including the ones made by the standard containers
+ * and by nlohmann::json) is counted. Allocations made by other threads are not.
+ *
+ * Counters may be nested; each of them counts all allocations made since its
+ * construction.
+ */
+class AllocationCounter {
+ public:
+  /**
+   * @brief Starts counting.
+   */
+  AllocationCounter() noexcept;
+
+  /**
+   * @brief Stops counting.
+   */
+  ~AllocationCounter() noexcept;
+
+  AllocationCounter(const AllocationCounter& other) = delete;
+  AllocationCounter& operator=(const AllocationCounter& other) = delete;
+
+  /**
+   * @brief Returns the number of allocations.
+   *
+   * @return
+   *   The number of allocations made by this thread since the construction of
+   *   this counter is returned.
+   */
+  [[nodiscard]] std::size_t GetCount() const noexcept;
+
+ private:
+  /**
+   * This is the thread's allocation count at the construction of this counter.
+   */
+  std::size_t start_;
+};
+
+}  // namespace fusion_server::test
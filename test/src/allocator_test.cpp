@@ -0,0 +1,52 @@
+/**
+ * @file allocator_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the Allocator class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/allocator.hpp>
+
+using namespace fusion_server;
+
+TEST(AllocatorTest, NameIsKnown) {
+  // Arrange
+  std::string name = Allocator::GetName();
+
+  // Act
+
+  // Assert
+  EXPECT_TRUE(name == "system" || name == "jemalloc" || name == "mimalloc");
+}
+
+TEST(AllocatorTest, StatsReportResidentMemory) {
+  // Arrange
+
+  // Act
+  auto stats = Allocator::GetStats();
+
+  // Assert
+  EXPECT_GT(stats.resident_bytes_, 0);
+}
+
+TEST(AllocatorTest, ThreadWithOwnArenaAllocates) {
+  // Arrange
+  std::string allocated;
+
+  // Act
+  std::thread thread{[&allocated] {
+    Allocator::BindThreadArena();
+    allocated = std::string(4096, 'x');
+  }};
+  thread.join();
+
+  // Assert
+  EXPECT_EQ(4096, allocated.size());
+}
@@ -0,0 +1,144 @@
+/**
+ * @file bot_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the Bot and BotPool
+ * classes.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <cmath>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/bot.hpp>
+#include <fusion_server/bot_pool.hpp>
+#include <fusion_server/game.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/ui/map.hpp>
+
+using namespace fusion_server;
+
+TEST(BotTest, BotJoinsGameLikeClient) {
+  // Arrange
+  Server server;
+  auto bot = std::make_shared<Bot>(server.GetShard(0), 1);
+
+  // Act
+  auto joined = bot->Join("g", "bot-1");
+  auto* game = bot->GetGame();
+
+  // Assert
+  EXPECT_TRUE(joined);
+  EXPECT_TRUE(bot->IsBot());
+  EXPECT_EQ(WebSocketSession::State::kInGame, bot->GetState());
+  ASSERT_NE(nullptr, game);
+  EXPECT_EQ(1, game->GetPlayersCount());
+}
+
+TEST(BotTest, DestroyedBotLeavesItsGame) {
+  // Arrange
+  Server server;
+  auto bot = std::make_shared<Bot>(server.GetShard(0), 1);
+  bot->Join("g", "bot-1");
+  auto& shard = bot->GetGame()->GetShard();
+
+  // Act
+  bot->Think();
+  bot.reset();
+
+  // Assert
+  EXPECT_EQ(0, shard.GetNumberOfGames());
+  EXPECT_EQ(0, server.GetShard(0).GetNumberOfSessions());
+}
+
+TEST(BotTest, FrozenGameDropsInputs) {
+  // Arrange
+  Server server;
+  auto bot = std::make_shared<Bot>(server.GetShard(0), 1);
+  bot->Join("g", "bot-1");
+  auto* game = bot->GetGame();
+  const auto get_angle = [](const json::JSON& snapshot) {
+    return snapshot["players"][0]["player"]["angle"].get<double>();
+  };
+
+  // Act
+  auto before = game->Freeze();
+  bot->Think();
+  game->Unfreeze();
+  auto frozen = game->Freeze();
+  game->Unfreeze();
+  bot->Think();
+  auto unfrozen = game->Freeze();
+
+  // Assert
+  ASSERT_TRUE(before && frozen && unfrozen);
+  EXPECT_EQ(get_angle(*before), get_angle(*frozen));
+  EXPECT_NE(get_angle(*before), get_angle(*unfrozen));
+}
+
+TEST(BotTest, BotWalksAlongAPathOnTheMap) {
+  // Arrange
+  Server server;
+  auto bot = std::make_shared<Bot>(server.GetShard(0), 1);
+  bot->Join("g", "bot-1");
+  auto* game = bot->GetGame();
+  game->SetMap(ui::Map::Parse({"........"}));
+
+  // Act & Assert
+  for (int i = 0; i < 16; i++) {
+    bot->Think();
+    auto snapshot = game->Freeze();
+    game->Unfreeze();
+    ASSERT_TRUE(snapshot);
+    // The map has a single row, so the bot walks either right or left.
+    auto angle = (*snapshot)["players"][0]["player"]["angle"].get<double>();
+    EXPECT_NEAR(0.0, std::fmod(angle, 180.0), 1e-9);
+  }
+}
+
+TEST(BotPoolTest, SpawnAndClearBots) {
+  // Arrange
+  Server server;
+  BotPool pool{server, 2};
+
+  // Act
+  auto joined = pool.Spawn("g", 3);
+  auto spawned = pool.GetNumberOfBots();
+  pool.Clear();
+
+  // Assert
+  EXPECT_EQ(3, joined);
+  EXPECT_EQ(3, spawned);
+  EXPECT_EQ(0, pool.GetNumberOfBots());
+}
+
+TEST(BotPoolTest, SpawnIsBoundedByTheSeatsOfAGame) {
+  // Arrange
+  Server server;
+  BotPool pool{server, 1};
+
+  // Act
+  auto joined = pool.Spawn("g", static_cast<std::size_t>(-1));
+
+  // Assert
+  EXPECT_EQ(BotPool::kMaxSpawnCount, joined);
+  EXPECT_EQ(BotPool::kMaxSpawnCount, pool.GetNumberOfBots());
+}
+
+TEST(BotPoolTest, StoppedPoolSpawnsNoBots) {
+  // Arrange
+  Server server;
+  BotPool pool{server, 1};
+
+  // Act
+  pool.Stop();
+  auto joined = pool.Spawn("g", 1);
+
+  // Assert
+  EXPECT_EQ(0, joined);
+  EXPECT_EQ(0, pool.GetNumberOfBots());
+}
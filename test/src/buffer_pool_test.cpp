@@ -0,0 +1,64 @@
+/**
+ * @file buffer_pool_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the BufferPool class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/system/buffer_pool.hpp>
+
+using namespace fusion_server;
+
+TEST(BufferPoolTest, ReleasedBlockIsReused) {
+  // Arrange
+  auto& pool = system::BufferPool::Get();
+  auto* block = pool.Allocate(1000);
+  pool.Deallocate(block, 1000);
+
+  // Act
+  auto* reused = pool.Allocate(700);
+
+  // Assert
+  EXPECT_EQ(block, reused);
+  pool.Deallocate(reused, 700);
+}
+
+TEST(BufferPoolTest, CountsBorrowedBytesPerBlock) {
+  // Arrange
+  auto& pool = system::BufferPool::Get();
+  auto borrowed = pool.GetBorrowedBytes();
+
+  // Act
+  auto* small = pool.Allocate(1);
+  auto* large = pool.Allocate(system::BufferPool::kMaxBlockSize + 1);
+
+  // Assert
+  EXPECT_EQ(borrowed + system::BufferPool::kMinBlockSize +
+    system::BufferPool::kMaxBlockSize + 1, pool.GetBorrowedBytes());
+  pool.Deallocate(small, 1);
+  pool.Deallocate(large, system::BufferPool::kMaxBlockSize + 1);
+  EXPECT_EQ(borrowed, pool.GetBorrowedBytes());
+}
+
+TEST(BufferPoolTest, EmptyFlatBufferHoldsNoMemory) {
+  // Arrange
+  auto& pool = system::BufferPool::Get();
+  auto borrowed = pool.GetBorrowedBytes();
+  system::PooledFlatBuffer buffer;
+  buffer.commit(boost::asio::buffer_copy(buffer.prepare(4096),
+    boost::asio::buffer(std::string(4096, 'x'))));
+
+  // Act
+  buffer.consume(buffer.size());
+  buffer.shrink_to_fit();
+
+  // Assert
+  EXPECT_EQ(0, buffer.capacity());
+  EXPECT_EQ(borrowed, pool.GetBorrowedBytes());
+}
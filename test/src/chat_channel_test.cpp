@@ -0,0 +1,163 @@
+/**
+ * @file chat_channel_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the ChatChannel and
+ * RingBuffer classes.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/chat_channel.hpp>
+#include <fusion_server/system/ring_buffer.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+ChatChannel::Line MakeLine(std::size_t player_id, std::size_t team_id,
+  ChatChannel::Scope scope = ChatChannel::Scope::kAll) {
+  ChatChannel::Line line;
+  line.player_id_ = player_id;
+  line.team_id_ = team_id;
+  line.nick_ = "nick";
+  line.message_ = "message";
+  line.scope_ = scope;
+  return line;
+}
+
+}  // namespace
+
+// RingBuffer
+
+TEST(RingBufferTest, KeepsElementsInOrder) {
+  // Arrange
+  system::RingBuffer<int, 4> buffer;
+
+  // Act
+  buffer.Push(1);
+  buffer.Push(2);
+  buffer.Push(3);
+
+  // Assert
+  ASSERT_EQ(3, buffer.Size());
+  EXPECT_EQ(1, buffer[0]);
+  EXPECT_EQ(2, buffer[1]);
+  EXPECT_EQ(3, buffer[2]);
+}
+
+TEST(RingBufferTest, OverwritesOldestWhenFull) {
+  // Arrange
+  system::RingBuffer<int, 3> buffer;
+
+  // Act
+  for (int i = 1; i <= 5; i++) buffer.Push(i);
+
+  // Assert
+  ASSERT_EQ(3, buffer.Size());
+  EXPECT_EQ(3, buffer[0]);
+  EXPECT_EQ(4, buffer[1]);
+  EXPECT_EQ(5, buffer[2]);
+}
+
+// ChatChannel
+
+TEST(ChatChannelTest, RejectsEmptyAndTooLongMessages) {
+  // Arrange
+  ChatChannel chat;
+  auto empty = MakeLine(0, 1);
+  empty.message_ = "";
+  auto too_long = MakeLine(0, 1);
+  too_long.message_ = std::string(ChatChannel::kMaxMessageLength + 1, 'x');
+
+  // Act
+
+  // Assert
+  EXPECT_EQ(ChatChannel::PostResult::kNotValid, chat.Post(empty));
+  EXPECT_EQ(ChatChannel::PostResult::kNotValid, chat.Post(too_long));
+  EXPECT_FALSE(chat.HasPending());
+}
+
+TEST(ChatChannelTest, LimitsRatePerSender) {
+  // Arrange
+  ChatChannel chat;
+  auto now = ChatChannel::Clock::now();
+
+  // Act
+  for (std::size_t i = 0; i < ChatChannel::kBurst; i++) {
+    ASSERT_EQ(ChatChannel::PostResult::kAccepted, chat.Post(MakeLine(0, 1), now));
+  }
+
+  // Assert
+  EXPECT_EQ(ChatChannel::PostResult::kRateLimited, chat.Post(MakeLine(0, 1), now));
+  EXPECT_EQ(ChatChannel::PostResult::kAccepted, chat.Post(MakeLine(1, 1), now));
+  EXPECT_EQ(ChatChannel::PostResult::kAccepted,
+    chat.Post(MakeLine(0, 1), now + ChatChannel::kRefillPeriod));
+}
+
+TEST(ChatChannelTest, BatchesPendingMessagesIntoOneFrame) {
+  // Arrange
+  ChatChannel chat;
+  chat.Post(MakeLine(0, 1));
+  chat.Post(MakeLine(1, 2));
+  chat.Post(MakeLine(2, 1));
+
+  // Act
+  auto frame = chat.MakeFrame(1);
+
+  // Assert
+  ASSERT_NE(nullptr, frame);
+  auto json = json::JSON::parse(*frame);
+  EXPECT_EQ("chat", json["type"]);
+  EXPECT_EQ(3, json["messages"].size());
+}
+
+TEST(ChatChannelTest, TeamMessagesAreVisibleOnlyToTeam) {
+  // Arrange
+  ChatChannel chat;
+  chat.Post(MakeLine(0, 1, ChatChannel::Scope::kTeam));
+
+  // Act
+  auto first_frame = chat.MakeFrame(1);
+  auto second_frame = chat.MakeFrame(2);
+
+  // Assert
+  EXPECT_NE(nullptr, first_frame);
+  EXPECT_EQ(nullptr, second_frame);
+  EXPECT_EQ(1, chat.GetHistory(1).size());
+  EXPECT_EQ(0, chat.GetHistory(2).size());
+}
+
+TEST(ChatChannelTest, ClearPendingKeepsHistory) {
+  // Arrange
+  ChatChannel chat;
+  chat.Post(MakeLine(0, 1));
+
+  // Act
+  chat.ClearPending();
+
+  // Assert
+  EXPECT_FALSE(chat.HasPending());
+  EXPECT_EQ(nullptr, chat.MakeFrame(1));
+  EXPECT_EQ(1, chat.GetHistory(2).size());
+}
+
+TEST(ChatChannelTest, HistoryIsBounded) {
+  // Arrange
+  ChatChannel chat;
+  auto now = ChatChannel::Clock::now();
+
+  // Act
+  for (std::size_t i = 0; i < ChatChannel::kHistorySize + 10; i++) {
+    chat.Post(MakeLine(i, 1), now);
+  }
+
+  // Assert
+  auto history = chat.GetHistory(1);
+  ASSERT_EQ(ChatChannel::kHistorySize, history.size());
+  EXPECT_EQ(10, history[0]["player_id"]);
+}
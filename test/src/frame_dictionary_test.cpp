@@ -0,0 +1,62 @@
+/**
+ * @file frame_dictionary_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the FrameDictionary
+ * class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/frame_dictionary.hpp>
+
+using namespace fusion_server;
+
+TEST(FrameDictionaryTest, ValidOfferIsParsed) {
+  // Arrange
+
+  // Act
+  auto offer = FrameDictionary::ParseOffer("zstd; dict=42");
+  auto without_spaces = FrameDictionary::ParseOffer("zstd;dict=7");
+
+  // Assert
+  EXPECT_EQ(42u, offer);
+  EXPECT_EQ(7u, without_spaces);
+}
+
+TEST(FrameDictionaryTest, NotValidOfferIsRejected) {
+  // Arrange
+
+  // Act
+
+  // Assert
+  EXPECT_FALSE(FrameDictionary::ParseOffer("").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("deflate; dict=42").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("zstd").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("zstd; dict=").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("zstd; dict=0").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("zstd; dict=-1").has_value());
+  EXPECT_FALSE(FrameDictionary::ParseOffer("zstd; dict=4294967296").has_value());
+}
+
+TEST(FrameDictionaryTest, NotADictionaryIsNotLoaded) {
+  // Arrange
+  auto path = "/tmp/fusion_dictionary_test_" + std::to_string(::getpid());
+  std::ofstream{path} << "not a dictionary";
+
+  // Act
+  auto missing = FrameDictionary::Load(path + "_missing");
+  auto not_valid = FrameDictionary::Load(path);
+  ::unlink(path.c_str());
+
+  // Assert
+  EXPECT_EQ(nullptr, missing);
+  EXPECT_EQ(nullptr, not_valid);
+}
@@ -8,32 +8,39 @@
  */
 
 #include <memory>
+#include <string>
+#include <thread>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <gtest/gtest.h>
 
 #include <fusion_server/http_session.hpp>
+#include <fusion_server/server.hpp>
 
 struct HttpSessionTest : public ::testing::Test {
-  HttpSessionTest() : ioc_{nullptr} {}
+  HttpSessionTest() : server_{nullptr}, ioc_{nullptr} {}
 
   void SetUp() override {
+    server_ = new fusion_server::Server;
     ioc_ = new boost::asio::io_context;
   }
 
   void TearDown() override {
     ioc_->stop();
     delete ioc_;
+    delete server_;
   }
 
+  fusion_server::Server* server_;  // NOLINT
   boost::asio::io_context* ioc_;  // NOLINT
 };
 
 struct HttpSessionTestWithConnection : public ::testing::Test {
-  HttpSessionTestWithConnection() : ioc_{nullptr} {}
+  HttpSessionTestWithConnection() : server_{nullptr}, ioc_{nullptr} {}
 
   void SetUp() override {
+    server_ = new fusion_server::Server;
     ioc_ = new boost::asio::io_context;
     work_ = new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(
       ioc_->get_executor()
@@ -62,8 +69,11 @@ struct HttpSessionTestWithConnection : public ::testing::Test {
     delete ioc_;
     delete client_endpoint_;
     delete server_endpoint_;
+    delete server_;
   }
 
+  fusion_server::Server* server_;
+
   std::thread* thread_;
 
   boost::asio::io_context* ioc_;  // NOLINT
@@ -108,9 +118,9 @@ struct HTTPClient {
 TEST_F(HttpSessionTest, SetLoggerCheck) {
   // Arrange
   auto socket = boost::asio::ip::tcp::socket{*ioc_};
-  auto http1 = std::make_shared<fusion_server::HTTPSession>(std::move(socket));
-  auto http2 = std::make_shared<fusion_server::HTTPSession>(std::move(socket)); // NOLINT(bugprone-use-after-move)
-  auto http3 = std::make_shared<fusion_server::HTTPSession>(std::move(socket)); // NOLINT(bugprone-use-after-move)
+  auto http1 = std::make_shared<fusion_server::HTTPSession>(std::move(socket), server_->GetShard(0));
+  auto http2 = std::make_shared<fusion_server::HTTPSession>(std::move(socket), server_->GetShard(0)); // NOLINT(bugprone-use-after-move)
+  auto http3 = std::make_shared<fusion_server::HTTPSession>(std::move(socket), server_->GetShard(0)); // NOLINT(bugprone-use-after-move)
   auto logger = std::make_shared<spdlog::logger>("test_logger");
 
   // Act
@@ -130,7 +140,7 @@ TEST_F(HttpSessionTest, SocketNotConnected) {  // NOLINT
   auto socket = boost::asio::ip::tcp::socket(*ioc_);
 
   // Act
-  auto http = std::make_shared<fusion_server::HTTPSession>(std::move(socket));
+  auto http = std::make_shared<fusion_server::HTTPSession>(std::move(socket), server_->GetShard(0));
 
   // Assert
   EXPECT_FALSE(*http);
@@ -139,7 +149,7 @@ TEST_F(HttpSessionTest, SocketNotConnected) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, NoDataInitialyFromServer) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
 
   // Act
@@ -152,7 +162,7 @@ TEST_F(HttpSessionTestWithConnection, NoDataInitialyFromServer) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, SendValidRequestGetRoot) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
   session->Run();
   auto req = []{
@@ -181,7 +191,7 @@ TEST_F(HttpSessionTestWithConnection, SendValidRequestGetRoot) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, KeepAliveTrue) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
   session->Run();
   auto req = []{
@@ -206,7 +216,7 @@ TEST_F(HttpSessionTestWithConnection, KeepAliveTrue) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, SendRequetGet404) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
   session->Run();
   auto req = []{
@@ -234,7 +244,7 @@ TEST_F(HttpSessionTestWithConnection, SendRequetGet404) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, BadRequestBadVersion) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
   session->Run();
   auto req = []{
@@ -261,7 +271,7 @@ TEST_F(HttpSessionTestWithConnection, BadRequestBadVersion) {  // NOLINT
 TEST_F(HttpSessionTestWithConnection, BadRequestMissingHostField) {  // NOLINT
   // Arrange
   auto session = std::make_shared<fusion_server::HTTPSession>(
-    std::move(*server_endpoint_));
+    std::move(*server_endpoint_), server_->GetShard(0));
   auto client = HTTPClient{std::move(*client_endpoint_)};
   session->Run();
   auto req = []{
@@ -283,3 +293,106 @@ TEST_F(HttpSessionTestWithConnection, BadRequestMissingHostField) {  // NOLINT
   ASSERT_EQ(400, client.response.result_int());
   EXPECT_EQ("Bad Request", client.response.reason());
 }
+
+TEST_F(HttpSessionTestWithConnection, PipelinedRequestsAreAnswered) {  // NOLINT
+  // Arrange
+  auto session = std::make_shared<fusion_server::HTTPSession>(
+    std::move(*server_endpoint_), server_->GetShard(0));
+  auto client = HTTPClient{std::move(*client_endpoint_)};
+  session->Run();
+  std::string requests =
+    "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n"
+    "GET /not/found HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  HTTPClient::Response_t second_response;
+
+  // Act
+  client.Write(requests);
+  boost::beast::http::read(client.socket_, client.buffer_, client.response);
+  boost::beast::http::read(client.socket_, client.buffer_, second_response);
+
+  // Assert
+  EXPECT_EQ(200, client.response.result_int());
+  EXPECT_EQ(404, second_response.result_int());
+}
+
+TEST_F(HttpSessionTestWithConnection, TooLargeHeaderClosesConnection) {  // NOLINT
+  // Arrange
+  auto session = std::make_shared<fusion_server::HTTPSession>(
+    std::move(*server_endpoint_), server_->GetShard(0));
+  auto client = HTTPClient{std::move(*client_endpoint_)};
+  session->Run();
+  std::string request = "GET / HTTP/1.1\r\nHost: example.com\r\nX-Padding: " +
+    std::string(fusion_server::HTTPSession::kMaxHeaderSize, 'a') + "\r\n\r\n";
+  boost::system::error_code ec;
+
+  // Act
+  boost::asio::write(client.socket_, boost::asio::buffer(request), ec);
+  boost::beast::http::read(client.socket_, client.buffer_, client.response, ec);
+
+  // Assert
+  EXPECT_TRUE(ec);
+}
+
+TEST_F(HttpSessionTestWithConnection, HealthProbesReportLoadScore) {  // NOLINT
+  // Arrange
+  auto session = std::make_shared<fusion_server::HTTPSession>(
+    std::move(*server_endpoint_), server_->GetShard(0));
+  auto client = HTTPClient{std::move(*client_endpoint_)};
+  session->Run();
+  const auto make_request = [](const char* target) {
+    HTTPClient::Request_t req;
+    req.method(boost::beast::http::verb::get);
+    req.version(11);
+    req.target(target);
+    req.set(boost::beast::http::field::host, "example.com");
+    req.keep_alive(true);
+    req.prepare_payload();
+    return req;
+  };
+  HTTPClient::Response_t readyz;
+
+  // Act
+  boost::beast::http::write(client.socket_, make_request("/healthz"));
+  boost::beast::http::read(client.socket_, client.buffer_, client.response);
+  boost::beast::http::write(client.socket_, make_request("/readyz"));
+  boost::beast::http::read(client.socket_, client.buffer_, readyz);
+
+  // Assert
+  EXPECT_EQ(200, client.response.result_int());
+  EXPECT_NE(client.response.end(),
+    client.response.find(fusion_server::HTTPSession::kLoadScoreField));
+  // The server is not accepting connections in this test.
+  EXPECT_EQ(503, readyz.result_int());
+  EXPECT_NE(readyz.end(), readyz.find(fusion_server::HTTPSession::kLoadScoreField));
+}
+
+TEST_F(HttpSessionTest, RequestOverMemoryStreamIsAnswered) {  // NOLINT
+  // Arrange
+  using MemoryStream = fusion_server::system::MemoryStream;
+  boost::asio::io_context client_ioc;
+  auto [server_stream, client_stream] = MemoryStream::MakePair(*ioc_, client_ioc);
+  auto session = std::make_shared<fusion_server::BasicHTTPSession<MemoryStream>>(
+    std::move(server_stream), server_->GetShard(0));
+  // The session is started first, so the I/O context has work to run.
+  session->Run();
+  std::thread thread{[this] { ioc_->run(); }};
+  HTTPClient::Request_t req;
+  req.method(boost::beast::http::verb::get);
+  req.version(11);
+  req.target("/healthz");
+  req.set(boost::beast::http::field::host, "example.com");
+  req.keep_alive(false);
+  req.prepare_payload();
+  boost::beast::flat_buffer buffer;
+  HTTPClient::Response_t response;
+
+  // Act
+  boost::beast::http::write(client_stream, req);
+  boost::beast::http::read(client_stream, buffer, response);
+  session.reset();
+  thread.join();
+
+  // Assert
+  EXPECT_EQ(200, response.result_int());
+  EXPECT_FALSE(response.keep_alive());
+}
@@ -0,0 +1,238 @@
+/**
+ * @file json_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the package
+ * verification.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/json.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+std::string MakeBatch(std::size_t size, std::uint64_t first_seq = 1) {
+  auto inputs = json::JSON::array();
+  for (std::size_t i = 0; i < size; i++) {
+    inputs.push_back(json::JSON({
+      {"type", "update"},
+      {"seq", first_seq + i},
+      {"direction", 4u},
+      {"angle", 1.5},
+    }, false, json::JSON::value_t::object));
+  }
+  return json::JSON({
+    {"type", "batch"},
+    {"inputs", std::move(inputs)},
+  }, false, json::JSON::value_t::object).dump();
+}
+
+}  // namespace
+
+TEST(JsonVerifyTest, NotValidJSON) {
+  // Arrange
+  std::string package = "{\"type\": ";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_FALSE(is_valid);
+  EXPECT_EQ("error", msg["type"]);
+}
+
+TEST(JsonVerifyTest, ValidUpdate) {
+  // Arrange
+  std::string package = R"({"type": "update", "direction": 4, "angle": 1.5})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_TRUE(is_valid);
+  EXPECT_EQ("update", msg["type"]);
+}
+
+TEST(JsonVerifyTest, UpdateWithAdditionalFieldIsNotValid) {
+  // Arrange
+  std::string package = R"({"type": "update", "direction": 4, "angle": 1.5, "seq": 1})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_FALSE(is_valid);
+}
+
+TEST(JsonVerifyTest, JoinWithToken) {
+  // Arrange
+  std::string with_token = R"({"type": "join", "game": "g", "nick": "n", "token": "abc"})";
+  std::string not_string = R"({"type": "join", "game": "g", "nick": "n", "token": 1})";
+
+  // Act
+
+  // Assert
+  EXPECT_TRUE(json::Verify(with_token).first);
+  EXPECT_FALSE(json::Verify(not_string).first);
+}
+
+TEST(JsonVerifyTest, ValidChat) {
+  // Arrange
+  std::string package = R"({"type": "chat", "channel": "team", "message": "gg"})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_TRUE(is_valid);
+}
+
+TEST(JsonVerifyTest, ChatWithUnknownChannelIsNotValid) {
+  // Arrange
+  std::string package = R"({"type": "chat", "channel": "enemy", "message": "gg"})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_FALSE(is_valid);
+}
+
+TEST(JsonVerifyTest, ValidBatch) {
+  // Arrange
+  auto package = MakeBatch(json::kMaxBatchSize);
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  ASSERT_TRUE(is_valid);
+  EXPECT_EQ(json::kMaxBatchSize, msg["inputs"].size());
+}
+
+TEST(JsonVerifyTest, EmptyOrTooLargeBatchIsNotValid) {
+  // Arrange
+  auto empty = MakeBatch(0);
+  auto too_large = MakeBatch(json::kMaxBatchSize + 1);
+
+  // Act
+
+  // Assert
+  EXPECT_FALSE(json::Verify(empty).first);
+  EXPECT_FALSE(json::Verify(too_large).first);
+}
+
+TEST(JsonVerifyTest, BatchWithNotIncreasingSequenceIsNotValid) {
+  // Arrange
+  std::string package = R"({"type": "batch", "inputs": [
+    {"type": "update", "seq": 2, "direction": 4, "angle": 1.5},
+    {"type": "update", "seq": 2, "direction": 4, "angle": 1.5}
+  ]})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_FALSE(is_valid);
+}
+
+TEST(JsonVerifyTest, BatchWithNotValidInputIsNotValid) {
+  // Arrange
+  std::string missing_seq = R"({"type": "batch", "inputs": [
+    {"type": "update", "direction": 4, "angle": 1.5}
+  ]})";
+  std::string not_update = R"({"type": "batch", "inputs": [
+    {"type": "leave", "seq": 1}
+  ]})";
+  std::string not_object = R"({"type": "batch", "inputs": [1, 2, 3]})";
+
+  // Act
+
+  // Assert
+  EXPECT_FALSE(json::Verify(missing_seq).first);
+  EXPECT_FALSE(json::Verify(not_update).first);
+  EXPECT_FALSE(json::Verify(not_object).first);
+}
+
+TEST(JsonVerifyTest, PaddedPackageIsParsedLikeNotPadded) {
+  // Arrange
+  std::string package = MakeBatch(3);
+  std::string padded;
+  padded.reserve(package.size() + json::kPackagePadding);
+  padded = package;
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+  auto [is_padded_valid, padded_msg] = json::Verify(padded);
+
+  // Assert
+  EXPECT_TRUE(is_valid);
+  EXPECT_TRUE(is_padded_valid);
+  EXPECT_EQ(msg, padded_msg);
+  EXPECT_EQ(json::JSON::parse(package), padded_msg);
+}
+
+TEST(JsonVerifyTest, NumbersAreTypedLikeInJSON) {
+  // Arrange
+  std::string negative_zero = R"({"type": "update", "direction": -0, "angle": 1.5})";
+  std::string integer_angle = R"({"type": "update", "direction": 4, "angle": 1})";
+  std::string float_direction = R"({"type": "update", "direction": 4.0, "angle": 1.5})";
+
+  // Act
+
+  // Assert
+  EXPECT_FALSE(json::Verify(negative_zero).first);
+  EXPECT_FALSE(json::Verify(integer_angle).first);
+  EXPECT_FALSE(json::Verify(float_direction).first);
+}
+
+TEST(JsonVerifyTest, LastOfDuplicatedFieldsIsUsed) {
+  // Arrange
+  std::string package = R"({"type": "leave", "type": "update", "direction": 4, "angle": 1.5})";
+
+  // Act
+  auto [is_valid, msg] = json::Verify(package);
+
+  // Assert
+  EXPECT_TRUE(is_valid);
+  EXPECT_EQ("update", msg["type"]);
+}
+
+TEST(JsonPackageTypeTest, TypesOfVerifiedPackagesAreKnown) {
+  // Arrange
+  auto join = json::Verify(R"({"type": "join", "game": "g", "nick": "n"})").second;
+  auto update = json::Verify(R"({"type": "update", "direction": 4, "angle": 1.5})").second;
+  auto batch = json::Verify(MakeBatch(2)).second;
+  auto leave = json::Verify(R"({"type": "leave"})").second;
+  auto chat = json::Verify(R"({"type": "chat", "channel": "all", "message": "m"})").second;
+
+  // Act
+
+  // Assert
+  EXPECT_EQ(json::PackageType::kJoin, json::GetPackageType(join));
+  EXPECT_EQ(json::PackageType::kUpdate, json::GetPackageType(update));
+  EXPECT_EQ(json::PackageType::kBatch, json::GetPackageType(batch));
+  EXPECT_EQ(json::PackageType::kLeave, json::GetPackageType(leave));
+  EXPECT_EQ(json::PackageType::kChat, json::GetPackageType(chat));
+}
+
+TEST(JsonPackageTypeTest, UnknownTypeIsEmpty) {
+  // Arrange
+  auto unknown = json::JSON({{"type", "dance"}}, false, json::JSON::value_t::object);
+  auto not_string = json::JSON({{"type", 1}}, false, json::JSON::value_t::object);
+  auto missing = json::JSON::object();
+
+  // Act
+
+  // Assert
+  EXPECT_FALSE(json::GetPackageType(unknown).has_value());
+  EXPECT_FALSE(json::GetPackageType(not_string).has_value());
+  EXPECT_FALSE(json::GetPackageType(missing).has_value());
+}
@@ -0,0 +1,52 @@
+/**
+ * @file lag_probe_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the LagProbe class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <gtest/gtest.h>
+
+#include <fusion_server/lag_probe.hpp>
+
+using namespace fusion_server;
+using namespace std::chrono_literals;
+
+TEST(LagProbeTest, IdleContextHasNoLag) {
+  // Arrange
+  boost::asio::io_context ioc;
+  LagProbe probe{ioc};
+
+  // Act
+  probe.Start();
+  ioc.run_for(5 * LagProbe::kProbeInterval + 50ms);
+  probe.Stop();
+
+  // Assert
+  EXPECT_LT(probe.GetLag(), 20ms);
+}
+
+TEST(LagProbeTest, BlockedContextHasLag) {
+  // Arrange
+  boost::asio::io_context ioc;
+  LagProbe probe{ioc};
+  boost::asio::steady_timer blocker{ioc};
+  blocker.expires_after(LagProbe::kProbeInterval / 2);
+  blocker.async_wait([](const boost::system::error_code&) {
+    std::this_thread::sleep_for(4 * LagProbe::kProbeInterval);
+  });
+
+  // Act
+  probe.Start();
+  ioc.run_for(6 * LagProbe::kProbeInterval);
+  probe.Stop();
+
+  // Assert
+  EXPECT_GT(probe.GetLag(), 50ms);
+}
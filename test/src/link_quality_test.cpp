@@ -0,0 +1,108 @@
+/**
+ * @file link_quality_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the LinkQuality class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/system/link_quality.hpp>
+
+using namespace fusion_server;
+using namespace std::chrono_literals;
+
+TEST(LinkQualityTest, MeasuresRoundTripTime) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+
+  // Act
+  auto should_ping = link.ShouldPing(now);
+  link.OnPingSent(now);
+  auto should_ping_again = link.ShouldPing(now + 3s);
+  link.OnPong(now + 20ms);
+
+  // Assert
+  EXPECT_TRUE(should_ping);
+  EXPECT_FALSE(should_ping_again);
+  EXPECT_EQ(20ms, link.GetRtt(now + 20ms));
+  EXPECT_FALSE(link.ShouldPing(now + 1s));
+  EXPECT_TRUE(link.ShouldPing(now + 2s));
+}
+
+TEST(LinkQualityTest, UnsolicitedPongIsIgnored) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+
+  // Act
+  link.OnPong(now);
+
+  // Assert
+  EXPECT_EQ(0us, link.GetRtt(now));
+}
+
+TEST(LinkQualityTest, GoodLinkGetsEveryUpdate) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+  link.OnPingSent(now);
+  link.OnPong(now + 30ms);
+  link.OnWriteCompleted(1000, 100us);
+
+  // Act
+  auto divisor = link.GetUpdateDivisor(1000, now + 30ms);
+
+  // Assert
+  EXPECT_EQ(1, divisor);
+  EXPECT_EQ(system::LinkQuality::Detail::kFull, link.GetDetail(1000, now + 30ms));
+}
+
+TEST(LinkQualityTest, HighRoundTripTimeLowersUpdateRate) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+  link.OnPingSent(now);
+  link.OnPong(now + 200ms);
+
+  // Act
+  auto divisor = link.GetUpdateDivisor(0, now + 200ms);
+
+  // Assert
+  EXPECT_EQ(2, divisor);
+}
+
+TEST(LinkQualityTest, StalledClientGetsReducedUpdates) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+  link.OnPingSent(now);
+
+  // Act
+  auto divisor = link.GetUpdateDivisor(0, now + 1s);
+
+  // Assert
+  EXPECT_EQ(system::LinkQuality::kMaxUpdateDivisor, divisor);
+  EXPECT_EQ(system::LinkQuality::Detail::kReduced, link.GetDetail(0, now + 1s));
+}
+
+TEST(LinkQualityTest, BacklogLowersUpdateRate) {
+  // Arrange
+  system::LinkQuality link;
+  auto now = system::LinkQuality::Clock::now();
+  // 10 kB/s, so the client drains 500 bytes per drain window.
+  link.OnWriteCompleted(1000, 100ms);
+
+  // Act
+  auto small_backlog = link.GetUpdateDivisor(400, now);
+  auto large_backlog = link.GetUpdateDivisor(600, now);
+
+  // Assert
+  EXPECT_EQ(1, small_backlog);
+  EXPECT_EQ(2, large_backlog);
+}
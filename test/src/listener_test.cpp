@@ -15,27 +15,30 @@
 #include <spdlog/spdlog.h>
 
 #include <fusion_server/listener.hpp>
+#include <fusion_server/server.hpp>
 
 struct ListenerTest : public ::testing::Test {
-  ListenerTest() noexcept : ioc_{nullptr} {}
+  ListenerTest() noexcept : server_{nullptr}, ioc_{nullptr} {}
 
   void SetUp() override {
-    ioc_ = new boost::asio::io_context;
+    server_ = new fusion_server::Server;
+    ioc_ = &server_->GetIOContext();
   }
 
   void TearDown() override {
     ioc_->stop();
-    delete ioc_;
+    delete server_;
   }
 
+  fusion_server::Server *server_;
   boost::asio::io_context *ioc_;
 };
 
 TEST_F(ListenerTest, SetLoggerCheck) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener3 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener3 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto logger = std::make_shared<spdlog::logger>("test_logger");
 
   // Act
@@ -52,9 +55,9 @@ TEST_F(ListenerTest, SetLoggerCheck) {
 
 TEST_F(ListenerTest, BindToValidEndpoint) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener3 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener3 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("127.0.0.1"), 1337};
 
@@ -68,7 +71,7 @@ TEST_F(ListenerTest, BindToValidEndpoint) {
 
 TEST_F(ListenerTest, BindToNotValidEndpoint) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("8.8.8.8"), 1337};
 
@@ -80,9 +83,9 @@ TEST_F(ListenerTest, BindToNotValidEndpoint) {
 
 TEST_F(ListenerTest, GetEndpoint) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener3 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener3 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint1 = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("127.0.0.1"), 2121};
   auto endpoint2 = boost::asio::ip::tcp::endpoint{
@@ -103,7 +106,7 @@ TEST_F(ListenerTest, GetEndpoint) {
 
 TEST_F(ListenerTest, BindSuccessfully) {
   // Arrange
-  auto listener = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("127.0.0.1"), 2121};
 
@@ -116,8 +119,8 @@ TEST_F(ListenerTest, BindSuccessfully) {
 
 TEST_F(ListenerTest, BindUnsuccessfullyAddressInUse) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("127.0.0.1"), 21};
 
@@ -131,8 +134,8 @@ TEST_F(ListenerTest, BindUnsuccessfullyAddressInUse) {
 
 TEST_F(ListenerTest, AcceptConnection) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto socket = boost::asio::ip::tcp::socket{*ioc_};
 
   // Act
@@ -148,8 +151,8 @@ TEST_F(ListenerTest, AcceptConnection) {
 
 TEST_F(ListenerTest, AcceptConnectionFromBeforeRun) {
   // Arrange
-  auto listener1 = std::make_shared<fusion_server::Listener>(*ioc_);
-  auto listener2 = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener1 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
+  auto listener2 = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto socket = boost::asio::ip::tcp::socket{*ioc_};
 
   // Act
@@ -165,7 +168,7 @@ TEST_F(ListenerTest, AcceptConnectionFromBeforeRun) {
 
 TEST_F(ListenerTest, AcceptMaxConnections) {
   // Arrange
-  auto listener = std::make_shared<fusion_server::Listener>(*ioc_);
+  auto listener = std::make_shared<fusion_server::Listener>(server_->GetShard(0));
   auto endpoint = boost::asio::ip::tcp::endpoint{
     boost::asio::ip::make_address_v4("127.0.0.1"), 9001
   };
@@ -0,0 +1,83 @@
+/**
+ * @file map_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the Map class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/ui/map.hpp>
+
+using namespace fusion_server;
+
+TEST(MapTest, RaggedRowsAreRejected) {
+  // Arrange
+  std::vector<std::string> rows{"...", ".."};
+
+  // Act
+  auto map = ui::Map::Parse(rows);
+
+  // Assert
+  EXPECT_EQ(nullptr, map);
+}
+
+TEST(MapTest, PathAroundWallHasOnlyTurningPoints) {
+  // Arrange
+  auto map = ui::Map::Parse({
+    ".....",
+    ".###.",
+    ".....",
+  });
+  std::vector<ui::Point> path;
+
+  // Act
+  auto status = map->FindPath({0, 1}, {4, 1}, 100, path);
+
+  // Assert
+  ASSERT_EQ(ui::Map::PathStatus::kFound, status);
+  ASSERT_EQ(4, path.size());
+  EXPECT_EQ((ui::Point{0, 1}), path.front());
+  EXPECT_EQ((ui::Point{4, 1}), path.back());
+}
+
+TEST(MapTest, DiagonalStepDoesNotCutCorner) {
+  // Arrange
+  auto map = ui::Map::Parse({
+    ".#",
+    "#.",
+  });
+  std::vector<ui::Point> path;
+
+  // Act
+  auto reachable = map->IsReachable({0, 0}, {1, 1});
+  auto status = map->FindPath({0, 0}, {1, 1}, 100, path);
+
+  // Assert
+  EXPECT_FALSE(reachable);
+  EXPECT_EQ(ui::Map::PathStatus::kUnreachable, status);
+  EXPECT_TRUE(path.empty());
+}
+
+TEST(MapTest, QueryStopsWhenBudgetIsSpent) {
+  // Arrange
+  auto map = ui::Map::Parse({
+    "...#...",
+    ".#.#.#.",
+    ".#...#.",
+  });
+  std::vector<ui::Point> path;
+
+  // Act
+  auto over_budget = map->FindPath({0, 0}, {6, 0}, 1, path);
+  auto found = map->FindPath({0, 0}, {6, 0}, 100, path);
+
+  // Assert
+  EXPECT_EQ(ui::Map::PathStatus::kOverBudget, over_budget);
+  EXPECT_EQ(ui::Map::PathStatus::kFound, found);
+  EXPECT_EQ((ui::Point{6, 0}), path.back());
+}
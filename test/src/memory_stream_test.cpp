@@ -0,0 +1,107 @@
+/**
+ * @file memory_stream_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the MemoryStream class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <string>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <gtest/gtest.h>
+
+#include <fusion_server/system/memory_stream.hpp>
+
+using namespace fusion_server::system;
+
+TEST(MemoryStreamTest, BytesWrittenToOneEndAreReadFromTheOther) {
+  // Arrange
+  boost::asio::io_context ioc;
+  auto [first, second] = MemoryStream::MakePair(ioc, ioc);
+  std::string received(5, '\0');
+  boost::system::error_code ec;
+
+  // Act
+  boost::asio::write(first, boost::asio::buffer(std::string{"hello"}));
+  boost::asio::read(second, boost::asio::buffer(received));
+
+  // Assert
+  EXPECT_EQ("hello", received);
+  EXPECT_EQ(first.local_endpoint(ec), second.remote_endpoint());
+}
+
+TEST(MemoryStreamTest, AsyncReadCompletesWhenBytesArrive) {
+  // Arrange
+  boost::asio::io_context ioc;
+  auto [first, second] = MemoryStream::MakePair(ioc, ioc);
+  std::string received(5, '\0');
+  boost::system::error_code result = boost::asio::error::would_block;
+  boost::asio::async_read(second, boost::asio::buffer(received),
+    [&result](const boost::system::error_code& ec, std::size_t) { result = ec; });
+
+  // Act
+  ioc.poll();
+  auto has_completed_early = result != boost::asio::error::would_block;
+  std::thread writer{[&first = first] {
+    boost::asio::write(first, boost::asio::buffer(std::string{"hello"}));
+  }};
+  writer.join();
+  ioc.run();
+
+  // Assert
+  EXPECT_FALSE(has_completed_early);
+  EXPECT_FALSE(result);
+  EXPECT_EQ("hello", received);
+}
+
+TEST(MemoryStreamTest, ClosedEndIsReadAsEndOfStream) {
+  // Arrange
+  boost::asio::io_context ioc;
+  auto [first, second] = MemoryStream::MakePair(ioc, ioc);
+  boost::asio::write(first, boost::asio::buffer(std::string{"bye"}));
+  std::string received(3, '\0');
+  boost::system::error_code write_ec;
+  boost::system::error_code read_ec;
+  char byte = 0;
+
+  // Act
+  first.close();
+  boost::asio::read(second, boost::asio::buffer(received));
+  second.read_some(boost::asio::buffer(&byte, 1), read_ec);
+  second.write_some(boost::asio::buffer(&byte, 1), write_ec);
+
+  // Assert
+  EXPECT_FALSE(first.is_open());
+  EXPECT_EQ("bye", received);
+  EXPECT_EQ(boost::asio::error::eof, read_ec);
+  EXPECT_EQ(boost::asio::error::broken_pipe, write_ec);
+}
+
+TEST(MemoryStreamTest, WebSocketStreamsExchangeMessages) {
+  // Arrange
+  boost::asio::io_context ioc;
+  auto [client_end, server_end] = MemoryStream::MakePair(ioc, ioc);
+  boost::beast::websocket::stream<MemoryStream> client{std::move(client_end)};
+  boost::beast::websocket::stream<MemoryStream> server{std::move(server_end)};
+  boost::beast::flat_buffer buffer;
+
+  // Act
+  std::thread server_thread{[&server] {
+    server.accept();
+    boost::beast::flat_buffer message;
+    server.read(message);
+    server.text(true);
+    server.write(message.data());
+  }};
+  client.handshake("localhost", "/");
+  client.write(boost::asio::buffer(std::string{"ping"}));
+  client.read(buffer);
+  server_thread.join();
+
+  // Assert
+  EXPECT_EQ("ping", boost::beast::buffers_to_string(buffer.data()));
+}
@@ -0,0 +1,80 @@
+/**
+ * @file metrics_segment_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the MetricsSegment
+ * class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/metrics_segment.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+std::string MakePath() {
+  return "/tmp/fusion_metrics_test_" + std::to_string(::getpid());
+}
+
+}  // namespace
+
+TEST(MetricsSegmentTest, PublishedMetricsAreRead) {
+  // Arrange
+  auto path = MakePath();
+  auto writer = MetricsSegment::Create(path);
+  ASSERT_NE(nullptr, writer);
+  auto reader = MetricsSegment::Open(path);
+  ASSERT_NE(nullptr, reader);
+  MetricsSegment::Snapshot published{};
+  published.connections_ = 42;
+  published.number_of_shards_ = 2;
+  published.shards_[1].players_ = 7;
+  published.shards_[1].loop_lag_us_ = 1500;
+  MetricsSegment::Snapshot read{};
+
+  // Act
+  writer->Publish(published);
+  auto is_read = reader->Read(read);
+
+  // Assert
+  EXPECT_TRUE(is_read);
+  EXPECT_EQ(42, read.connections_);
+  EXPECT_EQ(2, read.number_of_shards_);
+  EXPECT_EQ(7, read.shards_[1].players_);
+  EXPECT_EQ(1500, read.shards_[1].loop_lag_us_);
+}
+
+TEST(MetricsSegmentTest, WriterRemovesTheFile) {
+  // Arrange
+  auto path = MakePath();
+  auto writer = MetricsSegment::Create(path);
+  ASSERT_NE(nullptr, writer);
+
+  // Act
+  writer.reset();
+
+  // Assert
+  EXPECT_EQ(nullptr, MetricsSegment::Open(path));
+}
+
+TEST(MetricsSegmentTest, OtherFileIsNotOpened) {
+  // Arrange
+  auto path = MakePath();
+  std::ofstream{path} << std::string(sizeof(MetricsSegment::Snapshot) + 64, 'x');
+
+  // Act
+  auto segment = MetricsSegment::Open(path);
+  ::unlink(path.c_str());
+
+  // Assert
+  EXPECT_EQ(nullptr, segment);
+}
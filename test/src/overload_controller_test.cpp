@@ -0,0 +1,84 @@
+/**
+ * @file overload_controller_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the OverloadController
+ * class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/overload_controller.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+void Report(OverloadController& controller, double pressure, std::size_t intervals) {
+  for (std::size_t i = 0; i < intervals; i++) {
+    controller.Update(pressure);
+  }
+}
+
+}  // namespace
+
+TEST(OverloadControllerTest, NormalByDefault) {
+  // Arrange
+  OverloadController controller;
+
+  // Act
+
+  // Assert
+  EXPECT_EQ(OverloadController::Level::kNormal, controller.GetLevel());
+  EXPECT_EQ(1, controller.GetUpdateDivisor());
+  EXPECT_EQ(1, controller.GetIdleTickDivisor());
+}
+
+TEST(OverloadControllerTest, SingleSpikeDoesNotDegrade) {
+  // Arrange
+  OverloadController controller;
+
+  // Act
+  Report(controller, 2.0, OverloadController::kEscalationIntervals - 1);
+  Report(controller, 0.1, 1);
+  Report(controller, 2.0, OverloadController::kEscalationIntervals - 1);
+
+  // Assert
+  EXPECT_EQ(OverloadController::Level::kNormal, controller.GetLevel());
+}
+
+TEST(OverloadControllerTest, SustainedPressureDegradesStepByStep) {
+  // Arrange
+  OverloadController controller;
+
+  // Act
+  Report(controller, 1.0, OverloadController::kEscalationIntervals);
+  auto first = controller.GetLevel();
+  Report(controller, 1.0, OverloadController::kEscalationIntervals);
+  auto second = controller.GetLevel();
+  Report(controller, 1.0, 10 * OverloadController::kEscalationIntervals);
+
+  // Assert
+  EXPECT_EQ(OverloadController::Level::kReducedUpdates, first);
+  EXPECT_EQ(OverloadController::Level::kReducedIdleTicks, second);
+  EXPECT_EQ(OverloadController::Level::kMinimalIdleTicks, controller.GetLevel());
+  EXPECT_EQ(OverloadController::kReducedUpdateDivisor, controller.GetUpdateDivisor());
+  EXPECT_EQ(4, controller.GetIdleTickDivisor());
+}
+
+TEST(OverloadControllerTest, RecoversWhenLoadDrops) {
+  // Arrange
+  OverloadController controller;
+  Report(controller, 1.0, 2 * OverloadController::kEscalationIntervals);
+
+  // Act
+  Report(controller, 0.6, 10 * OverloadController::kRecoveryIntervals);
+  auto between_thresholds = controller.GetLevel();
+  Report(controller, 0.1, 2 * OverloadController::kRecoveryIntervals);
+
+  // Assert
+  EXPECT_EQ(OverloadController::Level::kReducedIdleTicks, between_thresholds);
+  EXPECT_EQ(OverloadController::Level::kNormal, controller.GetLevel());
+}
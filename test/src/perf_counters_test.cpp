@@ -0,0 +1,69 @@
+/**
+ * @file perf_counters_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the PerfCounters class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/perf_counters.hpp>
+
+using namespace fusion_server;
+
+TEST(PerfCountersTest, DisabledScopeDoesNothing) {
+  // Arrange
+  auto& counters = PerfCounters::Get();
+  counters.Disable();
+  auto before = counters.GetTotals(PerfCounters::Subsystem::kVerify);
+
+  // Act
+  {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kVerify};
+  }
+
+  // Assert
+  EXPECT_EQ(before.samples_, counters.GetTotals(PerfCounters::Subsystem::kVerify).samples_);
+}
+
+TEST(PerfCountersTest, EnabledScopeAddsSample) {
+  // Arrange
+  auto& counters = PerfCounters::Get();
+  if (!counters.Enable()) {
+    // The counters are not available in this environment. Sampling must stay
+    // disabled then.
+    EXPECT_FALSE(counters.IsEnabled());
+    return;
+  }
+  auto before = counters.GetTotals(PerfCounters::Subsystem::kTick);
+
+  // Act
+  {
+    PerfCounters::Scope perf{PerfCounters::Subsystem::kTick};
+    volatile std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < 10000; i++) {
+      sum = sum + i;
+    }
+  }
+  counters.Disable();
+
+  // Assert
+  auto after = counters.GetTotals(PerfCounters::Subsystem::kTick);
+  EXPECT_EQ(before.samples_ + 1, after.samples_);
+  EXPECT_LT(before.events_[static_cast<std::size_t>(PerfCounters::Event::kInstructions)],
+    after.events_[static_cast<std::size_t>(PerfCounters::Event::kInstructions)]);
+}
+
+TEST(PerfCountersTest, NamesAreDistinct) {
+  // Arrange
+
+  // Act
+
+  // Assert
+  EXPECT_STREQ("tick", PerfCounters::GetName(PerfCounters::Subsystem::kTick));
+  EXPECT_STREQ("fan_out", PerfCounters::GetName(PerfCounters::Subsystem::kFanOut));
+  EXPECT_STREQ("cycles", PerfCounters::GetName(PerfCounters::Event::kCycles));
+  EXPECT_STREQ("branch_misses", PerfCounters::GetName(PerfCounters::Event::kBranchMisses));
+}
@@ -0,0 +1,104 @@
+/**
+ * @file placement_policy_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the PlacementPolicy
+ * class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/placement_policy.hpp>
+#include <fusion_server/server.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+std::vector<std::unique_ptr<Shard>> MakeShards(Server& server, std::size_t number) {
+  std::vector<std::unique_ptr<Shard>> shards;
+  for (std::size_t i = 0; i < number; i++) {
+    shards.push_back(std::make_unique<Shard>(i, server));
+  }
+  return shards;
+}
+
+}  // namespace
+
+TEST(PlacementPolicyTest, SelectsShardWithFewestPlayers) {
+  // Arrange
+  PlacementPolicy policy;
+  Server server;
+  auto shards = MakeShards(server, 3);
+  shards[0]->GetMetrics().players_ = 10;
+  shards[1]->GetMetrics().players_ = 2;
+  shards[2]->GetMetrics().players_ = 6;
+
+  // Act
+  auto& shard = policy.SelectShard(shards, *shards[0]);
+
+  // Assert
+  EXPECT_EQ(1, shard.GetId());
+}
+
+TEST(PlacementPolicyTest, PrefersCreatorShardOnTie) {
+  // Arrange
+  PlacementPolicy policy;
+  Server server;
+  auto shards = MakeShards(server, 3);
+
+  // Act
+  auto& shard = policy.SelectShard(shards, *shards[2]);
+
+  // Assert
+  EXPECT_EQ(2, shard.GetId());
+}
+
+TEST(PlacementPolicyTest, SlowTicksOutweighPlayers) {
+  // Arrange
+  PlacementPolicy policy;
+  Server server;
+  auto shards = MakeShards(server, 2);
+  shards[0]->GetMetrics().players_ = 4;
+  shards[1]->GetMetrics().players_ = 2;
+  shards[1]->GetMetrics().tick_time_us_ =
+    std::chrono::microseconds{Shard::kTickInterval}.count() / 2;
+
+  // Act
+  auto& shard = policy.SelectShard(shards, *shards[1]);
+
+  // Assert
+  EXPECT_EQ(0, shard.GetId());
+}
+
+TEST(PlacementPolicyTest, ConfigureRejectsNegativeWeights) {
+  // Arrange
+  PlacementPolicy policy;
+  auto config = json::JSON::parse(R"({"players": 2.0, "queued_packages": -1})");
+
+  // Act
+  auto result = policy.Configure(config);
+
+  // Assert
+  EXPECT_FALSE(result);
+  EXPECT_DOUBLE_EQ(1.0, policy.GetWeights().players_);
+}
+
+TEST(PlacementPolicyTest, ConfigureKeepsMissingWeights) {
+  // Arrange
+  PlacementPolicy policy;
+  auto config = json::JSON::parse(R"({"queued_packages": 1})");
+
+  // Act
+  auto result = policy.Configure(config);
+
+  // Assert
+  ASSERT_TRUE(result);
+  EXPECT_DOUBLE_EQ(1.0, policy.GetWeights().players_);
+  EXPECT_DOUBLE_EQ(1.0, policy.GetWeights().queued_packages_);
+}
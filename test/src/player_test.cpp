@@ -97,6 +97,23 @@ TEST(PlayerTest, SetAngle) {
   EXPECT_EQ(3.14, json["angle"]);
 }
 
+TEST(PlayerTest, AdvanceInputSeqRejectsOldInputs) {
+  // Arrange
+  ui::Player player{0, 0, "", 0.0, {}, 0.0, {}};
+
+  // Act
+  auto first = player.AdvanceInputSeq(41);
+  auto replayed = player.AdvanceInputSeq(41);
+  auto reordered = player.AdvanceInputSeq(40);
+  auto next = player.AdvanceInputSeq(42);
+
+  // Assert
+  EXPECT_TRUE(first);
+  EXPECT_FALSE(replayed);
+  EXPECT_FALSE(reordered);
+  EXPECT_TRUE(next);
+}
+
 TEST(PlayerTest, GetId) {
   // Arrange
   ui::Player player1{0, 0, "", 0.0, {}, 0.0, {}};
@@ -119,4 +136,31 @@ TEST(PlayerTest, GetIdTheSameAsSerialise) {
   // Assert
   EXPECT_EQ(1337, player.GetId());
   EXPECT_EQ(1337, json["player_id"]);
-}
\ No newline at end of file
+}
+TEST(PlayerTest, DeserializeRestoresSerializedPlayer) {
+  // Arrange
+  ui::Player player{7, 2, "nick", 42.5, {-3, 5}, 1.25, {1, 2, 3}};
+  ui::Player restored;
+
+  // Act
+  auto result = restored.Deserialize(player.Serialize());
+
+  // Assert
+  ASSERT_TRUE(result);
+  EXPECT_EQ(player.Serialize(), restored.Serialize());
+}
+
+TEST(PlayerTest, DeserializeRejectsIncompleteObject) {
+  // Arrange
+  ui::Player player{7, 2, "nick", 42.5, {-3, 5}, 1.25, {1, 2, 3}};
+  auto json = player.Serialize();
+  json.erase("health");
+  ui::Player restored{1, 1, "other", 0.0, {}, 0.0, {}};
+
+  // Act
+  auto result = restored.Deserialize(json);
+
+  // Assert
+  EXPECT_FALSE(result);
+  EXPECT_EQ(1, restored.GetId());
+}
@@ -0,0 +1,72 @@
+/**
+ * @file profiler_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the Profiler class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/profiler.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+void BurnCPU(std::chrono::milliseconds duration) {
+  volatile double sink = 0.0;
+  auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+    for (int i = 0; i < 10000; i++) {
+      sink = sink + std::sqrt(static_cast<double>(i));
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ProfilerTest, CollectsProfile) {
+  // Arrange
+  auto& profiler = Profiler::Get();
+
+  // Act
+  auto is_started = profiler.Start();
+  BurnCPU(std::chrono::milliseconds{200});
+  auto profile = profiler.Stop();
+
+  // Assert
+  ASSERT_TRUE(is_started);
+  EXPECT_FALSE(profiler.IsRunning());
+  // The profile holds at least the sample types and the string table.
+  EXPECT_NE(std::string::npos, profile.find("nanoseconds"));
+  EXPECT_GT(profile.size(), 100);
+}
+
+TEST(ProfilerTest, OnlyOneProfileAtATime) {
+  // Arrange
+  auto& profiler = Profiler::Get();
+  ASSERT_TRUE(profiler.Start());
+
+  // Act
+  auto is_started = profiler.Start();
+  profiler.Stop();
+
+  // Assert
+  EXPECT_FALSE(is_started);
+}
+
+TEST(ProfilerTest, StopWithoutStartReturnsNothing) {
+  // Arrange
+  auto& profiler = Profiler::Get();
+
+  // Act
+  auto profile = profiler.Stop();
+
+  // Assert
+  EXPECT_TRUE(profile.empty());
+}
@@ -0,0 +1,207 @@
+/**
+ * @file server_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the Server class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <gtest/gtest.h>
+
+#include <fusion_server/game.hpp>
+#include <fusion_server/http_session.hpp>
+#include <fusion_server/json.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/shard.hpp>
+#include <fusion_server/system/memory_stream.hpp>
+#include <fusion_server/websocket_session.hpp>
+
+using namespace fusion_server;
+
+namespace {
+
+/**
+ * This function creates a WebSocket session on the first shard of a server.
+ *
+ * @param[in] server
+ *   The server.
+ *
+ * @param[in] client_ioc
+ *   The I/O context of the client's end of the stream.
+ *
+ * @return
+ *   The new session is returned.
+ */
+std::shared_ptr<WebSocketSession> MakeSession(Server& server,
+    boost::asio::io_context& client_ioc) {
+  auto [server_stream, client_stream] = system::MemoryStream::MakePair(
+    server.GetIOContext(), client_ioc);
+  return std::make_shared<BasicWebSocketSession<system::MemoryStream>>(
+    std::move(server_stream), server.GetShard(0));
+}
+
+/**
+ * This function waits until the given condition is met.
+ *
+ * @param[in] condition
+ *   The condition.
+ *
+ * @return
+ *   An indication whether or not the condition has been met within five
+ *   seconds is returned.
+ */
+bool WaitFor(const std::function<bool()>& condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(ServerTest, SessionIsRegisteredOnItsShard) {
+  // Arrange
+  Server server;
+  boost::asio::io_context client_ioc;
+
+  // Act
+  auto session = MakeSession(server, client_ioc);
+  auto registered = server.GetShard(0).GetNumberOfSessions();
+  session.reset();
+
+  // Assert
+  EXPECT_EQ(1, registered);
+  EXPECT_EQ(0, server.GetShard(0).GetNumberOfSessions());
+}
+
+TEST(ServerTest, ServersInOneProcessAreIndependent) {
+  // Arrange
+  Server first;
+  Server second;
+  boost::asio::io_context client_ioc;
+
+  // Act
+  auto session = MakeSession(first, client_ioc);
+
+  // Assert
+  EXPECT_EQ(&first, &first.GetShard(0).GetServer());
+  EXPECT_EQ(&second, &second.GetShard(0).GetServer());
+  EXPECT_EQ(1, first.GetShard(0).GetNumberOfSessions());
+  EXPECT_EQ(0, second.GetShard(0).GetNumberOfSessions());
+}
+
+TEST(ServerTest, JoinAndLeaveChangeTheSessionState) {
+  // Arrange
+  Server server;
+  boost::asio::io_context client_ioc;
+  auto session = MakeSession(server, client_ioc);
+  auto join = json::Verify(R"({"type": "join", "game": "g", "nick": "n"})").second;
+  auto leave = json::Verify(R"({"type": "leave"})").second;
+
+  // Act
+  auto initial = session->GetState();
+  session->Dispatch(json::PackageType::kJoin, join);
+  auto joined = session->GetState();
+  auto* game = session->GetGame();
+  session->Dispatch(json::PackageType::kLeave, leave);
+
+  // Assert
+  EXPECT_EQ(WebSocketSession::State::kUnjoined, initial);
+  EXPECT_EQ(WebSocketSession::State::kInGame, joined);
+  EXPECT_NE(nullptr, game);
+  EXPECT_EQ(WebSocketSession::State::kUnjoined, session->GetState());
+  EXPECT_EQ(nullptr, session->GetGame());
+}
+
+TEST(ServerTest, LastLeavingPlayerRemovesTheGame) {
+  // Arrange
+  Server server;
+  boost::asio::io_context client_ioc;
+  auto first = MakeSession(server, client_ioc);
+  auto second = MakeSession(server, client_ioc);
+  auto join = json::Verify(R"({"type": "join", "game": "g", "nick": "n"})").second;
+  auto leave = json::Verify(R"({"type": "leave"})").second;
+  first->Dispatch(json::PackageType::kJoin, join);
+  second->Dispatch(json::PackageType::kJoin, join);
+
+  // Act
+  first->Dispatch(json::PackageType::kLeave, leave);
+  auto games_after_first = server.GetShard(0).GetNumberOfGames();
+  second->Dispatch(json::PackageType::kLeave, leave);
+
+  // Assert
+  EXPECT_EQ(1, games_after_first);
+  EXPECT_EQ(0, server.GetShard(0).GetNumberOfGames());
+  EXPECT_EQ(2, server.GetShard(0).GetNumberOfSessions());
+}
+
+TEST(ServerTest, IdleSessionFollowsItsMigratedGame) {
+  // Arrange
+  Server server;
+  ASSERT_TRUE(server.Configure(json::JSON::parse(R"({
+    "listener": {"max_queued_connections": 1, "interface": "127.0.0.1", "port": 9002},
+    "number_of_shards": 2
+  })")));
+  std::thread shard_threads[2];
+  for (std::size_t i = 0; i < 2; i++) {
+    auto& shard = server.GetShard(i);
+    boost::asio::post(shard.GetIOContext(), [&shard] { shard.StartTicking(); });
+    shard_threads[i] = std::thread{[&shard] { shard.Run(); }};
+  }
+
+  boost::asio::io_context client_ioc;
+  boost::asio::ip::tcp::acceptor acceptor{client_ioc,
+    {boost::asio::ip::make_address_v4("127.0.0.1"), 0}};
+  boost::beast::websocket::stream<boost::asio::ip::tcp::socket> client{client_ioc};
+  client.next_layer().connect(acceptor.local_endpoint());
+  boost::asio::ip::tcp::socket socket{server.GetShard(0).GetIOContext()};
+  acceptor.accept(socket);
+  std::make_shared<HTTPSession>(std::move(socket), server.GetShard(0))->Run();
+
+  client.handshake("127.0.0.1", "/");
+  client.write(boost::asio::buffer(std::string{R"({"type": "join", "game": "g", "nick": "n"})"}));
+  boost::beast::flat_buffer response;
+  client.read(response);
+  auto source = server.GetShard(0).GetNumberOfGames() == 1 ? 0 : 1;
+  auto target = 1 - source;
+
+  // Act
+  auto migrated = server.MigrateGame("g", target);
+  auto followed = WaitFor([&server, target] {
+    return server.GetShard(target).GetNumberOfSessions() == 1;
+  });
+  auto remaining = server.GetShard(source).GetNumberOfSessions();
+  client.write(boost::asio::buffer(std::string{R"({"type": "leave"})"}));
+  client.write(boost::asio::buffer(std::string{R"({"type": "join", "game": "h", "nick": "n"})"}));
+  auto rejoined = false;
+  for (auto i = 0; i < 100 && !rejoined; i++) {
+    response.consume(response.size());
+    client.read(response);
+    rejoined = boost::beast::buffers_to_string(response.data()).find("join-result") !=
+      std::string::npos;
+  }
+
+  // Assert
+  EXPECT_TRUE(migrated);
+  EXPECT_TRUE(followed);
+  EXPECT_EQ(0, remaining);
+  EXPECT_TRUE(rejoined);
+
+  server.Shutdown();
+  for (auto& thread : shard_threads) {
+    thread.join();
+  }
+}
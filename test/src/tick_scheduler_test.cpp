@@ -0,0 +1,96 @@
+/**
+ * @file tick_scheduler_test.cpp
+ *
+ * This module is a part of Fusion Server project.
+ * It contains the implementation of the unit tests for the TickScheduler
+ * class.
+ *
+ * Copyright 2019 Kamil Rusin
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <fusion_server/game.hpp>
+#include <fusion_server/server.hpp>
+#include <fusion_server/shard.hpp>
+#include <fusion_server/tick_scheduler.hpp>
+
+using namespace fusion_server;
+
+TEST(TickSchedulerTest, GamesAreSpreadAcrossSlots) {
+  // Arrange
+  Server server;
+  auto& shard = server.GetShard(0);
+  TickScheduler scheduler;
+
+  // Act
+  for (std::size_t i = 0; i < 3 * TickScheduler::kNumberOfSlots + 1; i++) {
+    scheduler.Add(std::make_shared<Game>(shard));
+  }
+
+  // Assert
+  EXPECT_EQ(3 * TickScheduler::kNumberOfSlots + 1, scheduler.GetNumberOfGames());
+  EXPECT_EQ(4, scheduler.GetSlotSize(0));
+  for (std::size_t slot = 1; slot < TickScheduler::kNumberOfSlots; slot++) {
+    EXPECT_EQ(3, scheduler.GetSlotSize(slot));
+  }
+}
+
+TEST(TickSchedulerTest, NewGameFillsFreedSlot) {
+  // Arrange
+  Server server;
+  auto& shard = server.GetShard(0);
+  TickScheduler scheduler;
+  std::vector<std::shared_ptr<Game>> games;
+  for (std::size_t i = 0; i < TickScheduler::kNumberOfSlots; i++) {
+    games.push_back(std::make_shared<Game>(shard));
+    scheduler.Add(games.back());
+  }
+
+  // Act
+  auto removed = scheduler.Remove(games[2].get());
+  auto slot = scheduler.Add(std::make_shared<Game>(shard));
+
+  // Assert
+  EXPECT_TRUE(removed);
+  EXPECT_EQ(2, slot);
+}
+
+TEST(TickSchedulerTest, RemovingUnknownGameFails) {
+  // Arrange
+  Server server;
+  auto& shard = server.GetShard(0);
+  TickScheduler scheduler;
+  auto game = std::make_shared<Game>(shard);
+
+  // Act
+  auto removed = scheduler.Remove(game.get());
+
+  // Assert
+  EXPECT_FALSE(removed);
+  EXPECT_EQ(0, scheduler.GetNumberOfGames());
+}
+
+TEST(TickSchedulerTest, GetSlotAppendsGamesOfSlot) {
+  // Arrange
+  Server server;
+  auto& shard = server.GetShard(0);
+  TickScheduler scheduler;
+  auto first = std::make_shared<Game>(shard);
+  auto second = std::make_shared<Game>(shard);
+  scheduler.Add(first);
+  scheduler.Add(second);
+  std::vector<std::shared_ptr<Game>> games;
+
+  // Act
+  scheduler.GetSlot(0, games);
+  scheduler.GetSlot(1, games);
+
+  // Assert
+  ASSERT_EQ(2, games.size());
+  EXPECT_EQ(first, games[0]);
+  EXPECT_EQ(second, games[1]);
+}